@@ -0,0 +1,77 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+extern "C" {
+#include <launchdarkly/api.h>
+
+#include "arena.h"
+}
+
+// The temporaries of one evaluation context with `state.range(0)` memos:
+// a node and a copy of the key for each, all released together.
+static const size_t memoSize = 72;
+
+static void
+BM_ScratchMalloc(benchmark::State &state)
+{
+    const int   count = state.range(0);
+    std::string keys[64];
+    void *      allocations[128];
+    int         i;
+
+    for (i = 0; i < count; i++) {
+        keys[i] = "segment-key-" + std::to_string(i);
+    }
+
+    for (auto _ : state) {
+        for (i = 0; i < count; i++) {
+            allocations[i * 2]     = LDAlloc(memoSize);
+            allocations[i * 2 + 1] = LDStrDup(keys[i].c_str());
+        }
+
+        benchmark::DoNotOptimize(allocations);
+
+        for (i = 0; i < count * 2; i++) {
+            LDFree(allocations[i]);
+        }
+    }
+}
+BENCHMARK(BM_ScratchMalloc)
+    ->Arg(4)
+    ->Arg(64)
+    ->Threads(1)
+    ->Threads(32)
+    ->UseRealTime();
+
+static void
+BM_ScratchArena(benchmark::State &state)
+{
+    const int          count = state.range(0);
+    std::string        keys[64];
+    union LDArenaAlign buffer[1024 / sizeof(union LDArenaAlign)];
+    int                i;
+
+    for (i = 0; i < count; i++) {
+        keys[i] = "segment-key-" + std::to_string(i);
+    }
+
+    for (auto _ : state) {
+        struct LDArena arena;
+
+        LDi_arenaInit(&arena, buffer, sizeof(buffer));
+
+        for (i = 0; i < count; i++) {
+            benchmark::DoNotOptimize(LDi_arenaAlloc(&arena, memoSize));
+            benchmark::DoNotOptimize(LDi_arenaStrDup(&arena, keys[i].c_str()));
+        }
+
+        LDi_arenaDestroy(&arena);
+    }
+}
+BENCHMARK(BM_ScratchArena)
+    ->Arg(4)
+    ->Arg(64)
+    ->Threads(1)
+    ->Threads(32)
+    ->UseRealTime();
@@ -0,0 +1,284 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+extern "C" {
+#include <launchdarkly/api.h>
+#include <launchdarkly/integrations/test_data.h>
+
+#include "client.h"
+#include "config.h"
+#include "store.h"
+
+#include "test-utils/flags.h"
+}
+
+// A client whose store is populated directly, so that no network is needed.
+class BenchmarkClient {
+public:
+    BenchmarkClient(struct LDJSON *const flags) {
+        struct LDConfig *config;
+        struct LDJSON *  sets;
+
+        td     = LDTestDataInit();
+        config = LDConfigNew("key");
+        LDConfigSetSendEvents(config, LDBooleanFalse);
+        LDConfigSetDataSource(config, LDTestDataCreateDataSource(td));
+        client = LDClientInit(config, 1000);
+
+        sets = LDNewObject();
+        LDObjectSetKey(sets, "features", flags);
+        LDObjectSetKey(sets, "segments", LDNewObject());
+        LDStoreInit(client->store, sets);
+    }
+
+    ~BenchmarkClient() {
+        LDClientClose(client);
+        LDTestDataFree(td);
+    }
+
+    struct LDClient *client;
+
+private:
+    struct LDTestData *td;
+};
+
+static struct LDJSON *
+makeTextArray(const std::string &text)
+{
+    struct LDJSON *array = LDNewArray();
+
+    LDArrayPush(array, LDNewText(text.c_str()));
+
+    return array;
+}
+
+static struct LDJSON *
+makeClause(const char *const attribute, const char *const op, struct LDJSON *const values)
+{
+    struct LDJSON *clause = LDNewObject();
+
+    LDObjectSetKey(clause, "attribute", LDNewText(attribute));
+    LDObjectSetKey(clause, "op", LDNewText(op));
+    LDObjectSetKey(clause, "values", values);
+
+    return clause;
+}
+
+// A flag with one target list of `complexity` keys, and `complexity` rules of
+// `complexity` clauses each. Every clause but the last in each rule matches the
+// benchmark user, so evaluation visits every clause before falling through.
+static struct LDJSON *
+makeComplexFlag(const std::string &key, const int complexity, const bool jsonVariations)
+{
+    struct LDJSON *flag, *targets, *target, *values, *rules;
+    int            i, j;
+
+    flag = makeMinimalFlag(key.c_str(), 1, LDBooleanTrue, LDBooleanFalse);
+
+    if (jsonVariations) {
+        for (i = 0; i < 2; i++) {
+            struct LDJSON *variation = LDNewObject();
+
+            LDObjectSetKey(variation, "index", LDNewNumber(i));
+            LDObjectSetKey(variation, "name", LDNewText(("variation-" + std::to_string(i)).c_str()));
+            LDObjectSetKey(variation, "tags", makeTextArray("tag"));
+            addVariation(flag, variation);
+        }
+    } else {
+        addVariation(flag, LDNewBool(LDBooleanFalse));
+        addVariation(flag, LDNewBool(LDBooleanTrue));
+    }
+    setFallthrough(flag, 1);
+
+    if (complexity > 0) {
+        values = LDNewArray();
+        for (i = 0; i < complexity; i++) {
+            LDArrayPush(values, LDNewText(("target-" + std::to_string(i)).c_str()));
+        }
+
+        target = LDNewObject();
+        LDObjectSetKey(target, "values", values);
+        LDObjectSetKey(target, "variation", LDNewNumber(0));
+
+        targets = LDNewArray();
+        LDArrayPush(targets, target);
+        LDObjectSetKey(flag, "targets", targets);
+    }
+
+    rules = LDNewArray();
+    for (i = 0; i < complexity; i++) {
+        struct LDJSON *rule, *clauses;
+
+        clauses = LDNewArray();
+        for (j = 0; j < complexity - 1; j++) {
+            LDArrayPush(clauses, makeClause("email", "endsWith", makeTextArray("@example.com")));
+        }
+        LDArrayPush(clauses, makeClause("country", "in", makeTextArray("nowhere")));
+
+        rule = LDNewObject();
+        LDObjectSetKey(rule, "id", LDNewText(("rule-" + std::to_string(i)).c_str()));
+        LDObjectSetKey(rule, "clauses", clauses);
+        LDObjectSetKey(rule, "variation", LDNewNumber(0));
+        LDArrayPush(rules, rule);
+    }
+    LDObjectSetKey(flag, "rules", rules);
+
+    return flag;
+}
+
+static struct LDUser *
+makeBenchmarkUser()
+{
+    struct LDUser *user = LDUserNew("user");
+
+    LDUserSetEmail(user, "user@example.com");
+    LDUserSetCountry(user, "somewhere");
+
+    return user;
+}
+
+static struct LDJSON *
+makeFlags(const int count, const int complexity, const bool jsonVariations)
+{
+    struct LDJSON *flags = LDNewObject();
+    int            i;
+
+    for (i = 0; i < count; i++) {
+        const std::string key = "flag-" + std::to_string(i);
+
+        LDObjectSetKey(flags, key.c_str(), makeComplexFlag(key, complexity, jsonVariations));
+    }
+
+    return flags;
+}
+
+static void
+BM_BoolVariation(benchmark::State &state)
+{
+    BenchmarkClient benchmarkClient(makeFlags(1, state.range(0), false));
+    struct LDUser * user = makeBenchmarkUser();
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(LDBoolVariation(
+            benchmarkClient.client, user, "flag-0", LDBooleanFalse, NULL));
+    }
+
+    LDUserFree(user);
+}
+BENCHMARK(BM_BoolVariation)->Arg(0)->Arg(1)->Arg(4)->Arg(16)->Arg(64);
+
+static void
+BM_JSONVariation(benchmark::State &state)
+{
+    BenchmarkClient benchmarkClient(makeFlags(1, state.range(0), true));
+    struct LDUser * user     = makeBenchmarkUser();
+    struct LDJSON * fallback = LDNewObject();
+
+    for (auto _ : state) {
+        LDJSONFree(LDJSONVariation(
+            benchmarkClient.client, user, "flag-0", fallback, NULL));
+    }
+
+    LDJSONFree(fallback);
+    LDUserFree(user);
+}
+BENCHMARK(BM_JSONVariation)->Arg(0)->Arg(1)->Arg(4)->Arg(16)->Arg(64);
+
+static void
+BM_AllFlagsState(benchmark::State &state)
+{
+    BenchmarkClient benchmarkClient(makeFlags(state.range(0), 2, false));
+    struct LDUser * user = makeBenchmarkUser();
+
+    for (auto _ : state) {
+        LDAllFlagsStateFree(
+            LDAllFlagsState(benchmarkClient.client, user, LD_ALLFLAGS_DEFAULT));
+    }
+
+    LDUserFree(user);
+}
+BENCHMARK(BM_AllFlagsState)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Unit(benchmark::kMicrosecond);
+
+static void
+BM_AllFlagsStateThreaded(benchmark::State &state)
+{
+    BenchmarkClient benchmarkClient(makeFlags(state.range(0), 2, false));
+    struct LDUser * user = makeBenchmarkUser();
+
+    LDConfigSetAllFlagsThreads(benchmarkClient.client->config, state.range(1));
+
+    for (auto _ : state) {
+        LDAllFlagsStateFree(
+            LDAllFlagsState(benchmarkClient.client, user, LD_ALLFLAGS_DEFAULT));
+    }
+
+    LDUserFree(user);
+}
+BENCHMARK(BM_AllFlagsStateThreaded)
+    ->Args({10000, 1})
+    ->Args({10000, 2})
+    ->Args({10000, 4})
+    ->Args({10000, 8})
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+// 32 flags for one user, evaluated one call at a time, as a request handler
+// would without the batch API.
+static void
+BM_VariationLoop(benchmark::State &state)
+{
+    BenchmarkClient benchmarkClient(makeFlags(32, 2, true));
+    struct LDUser * user     = makeBenchmarkUser();
+    struct LDJSON * fallback = LDNewObject();
+    int             i;
+
+    for (auto _ : state) {
+        for (i = 0; i < 32; i++) {
+            const std::string key = "flag-" + std::to_string(i);
+
+            LDJSONFree(LDJSONVariation(
+                benchmarkClient.client, user, key.c_str(), fallback, NULL));
+        }
+    }
+
+    LDJSONFree(fallback);
+    LDUserFree(user);
+}
+BENCHMARK(BM_VariationLoop);
+
+static void
+BM_VariationBatch(benchmark::State &state)
+{
+    BenchmarkClient      benchmarkClient(makeFlags(32, 2, true));
+    struct LDUser *      user     = makeBenchmarkUser();
+    struct LDJSON *      fallback = LDNewObject();
+    std::string          keys[32];
+    const char *         keyRefs[32];
+    const struct LDJSON *fallbacks[32];
+    struct LDJSON *      results[32];
+    int                  i;
+
+    for (i = 0; i < 32; i++) {
+        keys[i]      = "flag-" + std::to_string(i);
+        keyRefs[i]   = keys[i].c_str();
+        fallbacks[i] = fallback;
+    }
+
+    for (auto _ : state) {
+        LDVariationBatch(
+            benchmarkClient.client, user, keyRefs, fallbacks, 32, results, NULL);
+
+        for (i = 0; i < 32; i++) {
+            LDJSONFree(results[i]);
+        }
+    }
+
+    LDJSONFree(fallback);
+    LDUserFree(user);
+}
+BENCHMARK(BM_VariationBatch);
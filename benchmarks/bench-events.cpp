@@ -0,0 +1,98 @@
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <launchdarkly/api.h>
+
+#include "config.h"
+#include "event_processor.h"
+#include "lru.h"
+
+#include "test-utils/flags.h"
+}
+
+static struct LDEventProcessor *sharedProcessor;
+static struct LDConfig *        sharedConfig;
+static struct LDJSON *          sharedFlag;
+
+// Every thread records evaluations of the same flag into one event processor,
+// each with its own user, as concurrent variation calls would.
+static void
+BM_ProcessEvaluation(benchmark::State &state)
+{
+    struct LDUser *         user;
+    struct LDJSON *         value, *fallback;
+    struct LDDetails        details;
+    struct EvaluationResult result;
+
+    if (state.thread_index() == 0) {
+        sharedConfig    = LDConfigNew("key");
+        sharedProcessor = LDEventProcessor_Create(sharedConfig);
+        sharedFlag = makeMinimalFlag("flag", 1, LDBooleanTrue, LDBooleanFalse);
+        addVariations1(sharedFlag);
+        setFallthrough(sharedFlag, 0);
+    }
+
+    user     = LDUserNew(("user-" + std::to_string(state.thread_index())).c_str());
+    value    = LDNewText("fall");
+    fallback = LDNewText("default");
+
+    LDDetailsInit(&details);
+    details.reason         = LD_FALLTHROUGH;
+    details.hasVariation   = LDBooleanTrue;
+    details.variationIndex = 0;
+
+    for (auto _ : state) {
+        result.user               = user;
+        result.subEvents          = NULL;
+        result.flagKey            = "flag";
+        result.actualValue        = value;
+        result.fallbackValue      = fallback;
+        result.flag               = sharedFlag;
+        result.details            = &details;
+        result.detailedEvaluation = LDBooleanFalse;
+
+        LDEventProcessor_ProcessEvaluation(sharedProcessor, &result);
+    }
+
+    LDDetailsClear(&details);
+    LDJSONFree(value);
+    LDJSONFree(fallback);
+    LDUserFree(user);
+
+    if (state.thread_index() == 0) {
+        LDEventProcessor_Destroy(sharedProcessor);
+        LDConfigFree(sharedConfig);
+        LDJSONFree(sharedFlag);
+    }
+}
+BENCHMARK(BM_ProcessEvaluation)->ThreadRange(1, 64)->UseRealTime();
+
+// Deduplicates user keys in an LRU of the given capacity, drawn at random from
+// twice as many users, so that about half of the inserts evict.
+static void
+BM_LRUInsert(benchmark::State &state)
+{
+    const unsigned int       capacity = state.range(0);
+    std::vector<std::string> keys;
+    std::mt19937             random;
+    struct LDLRU *           lru;
+    size_t                   i;
+
+    for (i = 0; i < capacity * 2; i++) {
+        keys.push_back("user-" + std::to_string(i));
+    }
+
+    lru = LDLRUInit(capacity);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            LDLRUInsert(lru, keys[random() % keys.size()].c_str()));
+    }
+
+    LDLRUFree(lru);
+}
+BENCHMARK(BM_LRUInsert)->Arg(1000)->Arg(1000 * 1000);
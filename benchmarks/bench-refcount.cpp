@@ -0,0 +1,77 @@
+#include <benchmark/benchmark.h>
+
+extern "C" {
+#include <launchdarkly/api.h>
+#include <launchdarkly/integrations/test_data.h>
+
+#include "ldjsonrc.h"
+}
+
+// Every evaluation retains and releases the flag it fetches from the store, so
+// concurrent evaluations of one flag all contend on the same reference count.
+static struct LDJSONRC *sharedRC;
+
+static void
+BM_RetainReleaseShared(benchmark::State &state)
+{
+    if (state.thread_index() == 0) {
+        sharedRC = LDJSONRCNew(LDNewObject());
+    }
+
+    for (auto _ : state) {
+        LDJSONRCRetain(sharedRC);
+        LDJSONRCRelease(sharedRC);
+    }
+
+    if (state.thread_index() == 0) {
+        LDJSONRCRelease(sharedRC);
+    }
+}
+BENCHMARK(BM_RetainReleaseShared)->ThreadRange(1, 64)->UseRealTime();
+
+static struct LDClient *
+makeClient()
+{
+    struct LDConfig *     config;
+    struct LDTestData *   td;
+    struct LDFlagBuilder *flag;
+    struct LDJSON *       values;
+
+    td   = LDTestDataInit();
+    flag = LDTestDataFlag(td, "flag");
+    LDFlagBuilderBooleanFlag(flag);
+    LDFlagBuilderFallthroughVariationBoolean(flag, LDBooleanFalse);
+
+    values = LDNewArray();
+    LDArrayPush(values, LDNewText("user@example.com"));
+    LDFlagRuleBuilderThenReturnBoolean(
+        LDFlagBuilderIfMatch(flag, "email", values), LDBooleanTrue);
+
+    LDTestDataUpdate(td, flag);
+
+    config = LDConfigNew("key");
+    LDConfigSetSendEvents(config, LDBooleanFalse);
+    LDConfigSetDataSource(config, LDTestDataCreateDataSource(td));
+
+    /* The client and test data live for the whole benchmark run. */
+    return LDClientInit(config, 1000);
+}
+
+// All threads evaluate the same flag through one client.
+static void
+BM_BoolVariationSameFlag(benchmark::State &state)
+{
+    static struct LDClient *const client = makeClient();
+    struct LDUser *user;
+
+    user = LDUserNew("user");
+    LDUserSetEmail(user, "user@example.com");
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            LDBoolVariation(client, user, "flag", LDBooleanFalse, NULL));
+    }
+
+    LDUserFree(user);
+}
+BENCHMARK(BM_BoolVariationSameFlag)->ThreadRange(1, 64)->UseRealTime();
@@ -0,0 +1,66 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+extern "C" {
+#include "sse.h"
+}
+
+static LDBoolean
+countDispatch(
+    const char *const name, const char *const body, void *const context)
+{
+    benchmark::DoNotOptimize(body);
+
+    (*(size_t *)context)++;
+
+    return LDBooleanTrue;
+}
+
+// A put of about 10 MB, split over the given number of data lines, as curl
+// would deliver it in 16 KB chunks.
+static void
+BM_SSEProcessLargePut(benchmark::State &state)
+{
+    const size_t totalSize = 10 * 1024 * 1024, chunkSize = 16 * 1024;
+    const size_t lineSize = totalSize / state.range(0);
+    std::string  event, line;
+    size_t       i, dispatched;
+
+    line = "data: " + std::string(lineSize, 'x') + "\n";
+    event = "event: put\n";
+
+    for (i = 0; i < (size_t)state.range(0); i++) {
+        event += line;
+    }
+
+    event += "\n";
+
+    dispatched = 0;
+
+    for (auto _ : state) {
+        struct LDSSEParser parser;
+
+        LDSSEParserInitialize(&parser, countDispatch, &dispatched);
+
+        for (i = 0; i < event.size(); i += chunkSize) {
+            LDSSEParserProcess(
+                &parser,
+                event.data() + i,
+                event.size() - i < chunkSize ? event.size() - i : chunkSize);
+        }
+
+        LDSSEParserDestroy(&parser);
+    }
+
+    if (dispatched != (size_t)state.iterations()) {
+        state.SkipWithError("event was not dispatched");
+    }
+
+    state.SetBytesProcessed(state.iterations() * event.size());
+}
+BENCHMARK(BM_SSEProcessLargePut)
+    ->Arg(1)
+    ->Arg(1024)
+    ->Arg(64 * 1024)
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,275 @@
+#include <benchmark/benchmark.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+
+extern "C" {
+#include <string.h>
+
+#include <launchdarkly/api.h>
+#include <launchdarkly/store.h>
+
+#include "config.h"
+#include "store.h"
+
+#include "test-utils/flags.h"
+}
+
+// An in-process persistent store backend, so that the caching wrapper can be
+// measured without Redis. Deleted items are stored with an empty buffer.
+struct MapBackendItem {
+    std::string  serialized;
+    unsigned int version;
+};
+
+struct MapBackend {
+    std::mutex lock;
+    bool       initialized = false;
+    std::map<std::string, std::map<std::string, MapBackendItem>> kinds;
+};
+
+static void
+copyItem(const MapBackendItem &source, struct LDStoreCollectionItem *const destination)
+{
+    destination->version = source.version;
+
+    if (source.serialized.empty()) {
+        destination->buffer     = NULL;
+        destination->bufferSize = 0;
+    } else {
+        destination->buffer     = LDStrDup(source.serialized.c_str());
+        destination->bufferSize = source.serialized.size();
+    }
+}
+
+static LDBoolean
+mapBackendInit(
+    void *const                          context,
+    const struct LDStoreCollectionState *collections,
+    const unsigned int                   collectionCount)
+{
+    MapBackend * backend = static_cast<MapBackend *>(context);
+    unsigned int i, j;
+
+    std::lock_guard<std::mutex> guard(backend->lock);
+
+    backend->kinds.clear();
+
+    for (i = 0; i < collectionCount; i++) {
+        std::map<std::string, MapBackendItem> &items = backend->kinds[collections[i].kind];
+
+        for (j = 0; j < collections[i].itemCount; j++) {
+            const struct LDStoreCollectionStateItem *const item = &collections[i].items[j];
+
+            items[item->key] = MapBackendItem{
+                item->item.buffer
+                    ? std::string(static_cast<const char *>(item->item.buffer), item->item.bufferSize)
+                    : std::string(),
+                item->item.version};
+        }
+    }
+
+    backend->initialized = true;
+
+    return LDBooleanTrue;
+}
+
+static LDBoolean
+mapBackendGet(
+    void *const                         context,
+    const char *const                   kind,
+    const char *const                   featureKey,
+    struct LDStoreCollectionItem *const result)
+{
+    MapBackend *backend = static_cast<MapBackend *>(context);
+
+    std::lock_guard<std::mutex> guard(backend->lock);
+
+    const auto items = backend->kinds.find(kind);
+
+    memset(result, 0, sizeof(struct LDStoreCollectionItem));
+
+    if (items != backend->kinds.end()) {
+        const auto item = items->second.find(featureKey);
+
+        if (item != items->second.end()) {
+            copyItem(item->second, result);
+        }
+    }
+
+    return LDBooleanTrue;
+}
+
+static LDBoolean
+mapBackendAll(
+    void *const                          context,
+    const char *const                    kind,
+    struct LDStoreCollectionItem **const result,
+    unsigned int *const                  resultCount)
+{
+    MapBackend * backend = static_cast<MapBackend *>(context);
+    unsigned int count   = 0;
+
+    std::lock_guard<std::mutex> guard(backend->lock);
+
+    const auto items = backend->kinds.find(kind);
+
+    *result      = NULL;
+    *resultCount = 0;
+
+    if (items == backend->kinds.end() || items->second.empty()) {
+        return LDBooleanTrue;
+    }
+
+    *result = static_cast<struct LDStoreCollectionItem *>(
+        LDAlloc(sizeof(struct LDStoreCollectionItem) * items->second.size()));
+
+    for (const auto &item : items->second) {
+        copyItem(item.second, &(*result)[count++]);
+    }
+
+    *resultCount = count;
+
+    return LDBooleanTrue;
+}
+
+static LDBoolean
+mapBackendUpsert(
+    void *const                               context,
+    const char *const                         kind,
+    const struct LDStoreCollectionItem *const feature,
+    const char *const                         featureKey)
+{
+    MapBackend *backend = static_cast<MapBackend *>(context);
+
+    std::lock_guard<std::mutex> guard(backend->lock);
+
+    std::map<std::string, MapBackendItem> &items    = backend->kinds[kind];
+    const auto                             existing = items.find(featureKey);
+
+    if (existing == items.end() || existing->second.version < feature->version) {
+        items[featureKey] = MapBackendItem{
+            feature->buffer
+                ? std::string(static_cast<const char *>(feature->buffer), feature->bufferSize)
+                : std::string(),
+            feature->version};
+    }
+
+    return LDBooleanTrue;
+}
+
+static LDBoolean
+mapBackendInitialized(void *const context)
+{
+    MapBackend *backend = static_cast<MapBackend *>(context);
+
+    std::lock_guard<std::mutex> guard(backend->lock);
+
+    return backend->initialized ? LDBooleanTrue : LDBooleanFalse;
+}
+
+static void
+mapBackendDestructor(void *const context)
+{
+    delete static_cast<MapBackend *>(context);
+}
+
+static struct LDStoreInterface *
+makeMapBackend()
+{
+    struct LDStoreInterface *handle = static_cast<struct LDStoreInterface *>(
+        LDAlloc(sizeof(struct LDStoreInterface)));
+
+    handle->context     = new MapBackend();
+    handle->init        = mapBackendInit;
+    handle->get         = mapBackendGet;
+    handle->all         = mapBackendAll;
+    handle->upsert      = mapBackendUpsert;
+    handle->initialized = mapBackendInitialized;
+    handle->destructor  = mapBackendDestructor;
+
+    return handle;
+}
+
+// A store holding `count` flags, backed by the map backend when
+// `cacheMilliseconds` is non-negative.
+static struct LDStore *
+makeStore(const int count, const int cacheMilliseconds)
+{
+    struct LDConfig *config;
+    struct LDStore * store;
+    struct LDJSON *  sets, *flags;
+    int              i;
+
+    config = LDConfigNew("");
+
+    if (cacheMilliseconds >= 0) {
+        LDConfigSetFeatureStoreBackend(config, makeMapBackend());
+        LDConfigSetFeatureStoreBackendCacheTTL(config, cacheMilliseconds);
+    }
+
+    store = LDStoreNew(config);
+    config->storeBackend = NULL;
+    LDConfigFree(config);
+
+    flags = LDNewObject();
+    for (i = 0; i < count; i++) {
+        const std::string key  = "flag-" + std::to_string(i);
+        struct LDJSON *   flag = makeMinimalFlag(key.c_str(), 1, LDBooleanTrue, LDBooleanFalse);
+
+        addVariations1(flag);
+        setFallthrough(flag, 0);
+        LDObjectSetKey(flags, key.c_str(), flag);
+    }
+
+    sets = LDNewObject();
+    LDObjectSetKey(sets, "features", flags);
+    LDObjectSetKey(sets, "segments", LDNewObject());
+    LDStoreInit(store, sets);
+
+    return store;
+}
+
+static struct LDStore *sharedStore;
+
+static void
+storeGet(benchmark::State &state, const int cacheMilliseconds)
+{
+    if (state.thread_index() == 0) {
+        sharedStore = makeStore(1000, cacheMilliseconds);
+    }
+
+    for (auto _ : state) {
+        struct LDJSONRC *result;
+
+        LDStoreGet(sharedStore, LD_FLAG, "flag-500", &result);
+        LDJSONRCRelease(result);
+    }
+
+    if (state.thread_index() == 0) {
+        LDStoreDestroy(sharedStore);
+    }
+}
+
+static void
+BM_StoreGetMemory(benchmark::State &state)
+{
+    storeGet(state, -1);
+}
+BENCHMARK(BM_StoreGetMemory)->ThreadRange(1, 16)->UseRealTime();
+
+static void
+BM_StoreGetCachingWrapper(benchmark::State &state)
+{
+    storeGet(state, 30000);
+}
+BENCHMARK(BM_StoreGetCachingWrapper)->ThreadRange(1, 16)->UseRealTime();
+
+// Every read goes through to the backend and deserializes the flag.
+static void
+BM_StoreGetCachingWrapperUncached(benchmark::State &state)
+{
+    storeGet(state, 0);
+}
+BENCHMARK(BM_StoreGetCachingWrapperUncached)->ThreadRange(1, 16)->UseRealTime();
@@ -229,6 +229,258 @@ cJSON_New_Item(const internal_hooks *const hooks)
     return node;
 }
 
+/* Object index: open addressing with linear probing, at most half full. Only
+ * the first of several items with the same name is indexed, as that is the
+ * one a walk would find. */
+typedef struct index_slot
+{
+    size_t hash;
+    cJSON *item;
+} index_slot;
+
+typedef struct cJSON_Index
+{
+    /* The number of slots minus one, the number of slots being a power of 2 */
+    size_t      mask;
+    size_t      count;
+    /* The last item of the object, for appending */
+    cJSON *     last;
+    /* Whether an item went unindexed because an earlier one has its name */
+    cJSON_bool  duplicates;
+    index_slot *slots;
+} cJSON_Index;
+
+static cJSON_bool
+index_wanted(const cJSON *const object, const size_t count)
+{
+#if CJSON_INDEX_THRESHOLD > 0
+    return ((object->type & (0xFF | cJSON_IsReference)) == cJSON_Object) &&
+           (count >= CJSON_INDEX_THRESHOLD);
+#else
+    (void)object;
+    (void)count;
+
+    return false;
+#endif
+}
+
+/* FNV-1a */
+static size_t
+index_hash(const char *name)
+{
+    size_t hash = (size_t)2166136261U;
+
+    for (; *name; name++) {
+        hash = (hash ^ (unsigned char)*name) * (size_t)16777619U;
+    }
+
+    return hash;
+}
+
+static cJSON_Index *
+index_allocate(const size_t slot_count)
+{
+    cJSON_Index *index = (cJSON_Index *)global_hooks.allocate(
+        sizeof(cJSON_Index) + sizeof(index_slot) * slot_count);
+
+    if (index == NULL) {
+        return NULL;
+    }
+
+    memset(index, 0, sizeof(cJSON_Index) + sizeof(index_slot) * slot_count);
+
+    index->mask  = slot_count - 1;
+    index->slots = (index_slot *)(index + 1);
+
+    return index;
+}
+
+static cJSON *
+index_lookup(const cJSON_Index *const index, const char *const name,
+    const size_t hash)
+{
+    size_t slot;
+
+    for (slot = hash & index->mask; index->slots[slot].item != NULL;
+         slot = (slot + 1) & index->mask)
+    {
+        if ((index->slots[slot].hash == hash) &&
+            (strcmp(index->slots[slot].item->string, name) == 0))
+        {
+            return index->slots[slot].item;
+        }
+    }
+
+    return NULL;
+}
+
+static cJSON *
+index_find(const cJSON_Index *const index, const char *const name)
+{
+    return index_lookup(index, name, index_hash(name));
+}
+
+/* Indexes the item unless an item with its name already is. There must be a
+ * free slot. */
+static void
+index_insert(cJSON_Index *const index, cJSON *const item)
+{
+    size_t hash, slot;
+
+    if (item->string == NULL) {
+        return;
+    }
+
+    hash = index_hash(item->string);
+
+    if (index_lookup(index, item->string, hash) != NULL) {
+        index->duplicates = true;
+
+        return;
+    }
+
+    for (slot = hash & index->mask; index->slots[slot].item != NULL;
+         slot = (slot + 1) & index->mask)
+    {}
+
+    index->slots[slot].hash = hash;
+    index->slots[slot].item = item;
+    index->count++;
+}
+
+/* Replaces any index of the object with one of its current items. Without
+ * memory for it, the object is left unindexed. */
+static void
+index_build(cJSON *const object)
+{
+    cJSON_Index *index;
+    cJSON *      child;
+    size_t       count = 0, slot_count = 64;
+
+    if (object->object_index != NULL) {
+        global_hooks.deallocate(object->object_index);
+        object->object_index = NULL;
+    }
+
+    for (child = object->child; child != NULL; child = child->next) {
+        count++;
+    }
+
+    while (slot_count < count * 2) {
+        slot_count *= 2;
+    }
+
+    if ((index = index_allocate(slot_count)) == NULL) {
+        return;
+    }
+
+    for (child = object->child; child != NULL; child = child->next) {
+        index_insert(index, child);
+        index->last = child;
+    }
+
+    object->object_index = index;
+}
+
+/* Indexes an item appended to the object. */
+static void
+index_add(cJSON *const object, cJSON *const item)
+{
+    cJSON_Index *index = object->object_index;
+
+    index->last = item;
+
+    if ((index->count + 1) * 2 > index->mask + 1) {
+        cJSON_Index *grown;
+        size_t       slot;
+
+        if ((grown = index_allocate((index->mask + 1) * 2)) == NULL) {
+            global_hooks.deallocate(index);
+            object->object_index = NULL;
+
+            return;
+        }
+
+        grown->last       = index->last;
+        grown->duplicates = index->duplicates;
+
+        for (slot = 0; slot <= index->mask; slot++) {
+            if (index->slots[slot].item != NULL) {
+                index_insert(grown, index->slots[slot].item);
+            }
+        }
+
+        global_hooks.deallocate(index);
+        object->object_index = index = grown;
+    }
+
+    index_insert(index, item);
+}
+
+/* Removes an item that is about to be detached from the object. */
+static void
+index_detach(cJSON *const object, cJSON *const item)
+{
+    cJSON_Index *const index = object->object_index;
+    size_t             hole, next;
+    cJSON *            later;
+
+    if (index->last == item) {
+        index->last = item->prev;
+    }
+
+    if (item->string == NULL) {
+        return;
+    }
+
+    for (hole = index_hash(item->string) & index->mask;
+         index->slots[hole].item != item;
+         hole = (hole + 1) & index->mask)
+    {
+        if (index->slots[hole].item == NULL) {
+            /* not indexed, as an earlier item has its name */
+            return;
+        }
+    }
+
+    index->count--;
+
+    /* Move back any later slots that would become unreachable. */
+    for (next = hole;;) {
+        size_t home;
+
+        index->slots[hole].item = NULL;
+
+        do {
+            next = (next + 1) & index->mask;
+
+            if (index->slots[next].item == NULL) {
+                goto moved;
+            }
+
+            home = index->slots[next].hash & index->mask;
+        } while (hole <= next ? (hole < home && home <= next)
+                              : (hole < home || home <= next));
+
+        index->slots[hole] = index->slots[next];
+        hole               = next;
+    }
+
+moved:
+    /* Only later items can have the same name as an indexed one. */
+    if (index->duplicates) {
+        for (later = item->next; later != NULL; later = later->next) {
+            if ((later->string != NULL) &&
+                (strcmp(later->string, item->string) == 0))
+            {
+                index_insert(index, later);
+
+                break;
+            }
+        }
+    }
+}
+
 /* Delete a cJSON structure. */
 CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
 {
@@ -244,6 +496,9 @@ CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
         if (!(item->type & cJSON_StringIsConst) && (item->string != NULL)) {
             global_hooks.deallocate(item->string);
         }
+        if (item->object_index != NULL) {
+            global_hooks.deallocate(item->object_index);
+        }
         global_hooks.deallocate(item);
         item = next;
     }
@@ -1458,6 +1713,7 @@ parse_object(cJSON *const item, parse_buffer *const input_buffer)
 {
     cJSON *head         = NULL; /* linked list head */
     cJSON *current_item = NULL;
+    size_t count        = 0;
 
     if (input_buffer->depth >= CJSON_NESTING_LIMIT) {
         return false; /* to deeply nested */
@@ -1504,6 +1760,7 @@ parse_object(cJSON *const item, parse_buffer *const input_buffer)
             new_item->prev     = current_item;
             current_item       = new_item;
         }
+        count++;
 
         /* parse the name of the child */
         input_buffer->offset++;
@@ -1545,6 +1802,10 @@ success:
     item->type  = cJSON_Object;
     item->child = head;
 
+    if (index_wanted(item, count)) {
+        index_build(item);
+    }
+
     input_buffer->offset++;
     return true;
 
@@ -1719,6 +1980,10 @@ get_object_item(
         return NULL;
     }
 
+    if (case_sensitive && (object->object_index != NULL)) {
+        return index_find(object->object_index, name);
+    }
+
     current_element = object->child;
     if (case_sensitive) {
         while ((current_element != NULL) && (current_element->string != NULL) &&
@@ -1786,6 +2051,8 @@ create_reference(const cJSON *item, const internal_hooks *const hooks)
 
     memcpy(reference, item, sizeof(cJSON));
     reference->string = NULL;
+    /* The index belongs to the referenced object. */
+    reference->object_index = NULL;
     reference->type |= cJSON_IsReference;
     reference->next = reference->prev = NULL;
     return reference;
@@ -1795,6 +2062,7 @@ static cJSON_bool
 add_item_to_array(cJSON *array, cJSON *item)
 {
     cJSON *child = NULL;
+    size_t count = 1;
 
     if ((item == NULL) || (array == NULL)) {
         return false;
@@ -1805,12 +2073,22 @@ add_item_to_array(cJSON *array, cJSON *item)
     if (child == NULL) {
         /* list is empty, start new one */
         array->child = item;
+    } else if (array->object_index != NULL) {
+        suffix_object(array->object_index->last, item);
     } else {
         /* append to the end */
         while (child->next) {
             child = child->next;
+            count++;
         }
         suffix_object(child, item);
+        count++;
+    }
+
+    if (array->object_index != NULL) {
+        index_add(array, item);
+    } else if (index_wanted(array, count)) {
+        index_build(array);
     }
 
     return true;
@@ -1879,10 +2157,10 @@ add_item_to_object(
     return add_item_to_array(object, item);
 }
 
-CJSON_PUBLIC(void)
+CJSON_PUBLIC(cJSON_bool)
 cJSON_AddItemToObject(cJSON *object, const char *string, cJSON *item)
 {
-    add_item_to_object(object, string, item, &global_hooks, false);
+    return add_item_to_object(object, string, item, &global_hooks, false);
 }
 
 /* Add an item to an object with constant string as key */
@@ -2035,6 +2313,10 @@ cJSON_DetachItemViaPointer(cJSON *parent, cJSON *const item)
         return NULL;
     }
 
+    if (parent->object_index != NULL) {
+        index_detach(parent, item);
+    }
+
     if (item->prev != NULL) {
         /* not the first element */
         item->prev->next = item->next;
@@ -2121,6 +2403,12 @@ cJSON_InsertItemInArray(cJSON *array, int which, cJSON *newitem)
     } else {
         newitem->prev->next = newitem;
     }
+
+    /* Rare enough to simply rebuild, which keeps the first of any items with
+     * the same name indexed. */
+    if (array->object_index != NULL) {
+        index_build(array);
+    }
 }
 
 CJSON_PUBLIC(cJSON_bool)
@@ -2150,6 +2438,11 @@ cJSON_ReplaceItemViaPointer(
 
     item->next = NULL;
     item->prev = NULL;
+
+    if (parent->object_index != NULL) {
+        index_build(parent);
+    }
+
     cJSON_Delete(item);
 
     return true;
@@ -2478,6 +2771,7 @@ CJSON_PUBLIC(cJSON *) cJSON_Duplicate(const cJSON *item, cJSON_bool recurse)
     cJSON *child    = NULL;
     cJSON *next     = NULL;
     cJSON *newchild = NULL;
+    size_t count    = 0;
 
     /* Bail on bad ptr */
     if (!item) {
@@ -2534,6 +2828,11 @@ CJSON_PUBLIC(cJSON *) cJSON_Duplicate(const cJSON *item, cJSON_bool recurse)
             next           = newchild;
         }
         child = child->next;
+        count++;
+    }
+
+    if (index_wanted(newitem, count)) {
+        index_build(newitem);
     }
 
     return newitem;
@@ -120,17 +120,21 @@ typedef struct cJSON
 
     /* The type of the item, as above. */
     int type;
+    /* writing to valueint is DEPRECATED, use cJSON_SetNumberValue instead */
+    int valueint;
 
     /* The item's string, if type==cJSON_String  and type == cJSON_Raw */
     char *valuestring;
-    /* writing to valueint is DEPRECATED, use cJSON_SetNumberValue instead */
-    int valueint;
     /* The item's number, if type==cJSON_Number */
     double valuedouble;
 
     /* The item's name string, if this item is the child of, or is in the list
      * of subitems of an object. */
     char *string;
+
+    /* An index of the items of a large object by name, or NULL. See
+     * CJSON_INDEX_THRESHOLD. */
+    struct cJSON_Index *object_index;
 } cJSON;
 
 typedef struct cJSON_Hooks
@@ -150,6 +154,15 @@ typedef int cJSON_bool;
 #define CJSON_NESTING_LIMIT 1000
 #endif
 
+/* Objects with at least this many items are given a hash index of their items
+ * by name, which case sensitive lookups use instead of walking the items, and
+ * which lets items be appended without walking them. The index is kept up to
+ * date by every function that adds, detaches or replaces items, so the items
+ * of an object must not be relinked directly. Define as 0 to never index. */
+#ifndef CJSON_INDEX_THRESHOLD
+#define CJSON_INDEX_THRESHOLD 32
+#endif
+
 /* returns the version of cJSON as a string */
 CJSON_PUBLIC(const char *) cJSON_Version(void);
 
@@ -255,7 +268,8 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateStringArray(const char **strings, int count);
 
 /* Append item to the specified array/object. */
 CJSON_PUBLIC(void) cJSON_AddItemToArray(cJSON *array, cJSON *item);
-CJSON_PUBLIC(void)
+/* Returns false, without taking the item, if the key cannot be copied. */
+CJSON_PUBLIC(cJSON_bool)
 cJSON_AddItemToObject(cJSON *object, const char *string, cJSON *item);
 /* Use this when string is definitely const (i.e. a literal, or as good as), and
  * will definitely survive the cJSON object. WARNING: When this function was
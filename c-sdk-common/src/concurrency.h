@@ -40,6 +40,71 @@
 #endif
 #endif
 
+/* Atomic counters, for reference counts and totals updated without a lock. The
+ * SDK targets C89, so these map to compiler and platform intrinsics rather
+ * than C11 atomics. All but load return the updated value.
+ * Decrement has acquire-release ordering, so that the thread which observes
+ * zero sees every write made before the other references were released. */
+#ifdef _WIN32
+#define ld_atomic_t volatile LONG
+#define LDi_atomic_increment(counter) InterlockedIncrement(counter)
+#define LDi_atomic_decrement(counter) InterlockedDecrement(counter)
+#define LDi_atomic_load(counter) InterlockedCompareExchange(counter, 0, 0)
+#define LDi_atomic_add(counter, value)                                         \
+    (InterlockedExchangeAdd(counter, (LONG)(value)) + (LONG)(value))
+#define LDi_atomic_sub(counter, value)                                         \
+    (InterlockedExchangeAdd(counter, -(LONG)(value)) - (LONG)(value))
+#elif defined(__ATOMIC_ACQ_REL)
+#define ld_atomic_t unsigned int
+#define LDi_atomic_increment(counter)                                          \
+    __atomic_add_fetch(counter, 1, __ATOMIC_RELAXED)
+#define LDi_atomic_decrement(counter)                                          \
+    __atomic_sub_fetch(counter, 1, __ATOMIC_ACQ_REL)
+#define LDi_atomic_load(counter) __atomic_load_n(counter, __ATOMIC_ACQUIRE)
+#define LDi_atomic_add(counter, value)                                         \
+    __atomic_add_fetch(counter, value, __ATOMIC_ACQ_REL)
+#define LDi_atomic_sub(counter, value)                                         \
+    __atomic_sub_fetch(counter, value, __ATOMIC_ACQ_REL)
+#else
+#define ld_atomic_t volatile unsigned int
+#define LDi_atomic_increment(counter) __sync_add_and_fetch(counter, 1)
+#define LDi_atomic_decrement(counter) __sync_sub_and_fetch(counter, 1)
+#define LDi_atomic_load(counter) __sync_add_and_fetch(counter, 0)
+#define LDi_atomic_add(counter, value) __sync_add_and_fetch(counter, value)
+#define LDi_atomic_sub(counter, value) __sync_sub_and_fetch(counter, value)
+#endif
+
+/* Atomic pointers, for publishing an immutable structure to readers which take
+ * no lock. Loads acquire, and exchange returns the previous pointer with
+ * acquire-release ordering. The fence is sequentially consistent, for ordering
+ * a store before a later load of a different variable. */
+#ifdef _WIN32
+#define LDi_atomic_load_pointer(target)                                        \
+    InterlockedCompareExchangePointer((PVOID volatile *)(target), NULL, NULL)
+#define LDi_atomic_exchange_pointer(target, value)                             \
+    InterlockedExchangePointer((PVOID volatile *)(target), (PVOID)(value))
+#define LDi_atomic_fence() MemoryBarrier()
+#elif defined(__ATOMIC_ACQ_REL)
+#define LDi_atomic_load_pointer(target) __atomic_load_n(target, __ATOMIC_ACQUIRE)
+#define LDi_atomic_exchange_pointer(target, value)                             \
+    __atomic_exchange_n(target, value, __ATOMIC_ACQ_REL)
+#define LDi_atomic_fence() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#else
+#define LDi_atomic_load_pointer(target)                                        \
+    __sync_val_compare_and_swap(target, NULL, NULL)
+#define LDi_atomic_exchange_pointer(target, value)                             \
+    (__sync_synchronize(), __sync_lock_test_and_set(target, value))
+#define LDi_atomic_fence() __sync_synchronize()
+#endif
+
+/* An identifier for the calling thread, for spreading work across shards. It
+ * is not guaranteed to be unique. */
+#ifdef _WIN32
+#define LDi_thread_id() ((unsigned long)GetCurrentThreadId())
+#else
+#define LDi_thread_id() ((unsigned long)pthread_self())
+#endif
+
 typedef LDBoolean (*ld_mutex_unary_t)(ld_mutex_t *const mutex);
 
 typedef LDBoolean (*ld_thread_join_t)(ld_thread_t *const thread);
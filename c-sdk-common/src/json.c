@@ -526,7 +526,9 @@ LDObjectSetKey(
 
     cJSON_DeleteItemFromObjectCaseSensitive(object, key);
 
-    cJSON_AddItemToObject(object, key, (cJSON *)item);
+    if (!cJSON_AddItemToObject(object, key, (cJSON *)item)) {
+        return LDBooleanFalse;
+    }
 
     return LDBooleanTrue;
 }
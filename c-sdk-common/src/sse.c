@@ -14,12 +14,36 @@ LDSSEParserInitialize(
     LD_ASSERT(parser);
     LD_ASSERT(dispatch);
 
-    parser->buffer     = NULL;
-    parser->bufferSize = 0;
-    parser->eventName  = NULL;
-    parser->eventBody  = NULL;
-    parser->dispatch   = dispatch;
-    parser->context    = context;
+    parser->buffer            = NULL;
+    parser->bufferSize        = 0;
+    parser->bufferCapacity    = 0;
+    parser->bufferScanned     = 0;
+    parser->eventName         = NULL;
+    parser->eventBody         = NULL;
+    parser->eventBodySize     = 0;
+    parser->eventBodyCapacity = 0;
+    parser->pendingData       = NULL;
+    parser->pendingDataSize   = 0;
+    parser->dispatch          = dispatch;
+    parser->context           = context;
+    parser->streamName        = NULL;
+    parser->stream            = NULL;
+    parser->streaming         = LDBooleanFalse;
+    parser->streamingLine     = LDBooleanFalse;
+}
+
+void
+LDSSEParserStreamEvent(
+    struct LDSSEParser *const parser,
+    const char *const         eventName,
+    ld_sse_stream             stream)
+{
+    LD_ASSERT(parser);
+    LD_ASSERT(eventName);
+    LD_ASSERT(stream);
+
+    parser->streamName = eventName;
+    parser->stream     = stream;
 }
 
 void
@@ -30,14 +54,129 @@ LDSSEParserDestroy(struct LDSSEParser *const parser)
         LDFree(parser->eventName);
         LDFree(parser->eventBody);
 
-        parser->buffer    = NULL;
-        parser->eventName = NULL;
-        parser->eventBody = NULL;
+        parser->buffer            = NULL;
+        parser->bufferSize        = 0;
+        parser->bufferCapacity    = 0;
+        parser->bufferScanned     = 0;
+        parser->eventName         = NULL;
+        parser->eventBody         = NULL;
+        parser->eventBodySize     = 0;
+        parser->eventBodyCapacity = 0;
+        parser->pendingData       = NULL;
+        parser->pendingDataSize   = 0;
+        parser->streaming         = LDBooleanFalse;
+        parser->streamingLine     = LDBooleanFalse;
+    }
+}
+
+/* Grows an allocation geometrically until it holds at least required bytes,
+ * so that appending to it costs amortized constant time per byte. */
+static LDBoolean
+reserve(char **const data, size_t *const capacity, const size_t required)
+{
+    char * dataTmp;
+    size_t capacityTmp;
+
+    if (required <= *capacity) {
+        return LDBooleanTrue;
+    }
+
+    capacityTmp = *capacity ? *capacity : 256;
+
+    while (capacityTmp < required) {
+        if (capacityTmp * 2 < capacityTmp) {
+            capacityTmp = required;
+        } else {
+            capacityTmp *= 2;
+        }
+    }
+
+    if (!(dataTmp = (char *)LDRealloc(*data, capacityTmp))) {
+        return LDBooleanFalse;
+    }
+
+    *data     = dataTmp;
+    *capacity = capacityTmp;
+
+    return LDBooleanTrue;
+}
+
+/* Appends a data line to the event body, joining it to any previous line. */
+static LDBoolean
+appendEventBody(
+    struct LDSSEParser *const parser,
+    const char *const         line,
+    const size_t              lineSize)
+{
+    const LDBoolean notEmpty = parser->eventBody != NULL;
+
+    if (!reserve(
+            &parser->eventBody,
+            &parser->eventBodyCapacity,
+            parser->eventBodySize + notEmpty + lineSize + 1))
+    {
+        return LDBooleanFalse;
+    }
+
+    if (notEmpty) {
+        parser->eventBody[parser->eventBodySize++] = '\n';
+    }
+
+    memcpy(parser->eventBody + parser->eventBodySize, line, lineSize);
+
+    parser->eventBodySize += lineSize;
+    parser->eventBody[parser->eventBodySize] = '\0';
+
+    return LDBooleanTrue;
+}
+
+/* Copies a pending data line out of the buffer, before the buffer changes. */
+static LDBoolean
+flushPendingData(struct LDSSEParser *const parser)
+{
+    const char *const data = parser->pendingData;
+
+    if (!data) {
+        return LDBooleanTrue;
+    }
+
+    parser->pendingData = NULL;
+
+    return appendEventBody(parser, data, parser->pendingDataSize);
+}
+
+static LDBoolean
+isStreamed(const struct LDSSEParser *const parser)
+{
+    return parser->stream && parser->eventName &&
+        strcmp(parser->eventName, parser->streamName) == 0;
+}
+
+/* Streams the start of a data line, joining it to any previous line. */
+static LDBoolean
+streamLine(
+    struct LDSSEParser *const parser,
+    const char *const         data,
+    const size_t              dataSize)
+{
+    if (parser->streaming &&
+        !parser->stream(parser->eventName, "\n", 1, parser->context))
+    {
+        return LDBooleanFalse;
+    }
+
+    parser->streaming = LDBooleanTrue;
+
+    if (dataSize == 0) {
+        return LDBooleanTrue;
     }
+
+    return parser->stream(parser->eventName, data, dataSize, parser->context);
 }
 
 static LDBoolean
-LDi_processLine(struct LDSSEParser *const parser, const char *line)
+LDi_processLine(
+    struct LDSSEParser *const parser, const char *line, size_t lineSize)
 {
     LD_ASSERT(parser);
     LD_ASSERT(line);
@@ -45,65 +184,74 @@ LDi_processLine(struct LDSSEParser *const parser, const char *line)
     if (line[0] == ':') {
         /* skip comment */
     } else if (line[0] == '\0') {
-        LDBoolean status;
+        LDBoolean   status;
+        const char *body;
+        size_t      bodySize;
+
+        /* a pending line is the whole body, and is still NUL terminated */
+        if (parser->pendingData) {
+            body     = parser->pendingData;
+            bodySize = parser->pendingDataSize;
+        } else {
+            body     = parser->eventBody;
+            bodySize = parser->eventBodySize;
+        }
+
         /* dispatch */
-        if (parser->eventName == NULL) {
+        if (parser->streaming) {
+            status = parser->stream(parser->eventName, NULL, 0, parser->context);
+        } else if (body && isStreamed(parser)) {
+            /* the event name followed its data */
+            status = parser->stream(
+                         parser->eventName, body, bodySize, parser->context) &&
+                parser->stream(parser->eventName, NULL, 0, parser->context);
+        } else if (parser->eventName == NULL) {
             LD_LOG(LD_LOG_WARNING, "SSE dispatch with NULL event name");
 
             status = LDBooleanTrue;
-        } else if (parser->eventBody == NULL) {
+        } else if (body == NULL) {
             LD_LOG(LD_LOG_WARNING, "SSE dispatch with NULL event body");
 
             status = LDBooleanTrue;
         } else {
             LD_ASSERT(parser->dispatch);
 
-            status = parser->dispatch(
-                parser->eventName, parser->eventBody, parser->context);
+            status = parser->dispatch(parser->eventName, body, parser->context);
         }
 
         LDFree(parser->eventName);
         LDFree(parser->eventBody);
 
-        parser->eventName = NULL;
-        parser->eventBody = NULL;
+        parser->eventName         = NULL;
+        parser->eventBody         = NULL;
+        parser->eventBodySize     = 0;
+        parser->eventBodyCapacity = 0;
+        parser->pendingData       = NULL;
+        parser->streaming         = LDBooleanFalse;
 
         if (status == LDBooleanFalse) {
             return LDBooleanFalse;
         }
     } else if (strncmp(line, "data:", 5) == 0) {
-        char *    eventBodyTmp;
-        size_t    lineSize, currentBodySize;
-        LDBoolean notEmpty;
+        const size_t prefixSize = 5 + (line[5] == ' ');
 
-        line += 5;
-        line += line[0] == ' ';
+        line += prefixSize;
+        lineSize -= prefixSize;
 
-        lineSize = strlen(line);
-        notEmpty = parser->eventBody != NULL;
-
-        if (notEmpty) {
-            currentBodySize = strlen(parser->eventBody);
-        } else {
-            currentBodySize = 0;
-        }
-
-        eventBodyTmp = (char *)LDRealloc(
-            parser->eventBody, lineSize + currentBodySize + notEmpty + 1);
-
-        if (eventBodyTmp == NULL) {
-            return LDBooleanFalse;
+        if (isStreamed(parser)) {
+            return streamLine(parser, line, lineSize);
         }
 
-        parser->eventBody = eventBodyTmp;
+        /* the first line is only copied if the event outlives the buffer */
+        if (parser->eventBody == NULL && parser->pendingData == NULL) {
+            parser->pendingData     = line;
+            parser->pendingDataSize = lineSize;
 
-        if (notEmpty) {
-            parser->eventBody[currentBodySize] = '\n';
+            return LDBooleanTrue;
         }
 
-        memcpy(parser->eventBody + currentBodySize + notEmpty, line, lineSize);
-
-        parser->eventBody[currentBodySize + notEmpty + lineSize] = '\0';
+        return flushPendingData(parser) &&
+            appendEventBody(parser, line, lineSize);
     } else if (strncmp(line, "event:", 6) == 0) {
         /* skip prefix and optional space*/
         line += 6;
@@ -129,9 +277,10 @@ LDSSEParserProcess(
     const void *const         buffer,
     const size_t              bufferSize)
 {
-    void * bufferTmp;
-    char * newLineLocation;
-    size_t consumed;
+    char *      newLineLocation;
+    size_t      consumed, scanned;
+    const char *input;
+    size_t      inputSize;
 
     LD_ASSERT(parser);
 
@@ -141,31 +290,72 @@ LDSSEParserProcess(
 
     LD_ASSERT(buffer);
 
-    bufferTmp = LDRealloc(parser->buffer, parser->bufferSize + bufferSize + 1);
+    input     = (const char *)buffer;
+    inputSize = bufferSize;
+
+    /* The rest of a streamed data line is passed on without buffering. */
+    if (parser->streamingLine) {
+        const char *const end  = (const char *)memchr(input, '\n', inputSize);
+        const size_t      size = end ? (size_t)(end - input) : inputSize;
+
+        if (size && !parser->stream(parser->eventName, input, size, parser->context)) {
+            return LDBooleanFalse;
+        }
+
+        if (!end) {
+            return LDBooleanTrue;
+        }
 
-    if (bufferTmp == NULL) {
+        parser->streamingLine = LDBooleanFalse;
+
+        input += size + 1;
+        inputSize -= size + 1;
+
+        if (inputSize == 0) {
+            return LDBooleanTrue;
+        }
+    }
+
+    if (!reserve(
+            &parser->buffer,
+            &parser->bufferCapacity,
+            parser->bufferSize + inputSize + 1))
+    {
         return LDBooleanFalse;
     }
 
-    parser->buffer = bufferTmp;
-    consumed       = 0;
+    consumed = 0;
+    scanned  = parser->bufferScanned;
 
-    memcpy(&(parser->buffer[parser->bufferSize]), buffer, bufferSize);
+    memcpy(&(parser->buffer[parser->bufferSize]), input, inputSize);
 
-    parser->bufferSize += bufferSize;
+    parser->bufferSize += inputSize;
     parser->buffer[parser->bufferSize] = '\0';
 
     while (
         (newLineLocation = (char *)memchr(
-             parser->buffer + consumed, '\n', parser->bufferSize - consumed)))
+             parser->buffer + scanned, '\n', parser->bufferSize - scanned)))
     {
         *newLineLocation = '\0';
 
-        if (!LDi_processLine(parser, parser->buffer + consumed)) {
+        if (!LDi_processLine(
+                parser,
+                parser->buffer + consumed,
+                newLineLocation - (parser->buffer + consumed)))
+        {
+            parser->pendingData = NULL;
+
             return LDBooleanFalse;
         }
 
         consumed = newLineLocation - parser->buffer + 1;
+        scanned  = consumed;
+    }
+
+    /* Only the incomplete line is moved, so each byte is moved at most once
+     * per call no matter how much of the event is already buffered. */
+    if (!flushPendingData(parser)) {
+        return LDBooleanFalse;
     }
 
     if (consumed) {
@@ -173,5 +363,28 @@ LDSSEParserProcess(
         memmove(parser->buffer, parser->buffer + consumed, parser->bufferSize);
     }
 
+    parser->bufferScanned = parser->bufferSize;
+
+    /* Once an incomplete line is known to be streamed data, it is passed on
+     * rather than buffered until it ends. Six characters are needed to see if
+     * the prefix includes the optional space. */
+    if (parser->bufferSize > 5 && isStreamed(parser) &&
+        strncmp(parser->buffer, "data:", 5) == 0)
+    {
+        const size_t prefixSize = 5 + (parser->buffer[5] == ' ');
+
+        if (!streamLine(
+                parser,
+                parser->buffer + prefixSize,
+                parser->bufferSize - prefixSize))
+        {
+            return LDBooleanFalse;
+        }
+
+        parser->bufferSize    = 0;
+        parser->bufferScanned = 0;
+        parser->streamingLine = LDBooleanTrue;
+    }
+
     return LDBooleanTrue;
 }
@@ -7,14 +7,39 @@
 typedef LDBoolean (*ld_sse_dispatch)(
     const char *const name, const char *const body, void *const context);
 
+/* Receives the body of a streamed event in pieces, as it arrives. Called with
+ * NULL data once the event is complete. */
+typedef LDBoolean (*ld_sse_stream)(
+    const char *const name,
+    const char *const data,
+    const size_t      dataSize,
+    void *const       context);
+
 struct LDSSEParser
 {
+    /* Holds the incomplete line. Grows geometrically and is kept between
+     * calls, the first bufferScanned bytes are known to contain no newline. */
     char *          buffer;
     size_t          bufferSize;
+    size_t          bufferCapacity;
+    size_t          bufferScanned;
     char *          eventName;
     char *          eventBody;
+    size_t          eventBodySize;
+    size_t          eventBodyCapacity;
+    /* The only data line of the current event so far, still in buffer. It is
+     * dispatched from there if the event ends in the same call. */
+    const char *    pendingData;
+    size_t          pendingDataSize;
     ld_sse_dispatch dispatch;
     void *          context;
+    /* optional, see LDSSEParserStreamEvent */
+    const char *    streamName;
+    ld_sse_stream   stream;
+    /* part of the body of the current event has been streamed */
+    LDBoolean       streaming;
+    /* the current line is streamed data which has not ended yet */
+    LDBoolean       streamingLine;
 };
 
 void
@@ -23,6 +48,16 @@ LDSSEParserInitialize(
     ld_sse_dispatch           dispatch,
     void *const               context);
 
+/* Events named eventName are passed to stream as their data arrives, instead
+ * of being buffered whole for dispatch. The body is the same as the one that
+ * would be dispatched. eventName is not copied. */
+void
+LDSSEParserStreamEvent(
+    struct LDSSEParser *const parser,
+    const char *const         eventName,
+    ld_sse_stream             stream);
+
+/* Releases buffered data, leaving the parser ready for a new connection. */
 void
 LDSSEParserDestroy(struct LDSSEParser *const parser);
 
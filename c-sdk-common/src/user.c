@@ -489,62 +489,124 @@ LDi_userToJSON(
 #undef addstring
 }
 
-struct LDJSON *
-LDi_valueOfAttribute(
-    const struct LDUser *const user, const char *const attribute)
+LDUserAttribute
+LDi_parseUserAttribute(const char *const attribute)
 {
-    LD_ASSERT(user);
     LD_ASSERT(attribute);
 
     if (strcmp(attribute, "key") == 0) {
-        if (user->key) {
-            return LDNewText(user->key);
-        }
+        return LD_USER_ATTRIBUTE_KEY;
     } else if (strcmp(attribute, "secondary") == 0) {
-        if (user->secondary) {
-            return LDNewText(user->secondary);
-        }
+        return LD_USER_ATTRIBUTE_SECONDARY;
     } else if (strcmp(attribute, "ip") == 0) {
-        if (user->ip) {
-            return LDNewText(user->ip);
-        }
+        return LD_USER_ATTRIBUTE_IP;
     } else if (strcmp(attribute, "email") == 0) {
-        if (user->email) {
-            return LDNewText(user->email);
-        }
+        return LD_USER_ATTRIBUTE_EMAIL;
     } else if (strcmp(attribute, "firstName") == 0) {
-        if (user->firstName) {
-            return LDNewText(user->firstName);
-        }
+        return LD_USER_ATTRIBUTE_FIRST_NAME;
     } else if (strcmp(attribute, "lastName") == 0) {
-        if (user->lastName) {
-            return LDNewText(user->lastName);
-        }
+        return LD_USER_ATTRIBUTE_LAST_NAME;
     } else if (strcmp(attribute, "avatar") == 0) {
-        if (user->avatar) {
-            return LDNewText(user->avatar);
-        }
+        return LD_USER_ATTRIBUTE_AVATAR;
     } else if (strcmp(attribute, "country") == 0) {
-        if (user->country) {
-            return LDNewText(user->country);
-        }
+        return LD_USER_ATTRIBUTE_COUNTRY;
     } else if (strcmp(attribute, "name") == 0) {
-        if (user->name) {
-            return LDNewText(user->name);
-        }
+        return LD_USER_ATTRIBUTE_NAME;
     } else if (strcmp(attribute, "anonymous") == 0) {
-        return LDNewBool(user->anonymous);
-    } else if (user->custom) {
-        const struct LDJSON *node = NULL;
+        return LD_USER_ATTRIBUTE_ANONYMOUS;
+    }
+
+    return LD_USER_ATTRIBUTE_CUSTOM;
+}
+
+static const struct LDJSON *
+viewText(const char *const text, struct LDUserAttributeView *const view)
+{
+    if (!text) {
+        return NULL;
+    }
+
+    memset(&view->node, 0, sizeof(view->node));
+
+    /* The string is owned by the user, so the node is marked as a reference
+     * in the same way cJSON marks nodes that do not own their contents. */
+    view->node.type        = cJSON_String | cJSON_IsReference;
+    view->node.valuestring = (char *)text;
+
+    return (const struct LDJSON *)&view->node;
+}
+
+static const struct LDJSON *
+viewBool(const LDBoolean value, struct LDUserAttributeView *const view)
+{
+    memset(&view->node, 0, sizeof(view->node));
+
+    view->node.type = value ? cJSON_True : cJSON_False;
+
+    return (const struct LDJSON *)&view->node;
+}
 
+const struct LDJSON *
+LDi_viewAttributeByID(
+    const struct LDUser *const        user,
+    const LDUserAttribute             id,
+    const char *const                 attribute,
+    struct LDUserAttributeView *const view)
+{
+    LD_ASSERT(user);
+    LD_ASSERT(view);
+
+    switch (id) {
+        case LD_USER_ATTRIBUTE_KEY:
+            return viewText(user->key, view);
+        case LD_USER_ATTRIBUTE_SECONDARY:
+            return viewText(user->secondary, view);
+        case LD_USER_ATTRIBUTE_IP:
+            return viewText(user->ip, view);
+        case LD_USER_ATTRIBUTE_EMAIL:
+            return viewText(user->email, view);
+        case LD_USER_ATTRIBUTE_FIRST_NAME:
+            return viewText(user->firstName, view);
+        case LD_USER_ATTRIBUTE_LAST_NAME:
+            return viewText(user->lastName, view);
+        case LD_USER_ATTRIBUTE_AVATAR:
+            return viewText(user->avatar, view);
+        case LD_USER_ATTRIBUTE_COUNTRY:
+            return viewText(user->country, view);
+        case LD_USER_ATTRIBUTE_NAME:
+            return viewText(user->name, view);
+        case LD_USER_ATTRIBUTE_ANONYMOUS:
+            return viewBool(user->anonymous, view);
+        case LD_USER_ATTRIBUTE_CUSTOM:
+            break;
+    }
+
+    LD_ASSERT(attribute);
+
+    if (user->custom) {
         LD_ASSERT(LDJSONGetType(user->custom) == LDObject);
 
-        if ((node = LDObjectLookup(user->custom, attribute))) {
-            return LDJSONDuplicate(node);
-        }
+        return LDObjectLookup(user->custom, attribute);
+    }
 
+    return NULL;
+}
+
+struct LDJSON *
+LDi_valueOfAttribute(
+    const struct LDUser *const user, const char *const attribute)
+{
+    struct LDUserAttributeView view;
+    const struct LDJSON *      value;
+
+    LD_ASSERT(user);
+    LD_ASSERT(attribute);
+
+    if (!(value = LDi_viewAttributeByID(
+              user, LDi_parseUserAttribute(attribute), attribute, &view)))
+    {
         return NULL;
     }
 
-    return NULL;
+    return LDJSONDuplicate(value);
 }
@@ -2,6 +2,8 @@
 
 #include <launchdarkly/json.h>
 
+#include "cJSON.h"
+
 struct LDUser
 {
     char *         key;
@@ -18,10 +20,48 @@ struct LDUser
     struct LDJSON *custom;                /* Object, may be NULL */
 };
 
+/* Identifies a built-in user attribute. Attribute names are resolved to an ID
+ * once, when flag data is compiled, instead of on every evaluation. Any name
+ * that is not built-in refers to a custom attribute. */
+typedef enum
+{
+    LD_USER_ATTRIBUTE_CUSTOM,
+    LD_USER_ATTRIBUTE_KEY,
+    LD_USER_ATTRIBUTE_SECONDARY,
+    LD_USER_ATTRIBUTE_IP,
+    LD_USER_ATTRIBUTE_EMAIL,
+    LD_USER_ATTRIBUTE_FIRST_NAME,
+    LD_USER_ATTRIBUTE_LAST_NAME,
+    LD_USER_ATTRIBUTE_AVATAR,
+    LD_USER_ATTRIBUTE_COUNTRY,
+    LD_USER_ATTRIBUTE_NAME,
+    LD_USER_ATTRIBUTE_ANONYMOUS
+} LDUserAttribute;
+
+LDUserAttribute
+LDi_parseUserAttribute(const char *const attribute);
+
 struct LDJSON *
 LDi_valueOfAttribute(
     const struct LDUser *const user, const char *const attribute);
 
+/* Storage for viewing a built-in attribute as JSON without allocating. */
+struct LDUserAttributeView
+{
+    struct cJSON node;
+};
+
+/* Returns a borrowed view of an attribute, or NULL if it is not set. Built-in
+ * attributes are presented through the view, which must outlive the result;
+ * custom attributes point into the user. The result must not be freed. The
+ * attribute name is only consulted for LD_USER_ATTRIBUTE_CUSTOM. */
+const struct LDJSON *
+LDi_viewAttributeByID(
+    const struct LDUser *const        user,
+    const LDUserAttribute             id,
+    const char *const                 attribute,
+    struct LDUserAttributeView *const view);
+
 struct LDJSON *
 LDi_userToJSON(
     const struct LDUser *const user,
@@ -1,6 +1,8 @@
 #include "commonfixture.h"
 #include "gtest/gtest.h"
 
+#include <string>
+
 extern "C" {
 #include <string.h>
 
@@ -39,3 +41,125 @@ TEST_F(SseFixture, BasicEvent)
 
     LDSSEParserDestroy(&parser);
 }
+
+static std::string streamedBody;
+static int         streamedCompletions;
+
+static LDBoolean
+mockStream(
+    const char *const name,
+    const char *const data,
+    const size_t      dataSize,
+    void *const       context)
+{
+    if (data) {
+        streamedBody.append(data, dataSize);
+    } else {
+        streamedCompletions++;
+    }
+
+    return LDBooleanTrue;
+}
+
+TEST_F(SseFixture, StreamedEventInSmallChunks)
+{
+    struct LDSSEParser parser;
+    size_t             i;
+
+    LDSSEParserInitialize(&parser, mockDispatch, NULL);
+    LDSSEParserStreamEvent(&parser, "put", mockStream);
+
+    streamedBody.clear();
+    streamedCompletions = 0;
+
+    const char *const event =
+        "event: put\n"
+        "data: {\"a\":\n"
+        "data:1}\n\n"
+        "event: delete\n"
+        "data: hello\n\n";
+
+    for (i = 0; i < strlen(event); i++) {
+        ASSERT_TRUE(LDSSEParserProcess(&parser, event + i, 1));
+    }
+
+    ASSERT_EQ(streamedBody, "{\"a\":\n1}");
+    ASSERT_EQ(streamedCompletions, 1);
+    ASSERT_STREQ(nameBuffer, "delete");
+    ASSERT_STREQ(bodyBuffer, "hello");
+
+    LDSSEParserDestroy(&parser);
+}
+
+TEST_F(SseFixture, StreamedEventNamedAfterData)
+{
+    struct LDSSEParser parser;
+
+    LDSSEParserInitialize(&parser, mockDispatch, NULL);
+    LDSSEParserStreamEvent(&parser, "put", mockStream);
+
+    streamedBody.clear();
+    streamedCompletions = 0;
+
+    const char *const event =
+        "data: {}\n"
+        "event: put\n\n";
+
+    ASSERT_TRUE(LDSSEParserProcess(&parser, event, strlen(event)));
+
+    ASSERT_EQ(streamedBody, "{}");
+    ASSERT_EQ(streamedCompletions, 1);
+
+    LDSSEParserDestroy(&parser);
+}
+
+TEST_F(SseFixture, MultiLineEventInSmallChunks)
+{
+    struct LDSSEParser parser;
+    size_t             i, chunk;
+
+    LDSSEParserInitialize(&parser, mockDispatch, NULL);
+
+    const char *const event =
+        "event: patch\n"
+        "data: first\n"
+        "data:\n"
+        "data: third\n\n";
+
+    for (i = 0; i < strlen(event); i += chunk) {
+        chunk = strlen(event) - i < 7 ? strlen(event) - i : 7;
+
+        ASSERT_TRUE(LDSSEParserProcess(&parser, event + i, chunk));
+    }
+
+    ASSERT_STREQ(nameBuffer, "patch");
+    ASSERT_STREQ(bodyBuffer, "first\n\nthird");
+
+    LDSSEParserDestroy(&parser);
+}
+
+TEST_F(SseFixture, SeveralEventsInOneChunk)
+{
+    struct LDSSEParser parser;
+
+    LDSSEParserInitialize(&parser, mockDispatch, NULL);
+
+    const char *const events =
+        "event: patch\n"
+        "data: one\n\n"
+        "event: delete\n"
+        "data: two\n"
+        "data: three\n\n"
+        "event: patch\n"
+        "data: fo";
+
+    ASSERT_TRUE(LDSSEParserProcess(&parser, events, strlen(events)));
+    ASSERT_STREQ(nameBuffer, "delete");
+    ASSERT_STREQ(bodyBuffer, "two\nthree");
+
+    ASSERT_TRUE(LDSSEParserProcess(&parser, "ur\n\n", 4));
+    ASSERT_STREQ(nameBuffer, "patch");
+    ASSERT_STREQ(bodyBuffer, "four");
+
+    LDSSEParserDestroy(&parser);
+}
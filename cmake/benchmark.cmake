@@ -0,0 +1,12 @@
+set(BENCHMARK_ENABLE_TESTING OFF CACHE BOOL "" FORCE)
+set(BENCHMARK_ENABLE_GTEST_TESTS OFF CACHE BOOL "" FORCE)
+set(BENCHMARK_ENABLE_INSTALL OFF CACHE BOOL "" FORCE)
+
+FetchContent_Declare(benchmark
+        GIT_REPOSITORY    https://github.com/google/benchmark.git
+        GIT_TAG           v1.7.1
+        SOURCE_DIR        "${CMAKE_BINARY_DIR}/benchmark-src"
+        BINARY_DIR        "${CMAKE_BINARY_DIR}/benchmark-build"
+)
+
+FetchContent_MakeAvailable(benchmark)
@@ -3,6 +3,8 @@ include(CMakeFindDependencyMacro)
 
 find_dependency(Threads REQUIRED)
 find_dependency(CURL REQUIRED)
+# Only needed when the SDK was built with the optional EVENT_COMPRESSION.
+find_dependency(ZLIB)
 
 list(APPEND CMAKE_MODULE_PATH ${ldserverapi_CMAKE_DIR})
 find_dependency(PCRE REQUIRED)
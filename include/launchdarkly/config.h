@@ -247,6 +247,22 @@ LD_EXPORT(void)
 LDConfigSetFeatureStoreBackendCacheTTL(
     struct LDConfig *const config, const unsigned int milliseconds);
 
+/**
+ * @brief When a feature store backend is provided, configure whether cached
+ * items are refreshed ahead of expiry. A background thread re-reads each kind
+ * of data from the backend, with a single call, once its cached items are
+ * halfway to expiry. Expired items continue to be served until they are
+ * refreshed, so evaluations do not wait on the backend, but may use stale
+ * data while it is unavailable. Ignored if the cache TTL is zero. The default
+ * is false.
+ * @param[in] config The configuration to modify. May not be `NULL`.
+ * @param[in] refreshAhead
+ * @return Void.
+ */
+LD_EXPORT(void)
+LDConfigSetFeatureStoreBackendRefreshAhead(
+    struct LDConfig *const config, const LDBoolean refreshAhead);
+
 /**
  * @brief Indicates to LaunchDarkly the name and version of an SDK wrapper
  * library. If `wrapperVersion` is set `wrapperName` must be set.
@@ -260,3 +276,33 @@ LDConfigSetWrapperInfo(
     struct LDConfig *const config,
     const char *const      wrapperName,
     const char *const      wrapperVersion);
+
+/**
+ * @brief Sets how many threads `LDAllFlags` and `LDAllFlagsState` may use to
+ * evaluate flags. The flags are split into contiguous ranges, one per thread,
+ * and the results are combined in their original order, so the output does
+ * not depend on this setting. Stores with few flags are always evaluated on
+ * the calling thread. The default of 1 evaluates every flag on the calling
+ * thread.
+ * @param[in] config The configuration to modify. May not be `NULL`.
+ * @param[in] threads The maximum number of threads, including the caller's.
+ * Zero is treated as 1.
+ * @return Void.
+ */
+LD_EXPORT(void)
+LDConfigSetAllFlagsThreads(
+    struct LDConfig *const config, const unsigned int threads);
+
+/**
+ * @brief Sets whether analytics event payloads are gzip compressed, and sent
+ * with `Content-Encoding: gzip`. Events are compressed one at a time as the
+ * payload is serialized, so the uncompressed payload is never held whole.
+ * Requires an SDK built with the `EVENT_COMPRESSION` CMake option, otherwise
+ * payloads are sent uncompressed. The default is false.
+ * @param[in] config The configuration to modify. May not be `NULL`.
+ * @param[in] compressEvents
+ * @return Void.
+ */
+LD_EXPORT(void)
+LDConfigSetCompressEvents(
+    struct LDConfig *const config, const LDBoolean compressEvents);
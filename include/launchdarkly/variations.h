@@ -239,6 +239,38 @@ LDJSONVariation(
     const struct LDJSON *const fallback,
     struct LDDetails *const    details);
 
+/**
+ * @brief Evaluate several flags of any type for the same user.
+ *
+ * Equivalent to calling @ref LDJSONVariation for each key, but the flags are
+ * read from the store together, segment and prerequisite results are shared
+ * between them, and their analytics events are recorded in a single step.
+ * @param[in] client The client to use. May not be `NULL`.
+ * @param[in] user The user to evaluate the flags against. May not be `NULL`.
+ * @param[in] keys The keys of the flags to evaluate. Neither the array nor any
+ * key may be `NULL`.
+ * @param[in] fallbacks The value to return on error for each key. Ownership is
+ * not transferred. May be `NULL`, as may any of its entries.
+ * @param[in] count The number of keys.
+ * @param[out] results Receives the value of each flag, or a copy of its
+ * fallback on error. An entry is `NULL` if its fallback is `NULL` and an error
+ * occurred, or on allocation failure. Each entry must be cleaned up with
+ * `LDJSONFree`. May not be `NULL`.
+ * @param[out] details An array of `count` structs where the evaluation
+ * explanations will be put. If `NULL` no explanations will be generated.
+ * @return False if the arguments were invalid or memory could not be
+ * allocated, in which case `results` holds the fallbacks.
+ */
+LD_EXPORT(LDBoolean)
+LDVariationBatch(
+    struct LDClient *const            client,
+    const struct LDUser *const        user,
+    const char *const *const          keys,
+    const struct LDJSON *const *const fallbacks,
+    const unsigned int                count,
+    struct LDJSON **const             results,
+    struct LDDetails *const           details);
+
 /**
  * @brief Returns a map from feature flag keys to values for a given user.
  * This does not send analytics events back to LaunchDarkly.
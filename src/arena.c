@@ -0,0 +1,129 @@
+#include <string.h>
+
+#include <launchdarkly/boolean.h>
+#include <launchdarkly/memory.h>
+
+#include "arena.h"
+#include "assertion.h"
+
+/* Requests smaller than this share heap blocks of this size. Larger requests
+ * get a block of their own. */
+#define LD_ARENA_BLOCK_SIZE 4096
+
+#define LD_ARENA_ALIGNMENT sizeof(union LDArenaAlign)
+
+struct LDArenaBlock
+{
+    struct LDArenaBlock *next;
+};
+
+/* The size of a block header, rounded so that the data after it is aligned */
+#define LD_ARENA_HEADER_SIZE                                                   \
+    ((sizeof(struct LDArenaBlock) + LD_ARENA_ALIGNMENT - 1) /                  \
+     LD_ARENA_ALIGNMENT * LD_ARENA_ALIGNMENT)
+
+void
+LDi_arenaInit(
+    struct LDArena *const arena, void *const buffer, const size_t bufferSize)
+{
+    LD_ASSERT(arena);
+    LD_ASSERT(buffer || bufferSize == 0);
+
+    arena->current = (char *)buffer;
+    arena->used    = 0;
+    arena->size    = buffer ? bufferSize : 0;
+    arena->blocks  = NULL;
+}
+
+void
+LDi_arenaDestroy(struct LDArena *const arena)
+{
+    struct LDArenaBlock *block, *next;
+
+    LD_ASSERT(arena);
+
+    for (block = arena->blocks; block; block = next) {
+        next = block->next;
+
+        LDFree(block);
+    }
+
+    arena->current = NULL;
+    arena->used    = 0;
+    arena->size    = 0;
+    arena->blocks  = NULL;
+}
+
+/* The rest of the current block is abandoned. */
+static LDBoolean
+addBlock(struct LDArena *const arena, const size_t bytes)
+{
+    struct LDArenaBlock *block;
+    size_t               size;
+
+    size = bytes > LD_ARENA_BLOCK_SIZE ? bytes : LD_ARENA_BLOCK_SIZE;
+
+    if (size > (size_t)-1 - LD_ARENA_HEADER_SIZE) {
+        return LDBooleanFalse;
+    }
+
+    if (!(block = LDAlloc(LD_ARENA_HEADER_SIZE + size))) {
+        return LDBooleanFalse;
+    }
+
+    block->next   = arena->blocks;
+    arena->blocks = block;
+
+    arena->current = (char *)block + LD_ARENA_HEADER_SIZE;
+    arena->used    = 0;
+    arena->size    = size;
+
+    return LDBooleanTrue;
+}
+
+void *
+LDi_arenaAlloc(struct LDArena *const arena, const size_t bytes)
+{
+    size_t rounded;
+    void * result;
+
+    LD_ASSERT(arena);
+
+    if (bytes > (size_t)-1 - LD_ARENA_ALIGNMENT) {
+        return NULL;
+    }
+
+    rounded = (bytes + LD_ARENA_ALIGNMENT - 1) / LD_ARENA_ALIGNMENT *
+              LD_ARENA_ALIGNMENT;
+
+    if (rounded == 0) {
+        rounded = LD_ARENA_ALIGNMENT;
+    }
+
+    if (arena->size - arena->used < rounded && !addBlock(arena, rounded)) {
+        return NULL;
+    }
+
+    result = arena->current + arena->used;
+    arena->used += rounded;
+
+    return result;
+}
+
+char *
+LDi_arenaStrDup(struct LDArena *const arena, const char *const string)
+{
+    size_t length;
+    char * result;
+
+    LD_ASSERT(arena);
+    LD_ASSERT(string);
+
+    length = strlen(string) + 1;
+
+    if ((result = LDi_arenaAlloc(arena, length))) {
+        memcpy(result, string, length);
+    }
+
+    return result;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stddef.h>
+
+/* A bump allocator for temporaries that are all released together, such as
+ * the memos of an evaluation. Individual allocations are never freed.
+ * Not thread safe. */
+
+/* Allocations are aligned as strictly as any member of this union. A buffer
+ * given to LDi_arenaInit should be declared as an array of it. */
+union LDArenaAlign
+{
+    long   l;
+    double d;
+    void * p;
+    void (*f)(void);
+};
+
+struct LDArenaBlock;
+
+struct LDArena
+{
+    /* Where allocations are currently carved from, either the initial buffer
+     * or the most recent heap block. */
+    char * current;
+    size_t used;
+    size_t size;
+    /* Heap blocks, most recent first. */
+    struct LDArenaBlock *blocks;
+};
+
+/* The initial buffer may be NULL. It is used before any heap block, and is
+ * not freed by LDi_arenaDestroy. */
+void
+LDi_arenaInit(
+    struct LDArena *const arena, void *const buffer, const size_t bufferSize);
+
+/* Releases every allocation made from the arena in one step. */
+void
+LDi_arenaDestroy(struct LDArena *const arena);
+
+/* Returns NULL on allocation failure. */
+void *
+LDi_arenaAlloc(struct LDArena *const arena, const size_t bytes);
+
+char *
+LDi_arenaStrDup(struct LDArena *const arena, const char *const string);
@@ -44,6 +44,7 @@ LDClientInit(struct LDConfig *const config, const unsigned int maxwaitmilli)
     client->shouldFlush  = LDBooleanFalse;
     client->shuttingdown = LDBooleanFalse;
     client->config       = config;
+    client->multi        = NULL;
 
     if (!(client->eventProcessor = LDEventProcessor_Create(config))) {
         LDStoreDestroy(client->store);
@@ -89,6 +90,8 @@ LDClientClose(struct LDClient *const client)
         client->shuttingdown = LDBooleanTrue;
         LDi_rwlock_wrunlock(&client->lock);
 
+        LDi_networkWakeup(client);
+
         /* wait until background exits */
         LDi_thread_join(&client->thread);
 
@@ -302,5 +305,7 @@ LDClientFlush(struct LDClient *const client)
     client->shouldFlush = LDBooleanTrue;
     LDi_rwlock_wrunlock(&client->lock);
 
+    LDi_networkWakeup(client);
+
     return LDBooleanTrue;
 }
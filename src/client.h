@@ -1,5 +1,7 @@
 #pragma once
 
+#include <curl/curl.h>
+
 #include <launchdarkly/json.h>
 
 #include "concurrency.h"
@@ -15,4 +17,6 @@ struct LDClient
     LDBoolean              shouldFlush;
     struct LDStore *       store;
     struct LDEventProcessor *eventProcessor;
+    /* the network thread's multi handle while it runs, used to wake it */
+    CURLM *                multi;
 };
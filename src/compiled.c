@@ -0,0 +1,912 @@
+#include <string.h>
+
+#include <uthash.h>
+
+#include <launchdarkly/api.h>
+
+#include "assertion.h"
+#include "compiled.h"
+#include "store/ldjsonrc.h"
+#include "store/store_utilities.h"
+
+#undef uthash_malloc
+#undef uthash_free
+
+#define uthash_malloc(sz) LDAlloc(sz)
+#define uthash_free(ptr, sz) LDFree(ptr)
+
+struct LDKeySetEntry
+{
+    /* Borrowed from the array the set was built from. */
+    const char *   key;
+    UT_hash_handle hh;
+};
+
+struct LDKeySet
+{
+    /* ut hash table */
+    struct LDKeySetEntry *table;
+    /* All entries are allocated together, rather than one at a time. */
+    struct LDKeySetEntry *entries;
+};
+
+/* Returns false if the key is present, not null, and of another type. */
+static LDBoolean
+optionalOfType(
+    const struct LDJSON *const  obj,
+    const char *const           key,
+    const LDJSONType            expectedType,
+    const struct LDJSON **const result)
+{
+    const struct LDJSON *tmp;
+    LDJSONType           actualType;
+
+    *result = NULL;
+
+    if (!(tmp = LDObjectLookup(obj, key))) {
+        return LDBooleanTrue;
+    }
+
+    actualType = LDJSONGetType(tmp);
+
+    if (actualType == LDNull) {
+        return LDBooleanTrue;
+    }
+
+    if (actualType != expectedType) {
+        return LDBooleanFalse;
+    }
+
+    *result = tmp;
+
+    return LDBooleanTrue;
+}
+
+/* Returns false if the key is missing, or of another type. */
+static LDBoolean
+requiredOfType(
+    const struct LDJSON *const  obj,
+    const char *const           key,
+    const LDJSONType            expectedType,
+    const struct LDJSON **const result)
+{
+    const struct LDJSON *tmp;
+
+    *result = NULL;
+
+    if (!(tmp = LDObjectLookup(obj, key))) {
+        return LDBooleanFalse;
+    }
+
+    if (LDJSONGetType(tmp) != expectedType) {
+        return LDBooleanFalse;
+    }
+
+    *result = tmp;
+
+    return LDBooleanTrue;
+}
+
+static const char *
+textOrNull(const struct LDJSON *const obj, const char *const key)
+{
+    const struct LDJSON *tmp;
+
+    if (requiredOfType(obj, key, LDText, &tmp)) {
+        return LDGetText(tmp);
+    }
+
+    return NULL;
+}
+
+static void *
+allocArray(const size_t elementSize, const unsigned int count)
+{
+    void *result;
+
+    if (count == 0) {
+        return NULL;
+    }
+
+    if ((result = LDAlloc(elementSize * count))) {
+        memset(result, 0, elementSize * count);
+    }
+
+    return result;
+}
+
+static void
+keySetFree(struct LDKeySet *const set)
+{
+    if (set) {
+        HASH_CLEAR(hh, set->table);
+        LDFree(set->entries);
+        LDFree(set);
+    }
+}
+
+/* Target and segment lists can hold many thousands of user keys, so they are
+ * indexed rather than searched linearly on every evaluation. Elements which
+ * are not text are ignored. */
+static LDBoolean
+compileKeySet(
+    const struct LDJSON *const array, struct LDKeySet **const result)
+{
+    struct LDKeySet *    set;
+    const struct LDJSON *iter;
+    unsigned int         used;
+
+    *result = NULL;
+
+    if (!(set = allocArray(sizeof(struct LDKeySet), 1))) {
+        return LDBooleanFalse;
+    }
+
+    if (!(set->entries = allocArray(
+              sizeof(struct LDKeySetEntry), LDCollectionGetSize(array))) &&
+        LDCollectionGetSize(array))
+    {
+        LDFree(set);
+
+        return LDBooleanFalse;
+    }
+
+    used = 0;
+
+    for (iter = LDGetIter(array); iter; iter = LDIterNext(iter)) {
+        struct LDKeySetEntry *entry, *existing;
+        const char *          key;
+        size_t                keyLength;
+
+        if (LDJSONGetType(iter) != LDText) {
+            continue;
+        }
+
+        key       = LDGetText(iter);
+        keyLength = strlen(key);
+
+        HASH_FIND(hh, set->table, key, keyLength, existing);
+
+        if (existing) {
+            continue;
+        }
+
+        entry      = &set->entries[used++];
+        entry->key = key;
+
+        HASH_ADD_KEYPTR(hh, set->table, entry->key, keyLength, entry);
+    }
+
+    *result = set;
+
+    return LDBooleanTrue;
+}
+
+LDBoolean
+LDi_keySetContains(const struct LDKeySet *const set, const char *const key)
+{
+    struct LDKeySetEntry *entry;
+
+    LD_ASSERT(set);
+    LD_ASSERT(key);
+
+    HASH_FIND(hh, set->table, key, strlen(key), entry);
+
+    return entry != NULL;
+}
+
+static int
+compileVariationIndex(
+    const struct LDJSON *const index, const unsigned int variationCount)
+{
+    double value;
+
+    if (LDJSONGetType(index) != LDNumber) {
+        return LD_INVALID_VARIATION;
+    }
+
+    value = LDGetNumber(index);
+
+    if (value < 0 || value >= variationCount) {
+        return LD_INVALID_VARIATION;
+    }
+
+    return (int)value;
+}
+
+/* Regular expressions are compiled once here, rather than on every
+ * evaluation. They live as long as the compiled clause, so replacing or
+ * deleting a flag releases them. */
+static LDBoolean
+compileRegexes(struct LDCompiledClause *const result)
+{
+    const struct LDJSON *iter;
+    unsigned int         index;
+
+    if (!(result->regexes = allocArray(
+              sizeof(struct LDRegex *), LDCollectionGetSize(result->values))))
+    {
+        return LDCollectionGetSize(result->values) == 0;
+    }
+
+    index = 0;
+
+    for (iter = LDGetIter(result->values); iter; iter = LDIterNext(iter)) {
+        if (LDJSONGetType(iter) == LDText) {
+            result->regexes[index] = LDi_regexCompile(LDGetText(iter));
+        }
+
+        index++;
+    }
+
+    return LDBooleanTrue;
+}
+
+static void
+freeClause(struct LDCompiledClause *const clause)
+{
+    if (clause->regexes) {
+        unsigned int i, count;
+
+        count = LDCollectionGetSize(clause->values);
+
+        for (i = 0; i < count; i++) {
+            LDi_regexFree(clause->regexes[i]);
+        }
+
+        LDFree(clause->regexes);
+    }
+}
+
+static void
+freeClauses(
+    struct LDCompiledClause *const clauses, const unsigned int clauseCount)
+{
+    unsigned int i;
+
+    for (i = 0; i < clauseCount; i++) {
+        freeClause(&clauses[i]);
+    }
+
+    LDFree(clauses);
+}
+
+static LDBoolean
+compileClause(
+    const struct LDJSON *const clause, struct LDCompiledClause *const result)
+{
+    const struct LDJSON *op, *attribute, *values, *negate;
+
+    result->op          = LD_OP_UNKNOWN;
+    result->attributeID = LD_USER_ATTRIBUTE_CUSTOM;
+
+    if (LDJSONGetType(clause) != LDObject ||
+        !requiredOfType(clause, "op", LDText, &op))
+    {
+        result->malformed = LDBooleanTrue;
+
+        return LDBooleanTrue;
+    }
+
+    result->op = LDi_parseOperator(LDGetText(op));
+    result->fn = LDi_operatorFunction(result->op);
+
+    if (!optionalOfType(clause, "values", LDArray, &values)) {
+        result->operandsMalformed = LDBooleanTrue;
+    }
+
+    result->values = values;
+
+    if (requiredOfType(clause, "attribute", LDText, &attribute)) {
+        result->attribute   = LDGetText(attribute);
+        result->attributeID = LDi_parseUserAttribute(result->attribute);
+    } else if (result->op != LD_OP_SEGMENT_MATCH) {
+        result->operandsMalformed = LDBooleanTrue;
+    }
+
+    if (!optionalOfType(clause, "negate", LDBool, &negate)) {
+        result->negateMalformed = LDBooleanTrue;
+    } else if (negate) {
+        result->negate = LDGetBool(negate);
+    }
+
+    if (result->op == LD_OP_MATCHES && values) {
+        return compileRegexes(result);
+    }
+
+    return LDBooleanTrue;
+}
+
+static LDBoolean
+compileClauses(
+    const struct LDJSON *const       clauses,
+    struct LDCompiledClause **const  result,
+    unsigned int *const              resultCount)
+{
+    const struct LDJSON *iter;
+    unsigned int         index, count;
+
+    count = LDCollectionGetSize(clauses);
+
+    /* The count is only set with its array, so that a partly compiled item
+     * can always be freed. */
+    if (!(*result = allocArray(sizeof(struct LDCompiledClause), count)) &&
+        count)
+    {
+        return LDBooleanFalse;
+    }
+
+    *resultCount = count;
+
+    index = 0;
+
+    for (iter = LDGetIter(clauses); iter; iter = LDIterNext(iter)) {
+        if (!compileClause(iter, &(*result)[index++])) {
+            return LDBooleanFalse;
+        }
+    }
+
+    return LDBooleanTrue;
+}
+
+static LDBoolean
+compileBucketBy(
+    const struct LDJSON *const obj,
+    const char **const         bucketBy,
+    LDUserAttribute *const     bucketByID)
+{
+    const struct LDJSON *tmp;
+
+    if (!optionalOfType(obj, "bucketBy", LDText, &tmp)) {
+        return LDBooleanFalse;
+    }
+
+    *bucketBy   = tmp ? LDGetText(tmp) : "key";
+    *bucketByID = LDi_parseUserAttribute(*bucketBy);
+
+    return LDBooleanTrue;
+}
+
+static void
+compileWeightedVariation(
+    const struct LDJSON *const                weighted,
+    const unsigned int                        variationCount,
+    struct LDCompiledWeightedVariation *const result)
+{
+    const struct LDJSON *weight, *variation, *untracked;
+
+    if (LDJSONGetType(weighted) != LDObject ||
+        !requiredOfType(weighted, "weight", LDNumber, &weight) ||
+        !requiredOfType(weighted, "variation", LDNumber, &variation) ||
+        !optionalOfType(weighted, "untracked", LDBool, &untracked))
+    {
+        result->malformed = LDBooleanTrue;
+
+        return;
+    }
+
+    result->weight    = LDGetNumber(weight);
+    result->variation = compileVariationIndex(variation, variationCount);
+    result->untracked = untracked ? LDGetBool(untracked) : LDBooleanFalse;
+}
+
+static LDBoolean
+compileVariationOrRollout(
+    const struct LDJSON *const                 varOrRoll,
+    const unsigned int                         variationCount,
+    struct LDCompiledVariationOrRollout *const result)
+{
+    const struct LDJSON *variation, *rollout, *kind, *variations, *seed, *iter;
+    unsigned int         index;
+
+    if (!varOrRoll || LDJSONGetType(varOrRoll) != LDObject ||
+        !optionalOfType(varOrRoll, "variation", LDNumber, &variation))
+    {
+        result->malformed = LDBooleanTrue;
+
+        return LDBooleanTrue;
+    }
+
+    if (variation) {
+        result->variation = compileVariationIndex(variation, variationCount);
+
+        return LDBooleanTrue;
+    }
+
+    if (!requiredOfType(varOrRoll, "rollout", LDObject, &rollout) ||
+        !optionalOfType(rollout, "kind", LDText, &kind) ||
+        !requiredOfType(rollout, "variations", LDArray, &variations) ||
+        LDCollectionGetSize(variations) == 0 ||
+        !compileBucketBy(rollout, &result->bucketBy, &result->bucketByID) ||
+        !optionalOfType(rollout, "seed", LDNumber, &seed))
+    {
+        result->malformed = LDBooleanTrue;
+
+        return LDBooleanTrue;
+    }
+
+    result->isRollout    = LDBooleanTrue;
+    result->isExperiment = (LDBoolean)(
+        kind && strcmp(LDGetText(kind), "experiment") == 0);
+
+    if (seed) {
+        result->hasSeed = LDBooleanTrue;
+        result->seed    = (int)LDGetNumber(seed);
+    }
+
+    result->variationCount = LDCollectionGetSize(variations);
+
+    if (!(result->variations = allocArray(
+              sizeof(struct LDCompiledWeightedVariation),
+              result->variationCount)))
+    {
+        return LDBooleanFalse;
+    }
+
+    index = 0;
+
+    for (iter = LDGetIter(variations); iter; iter = LDIterNext(iter)) {
+        compileWeightedVariation(
+            iter, variationCount, &result->variations[index++]);
+    }
+
+    return LDBooleanTrue;
+}
+
+static void
+freeVariationOrRollout(struct LDCompiledVariationOrRollout *const varOrRoll)
+{
+    LDFree(varOrRoll->variations);
+}
+
+static LDBoolean
+compilePrerequisites(
+    const struct LDJSON *const  prerequisites,
+    struct LDCompiledFlag *const result)
+{
+    const struct LDJSON *iter;
+    unsigned int         index;
+
+    result->prerequisiteCount = LDCollectionGetSize(prerequisites);
+
+    if (!(result->prerequisites = allocArray(
+              sizeof(struct LDCompiledPrerequisite),
+              result->prerequisiteCount)) &&
+        result->prerequisiteCount)
+    {
+        return LDBooleanFalse;
+    }
+
+    index = 0;
+
+    for (iter = LDGetIter(prerequisites); iter; iter = LDIterNext(iter)) {
+        struct LDCompiledPrerequisite *const prerequisite =
+            &result->prerequisites[index++];
+        const struct LDJSON *key, *variation;
+
+        if (LDJSONGetType(iter) != LDObject ||
+            !requiredOfType(iter, "key", LDText, &key) ||
+            !requiredOfType(iter, "variation", LDNumber, &variation))
+        {
+            prerequisite->malformed = LDBooleanTrue;
+
+            continue;
+        }
+
+        prerequisite->key       = LDGetText(key);
+        prerequisite->variation = LDGetNumber(variation);
+    }
+
+    return LDBooleanTrue;
+}
+
+static LDBoolean
+compileTargets(
+    const struct LDJSON *const   targets,
+    struct LDCompiledFlag *const result)
+{
+    const struct LDJSON *iter;
+    unsigned int         index, count;
+
+    count = LDCollectionGetSize(targets);
+
+    if (!(result->targets = allocArray(
+              sizeof(struct LDCompiledTarget), count)) &&
+        count)
+    {
+        return LDBooleanFalse;
+    }
+
+    result->targetCount = count;
+
+    index = 0;
+
+    for (iter = LDGetIter(targets); iter; iter = LDIterNext(iter)) {
+        struct LDCompiledTarget *const target = &result->targets[index++];
+        const struct LDJSON *          values, *variation;
+
+        if (LDJSONGetType(iter) != LDObject ||
+            !optionalOfType(iter, "values", LDArray, &values))
+        {
+            target->malformed = LDBooleanTrue;
+
+            continue;
+        }
+
+        if (values && !compileKeySet(values, &target->values)) {
+            return LDBooleanFalse;
+        }
+
+        if (requiredOfType(iter, "variation", LDNumber, &variation)) {
+            target->variation =
+                compileVariationIndex(variation, result->variationCount);
+        } else {
+            target->variationMalformed = LDBooleanTrue;
+        }
+    }
+
+    return LDBooleanTrue;
+}
+
+static LDBoolean
+compileRules(
+    const struct LDJSON *const   rules,
+    struct LDCompiledFlag *const result)
+{
+    const struct LDJSON *iter;
+    unsigned int         index, count;
+
+    count = LDCollectionGetSize(rules);
+
+    if (!(result->rules = allocArray(sizeof(struct LDCompiledRule), count)) &&
+        count)
+    {
+        return LDBooleanFalse;
+    }
+
+    result->ruleCount = count;
+
+    index = 0;
+
+    for (iter = LDGetIter(rules); iter; iter = LDIterNext(iter)) {
+        struct LDCompiledRule *const rule = &result->rules[index++];
+        const struct LDJSON *        clauses, *id;
+
+        if (LDJSONGetType(iter) != LDObject ||
+            !optionalOfType(iter, "clauses", LDArray, &clauses))
+        {
+            rule->malformed = LDBooleanTrue;
+
+            continue;
+        }
+
+        if (clauses &&
+            !compileClauses(clauses, &rule->clauses, &rule->clauseCount))
+        {
+            return LDBooleanFalse;
+        }
+
+        if (!compileVariationOrRollout(
+                iter, result->variationCount, &rule->variationOrRollout))
+        {
+            return LDBooleanFalse;
+        }
+
+        if (!optionalOfType(iter, "id", LDText, &id)) {
+            rule->idMalformed = LDBooleanTrue;
+        } else if (id) {
+            rule->id = LDGetText(id);
+        }
+    }
+
+    return LDBooleanTrue;
+}
+
+static LDBoolean
+compileVariations(
+    const struct LDJSON *const flag, struct LDCompiledFlag *const result)
+{
+    const struct LDJSON *variations, *iter;
+    unsigned int         index;
+
+    if (!requiredOfType(flag, "variations", LDArray, &variations)) {
+        return LDBooleanTrue;
+    }
+
+    result->variationCount = LDCollectionGetSize(variations);
+
+    if (!(result->variations = allocArray(
+              sizeof(const struct LDJSON *), result->variationCount)) &&
+        result->variationCount)
+    {
+        return LDBooleanFalse;
+    }
+
+    index = 0;
+
+    for (iter = LDGetIter(variations); iter; iter = LDIterNext(iter)) {
+        result->variations[index++] = iter;
+    }
+
+    return LDBooleanTrue;
+}
+
+struct LDCompiledFlag *
+LDi_compileFlag(const struct LDJSON *const flag)
+{
+    struct LDCompiledFlag *result;
+    const struct LDJSON *  tmp;
+
+    LD_ASSERT(flag);
+
+    if (!(result = allocArray(sizeof(struct LDCompiledFlag), 1))) {
+        return NULL;
+    }
+
+    result->json = flag;
+
+    if (LDJSONGetType(flag) != LDObject) {
+        result->malformed = LDBooleanTrue;
+
+        return result;
+    }
+
+    result->key  = textOrNull(flag, "key");
+    result->salt = textOrNull(flag, "salt");
+
+    if (!compileVariations(flag, result)) {
+        goto error;
+    }
+
+    if (!optionalOfType(flag, "on", LDBool, &tmp)) {
+        result->onMalformed = LDBooleanTrue;
+    } else if (tmp) {
+        result->on = LDGetBool(tmp);
+    }
+
+    /* It is valid for the offVariation to either be unspecified or to be null. */
+    if ((tmp = LDObjectLookup(flag, "offVariation")) &&
+        LDJSONGetType(tmp) != LDNull)
+    {
+        result->hasOffVariation = LDBooleanTrue;
+        result->offVariation =
+            compileVariationIndex(tmp, result->variationCount);
+    }
+
+    if (!optionalOfType(flag, "prerequisites", LDArray, &tmp)) {
+        result->prerequisitesMalformed = LDBooleanTrue;
+    } else if (tmp && !compilePrerequisites(tmp, result)) {
+        goto error;
+    }
+
+    if (!optionalOfType(flag, "targets", LDArray, &tmp)) {
+        result->targetsMalformed = LDBooleanTrue;
+    } else if (tmp && !compileTargets(tmp, result)) {
+        goto error;
+    }
+
+    if (!optionalOfType(flag, "rules", LDArray, &tmp)) {
+        result->rulesMalformed = LDBooleanTrue;
+    } else if (tmp && !compileRules(tmp, result)) {
+        goto error;
+    }
+
+    if (!compileVariationOrRollout(
+            LDObjectLookup(flag, "fallthrough"),
+            result->variationCount,
+            &result->fallthrough))
+    {
+        goto error;
+    }
+
+    return result;
+
+error:
+    LDi_compiledFlagFree(result);
+
+    return NULL;
+}
+
+void
+LDi_compiledFlagFree(struct LDCompiledFlag *const flag)
+{
+    if (flag) {
+        unsigned int i;
+
+        for (i = 0; i < flag->ruleCount; i++) {
+            freeClauses(flag->rules[i].clauses, flag->rules[i].clauseCount);
+            freeVariationOrRollout(&flag->rules[i].variationOrRollout);
+        }
+
+        for (i = 0; i < flag->targetCount; i++) {
+            keySetFree(flag->targets[i].values);
+        }
+
+        freeVariationOrRollout(&flag->fallthrough);
+        LDFree(flag->rules);
+        LDFree(flag->targets);
+        LDFree(flag->prerequisites);
+        LDFree(flag->variations);
+        LDFree(flag);
+    }
+}
+
+static LDBoolean
+compileSegmentRules(
+    const struct LDJSON *const      rules,
+    struct LDCompiledSegment *const result)
+{
+    const struct LDJSON *iter;
+    unsigned int         index, count;
+
+    count = LDCollectionGetSize(rules);
+
+    if (!(result->rules = allocArray(
+              sizeof(struct LDCompiledSegmentRule), count)) &&
+        count)
+    {
+        return LDBooleanFalse;
+    }
+
+    result->ruleCount = count;
+
+    index = 0;
+
+    for (iter = LDGetIter(rules); iter; iter = LDIterNext(iter)) {
+        struct LDCompiledSegmentRule *const rule = &result->rules[index++];
+        const struct LDJSON *               clauses, *weight;
+
+        if (LDJSONGetType(iter) != LDObject ||
+            !optionalOfType(iter, "clauses", LDArray, &clauses))
+        {
+            rule->malformed = LDBooleanTrue;
+
+            continue;
+        }
+
+        if (clauses &&
+            !compileClauses(clauses, &rule->clauses, &rule->clauseCount))
+        {
+            return LDBooleanFalse;
+        }
+
+        /* The bucketBy attribute is only used, and validated, when there is a
+         * weight. */
+        if (!optionalOfType(iter, "weight", LDNumber, &weight)) {
+            rule->weightMalformed = LDBooleanTrue;
+        } else if (weight) {
+            rule->hasWeight = LDBooleanTrue;
+            rule->weight    = LDGetNumber(weight);
+
+            if (!compileBucketBy(iter, &rule->bucketBy, &rule->bucketByID)) {
+                rule->weightMalformed = LDBooleanTrue;
+            }
+        }
+    }
+
+    return LDBooleanTrue;
+}
+
+struct LDCompiledSegment *
+LDi_compileSegment(const struct LDJSON *const segment)
+{
+    struct LDCompiledSegment *result;
+    const struct LDJSON *     rules, *included, *excluded;
+
+    LD_ASSERT(segment);
+
+    if (!(result = allocArray(sizeof(struct LDCompiledSegment), 1))) {
+        return NULL;
+    }
+
+    result->json = segment;
+
+    if (LDJSONGetType(segment) != LDObject) {
+        result->malformed = LDBooleanTrue;
+
+        return result;
+    }
+
+    result->key  = textOrNull(segment, "key");
+    result->salt = textOrNull(segment, "salt");
+
+    if (!optionalOfType(segment, "included", LDArray, &included)) {
+        result->includedMalformed = LDBooleanTrue;
+    } else if (included && !compileKeySet(included, &result->included)) {
+        goto error;
+    }
+
+    if (!optionalOfType(segment, "excluded", LDArray, &excluded)) {
+        result->excludedMalformed = LDBooleanTrue;
+    } else if (excluded && !compileKeySet(excluded, &result->excluded)) {
+        goto error;
+    }
+
+    if (!optionalOfType(segment, "rules", LDArray, &rules)) {
+        result->rulesMalformed = LDBooleanTrue;
+    } else if (rules) {
+        result->hasRules = LDBooleanTrue;
+
+        if (!compileSegmentRules(rules, result)) {
+            goto error;
+        }
+    }
+
+    return result;
+
+error:
+    LDi_compiledSegmentFree(result);
+
+    return NULL;
+}
+
+void
+LDi_compiledSegmentFree(struct LDCompiledSegment *const segment)
+{
+    if (segment) {
+        unsigned int i;
+
+        for (i = 0; i < segment->ruleCount; i++) {
+            freeClauses(
+                segment->rules[i].clauses, segment->rules[i].clauseCount);
+        }
+
+        keySetFree(segment->included);
+        keySetFree(segment->excluded);
+        LDFree(segment->rules);
+        LDFree(segment);
+    }
+}
+
+static void
+compiledFlagDestructor(void *const flag)
+{
+    LDi_compiledFlagFree((struct LDCompiledFlag *)flag);
+}
+
+static void
+compiledSegmentDestructor(void *const segment)
+{
+    LDi_compiledSegmentFree((struct LDCompiledSegment *)segment);
+}
+
+struct LDJSONRC *
+LDi_newCompiledRC(const enum FeatureKind kind, struct LDJSON *const item)
+{
+    struct LDJSONRC *result;
+
+    LD_ASSERT(item);
+
+    if (!(result = LDJSONRCNew(item))) {
+        LDJSONFree(item);
+
+        return NULL;
+    }
+
+    if (LDi_isDataDeleted(item)) {
+        return result;
+    }
+
+    /* If compilation fails the item is still usable, it is compiled on demand
+     * at evaluation time instead. */
+    switch (kind) {
+        case LD_FLAG: {
+            struct LDCompiledFlag *flag;
+
+            if ((flag = LDi_compileFlag(item))) {
+                LDJSONRCSetCompiled(result, flag, compiledFlagDestructor);
+            }
+        } break;
+        case LD_SEGMENT: {
+            struct LDCompiledSegment *segment;
+
+            if ((segment = LDi_compileSegment(item))) {
+                LDJSONRCSetCompiled(result, segment, compiledSegmentDestructor);
+            }
+        } break;
+        default:
+            break;
+    }
+
+    return result;
+}
@@ -0,0 +1,187 @@
+/*!
+ * @file compiled.h
+ * @brief Internal API Interface for compiled flags and segments
+ *
+ * Flags and segments are compiled once when they enter the store, so that
+ * evaluation does not have to look up object keys and check types on every
+ * call. All strings and values are borrowed from the JSON the flag or segment
+ * was compiled from, which must outlive the compiled representation.
+ *
+ * Compilation never rejects data. Schema problems are recorded on the element
+ * they were found in, and reported by the evaluator only when it reaches that
+ * element; the same point at which the raw JSON would have failed validation.
+ */
+
+#pragma once
+
+#include <launchdarkly/json.h>
+
+#include "operators.h"
+#include "store.h"
+#include "user.h"
+
+/* Variation indices which are present, but negative or out of bounds. */
+#define LD_INVALID_VARIATION -1
+
+/* A set of the text elements of an array, for constant time membership. */
+struct LDKeySet;
+
+struct LDCompiledClause
+{
+    /* Not an object, or op is missing or mistyped. */
+    LDBoolean           malformed;
+    LDOperator          op;
+    /* NULL for unknown operators, and for segmentMatch. */
+    OpFn                fn;
+    /* Mistyped values, or a missing attribute for operators that use one. */
+    LDBoolean           operandsMalformed;
+    const char *        attribute;
+    LDUserAttribute     attributeID;
+    /* Array, or NULL when absent. */
+    const struct LDJSON *values;
+    /* For the matches operator, one per element of values. An entry is NULL
+     * when the element is not text, or is not a valid expression. */
+    struct LDRegex **   regexes;
+    LDBoolean           negate;
+    LDBoolean           negateMalformed;
+};
+
+struct LDCompiledWeightedVariation
+{
+    /* Missing or mistyped weight, variation, or untracked. */
+    LDBoolean malformed;
+    int       variation;
+    double    weight;
+    LDBoolean untracked;
+};
+
+struct LDCompiledVariationOrRollout
+{
+    /* Missing, not an object, or has neither a variation nor a valid rollout. */
+    LDBoolean                           malformed;
+    LDBoolean                           isRollout;
+    /* Used when isRollout is false. */
+    int                                 variation;
+    LDBoolean                           isExperiment;
+    const char *                        bucketBy;
+    LDUserAttribute                     bucketByID;
+    LDBoolean                           hasSeed;
+    int                                 seed;
+    struct LDCompiledWeightedVariation *variations;
+    unsigned int                        variationCount;
+};
+
+struct LDCompiledPrerequisite
+{
+    LDBoolean   malformed;
+    const char *key;
+    double      variation;
+};
+
+struct LDCompiledTarget
+{
+    /* Not an object, or values is not an array. */
+    LDBoolean            malformed;
+    /* NULL when absent. */
+    struct LDKeySet *    values;
+    /* Variation is missing or not a number. */
+    LDBoolean            variationMalformed;
+    int                  variation;
+};
+
+struct LDCompiledRule
+{
+    /* Not an object, or clauses is not an array. */
+    LDBoolean                           malformed;
+    struct LDCompiledClause *           clauses;
+    unsigned int                        clauseCount;
+    struct LDCompiledVariationOrRollout variationOrRollout;
+    const char *                        id;
+    LDBoolean                           idMalformed;
+};
+
+struct LDCompiledFlag
+{
+    /* The flag this was compiled from. */
+    const struct LDJSON *                json;
+    /* The flag is not an object. */
+    LDBoolean                            malformed;
+    /* NULL when missing or not text. */
+    const char *                         key;
+    const char *                         salt;
+    LDBoolean                            on;
+    LDBoolean                            onMalformed;
+    LDBoolean                            hasOffVariation;
+    int                                  offVariation;
+    LDBoolean                            prerequisitesMalformed;
+    struct LDCompiledPrerequisite *      prerequisites;
+    unsigned int                         prerequisiteCount;
+    LDBoolean                            targetsMalformed;
+    struct LDCompiledTarget *            targets;
+    unsigned int                         targetCount;
+    LDBoolean                            rulesMalformed;
+    struct LDCompiledRule *              rules;
+    unsigned int                         ruleCount;
+    struct LDCompiledVariationOrRollout  fallthrough;
+    const struct LDJSON **               variations;
+    unsigned int                         variationCount;
+};
+
+struct LDCompiledSegmentRule
+{
+    /* Not an object, or clauses is not an array. */
+    LDBoolean                malformed;
+    struct LDCompiledClause *clauses;
+    unsigned int             clauseCount;
+    /* Mistyped weight or bucketBy. */
+    LDBoolean                weightMalformed;
+    LDBoolean                hasWeight;
+    double                   weight;
+    const char *             bucketBy;
+    LDUserAttribute          bucketByID;
+};
+
+struct LDCompiledSegment
+{
+    /* The segment this was compiled from. */
+    const struct LDJSON *          json;
+    /* The segment is not an object. */
+    LDBoolean                      malformed;
+    /* NULL when missing or not text. */
+    const char *                   key;
+    const char *                   salt;
+    LDBoolean                      includedMalformed;
+    /* NULL when absent. */
+    struct LDKeySet *              included;
+    LDBoolean                      excludedMalformed;
+    struct LDKeySet *              excluded;
+    LDBoolean                      rulesMalformed;
+    /* False when rules is absent. */
+    LDBoolean                      hasRules;
+    struct LDCompiledSegmentRule * rules;
+    unsigned int                   ruleCount;
+};
+
+LDBoolean
+LDi_keySetContains(const struct LDKeySet *const set, const char *const key);
+
+/* Returns NULL only on allocation failure. */
+struct LDCompiledFlag *
+LDi_compileFlag(const struct LDJSON *const flag);
+
+void
+LDi_compiledFlagFree(struct LDCompiledFlag *const flag);
+
+/* Returns NULL only on allocation failure. */
+struct LDCompiledSegment *
+LDi_compileSegment(const struct LDJSON *const segment);
+
+void
+LDi_compiledSegmentFree(struct LDCompiledSegment *const segment);
+
+/* Wraps a flag or segment for storage, attaching its compiled representation.
+ * Deleted items, and items that could not be compiled due to allocation
+ * failure, are stored without one. Takes ownership of the item. Returns NULL
+ * if the LDJSONRC could not be allocated, in which case the item is freed. */
+struct LDJSONRC *
+LDi_newCompiledRC(const enum FeatureKind kind, struct LDJSON *const item);
@@ -94,9 +94,12 @@ LDConfigNew(const char *const key)
     config->userKeysFlushInterval  = 300000;
     config->storeBackend           = NULL;
     config->storeCacheMilliseconds = 30 * 1000;
+    config->storeRefreshAhead      = LDBooleanFalse;
     config->wrapperName            = NULL;
     config->wrapperVersion         = NULL;
     config->dataSource             = NULL;
+    config->allFlagsThreads        = 1;
+    config->compressEvents         = LDBooleanFalse;
 
     return config;
 
@@ -489,6 +492,25 @@ LDConfigSetFeatureStoreBackendCacheTTL(
     config->storeCacheMilliseconds = milliseconds;
 }
 
+void
+LDConfigSetFeatureStoreBackendRefreshAhead(
+    struct LDConfig *const config, const LDBoolean refreshAhead)
+{
+    LD_ASSERT_API(config);
+
+#ifdef LAUNCHDARKLY_DEFENSIVE
+    if (config == NULL) {
+        LD_LOG(
+            LD_LOG_WARNING,
+            "LDConfigSetFeatureStoreBackendRefreshAhead NULL config");
+
+        return;
+    }
+#endif
+
+    config->storeRefreshAhead = refreshAhead;
+}
+
 LDBoolean
 LDConfigSetWrapperInfo(
     struct LDConfig *const config,
@@ -552,3 +574,45 @@ LDConfigSetWrapperInfo(
 
     return LDBooleanTrue;
 }
+
+void
+LDConfigSetAllFlagsThreads(
+    struct LDConfig *const config, const unsigned int threads)
+{
+    LD_ASSERT_API(config);
+
+#ifdef LAUNCHDARKLY_DEFENSIVE
+    if (config == NULL) {
+        LD_LOG(LD_LOG_WARNING, "LDConfigSetAllFlagsThreads NULL config");
+
+        return;
+    }
+#endif
+
+    config->allFlagsThreads = threads ? threads : 1;
+}
+
+void
+LDConfigSetCompressEvents(
+    struct LDConfig *const config, const LDBoolean compressEvents)
+{
+    LD_ASSERT_API(config);
+
+#ifdef LAUNCHDARKLY_DEFENSIVE
+    if (config == NULL) {
+        LD_LOG(LD_LOG_WARNING, "LDConfigSetCompressEvents NULL config");
+
+        return;
+    }
+#endif
+
+#ifndef LAUNCHDARKLY_EVENT_COMPRESSION
+    if (compressEvents) {
+        LD_LOG(
+            LD_LOG_WARNING,
+            "LDConfigSetCompressEvents SDK built without EVENT_COMPRESSION");
+    }
+#endif
+
+    config->compressEvents = compressEvents;
+}
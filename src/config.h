@@ -25,9 +25,12 @@ struct LDConfig
     unsigned int             userKeysFlushInterval;
     struct LDStoreInterface *storeBackend;
     unsigned int             storeCacheMilliseconds;
+    LDBoolean                storeRefreshAhead;
     char *                   wrapperName;
     char *                   wrapperVersion;
     struct LDDataSource     *dataSource;
+    unsigned int             allFlagsThreads;
+    LDBoolean                compressEvents;
 };
 
 /* Trims a single trailing slash, if present, from the end of the given string.
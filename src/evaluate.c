@@ -2,12 +2,12 @@
 
 #include "sha1.h"
 
-#include <hexify.h>
 #include <launchdarkly/api.h>
 
 #include "assertion.h"
 #include "client.h"
 #include "evaluate.h"
+#include "evaluation_context.h"
 #include "event_processor.h"
 #include "network.h"
 #include "operators.h"
@@ -16,74 +16,15 @@
 #include "utility.h"
 #include "time_utils.h"
 
-static const struct LDJSON *
-lookupRequiredValueOfType(
-    const struct LDJSON *const obj,
-    const char *const          context,
-    const char *const          key,
-    const LDJSONType           expectedType)
-{
-    const struct LDJSON *tmp;
-
-    LD_ASSERT(context);
-    LD_ASSERT(key);
-    LD_ASSERT(obj);
-    LD_ASSERT(LDJSONGetType(obj) == LDObject);
-
-    if (!(tmp = LDObjectLookup(obj, key))) {
-        LD_LOG_2(LD_LOG_ERROR, "%s missing required field %s", context, key);
-
-        return NULL;
-    }
-
-    if (LDJSONGetType(tmp) != expectedType) {
-        LD_LOG_2(LD_LOG_ERROR, "%s.%s unexpected type", context, key);
-
-        return NULL;
-    }
-
-    return tmp;
-}
-
 static LDBoolean
-lookupOptionalValueOfType(
-    const struct LDJSON *const  obj,
-    const char *const           context,
-    const char *const           key,
-    const LDJSONType            expectedType,
-    const struct LDJSON **const result)
-{
-    const struct LDJSON *tmp;
-    LDJSONType           actualType;
-
-    LD_ASSERT(context);
-    LD_ASSERT(key);
-    LD_ASSERT(obj);
-    LD_ASSERT(LDJSONGetType(obj) == LDObject);
-    LD_ASSERT(result);
-
-    *result = NULL;
-
-    if (!(tmp = LDObjectLookup(obj, key))) {
-        return LDBooleanTrue;
-    }
-
-    actualType = LDJSONGetType(tmp);
-
-    if (actualType == LDNull) {
-        return LDBooleanTrue;
-    }
-
-    if (actualType != expectedType) {
-        LD_LOG_2(LD_LOG_ERROR, "%s.%s unexpected type", context, key);
-
-        return LDBooleanFalse;
-    }
-
-    *result = tmp;
-
-    return LDBooleanTrue;
-}
+bucketUser(
+    const struct LDUser *const user,
+    const char *const          segmentKey,
+    const LDUserAttribute      attributeID,
+    const char *const          attribute,
+    const char *const          salt,
+    const int *const           seed,
+    float *const               bucket);
 
 LDBoolean
 LDi_isEvalError(const EvalStatus status)
@@ -92,28 +33,26 @@ LDi_isEvalError(const EvalStatus status)
 }
 
 static EvalStatus
-maybeNegate(const struct LDJSON *const clause, const EvalStatus status)
+maybeNegate(
+    const struct LDCompiledClause *const clause, const EvalStatus status)
 {
-    const struct LDJSON *negate;
-
     LD_ASSERT(clause);
 
     if (LDi_isEvalError(status)) {
         return status;
     }
 
-    if (!lookupOptionalValueOfType(clause, "clause", "negate", LDBool, &negate))
-    {
+    if (clause->negateMalformed) {
+        LD_LOG(LD_LOG_ERROR, "clause.negate unexpected type");
+
         return EVAL_SCHEMA;
     }
 
-    if (negate) {
-        if (LDGetBool(negate)) {
-            if (status == EVAL_MATCH) {
-                return EVAL_MISS;
-            } else if (status == EVAL_MISS) {
-                return EVAL_MATCH;
-            }
+    if (clause->negate) {
+        if (status == EVAL_MATCH) {
+            return EVAL_MISS;
+        } else if (status == EVAL_MISS) {
+            return EVAL_MATCH;
         }
     }
 
@@ -122,58 +61,23 @@ maybeNegate(const struct LDJSON *const clause, const EvalStatus status)
 
 static LDBoolean
 getValue(
-    const struct LDJSON *const flag,
-    struct LDJSON **           result,
-    const struct LDJSON *const index,
-    EvalStatus *o_error,
-    unsigned int *validatedVariationIndex)
+    const struct LDCompiledFlag *const flag,
+    struct LDJSON **                   result,
+    const int                          index,
+    EvalStatus *                       o_error)
 {
-    struct LDJSON *      variationCopy;
-    const struct LDJSON *variations, *variation;
-
-    double unvalidatedVariationIndex;
-
-    LD_ASSERT(validatedVariationIndex);
-
-    if (index == NULL) {
-        LD_LOG(LD_LOG_ERROR, "null variation index");
+    struct LDJSON *variationCopy;
 
-        *o_error = EVAL_SCHEMA;
-        return LDBooleanFalse;
-    }
-
-    if (LDJSONGetType(index) != LDNumber) {
-        LD_LOG(LD_LOG_ERROR, "variation index expected number");
-
-        *o_error = EVAL_SCHEMA;
-        return LDBooleanFalse;
-    }
+    if (index == LD_INVALID_VARIATION) {
+        LD_LOG(LD_LOG_ERROR, "variation index invalid or outside of bounds");
 
-    unvalidatedVariationIndex = LDGetNumber(index);
-    if (unvalidatedVariationIndex < 0) {
-        LD_LOG(LD_LOG_ERROR, "variation index negative");
-
-        *o_error = EVAL_SCHEMA;
-        return LDBooleanFalse;
-    }
-
-    *validatedVariationIndex = (unsigned int) unvalidatedVariationIndex;
-
-    if (!(variations =
-              lookupRequiredValueOfType(flag, "flag", "variations", LDArray)))
-    {
         *o_error = EVAL_SCHEMA;
         return LDBooleanFalse;
     }
 
-    if (!(variation = LDArrayLookup(variations, *validatedVariationIndex))) {
-        LD_LOG(LD_LOG_ERROR, "variation index outside of bounds");
-
-        *o_error = EVAL_SCHEMA;
-        return LDBooleanFalse;
-    }
+    LD_ASSERT((unsigned int)index < flag->variationCount);
 
-    if (!(variationCopy = LDJSONDuplicate(variation))) {
+    if (!(variationCopy = LDJSONDuplicate(flag->variations[index]))) {
         LD_LOG(LD_LOG_ERROR, "failed to allocate variation");
 
         *o_error = EVAL_MEM;
@@ -185,67 +89,276 @@ getValue(
     return LDBooleanTrue;
 }
 
-static LDBoolean  addValue(
-        const struct LDJSON *const flag,
-        struct LDJSON **           result,
-        struct LDDetails *const    details,
-        const struct LDJSON *const index,
-        EvalStatus *o_error)
+/* Scratch details are only used until the evaluation context is freed. Their
+ * strings are allocated from the context, and so are reset rather than
+ * cleared. */
+static void
+resetDetails(struct LDDetails *const details, const LDBoolean scratch)
+{
+    if (scratch) {
+        LDDetailsInit(details);
+    } else {
+        LDDetailsClear(details);
+    }
+}
+
+static char *
+detailsStrDup(
+    struct LDEvaluationContext *const context,
+    const LDBoolean                   scratch,
+    const char *const                 text)
 {
-    unsigned int validatedVariationIndex = 0;
+    if (scratch) {
+        return LDi_evaluationContextStrDup(context, text);
+    }
+
+    return LDStrDup(text);
+}
 
+static LDBoolean
+addValue(
+    const struct LDCompiledFlag *const flag,
+    struct LDJSON **                   result,
+    struct LDDetails *const            details,
+    const LDBoolean                    scratch,
+    const int                          index,
+    EvalStatus *                       o_error)
+{
     LD_ASSERT(flag);
     LD_ASSERT(result);
     LD_ASSERT(details);
     LD_ASSERT(o_error);
 
-    if(!getValue(flag, result, index, o_error, &validatedVariationIndex)) {
+    if (!getValue(flag, result, index, o_error)) {
 
-        LDDetailsClear(details);
+        resetDetails(details, scratch);
 
-        *result               = NULL;
-        details->hasVariation = LDBooleanFalse;
-        details->reason = LD_ERROR;
+        *result                  = NULL;
+        details->hasVariation    = LDBooleanFalse;
+        details->reason          = LD_ERROR;
         details->extra.errorKind = LD_MALFORMED_FLAG;
 
         return LDBooleanFalse;
     }
 
-    details->hasVariation = LDBooleanTrue;
-    details->variationIndex = validatedVariationIndex;
+    details->hasVariation   = LDBooleanTrue;
+    details->variationIndex = (unsigned int)index;
     return LDBooleanTrue;
 }
 
-static const char *
-LDi_getBucketAttribute(const struct LDJSON *const obj)
+static EvalStatus
+evaluateCompiled(
+    struct LDClient *const             client,
+    const struct LDCompiledFlag *const flag,
+    const struct LDUser *const         user,
+    struct LDStore *const              store,
+    struct LDEvaluationContext *const  context,
+    const LDBoolean                    scratch,
+    struct LDDetails *const            details,
+    struct LDJSON **const              o_events,
+    struct LDJSON **const              o_value,
+    const LDBoolean                    recordReason);
+
+static EvalStatus
+evaluate(
+    struct LDClient *const            client,
+    const struct LDJSON *const        flag,
+    const struct LDUser *const        user,
+    struct LDStore *const             store,
+    struct LDEvaluationContext *const context,
+    const LDBoolean                   scratch,
+    struct LDDetails *const           details,
+    struct LDJSON **const             o_events,
+    struct LDJSON **const             o_value,
+    const LDBoolean                   recordReason)
 {
-    const struct LDJSON *bucketBy;
+    struct LDCompiledFlag *compiled;
+    EvalStatus             status;
+
+    LD_ASSERT(flag);
 
-    LD_ASSERT(obj);
-    LD_ASSERT(LDJSONGetType(obj) == LDObject);
+    if (!(compiled = LDi_compileFlag(flag))) {
+        LD_LOG(LD_LOG_ERROR, "failed to compile flag");
 
-    if (!lookupOptionalValueOfType(
-            obj, "rollout", "bucketBy", LDText, &bucketBy)) {
-        return NULL;
+        return EVAL_MEM;
     }
 
-    if (bucketBy == NULL) {
-        return "key";
+    status = evaluateCompiled(
+        client,
+        compiled,
+        user,
+        store,
+        context,
+        scratch,
+        details,
+        o_events,
+        o_value,
+        recordReason);
+
+    LDi_compiledFlagFree(compiled);
+
+    return status;
+}
+
+static EvalStatus
+evaluateRC(
+    struct LDClient *const            client,
+    struct LDJSONRC *const            flag,
+    const struct LDUser *const        user,
+    struct LDStore *const             store,
+    struct LDEvaluationContext *const context,
+    const LDBoolean                   scratch,
+    struct LDDetails *const           details,
+    struct LDJSON **const             o_events,
+    struct LDJSON **const             o_value,
+    const LDBoolean                   recordReason)
+{
+    const struct LDCompiledFlag *compiled;
+
+    LD_ASSERT(flag);
+
+    if ((compiled = (const struct LDCompiledFlag *)LDJSONRCGetCompiled(flag)))
+    {
+        return evaluateCompiled(
+            client,
+            compiled,
+            user,
+            store,
+            context,
+            scratch,
+            details,
+            o_events,
+            o_value,
+            recordReason);
     }
 
-    return LDGetText(bucketBy);
+    return evaluate(
+        client,
+        LDJSONRCGet(flag),
+        user,
+        store,
+        context,
+        scratch,
+        details,
+        o_events,
+        o_value,
+        recordReason);
 }
 
 EvalStatus
 LDi_evaluate(
-    struct LDClient *const     client,
-    const struct LDJSON *const flag,
-    const struct LDUser *const user,
-    struct LDStore *const      store,
-    struct LDDetails *const    details,
-    struct LDJSON **const      o_events,
-    struct LDJSON **const      o_value,
-    const LDBoolean            recordReason)
+    struct LDClient *const            client,
+    const struct LDJSON *const        flag,
+    const struct LDUser *const        user,
+    struct LDStore *const             store,
+    struct LDEvaluationContext *const context,
+    struct LDDetails *const           details,
+    struct LDJSON **const             o_events,
+    struct LDJSON **const             o_value,
+    const LDBoolean                   recordReason)
+{
+    return evaluate(
+        client,
+        flag,
+        user,
+        store,
+        context,
+        LDBooleanFalse,
+        details,
+        o_events,
+        o_value,
+        recordReason);
+}
+
+EvalStatus
+LDi_evaluateRC(
+    struct LDClient *const            client,
+    struct LDJSONRC *const            flag,
+    const struct LDUser *const        user,
+    struct LDStore *const             store,
+    struct LDEvaluationContext *const context,
+    struct LDDetails *const           details,
+    struct LDJSON **const             o_events,
+    struct LDJSON **const             o_value,
+    const LDBoolean                   recordReason)
+{
+    return evaluateRC(
+        client,
+        flag,
+        user,
+        store,
+        context,
+        LDBooleanFalse,
+        details,
+        o_events,
+        o_value,
+        recordReason);
+}
+
+EvalStatus
+LDi_evaluateRCScratch(
+    struct LDClient *const            client,
+    struct LDJSONRC *const            flag,
+    const struct LDUser *const        user,
+    struct LDStore *const             store,
+    struct LDEvaluationContext *const context,
+    struct LDDetails *const           details,
+    struct LDJSON **const             o_events,
+    struct LDJSON **const             o_value,
+    const LDBoolean                   recordReason)
+{
+    LD_ASSERT(context);
+
+    return evaluateRC(
+        client,
+        flag,
+        user,
+        store,
+        context,
+        LDBooleanTrue,
+        details,
+        o_events,
+        o_value,
+        recordReason);
+}
+
+EvalStatus
+LDi_evaluateCompiled(
+    struct LDClient *const             client,
+    const struct LDCompiledFlag *const flag,
+    const struct LDUser *const         user,
+    struct LDStore *const              store,
+    struct LDEvaluationContext *const  context,
+    struct LDDetails *const            details,
+    struct LDJSON **const              o_events,
+    struct LDJSON **const              o_value,
+    const LDBoolean                    recordReason)
+{
+    return evaluateCompiled(
+        client,
+        flag,
+        user,
+        store,
+        context,
+        LDBooleanFalse,
+        details,
+        o_events,
+        o_value,
+        recordReason);
+}
+
+static EvalStatus
+evaluateCompiled(
+    struct LDClient *const             client,
+    const struct LDCompiledFlag *const flag,
+    const struct LDUser *const         user,
+    struct LDStore *const              store,
+    struct LDEvaluationContext *const  context,
+    const LDBoolean                    scratch,
+    struct LDDetails *const            details,
+    struct LDJSON **const              o_events,
+    struct LDJSON **const              o_value,
+    const LDBoolean                    recordReason)
 {
     LDBoolean inExperiment;
 
@@ -253,10 +366,10 @@ LDi_evaluate(
     LD_ASSERT(user);
     LD_ASSERT(store);
     LD_ASSERT(details);
-    LD_ASSERT(o_events);
     LD_ASSERT(o_value);
+    LD_ASSERT(context || !scratch);
 
-    if (LDJSONGetType(flag) != LDObject) {
+    if (flag->malformed) {
         LD_LOG(LD_LOG_ERROR, "flag expected object");
 
         return EVAL_SCHEMA;
@@ -264,27 +377,26 @@ LDi_evaluate(
 
     /* on */
     {
-        const struct LDJSON *on;
-        struct LDJSON* offVariationValue = NULL;
         EvalStatus status;
 
-        if (!lookupOptionalValueOfType(flag, "flag", "on", LDBool, &on)) {
+        if (flag->onMalformed) {
+            LD_LOG(LD_LOG_ERROR, "flag.on unexpected type");
+
             return EVAL_SCHEMA;
         }
 
-        if (on == NULL || !LDGetBool(on)) {
+        if (!flag->on) {
             details->reason = LD_OFF;
 
-            offVariationValue = LDObjectLookup(flag, "offVariation");
-
             /* It is valid for the offVariation to either be unspecified or to be null. */
-            if (offVariationValue == NULL || LDJSONGetType(offVariationValue) == LDNull) {
+            if (!flag->hasOffVariation) {
                 *o_value = NULL;
             } else if (!(addValue(
                     flag,
                     o_value,
                     details,
-                    offVariationValue, &status))) {
+                    scratch,
+                    flag->offVariation, &status))) {
                 LD_LOG(LD_LOG_ERROR, "failed to add value");
 
                return status;
@@ -307,6 +419,7 @@ LDi_evaluate(
                     flag,
                     user,
                     store,
+                    context,
                     &failedKey,
                     o_events,
                     recordReason)))
@@ -319,7 +432,7 @@ LDi_evaluate(
         if (substatus == EVAL_MISS) {
             char *key;
 
-            if (!(key = LDStrDup(failedKey))) {
+            if (!(key = detailsStrDup(context, scratch, failedKey))) {
                 LD_LOG(LD_LOG_ERROR, "failed to duplicate failed key");
 
                 return EVAL_MEM;
@@ -332,7 +445,9 @@ LDi_evaluate(
                     flag,
                     o_value,
                     details,
-                    LDObjectLookup(flag, "offVariation"),
+                    scratch,
+                    flag->hasOffVariation ? flag->offVariation
+                                          : LD_INVALID_VARIATION,
                     &status))) {
                 LD_LOG(LD_LOG_ERROR, "failed to add value");
 
@@ -345,149 +460,135 @@ LDi_evaluate(
 
     /* targets */
     {
-        const struct LDJSON *targets;
-        EvalStatus status;
+        unsigned int i;
+        EvalStatus   status;
+
+        if (flag->targetsMalformed) {
+            LD_LOG(LD_LOG_ERROR, "flag.targets unexpected type");
 
-        if (!lookupOptionalValueOfType(
-                flag, "flag", "targets", LDArray, &targets)) {
             return EVAL_SCHEMA;
         }
 
-        if (targets) {
-            const struct LDJSON *target;
+        for (i = 0; i < flag->targetCount; i++) {
+            const struct LDCompiledTarget *const target = &flag->targets[i];
 
-            for (target = LDGetIter(targets); target;
-                 target = LDIterNext(target)) {
-                const struct LDJSON *values = NULL;
+            if (target->malformed) {
+                LD_LOG(LD_LOG_ERROR, "target malformed");
 
-                if (LDJSONGetType(target) != LDObject) {
-                    LD_LOG(LD_LOG_ERROR, "target expected object");
+                return EVAL_SCHEMA;
+            }
 
-                    return EVAL_SCHEMA;
-                }
+            if (target->values &&
+                LDi_keySetContains(target->values, user->key))
+            {
+                if (target->variationMalformed) {
+                    LD_LOG(LD_LOG_ERROR, "target.variation malformed");
 
-                if (!lookupOptionalValueOfType(
-                        target, "target", "values", LDArray, &values)) {
                     return EVAL_SCHEMA;
                 }
 
-                if (values && LDi_textInArray(values, user->key)) {
-                    const struct LDJSON *variation;
-
-                    if (!(variation = lookupRequiredValueOfType(
-                              target, "target", "variation", LDNumber)))
-                    {
-                        return EVAL_SCHEMA;
-                    }
-
-                    details->reason = LD_TARGET_MATCH;
+                details->reason = LD_TARGET_MATCH;
 
-                    if (!(addValue(flag, o_value, details, variation, &status))) {
-                        LD_LOG(LD_LOG_ERROR, "failed to add value");
+                if (!(addValue(
+                        flag,
+                        o_value,
+                        details,
+                        scratch,
+                        target->variation,
+                        &status))) {
+                    LD_LOG(LD_LOG_ERROR, "failed to add value");
 
-                        return status;
-                    }
-
-                    return EVAL_MATCH;
+                    return status;
                 }
+
+                return EVAL_MATCH;
             }
         }
     }
 
     /* rules */
     {
-        const struct LDJSON *rules;
+        unsigned int index;
+
+        if (flag->rulesMalformed) {
+            LD_LOG(LD_LOG_ERROR, "flag.rules unexpected type");
 
-        if (!lookupOptionalValueOfType(flag, "flag", "rules", LDArray, &rules))
-        {
             return EVAL_SCHEMA;
         }
 
-        if (rules) {
-            unsigned int         index;
-            const struct LDJSON *rule;
+        for (index = 0; index < flag->ruleCount; index++) {
+            const struct LDCompiledRule *const rule = &flag->rules[index];
+            EvalStatus                         substatus;
 
-            index = 0;
+            if (LDi_isEvalError(
+                    substatus = LDi_ruleMatchesUser(rule, user, store, context))) {
+                LD_LOG(LD_LOG_ERROR, "ruleMatchesUser Failed");
 
-            for (rule = LDGetIter(rules); rule; rule = LDIterNext(rule)) {
-                EvalStatus substatus;
+                return substatus;
+            }
 
-                if (LDJSONGetType(rule) != LDObject) {
-                    LD_LOG(LD_LOG_ERROR, "rule expected object");
+            if (substatus == EVAL_MATCH) {
+                int        variation;
+                EvalStatus status;
 
-                    return EVAL_SCHEMA;
-                }
+                details->reason               = LD_RULE_MATCH;
+                details->extra.rule.ruleIndex = index;
+                details->extra.rule.id        = NULL;
 
-                if (LDi_isEvalError(
-                        substatus = LDi_ruleMatchesUser(rule, user, store))) {
-                    LD_LOG(LD_LOG_ERROR, "ruleMatchesUser Failed");
+                if (!LDi_getIndexForVariationOrRollout(
+                        flag,
+                        &rule->variationOrRollout,
+                        user,
+                        &inExperiment,
+                        &variation))
+                {
+                    LD_LOG(LD_LOG_ERROR, "schema error");
 
-                    return substatus;
+                    return EVAL_SCHEMA;
                 }
 
-                if (substatus == EVAL_MATCH) {
-                    const struct LDJSON *ruleId, *variation;
-                    EvalStatus status;
-
-                    variation = NULL;
-
-                    details->reason               = LD_RULE_MATCH;
-                    details->extra.rule.ruleIndex = index;
-                    details->extra.rule.id        = NULL;
-
-                    if (!LDi_getIndexForVariationOrRollout(
-                            flag, rule, user, &inExperiment, &variation))
-                    {
-                        LD_LOG(LD_LOG_ERROR, "schema error");
+                details->extra.rule.inExperiment = inExperiment;
 
-                        return EVAL_SCHEMA;
-                    }
-
-                    details->extra.rule.inExperiment = inExperiment;
+                if (!(addValue(
+                        flag, o_value, details, scratch, variation, &status))) {
+                    LD_LOG(LD_LOG_ERROR, "failed to add value");
 
-                    if (!(addValue(flag, o_value, details, variation, &status))) {
-                        LD_LOG(LD_LOG_ERROR, "failed to add value");
-
-                        return status;
-                    }
+                    return status;
+                }
 
-                    if (!lookupOptionalValueOfType(
-                            rule, "rule", "id", LDText, &ruleId)) {
-                        return EVAL_SCHEMA;
-                    }
+                if (rule->idMalformed) {
+                    LD_LOG(LD_LOG_ERROR, "rule.id unexpected type");
 
-                    if (ruleId) {
-                        char *text;
+                    return EVAL_SCHEMA;
+                }
 
-                        if (!(text = LDStrDup(LDGetText(ruleId)))) {
-                            LD_LOG(LD_LOG_ERROR, "failed to duplicate rule id");
+                if (rule->id) {
+                    char *text;
 
-                            return EVAL_MEM;
-                        }
+                    if (!(text = detailsStrDup(context, scratch, rule->id))) {
+                        LD_LOG(LD_LOG_ERROR, "failed to duplicate rule id");
 
-                        details->extra.rule.id = text;
+                        return EVAL_MEM;
                     }
 
-                    return EVAL_MATCH;
+                    details->extra.rule.id = text;
                 }
 
-                index++;
+                return EVAL_MATCH;
             }
         }
     }
 
     /* fallthrough */
     {
-        const struct LDJSON *index;
+        int        index;
         EvalStatus status;
 
-        index = NULL;
-
         details->reason = LD_FALLTHROUGH;
 
         if (!LDi_getIndexForVariationOrRollout(
                 flag,
-                LDObjectLookup(flag, "fallthrough"),
+                &flag->fallthrough,
                 user,
                 &inExperiment,
                 &index))
@@ -499,7 +600,7 @@ LDi_evaluate(
 
         details->extra.fallthrough.inExperiment = inExperiment;
 
-        if (!(addValue(flag, o_value, details, index, &status))) {
+        if (!(addValue(flag, o_value, details, scratch, index, &status))) {
             LD_LOG(LD_LOG_ERROR, "failed to add value");
 
             return status;
@@ -509,225 +610,194 @@ LDi_evaluate(
     }
 }
 
+/* The details of prerequisites are scratch when there is a context to hold
+ * them. */
+static void
+clearEvaluated(
+    struct LDEvaluationContext *const  context,
+    struct LDPrerequisiteResult *const evaluated)
+{
+    resetDetails(&evaluated->details, context != NULL);
+
+    LDi_prerequisiteResultClear(evaluated);
+}
+
 EvalStatus
 LDi_checkPrerequisites(
-    struct LDClient *const     client,
-    const struct LDJSON *const flag,
-    const struct LDUser *const user,
-    struct LDStore *const      store,
-    const char **const         failedKey,
-    struct LDJSON **const      events,
-    const LDBoolean            recordReason)
+    struct LDClient *const             client,
+    const struct LDCompiledFlag *const flag,
+    const struct LDUser *const         user,
+    struct LDStore *const              store,
+    struct LDEvaluationContext *const  context,
+    const char **const                 failedKey,
+    struct LDJSON **const              events,
+    const LDBoolean                    recordReason)
 {
-    const struct LDJSON *prerequisites, *iter;
+    unsigned int i;
 
     LD_ASSERT(flag);
     LD_ASSERT(user);
     LD_ASSERT(store);
     LD_ASSERT(failedKey);
-    LD_ASSERT(events);
-    LD_ASSERT(LDJSONGetType(flag) == LDObject);
 
-    if (!lookupOptionalValueOfType(
-            flag, "flag", "prerequisites", LDArray, &prerequisites))
-    {
+    if (flag->prerequisitesMalformed) {
+        LD_LOG(LD_LOG_ERROR, "flag.prerequisites unexpected type");
+
         return EVAL_SCHEMA;
     }
 
-    if (!prerequisites) {
-        return EVAL_MATCH;
-    }
+    for (i = 0; i < flag->prerequisiteCount; i++) {
+        const struct LDCompiledPrerequisite *const prerequisite =
+            &flag->prerequisites[i];
+        struct LDJSON *                    event;
+        const unsigned int *               variationNumRef;
+        struct LDPrerequisiteResult        evaluated;
+        const struct LDPrerequisiteResult *result;
+        struct LDTimestamp                 timestamp;
 
-    for (iter = LDGetIter(prerequisites); iter; iter = LDIterNext(iter)) {
-        struct LDJSON *      value, *preflag, *event, *subevents;
-        const struct LDJSON *key, *variation;
-        unsigned int *       variationNumRef;
-        EvalStatus           status;
-        const char *         keyText;
-        struct LDDetails     details;
-        struct LDJSONRC *    preflagrc;
-        struct LDTimestamp  timestamp;
-
-        value           = NULL;
-        preflag         = NULL;
-        key             = NULL;
-        variation       = NULL;
         variationNumRef = NULL;
         event           = NULL;
-        subevents       = NULL;
-        keyText         = NULL;
-        preflagrc       = NULL;
+        result          = NULL;
 
-        LDDetailsInit(&details);
-        LDTimestamp_InitNow(&timestamp);
+        memset(&evaluated, 0, sizeof(evaluated));
+        LDDetailsInit(&evaluated.details);
 
-        if (LDJSONGetType(iter) != LDObject) {
-            LD_LOG(LD_LOG_ERROR, "prerequisite expected object");
+        if (prerequisite->malformed) {
+            LD_LOG(LD_LOG_ERROR, "prerequisite malformed");
 
             return EVAL_SCHEMA;
         }
 
-        if (!(key = lookupRequiredValueOfType(
-                  iter, "prerequisite", "key", LDText))) {
-            return EVAL_SCHEMA;
-        }
+        *failedKey = prerequisite->key;
 
-        if (!(variation = lookupRequiredValueOfType(
-                  iter, "prerequisite", "variation", LDNumber)))
-        {
-            return EVAL_SCHEMA;
+        if (context) {
+            result = LDi_evaluationContextFindPrerequisite(
+                context, prerequisite->key);
         }
 
-        keyText    = LDGetText(key);
-        *failedKey = keyText;
+        if (!result) {
+            if (!LDStoreGet(
+                    store, LD_FLAG, prerequisite->key, &evaluated.flag)) {
+                LD_LOG(LD_LOG_ERROR, "store lookup error");
 
-        if (!LDStoreGet(store, LD_FLAG, keyText, &preflagrc)) {
-            LD_LOG(LD_LOG_ERROR, "store lookup error");
-
-            return EVAL_STORE;
-        }
+                return EVAL_STORE;
+            }
 
-        if (preflagrc) {
-            preflag = LDJSONRCGet(preflagrc);
-        }
+            if (!evaluated.flag || !LDJSONRCGet(evaluated.flag)) {
+                LD_LOG(LD_LOG_ERROR, "cannot find flag in store");
 
-        if (!preflag) {
-            LD_LOG(LD_LOG_ERROR, "cannot find flag in store");
+                LDJSONRCRelease(evaluated.flag);
 
-            return EVAL_MISS;
-        }
+                return EVAL_MISS;
+            }
 
-        if (LDi_isEvalError(
-                status = LDi_evaluate(
-                    client,
-                    preflag,
-                    user,
-                    store,
-                    &details,
-                    &subevents,
-                    &value,
-                    recordReason)))
-        {
-            LDJSONRCRelease(preflagrc);
-            LDJSONFree(value);
-            LDDetailsClear(&details);
-            LDJSONFree(subevents);
+            if (LDi_isEvalError(
+                    evaluated.status = evaluateRC(
+                        client,
+                        evaluated.flag,
+                        user,
+                        store,
+                        context,
+                        context != NULL,
+                        &evaluated.details,
+                        events ? &evaluated.events : NULL,
+                        &evaluated.value,
+                        recordReason)))
+            {
+                const EvalStatus status = evaluated.status;
 
-            return status;
-        }
+                clearEvaluated(context, &evaluated);
 
-        if (!value) {
-            LD_LOG(LD_LOG_ERROR, "sub error with result");
-        }
+                return status;
+            }
 
-        if (details.hasVariation) {
-            variationNumRef = &details.variationIndex;
-        }
+            if (!evaluated.value) {
+                LD_LOG(LD_LOG_ERROR, "sub error with result");
+            }
 
-        event = LDi_newFeatureEvent(
-                keyText,
-                user,
-                variationNumRef,
-                value,
-                NULL,
-                LDGetText(LDObjectLookup(flag, "key")),
-                preflag,
-                &details,
-                timestamp,
-                client->config->inlineUsersInEvents,
-                client->config->allAttributesPrivate,
-                client->config->privateAttributeNames
-        );
-
-        if (!event) {
-            LDJSONRCRelease(preflagrc);
-            LDJSONFree(value);
-            LDDetailsClear(&details);
-            LDJSONFree(subevents);
-
-            LD_LOG(LD_LOG_ERROR, "alloc error");
-
-            return EVAL_MEM;
+            /* Falls back to the local result if it cannot be memoized. */
+            if (!context || !(result = LDi_evaluationContextAddPrerequisite(
+                                  context, prerequisite->key, &evaluated)))
+            {
+                result = &evaluated;
+            }
         }
 
-        if (!(*events)) {
-            if (!(*events = LDNewArray())) {
-                LDJSONRCRelease(preflagrc);
-                LDJSONFree(value);
-                LDDetailsClear(&details);
-                LDJSONFree(subevents);
-
-                LD_LOG(LD_LOG_ERROR, "alloc error");
+        /* Without a destination, the events of prerequisites are not built at
+         * all, rather than built and discarded. */
+        if (events) {
+            LDTimestamp_InitNow(&timestamp);
 
-                return EVAL_MEM;
+            if (result->details.hasVariation) {
+                variationNumRef = &result->details.variationIndex;
             }
-        }
 
-        if (subevents) {
-            if (!LDArrayAppend(*events, subevents)) {
-                LDJSONRCRelease(preflagrc);
-                LDJSONFree(value);
-                LDDetailsClear(&details);
-                LDJSONFree(subevents);
+            event = LDi_newFeatureEvent(
+                    prerequisite->key,
+                    user,
+                    variationNumRef,
+                    result->value,
+                    NULL,
+                    flag->key,
+                    LDJSONRCGet(result->flag),
+                    &result->details,
+                    timestamp,
+                    client->config->inlineUsersInEvents,
+                    client->config->allAttributesPrivate,
+                    client->config->privateAttributeNames
+            );
+
+            if (!event) {
+                clearEvaluated(context, &evaluated);
 
                 LD_LOG(LD_LOG_ERROR, "alloc error");
 
                 return EVAL_MEM;
             }
 
-            LDJSONFree(subevents);
-        }
-
-        if (!LDArrayPush(*events, event)) {
-            LDJSONRCRelease(preflagrc);
-            LDJSONFree(value);
-            LDDetailsClear(&details);
-
-            LD_LOG(LD_LOG_ERROR, "alloc error");
+            if (!(*events)) {
+                if (!(*events = LDNewArray())) {
+                    clearEvaluated(context, &evaluated);
+                    LDJSONFree(event);
 
-            return EVAL_MEM;
-        }
+                    LD_LOG(LD_LOG_ERROR, "alloc error");
 
-        if (status == EVAL_MISS) {
-            LDJSONRCRelease(preflagrc);
-            LDJSONFree(value);
-            LDDetailsClear(&details);
+                    return EVAL_MEM;
+                }
+            }
 
-            return EVAL_MISS;
-        }
+            if (result->events) {
+                if (!LDArrayAppend(*events, result->events)) {
+                    clearEvaluated(context, &evaluated);
+                    LDJSONFree(event);
 
-        {
-            const struct LDJSON *on;
-            LDBoolean            variationMatch;
+                    LD_LOG(LD_LOG_ERROR, "alloc error");
 
-            variationMatch = LDBooleanFalse;
+                    return EVAL_MEM;
+                }
+            }
 
-            if (!lookupOptionalValueOfType(preflag, "flag", "on", LDBool, &on))
-            {
-                LDJSONRCRelease(preflagrc);
-                LDJSONFree(value);
-                LDDetailsClear(&details);
+            if (!LDArrayPush(*events, event)) {
+                clearEvaluated(context, &evaluated);
+                LDJSONFree(event);
 
-                return EVAL_SCHEMA;
-            }
+                LD_LOG(LD_LOG_ERROR, "alloc error");
 
-            if (details.hasVariation) {
-                variationMatch =
-                    details.variationIndex == LDGetNumber(variation);
+                return EVAL_MEM;
             }
+        }
 
-            if (on == NULL || !LDGetBool(on) || !variationMatch) {
-                LDJSONRCRelease(preflagrc);
-                LDJSONFree(value);
-                LDDetailsClear(&details);
+        /* A prerequisite which is off always evaluates to EVAL_MISS, so past
+         * this point it is known to be on. */
+        if (result->status == EVAL_MISS || !result->details.hasVariation ||
+            result->details.variationIndex != prerequisite->variation)
+        {
+            clearEvaluated(context, &evaluated);
 
-                return EVAL_MISS;
-            }
+            return EVAL_MISS;
         }
 
-        LDJSONRCRelease(preflagrc);
-        LDJSONFree(value);
-        LDDetailsClear(&details);
+        clearEvaluated(context, &evaluated);
     }
 
     return EVAL_MATCH;
@@ -735,35 +805,28 @@ LDi_checkPrerequisites(
 
 EvalStatus
 LDi_ruleMatchesUser(
-    const struct LDJSON *const rule,
-    const struct LDUser *const user,
-    struct LDStore *const      store)
+    const struct LDCompiledRule *const rule,
+    const struct LDUser *const         user,
+    struct LDStore *const              store,
+    struct LDEvaluationContext *const  context)
 {
-    const struct LDJSON *clauses, *clause;
+    unsigned int i;
 
     LD_ASSERT(rule);
     LD_ASSERT(user);
 
-    if (!lookupOptionalValueOfType(rule, "rule", "clauses", LDArray, &clauses))
-    {
-        return EVAL_SCHEMA;
-    }
+    if (rule->malformed) {
+        LD_LOG(LD_LOG_ERROR, "rule malformed");
 
-    if (clauses == NULL) {
-        return EVAL_MATCH;
+        return EVAL_SCHEMA;
     }
 
-    for (clause = LDGetIter(clauses); clause; clause = LDIterNext(clause)) {
+    for (i = 0; i < rule->clauseCount; i++) {
         EvalStatus evalStatus;
 
-        if (LDJSONGetType(clause) != LDObject) {
-            LD_LOG(LD_LOG_ERROR, "clause expected object");
-
-            return EVAL_SCHEMA;
-        }
-
         if (LDi_isEvalError(
-                evalStatus = LDi_clauseMatchesUser(clause, user, store))) {
+                evalStatus = LDi_clauseMatchesUser(
+                    &rule->clauses[i], user, store, context))) {
 
             return evalStatus;
         }
@@ -776,76 +839,101 @@ LDi_ruleMatchesUser(
     return EVAL_MATCH;
 }
 
-EvalStatus
-LDi_clauseMatchesUser(
-    const struct LDJSON *const clause,
-    const struct LDUser *const user,
-    struct LDStore *const      store)
+/* A segment missing from the store matches no one. */
+static EvalStatus
+segmentMatchesUserByKey(
+    const char *const                 segmentKey,
+    const struct LDUser *const        user,
+    struct LDStore *const             store,
+    struct LDEvaluationContext *const context)
 {
-    const struct LDJSON *op;
-
-    LD_ASSERT(clause);
-    LD_ASSERT(user);
+    EvalStatus                      evalStatus;
+    struct LDJSONRC *               segmentrc;
+    const struct LDCompiledSegment *segment;
 
-    if (LDJSONGetType(clause) != LDObject) {
-        LD_LOG(LD_LOG_ERROR, "clause expected object");
+    segmentrc = NULL;
 
-        return EVAL_SCHEMA;
+    if (context &&
+        LDi_evaluationContextFindSegment(context, segmentKey, &evalStatus))
+    {
+        return evalStatus;
     }
 
-    if (!(op = lookupRequiredValueOfType(clause, "clause", "op", LDText))) {
-        return EVAL_SCHEMA;
+    if (!LDStoreGet(store, LD_SEGMENT, segmentKey, &segmentrc)) {
+        LD_LOG(LD_LOG_ERROR, "store lookup error");
+
+        return EVAL_STORE;
     }
 
-    if (strcmp(LDGetText(op), "segmentMatch") == 0) {
-        const struct LDJSON *values, *iter;
+    if (!segmentrc) {
+        LD_LOG(LD_LOG_WARNING, "segment not found in store");
 
-        if (!lookupOptionalValueOfType(
-                clause, "clause", "values", LDArray, &values)) {
-            return EVAL_SCHEMA;
+        evalStatus = EVAL_MISS;
+    } else {
+        if ((segment = (const struct LDCompiledSegment *)
+                 LDJSONRCGetCompiled(segmentrc)))
+        {
+            evalStatus = LDi_segmentMatchesUserCompiled(segment, user);
+        } else {
+            evalStatus = LDi_segmentMatchesUser(LDJSONRCGet(segmentrc), user);
         }
 
-        if (values == NULL) {
-            return maybeNegate(clause, EVAL_MISS);
-        }
+        LDJSONRCRelease(segmentrc);
 
-        for (iter = LDGetIter(values); iter; iter = LDIterNext(iter)) {
-            if (LDJSONGetType(iter) == LDText) {
-                EvalStatus       evalStatus;
-                struct LDJSON *  segment;
-                struct LDJSONRC *segmentrc;
+        if (LDi_isEvalError(evalStatus)) {
+            LD_LOG(LD_LOG_ERROR, "segmentMatchesUser error");
 
-                segmentrc = NULL;
-                segment   = NULL;
+            return evalStatus;
+        }
+    }
 
-                if (!LDStoreGet(store, LD_SEGMENT, LDGetText(iter), &segmentrc))
-                {
-                    LD_LOG(LD_LOG_ERROR, "store lookup error");
+    if (context) {
+        LDi_evaluationContextAddSegment(context, segmentKey, evalStatus);
+    }
 
-                    return EVAL_STORE;
-                }
+    return evalStatus;
+}
 
-                if (segmentrc) {
-                    segment = LDJSONRCGet(segmentrc);
-                }
+EvalStatus
+LDi_clauseMatchesUser(
+    const struct LDCompiledClause *const clause,
+    const struct LDUser *const           user,
+    struct LDStore *const                store,
+    struct LDEvaluationContext *const    context)
+{
+    LD_ASSERT(clause);
+    LD_ASSERT(user);
 
-                if (!segment) {
-                    LD_LOG(LD_LOG_WARNING, "segment not found in store");
+    if (clause->malformed) {
+        LD_LOG(LD_LOG_ERROR, "clause malformed");
 
-                    continue;
-                }
+        return EVAL_SCHEMA;
+    }
 
-                if (LDi_isEvalError(
-                        evalStatus = LDi_segmentMatchesUser(segment, user))) {
-                    LD_LOG(LD_LOG_ERROR, "segmentMatchesUser error");
+    if (clause->op == LD_OP_SEGMENT_MATCH) {
+        const struct LDJSON *iter;
 
-                    LDJSONRCRelease(segmentrc);
+        if (clause->operandsMalformed) {
+            LD_LOG(LD_LOG_ERROR, "clause.values unexpected type");
+
+            return EVAL_SCHEMA;
+        }
+
+        if (clause->values == NULL) {
+            return maybeNegate(clause, EVAL_MISS);
+        }
+
+        for (iter = LDGetIter(clause->values); iter; iter = LDIterNext(iter)) {
+            if (LDJSONGetType(iter) == LDText) {
+                EvalStatus evalStatus;
 
+                evalStatus = segmentMatchesUserByKey(
+                    LDGetText(iter), user, store, context);
+
+                if (LDi_isEvalError(evalStatus)) {
                     return evalStatus;
                 }
 
-                LDJSONRCRelease(segmentrc);
-
                 if (evalStatus == EVAL_MATCH) {
                     return maybeNegate(clause, EVAL_MATCH);
                 }
@@ -862,172 +950,188 @@ EvalStatus
 LDi_segmentMatchesUser(
     const struct LDJSON *const segment, const struct LDUser *const user)
 {
+    struct LDCompiledSegment *compiled;
+    EvalStatus                status;
+
+    LD_ASSERT(segment);
+
+    if (!(compiled = LDi_compileSegment(segment))) {
+        LD_LOG(LD_LOG_ERROR, "failed to compile segment");
+
+        return EVAL_MEM;
+    }
+
+    status = LDi_segmentMatchesUserCompiled(compiled, user);
+
+    LDi_compiledSegmentFree(compiled);
+
+    return status;
+}
+
+EvalStatus
+LDi_segmentMatchesUserCompiled(
+    const struct LDCompiledSegment *const segment,
+    const struct LDUser *const            user)
+{
+    unsigned int i;
+
     LD_ASSERT(segment);
     LD_ASSERT(user);
 
-    /* included */
-    {
-        const struct LDJSON *included;
+    if (segment->malformed) {
+        LD_LOG(LD_LOG_ERROR, "segment expected object");
 
-        if (!lookupOptionalValueOfType(
-                segment, "segment", "included", LDArray, &included))
-        {
-            return EVAL_SCHEMA;
-        }
+        return EVAL_SCHEMA;
+    }
 
-        if (included && LDi_textInArray(included, user->key)) {
-            return EVAL_MATCH;
-        }
+    /* included */
+    if (segment->includedMalformed) {
+        LD_LOG(LD_LOG_ERROR, "segment.included unexpected type");
+
+        return EVAL_SCHEMA;
     }
 
-    /* excluded */
+    if (segment->included &&
+        LDi_keySetContains(segment->included, user->key))
     {
-        const struct LDJSON *excluded;
+        return EVAL_MATCH;
+    }
 
-        if (!lookupOptionalValueOfType(
-                segment, "segment", "excluded", LDArray, &excluded))
-        {
-            return EVAL_SCHEMA;
-        }
+    /* excluded */
+    if (segment->excludedMalformed) {
+        LD_LOG(LD_LOG_ERROR, "segment.excluded unexpected type");
 
-        if (excluded && LDi_textInArray(excluded, user->key)) {
-            return EVAL_MISS;
-        }
+        return EVAL_SCHEMA;
     }
 
-    /* rules */
+    if (segment->excluded &&
+        LDi_keySetContains(segment->excluded, user->key))
     {
-        const struct LDJSON *iter, *salt, *segmentRules, *key;
-
-        if (!lookupOptionalValueOfType(
-                segment, "segment", "rules", LDArray, &segmentRules))
-        {
-            return EVAL_SCHEMA;
-        }
-
-        if (segmentRules == NULL) {
-            return EVAL_MISS;
-        }
+        return EVAL_MISS;
+    }
 
-        if (!(key =
-                  lookupRequiredValueOfType(segment, "segment", "key", LDText)))
-        {
-            return EVAL_SCHEMA;
-        }
+    /* rules */
+    if (segment->rulesMalformed) {
+        LD_LOG(LD_LOG_ERROR, "segment.rules unexpected type");
 
-        if (!(salt = lookupRequiredValueOfType(
-                  segment, "segment", "salt", LDText))) {
-            return EVAL_SCHEMA;
-        }
+        return EVAL_SCHEMA;
+    }
 
-        for (iter = LDGetIter(segmentRules); iter; iter = LDIterNext(iter)) {
-            EvalStatus evalStatus;
+    if (!segment->hasRules) {
+        return EVAL_MISS;
+    }
 
-            if (LDJSONGetType(iter) != LDObject) {
-                LD_LOG(LD_LOG_ERROR, "segment rule expected object");
+    if (!segment->key || !segment->salt) {
+        LD_LOG(LD_LOG_ERROR, "segment missing key or salt");
 
-                return EVAL_SCHEMA;
-            }
+        return EVAL_SCHEMA;
+    }
 
-            if (LDi_isEvalError(
-                    evalStatus = LDi_segmentRuleMatchUser(
-                        iter, LDGetText(key), user, LDGetText(salt))))
-            {
-                return evalStatus;
-            }
+    for (i = 0; i < segment->ruleCount; i++) {
+        EvalStatus evalStatus;
 
-            if (evalStatus == EVAL_MATCH) {
-                return EVAL_MATCH;
-            }
+        if (LDi_isEvalError(
+                evalStatus = LDi_segmentRuleMatchUser(
+                    &segment->rules[i], segment->key, user, segment->salt)))
+        {
+            return evalStatus;
         }
 
-        return EVAL_MISS;
+        if (evalStatus == EVAL_MATCH) {
+            return EVAL_MATCH;
+        }
     }
+
+    return EVAL_MISS;
 }
 
 EvalStatus
 LDi_segmentRuleMatchUser(
-    const struct LDJSON *const segmentRule,
-    const char *const          segmentKey,
-    const struct LDUser *const user,
-    const char *const          salt)
+    const struct LDCompiledSegmentRule *const segmentRule,
+    const char *const                         segmentKey,
+    const struct LDUser *const                user,
+    const char *const                         salt)
 {
-    const struct LDJSON *clauses;
+    unsigned int i;
+    float        bucket;
 
     LD_ASSERT(segmentRule);
     LD_ASSERT(segmentKey);
     LD_ASSERT(user);
     LD_ASSERT(salt);
 
-    if (!lookupOptionalValueOfType(
-            segmentRule, "segmentRule", "clauses", LDArray, &clauses))
-    {
-        return EVAL_SCHEMA;
-    }
-
-    if (clauses) {
-        const struct LDJSON *clause;
-
-        for (clause = LDGetIter(clauses); clause; clause = LDIterNext(clause)) {
-            EvalStatus evalStatus;
+    if (segmentRule->malformed) {
+        LD_LOG(LD_LOG_ERROR, "segment rule malformed");
 
-            if (LDi_isEvalError(
-                    evalStatus = LDi_clauseMatchesUserNoSegments(clause, user)))
-            {
-                return evalStatus;
-            }
-
-            if (evalStatus == EVAL_MISS) {
-                return EVAL_MISS;
-            }
-        }
+        return EVAL_SCHEMA;
     }
 
-    {
-        const struct LDJSON *weight;
-        float                bucket;
-        const char *         attribute;
+    for (i = 0; i < segmentRule->clauseCount; i++) {
+        EvalStatus evalStatus;
 
-        if (!lookupOptionalValueOfType(
-                segmentRule, "segmentRule", "weight", LDNumber, &weight))
+        if (LDi_isEvalError(
+                evalStatus = LDi_clauseMatchesUserNoSegments(
+                    &segmentRule->clauses[i], user)))
         {
-            return EVAL_SCHEMA;
+            return evalStatus;
         }
 
-        if (weight == NULL) {
-            return EVAL_MATCH;
+        if (evalStatus == EVAL_MISS) {
+            return EVAL_MISS;
         }
+    }
 
-        attribute = LDi_getBucketAttribute(segmentRule);
+    if (segmentRule->weightMalformed) {
+        LD_LOG(LD_LOG_ERROR, "segment rule weight or bucketBy malformed");
 
-        if (attribute == NULL) {
-            LD_LOG(LD_LOG_ERROR, "failed to parse bucketBy");
+        return EVAL_SCHEMA;
+    }
 
-            return EVAL_SCHEMA;
-        }
+    if (!segmentRule->hasWeight) {
+        return EVAL_MATCH;
+    }
 
-        LDi_bucketUser(user, segmentKey, attribute, salt, NULL, &bucket);
+    bucketUser(
+        user,
+        segmentKey,
+        segmentRule->bucketByID,
+        segmentRule->bucketBy,
+        salt,
+        NULL,
+        &bucket);
 
-        if (bucket < LDGetNumber(weight) / 100000) {
-            return EVAL_MATCH;
-        } else {
-            return EVAL_MISS;
-        }
+    if (bucket < segmentRule->weight / 100000) {
+        return EVAL_MATCH;
+    } else {
+        return EVAL_MISS;
     }
 }
 
 static EvalStatus
 matchAny(
-    OpFn f, const struct LDJSON *const value, const struct LDJSON *const values)
+    const struct LDCompiledClause *const clause,
+    const struct LDJSON *const           value)
 {
     const struct LDJSON *iter;
+    unsigned int         index;
 
-    LD_ASSERT(f);
+    LD_ASSERT(clause);
+    LD_ASSERT(clause->fn);
     LD_ASSERT(value);
 
-    if (values) {
-        for (iter = LDGetIter(values); iter; iter = LDIterNext(iter)) {
-            if (f(value, iter)) {
+    index = 0;
+
+    if (clause->values) {
+        for (iter = LDGetIter(clause->values); iter; iter = LDIterNext(iter)) {
+            if (clause->regexes) {
+                const struct LDRegex *const regex = clause->regexes[index++];
+
+                if (regex && LDJSONGetType(value) == LDText &&
+                    LDi_regexMatches(regex, LDGetText(value)))
+                {
+                    return EVAL_MATCH;
+                }
+            } else if (clause->fn(value, iter)) {
                 return EVAL_MATCH;
             }
         }
@@ -1038,40 +1142,39 @@ matchAny(
 
 EvalStatus
 LDi_clauseMatchesUserNoSegments(
-    const struct LDJSON *const clause, const struct LDUser *const user)
+    const struct LDCompiledClause *const clause,
+    const struct LDUser *const           user)
 {
-    OpFn                 fn;
-    struct LDJSON *      attributeValue;
-    const struct LDJSON *values, *attribute, *op;
-    LDJSONType           attributeType;
+    struct LDUserAttributeView view;
+    const struct LDJSON *      attributeValue;
+    LDJSONType                 attributeType;
 
     LD_ASSERT(clause);
     LD_ASSERT(user);
 
     attributeValue = NULL;
 
-    if (!(op = lookupRequiredValueOfType(clause, "clause", "op", LDText))) {
+    if (clause->malformed) {
+        LD_LOG(LD_LOG_ERROR, "clause malformed");
+
         return EVAL_SCHEMA;
     }
 
-    if (!(fn = LDi_lookupOperation(LDGetText(op)))) {
+    if (!clause->fn) {
         LD_LOG(LD_LOG_WARNING, "unknown operator");
 
         return EVAL_MISS;
     }
 
-    if (!(attribute =
-              lookupRequiredValueOfType(clause, "clause", "attribute", LDText)))
-    {
-        return EVAL_SCHEMA;
-    }
+    if (clause->operandsMalformed) {
+        LD_LOG(LD_LOG_ERROR, "clause attribute or values malformed");
 
-    if (!lookupOptionalValueOfType(
-            clause, "clause", "values", LDArray, &values)) {
         return EVAL_SCHEMA;
     }
 
-    if (!(attributeValue = LDi_valueOfAttribute(user, LDGetText(attribute)))) {
+    if (!(attributeValue = LDi_viewAttributeByID(
+              user, clause->attributeID, clause->attribute, &view)))
+    {
         LD_LOG(LD_LOG_TRACE, "attribute does not exist");
 
         return EVAL_MISS;
@@ -1097,85 +1200,113 @@ LDi_clauseMatchesUserNoSegments(
                 LD_LOG(
                     LD_LOG_WARNING, "attribute value expected array or object");
 
-                LDJSONFree(attributeValue);
-
                 return EVAL_MISS;
             }
 
-            if (LDi_isEvalError(evalStatus = matchAny(fn, iter, values))) {
-
+            if (LDi_isEvalError(evalStatus = matchAny(clause, iter))) {
                 LD_LOG(LD_LOG_ERROR, "matchAny failed");
 
-                LDJSONFree(attributeValue);
-
                 return evalStatus;
             }
 
             if (evalStatus == EVAL_MATCH) {
-                LDJSONFree(attributeValue);
-
                 return maybeNegate(clause, EVAL_MATCH);
             }
         }
 
-        LDJSONFree(attributeValue);
-
         return maybeNegate(clause, EVAL_MISS);
     } else {
         EvalStatus evalStatus;
 
-        if (LDi_isEvalError(evalStatus = matchAny(fn, attributeValue, values)))
-        {
+        if (LDi_isEvalError(evalStatus = matchAny(clause, attributeValue))) {
             LD_LOG(LD_LOG_ERROR, "matchAny failed");
 
-            LDJSONFree(attributeValue);
-
             return evalStatus;
         }
 
-        LDJSONFree(attributeValue);
-
         return maybeNegate(clause, evalStatus);
     }
 }
 
+/* Interprets the first 60 bits of a SHA-1 digest as a number, accumulating
+ * one nibble at a time in single precision. This matches, bit for bit, the
+ * conversion of the first 15 hex characters of the digest that bucketing has
+ * always used, so existing rollouts keep their assignments. */
 static float
-LDi_hexToDecimal(const char *const input)
+LDi_digestToDecimal(const unsigned char *const digest)
 {
-    float       acc;
-    const char *i;
+    float        acc;
+    unsigned int i;
 
-    LD_ASSERT(input);
+    LD_ASSERT(digest);
 
     acc = 0;
 
-    for (i = input; *i != '\0'; i++) {
-        char charOffset;
-
-        if (*i >= 48 && *i <= 57) {
-            charOffset = *i - 48;
-        } else if (*i >= 97 && *i <= 102) {
-            charOffset = *i - 87;
-        } else {
-            return 0.0;
-        }
+    for (i = 0; i < 15; i++) {
+        const unsigned char byte = digest[i / 2];
 
-        acc = (acc * 16) + charOffset;
+        acc = (acc * 16) + ((i % 2) ? (byte & 0x0F) : (byte >> 4));
     }
 
     return acc;
 }
 
-LDBoolean
-LDi_bucketUser(
+/* Formats value as "%d" would, returning the start of the text within
+ * buffer. */
+static const char *
+LDi_formatInt(const int value, char *const buffer, const size_t bufferSize)
+{
+    char *       iter;
+    unsigned int magnitude;
+
+    LD_ASSERT(buffer);
+    LD_ASSERT(bufferSize >= 12);
+
+    iter    = buffer + bufferSize - 1;
+    *iter   = '\0';
+
+    if (value < 0) {
+        magnitude = 0u - (unsigned int)value;
+    } else {
+        magnitude = (unsigned int)value;
+    }
+
+    do {
+        *--iter = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+
+    if (value < 0) {
+        *--iter = '-';
+    }
+
+    return iter;
+}
+
+static void
+sha1UpdateText(SHA1_CTX *const context, const char *const text)
+{
+    clibs_SHA1Update(
+        context, (const unsigned char *)text, (uint32_t)strlen(text));
+}
+
+static LDBoolean
+bucketUser(
     const struct LDUser *const user,
     const char *const          segmentKey,
+    const LDUserAttribute      attributeID,
     const char *const          attribute,
     const char *const          salt,
     const int *const           seed,
     float *const               bucket)
 {
-    struct LDJSON *attributeValue;
+    struct LDUserAttributeView view;
+    const struct LDJSON *      attributeValue;
+    char                       bucketableBuffer[256];
+    const char *               bucketable;
+    SHA1_CTX                   context;
+    unsigned char              digest[20];
+    const float                longScale = 1152921504606846975.0;
 
     LD_ASSERT(user);
     LD_ASSERT(segmentKey);
@@ -1183,106 +1314,95 @@ LDi_bucketUser(
     LD_ASSERT(salt);
     LD_ASSERT(bucket);
 
-    attributeValue = NULL;
-    *bucket        = 0;
-
-    if ((attributeValue = LDi_valueOfAttribute(user, attribute))) {
-        char        raw[256], bucketableBuffer[256];
-        const char *bucketable;
-        int         snprintfStatus;
-
-        bucketable = NULL;
-
-        if (LDJSONGetType(attributeValue) == LDText) {
-            bucketable = LDGetText(attributeValue);
-        } else if (LDJSONGetType(attributeValue) == LDNumber) {
-            if (snprintf(
-                    bucketableBuffer,
-                    sizeof(bucketableBuffer),
-                    "%f",
-                    LDGetNumber(attributeValue)) >= 0)
-            {
-                bucketable = bucketableBuffer;
-            }
-        }
+    *bucket    = 0;
+    bucketable = NULL;
 
-        if (!bucketable) {
-            LDJSONFree(attributeValue);
+    if (!(attributeValue =
+              LDi_viewAttributeByID(user, attributeID, attribute, &view))) {
+        return LDBooleanFalse;
+    }
 
-            return LDBooleanFalse;
+    if (LDJSONGetType(attributeValue) == LDText) {
+        bucketable = LDGetText(attributeValue);
+    } else if (LDJSONGetType(attributeValue) == LDNumber) {
+        if (snprintf(
+                bucketableBuffer,
+                sizeof(bucketableBuffer),
+                "%f",
+                LDGetNumber(attributeValue)) >= 0)
+        {
+            bucketable = bucketableBuffer;
         }
+    }
 
-        if (seed) {
-            if (user->secondary) {
-                snprintfStatus = snprintf(
-                    raw,
-                    sizeof(raw),
-                    "%d.%s.%s",
-                    *seed,
-                    bucketable,
-                    user->secondary);
-            } else {
-                snprintfStatus =
-                    snprintf(raw, sizeof(raw), "%d.%s", *seed, bucketable);
-            }
-        } else {
-            if (user->secondary) {
-                snprintfStatus = snprintf(
-                    raw,
-                    sizeof(raw),
-                    "%s.%s.%s.%s",
-                    segmentKey,
-                    salt,
-                    bucketable,
-                    user->secondary);
-            } else {
-                snprintfStatus = snprintf(
-                    raw, sizeof(raw), "%s.%s.%s", segmentKey, salt, bucketable);
-            }
-        }
+    if (!bucketable) {
+        return LDBooleanFalse;
+    }
 
-        if (snprintfStatus >= 0 && (size_t)snprintfStatus < sizeof(raw)) {
-            int         status;
-            char        digest[21], encoded[17];
-            const float longScale = 1152921504606846975.0;
+    /* hashes "seed.bucketable[.secondary]" or
+     * "segmentKey.salt.bucketable[.secondary]" without building it */
+    clibs_SHA1Init(&context);
 
-            clibs_SHA1(digest, raw, strlen(raw));
+    if (seed) {
+        char seedBuffer[16];
 
-            /* encodes to hex, and shortens, 16 characters in hex 8 bytes */
-            status = hexify(
-                (unsigned char *)digest,
-                sizeof(digest) - 1,
-                encoded,
-                sizeof(encoded));
-            LD_ASSERT(status == 16);
+        sha1UpdateText(
+            &context, LDi_formatInt(*seed, seedBuffer, sizeof(seedBuffer)));
+    } else {
+        sha1UpdateText(&context, segmentKey);
+        sha1UpdateText(&context, ".");
+        sha1UpdateText(&context, salt);
+    }
 
-            encoded[15] = 0;
+    sha1UpdateText(&context, ".");
+    sha1UpdateText(&context, bucketable);
 
-            *bucket = LDi_hexToDecimal(encoded) / longScale;
+    if (user->secondary) {
+        sha1UpdateText(&context, ".");
+        sha1UpdateText(&context, user->secondary);
+    }
 
-            LDJSONFree(attributeValue);
+    clibs_SHA1Final(digest, &context);
 
-            return LDBooleanTrue;
-        }
+    *bucket = LDi_digestToDecimal(digest) / longScale;
 
-        LDJSONFree(attributeValue);
-    }
+    return LDBooleanTrue;
+}
 
-    return LDBooleanFalse;
+LDBoolean
+LDi_bucketUser(
+    const struct LDUser *const user,
+    const char *const          segmentKey,
+    const char *const          attribute,
+    const char *const          salt,
+    const int *const           seed,
+    float *const               bucket)
+{
+    LD_ASSERT(attribute);
+
+    return bucketUser(
+        user,
+        segmentKey,
+        LDi_parseUserAttribute(attribute),
+        attribute,
+        salt,
+        seed,
+        bucket);
 }
 
 LDBoolean
 LDi_variationIndexForUser(
-    const struct LDJSON *const  varOrRoll,
-    const struct LDUser *const  user,
-    const char *const           key,
-    const char *const           salt,
-    LDBoolean *const            inExperiment,
-    const struct LDJSON **const index)
+    const struct LDCompiledVariationOrRollout *const varOrRoll,
+    const struct LDUser *const                       user,
+    const char *const                                key,
+    const char *const                                salt,
+    LDBoolean *const                                 inExperiment,
+    int *const                                       index)
 {
-    const struct LDJSON *variation, *rollout, *variations, *subVariation;
-    float                userBucket, sum;
-    LDBoolean            untrackedValue;
+    const struct LDCompiledWeightedVariation *weighted;
+    float                                     userBucket, sum;
+    unsigned int                              i;
+    const int *                               seedRef;
 
     LD_ASSERT(varOrRoll);
     LD_ASSERT(index);
@@ -1290,137 +1410,50 @@ LDi_variationIndexForUser(
     LD_ASSERT(salt);
     LD_ASSERT(user);
 
-    variations     = NULL;
-    userBucket     = 0;
-    sum            = 0;
-    subVariation   = NULL;
-    untrackedValue = LDBooleanFalse;
-    *inExperiment  = LDBooleanFalse;
-
-    /* if a specific variation */
-    {
-        const struct LDJSON *variation;
-
-        if (!lookupOptionalValueOfType(
-                varOrRoll,
-                "variationOrRollout",
-                "variation",
-                LDNumber,
-                &variation))
-        {
-            return LDBooleanFalse;
-        }
-
-        if (variation != NULL) {
-            *index = variation;
-
-            return LDBooleanTrue;
-        }
-    }
-
-    if (!(rollout = lookupRequiredValueOfType(
-              varOrRoll, "variationOrRollout", "rollout", LDObject)))
-    {
-        return LDBooleanFalse;
-    }
-
-    /* rollout kind */
-    {
-        const struct LDJSON *rolloutKind;
-
-        if (!lookupOptionalValueOfType(
-                rollout, "rollout", "kind", LDText, &rolloutKind))
-        {
-            return LDBooleanFalse;
-        }
-
-        if (rolloutKind && strcmp(LDGetText(rolloutKind), "experiment") == 0) {
-            *inExperiment = LDBooleanTrue;
-        }
-    }
-
-    if (!(variations = lookupRequiredValueOfType(
-              rollout, "rollout", "variations", LDArray)))
-    {
-        return LDBooleanFalse;
-    }
+    userBucket    = 0;
+    sum           = 0;
+    weighted      = NULL;
+    *inExperiment = LDBooleanFalse;
 
-    if (LDCollectionGetSize(variations) == 0) {
-        LD_LOG(LD_LOG_ERROR, "rollout variations must not be empty");
+    if (varOrRoll->malformed) {
+        LD_LOG(LD_LOG_ERROR, "variationOrRollout malformed");
 
         return LDBooleanFalse;
     }
 
-    {
-        const char *         attribute;
-        const struct LDJSON *seedJSON;
-        int                  seedValue, *seedValueRef;
-
-        seedValueRef = NULL;
-        attribute    = LDi_getBucketAttribute(rollout);
-
-        if (attribute == NULL) {
-            LD_LOG(LD_LOG_ERROR, "failed to parse bucketBy");
-
-            return LDBooleanFalse;
-        }
-
-        if (!lookupOptionalValueOfType(
-                rollout, "rollout", "seed", LDNumber, &seedJSON)) {
-            return LDBooleanFalse;
-        }
-
-        if (seedJSON != NULL) {
-            seedValue    = (int)LDGetNumber(seedJSON);
-            seedValueRef = &seedValue;
-        }
+    /* if a specific variation */
+    if (!varOrRoll->isRollout) {
+        *index = varOrRoll->variation;
 
-        LDi_bucketUser(user, key, attribute, salt, seedValueRef, &userBucket);
+        return LDBooleanTrue;
     }
 
-    for (variation = LDGetIter(variations); variation;
-         variation = LDIterNext(variation))
-    {
-        const struct LDJSON *untracked, *weight;
+    *inExperiment = varOrRoll->isExperiment;
 
-        if (!(weight = lookupRequiredValueOfType(
-                  variation, "weightedVariation", "weight", LDNumber)))
-        {
-            return LDBooleanFalse;
-        }
+    seedRef = varOrRoll->hasSeed ? &varOrRoll->seed : NULL;
 
-        sum += LDGetNumber(weight) / 100000.0;
+    bucketUser(
+        user,
+        key,
+        varOrRoll->bucketByID,
+        varOrRoll->bucketBy,
+        salt,
+        seedRef,
+        &userBucket);
 
-        if (!(subVariation = lookupRequiredValueOfType(
-                  variation, "weightedVariation", "variation", LDNumber)))
-        {
-            return LDBooleanFalse;
-        }
+    for (i = 0; i < varOrRoll->variationCount; i++) {
+        weighted = &varOrRoll->variations[i];
 
-        untrackedValue = LDBooleanFalse;
+        if (weighted->malformed) {
+            LD_LOG(LD_LOG_ERROR, "weightedVariation malformed");
 
-        if (!lookupOptionalValueOfType(
-                variation,
-                "weightedVariation",
-                "untracked",
-                LDBool,
-                &untracked))
-        {
             return LDBooleanFalse;
         }
 
-        if (untracked != NULL) {
-            untrackedValue = LDGetBool(untracked);
-        }
+        sum += weighted->weight / 100000.0;
 
         if (userBucket < sum) {
-            *index = subVariation;
-
-            if (*inExperiment && untrackedValue) {
-                *inExperiment = LDBooleanFalse;
-            }
-
-            return LDBooleanTrue;
+            break;
         }
     }
 
@@ -1430,12 +1463,12 @@ LDi_variationIndexForUser(
     buckets that don't actually add up to 100000. Rather than returning an error
     in this case (or changing the scaling, which would potentially change the
     results for *all* users), we will simply put the user in the last bucket.
-    The loop ensures subVariation is the last element, and a size check above
-    ensures there is at least one element. */
+    The loop leaves weighted at the last element, and compilation ensures there
+    is at least one element. */
 
-    *index = subVariation;
+    *index = weighted->variation;
 
-    if (*inExperiment && untrackedValue) {
+    if (*inExperiment && weighted->untracked) {
         *inExperiment = LDBooleanFalse;
     }
 
@@ -1444,34 +1477,30 @@ LDi_variationIndexForUser(
 
 LDBoolean
 LDi_getIndexForVariationOrRollout(
-    const struct LDJSON *const  flag,
-    const struct LDJSON *const  varOrRoll,
-    const struct LDUser *const  user,
-    LDBoolean *const            inExperiment,
-    const struct LDJSON **const result)
+    const struct LDCompiledFlag *const               flag,
+    const struct LDCompiledVariationOrRollout *const varOrRoll,
+    const struct LDUser *const                       user,
+    LDBoolean *const                                 inExperiment,
+    int *const                                       result)
 {
-    const struct LDJSON *key, *salt;
-
     LD_ASSERT(flag);
     LD_ASSERT(varOrRoll);
     LD_ASSERT(inExperiment);
     LD_ASSERT(result);
 
-    *result = NULL;
+    *result = LD_INVALID_VARIATION;
 
-    if (!(key = lookupRequiredValueOfType(flag, "flag", "key", LDText))) {
-        return LDBooleanFalse;
-    }
+    if (!flag->key || !flag->salt) {
+        LD_LOG(LD_LOG_ERROR, "flag missing key or salt");
 
-    if (!(salt = lookupRequiredValueOfType(flag, "flag", "salt", LDText))) {
         return LDBooleanFalse;
     }
 
     if (!LDi_variationIndexForUser(
             varOrRoll,
             user,
-            LDGetText(key),
-            LDGetText(salt),
+            flag->key,
+            flag->salt,
             inExperiment,
             result))
     {
@@ -10,6 +10,7 @@
 #include <launchdarkly/json.h>
 #include <launchdarkly/variations.h>
 
+#include "compiled.h"
 #include "store.h"
 
 typedef enum
@@ -21,56 +22,115 @@ typedef enum
     EVAL_MISS
 } EvalStatus;
 
+struct LDEvaluationContext;
+
 LDBoolean
 LDi_isEvalError(const EvalStatus status);
 
+/* Compiles the flag for the duration of the call. Prefer LDi_evaluateRC for
+ * flags obtained from the store, which are compiled ahead of time. context
+ * memoizes segment and prerequisite results across calls for the same user,
+ * and may be NULL. o_events may be NULL when the events of prerequisites are
+ * not wanted, and then they are not built. */
 EvalStatus
 LDi_evaluate(
-    struct LDClient *const     client,
-    const struct LDJSON *const flag,
-    const struct LDUser *const user,
-    struct LDStore *const      store,
-    struct LDDetails *const    details,
-    struct LDJSON **const      o_events,
-    struct LDJSON **const      o_value,
-    const LDBoolean            recordReason);
+    struct LDClient *const            client,
+    const struct LDJSON *const        flag,
+    const struct LDUser *const        user,
+    struct LDStore *const             store,
+    struct LDEvaluationContext *const context,
+    struct LDDetails *const           details,
+    struct LDJSON **const             o_events,
+    struct LDJSON **const             o_value,
+    const LDBoolean                   recordReason);
+
+EvalStatus
+LDi_evaluateCompiled(
+    struct LDClient *const             client,
+    const struct LDCompiledFlag *const flag,
+    const struct LDUser *const         user,
+    struct LDStore *const              store,
+    struct LDEvaluationContext *const  context,
+    struct LDDetails *const            details,
+    struct LDJSON **const              o_events,
+    struct LDJSON **const              o_value,
+    const LDBoolean                    recordReason);
+
+/* Evaluates a flag from the store, using its compiled representation if one
+ * is attached. */
+EvalStatus
+LDi_evaluateRC(
+    struct LDClient *const            client,
+    struct LDJSONRC *const            flag,
+    const struct LDUser *const        user,
+    struct LDStore *const             store,
+    struct LDEvaluationContext *const context,
+    struct LDDetails *const           details,
+    struct LDJSON **const             o_events,
+    struct LDJSON **const             o_value,
+    const LDBoolean                   recordReason);
+
+/* As LDi_evaluateRC, for details which are not used after context is freed.
+ * Their strings are allocated from context, which must not be NULL, so they
+ * must not be cleared with LDDetailsClear. */
+EvalStatus
+LDi_evaluateRCScratch(
+    struct LDClient *const            client,
+    struct LDJSONRC *const            flag,
+    const struct LDUser *const        user,
+    struct LDStore *const             store,
+    struct LDEvaluationContext *const context,
+    struct LDDetails *const           details,
+    struct LDJSON **const             o_events,
+    struct LDJSON **const             o_value,
+    const LDBoolean                   recordReason);
 
 EvalStatus
 LDi_checkPrerequisites(
-    struct LDClient *const     client,
-    const struct LDJSON *const flag,
-    const struct LDUser *const user,
-    struct LDStore *const      store,
-    const char **const         failedKey,
-    struct LDJSON **const      events,
-    const LDBoolean            recordReason);
+    struct LDClient *const             client,
+    const struct LDCompiledFlag *const flag,
+    const struct LDUser *const         user,
+    struct LDStore *const              store,
+    struct LDEvaluationContext *const  context,
+    const char **const                 failedKey,
+    struct LDJSON **const              events,
+    const LDBoolean                    recordReason);
 
 EvalStatus
 LDi_ruleMatchesUser(
-    const struct LDJSON *const rule,
-    const struct LDUser *const user,
-    struct LDStore *const      store);
+    const struct LDCompiledRule *const rule,
+    const struct LDUser *const         user,
+    struct LDStore *const              store,
+    struct LDEvaluationContext *const  context);
 
 EvalStatus
 LDi_clauseMatchesUser(
-    const struct LDJSON *const clause,
-    const struct LDUser *const user,
-    struct LDStore *const      store);
+    const struct LDCompiledClause *const clause,
+    const struct LDUser *const           user,
+    struct LDStore *const                store,
+    struct LDEvaluationContext *const    context);
 
+/* Compiles the segment for the duration of the call. */
 EvalStatus
 LDi_segmentMatchesUser(
     const struct LDJSON *const segment, const struct LDUser *const user);
 
+EvalStatus
+LDi_segmentMatchesUserCompiled(
+    const struct LDCompiledSegment *const segment,
+    const struct LDUser *const            user);
+
 EvalStatus
 LDi_segmentRuleMatchUser(
-    const struct LDJSON *const segmentRule,
-    const char *const          segmentKey,
-    const struct LDUser *const user,
-    const char *const          salt);
+    const struct LDCompiledSegmentRule *const segmentRule,
+    const char *const                         segmentKey,
+    const struct LDUser *const                user,
+    const char *const                         salt);
 
 EvalStatus
 LDi_clauseMatchesUserNoSegments(
-    const struct LDJSON *const clause, const struct LDUser *const user);
+    const struct LDCompiledClause *const clause,
+    const struct LDUser *const           user);
 
 LDBoolean
 LDi_bucketUser(
@@ -83,17 +143,17 @@ LDi_bucketUser(
 
 LDBoolean
 LDi_variationIndexForUser(
-    const struct LDJSON *const  varOrRoll,
-    const struct LDUser *const  user,
-    const char *const           key,
-    const char *const           salt,
-    LDBoolean *const            inExperiment,
-    const struct LDJSON **const index);
+    const struct LDCompiledVariationOrRollout *const varOrRoll,
+    const struct LDUser *const                       user,
+    const char *const                                key,
+    const char *const                                salt,
+    LDBoolean *const                                 inExperiment,
+    int *const                                       index);
 
 LDBoolean
 LDi_getIndexForVariationOrRollout(
-    const struct LDJSON *const  flag,
-    const struct LDJSON *const  varOrRoll,
-    const struct LDUser *const  user,
-    LDBoolean *const            inExperiment,
-    const struct LDJSON **const result);
+    const struct LDCompiledFlag *const               flag,
+    const struct LDCompiledVariationOrRollout *const varOrRoll,
+    const struct LDUser *const                       user,
+    LDBoolean *const                                 inExperiment,
+    int *const                                       result);
@@ -0,0 +1,215 @@
+#include <string.h>
+
+#include <uthash.h>
+
+#include <launchdarkly/memory.h>
+
+#include "arena.h"
+#include "assertion.h"
+#include "evaluation_context.h"
+#include "utility.h"
+
+#undef uthash_malloc
+#undef uthash_free
+
+/* Memos and their tables live in the arena of the context, which is in scope
+ * wherever a hash is added to, and are released with it. */
+#define uthash_malloc(sz) LDi_arenaAlloc(&context->arena, sz)
+#define uthash_free(ptr, sz)
+
+struct LDSegmentMemo
+{
+    char *         key;
+    EvalStatus     status;
+    UT_hash_handle hh;
+};
+
+struct LDPrerequisiteMemo
+{
+    char *                      key;
+    struct LDPrerequisiteResult result;
+    UT_hash_handle              hh;
+};
+
+/* Enough for the first memo and its table, so that a context with few memos
+ * takes a single allocation. */
+#define LD_EVALUATION_CONTEXT_BUFFER_SIZE 1024
+
+struct LDEvaluationContext
+{
+    struct LDSegmentMemo *     segments;
+    struct LDPrerequisiteMemo *prerequisites;
+    struct LDArena             arena;
+    union LDArenaAlign
+        buffer[LD_EVALUATION_CONTEXT_BUFFER_SIZE / sizeof(union LDArenaAlign)];
+};
+
+void
+LDi_prerequisiteResultClear(struct LDPrerequisiteResult *const result)
+{
+    LD_ASSERT(result);
+
+    LDJSONRCRelease(result->flag);
+    LDJSONFree(result->value);
+    LDJSONFree(result->events);
+
+    result->status = EVAL_MISS;
+    result->flag   = NULL;
+    result->value  = NULL;
+    result->events = NULL;
+}
+
+struct LDEvaluationContext *
+LDi_evaluationContextNew(void)
+{
+    struct LDEvaluationContext *context;
+
+    if (!(context = LDAlloc(sizeof(struct LDEvaluationContext)))) {
+        return NULL;
+    }
+
+    context->segments      = NULL;
+    context->prerequisites = NULL;
+
+    LDi_arenaInit(&context->arena, context->buffer, sizeof(context->buffer));
+
+    return context;
+}
+
+void
+LDi_evaluationContextFree(struct LDEvaluationContext *const context)
+{
+    if (context) {
+        struct LDPrerequisiteMemo *prerequisite, *prerequisiteTmp;
+
+        /* Only the flags, values and events of results are held outside of
+         * the arena. */
+        HASH_ITER(hh, context->prerequisites, prerequisite, prerequisiteTmp)
+        {
+            LDi_prerequisiteResultClear(&prerequisite->result);
+        }
+
+        LDi_arenaDestroy(&context->arena);
+
+        LDFree(context);
+    }
+}
+
+LDBoolean
+LDi_evaluationContextFindSegment(
+    const struct LDEvaluationContext *const context,
+    const char *const                       segmentKey,
+    EvalStatus *const                       status)
+{
+    struct LDSegmentMemo *segment;
+
+    LD_ASSERT(context);
+    LD_ASSERT(segmentKey);
+    LD_ASSERT(status);
+
+    HASH_FIND_STR(context->segments, segmentKey, segment);
+
+    if (!segment) {
+        return LDBooleanFalse;
+    }
+
+    *status = segment->status;
+
+    return LDBooleanTrue;
+}
+
+void
+LDi_evaluationContextAddSegment(
+    struct LDEvaluationContext *const context,
+    const char *const                 segmentKey,
+    const EvalStatus                  status)
+{
+    struct LDSegmentMemo *segment;
+
+    LD_ASSERT(context);
+    LD_ASSERT(segmentKey);
+
+    if (!(segment = LDi_arenaAlloc(
+              &context->arena, sizeof(struct LDSegmentMemo))) ||
+        !(segment->key = LDi_arenaStrDup(&context->arena, segmentKey)))
+    {
+        return;
+    }
+
+    segment->status = status;
+
+    HASH_ADD_KEYPTR(
+        hh, context->segments, segment->key, strlen(segment->key), segment);
+}
+
+const struct LDPrerequisiteResult *
+LDi_evaluationContextFindPrerequisite(
+    const struct LDEvaluationContext *const context, const char *const flagKey)
+{
+    struct LDPrerequisiteMemo *prerequisite;
+
+    LD_ASSERT(context);
+    LD_ASSERT(flagKey);
+
+    HASH_FIND_STR(context->prerequisites, flagKey, prerequisite);
+
+    if (!prerequisite) {
+        return NULL;
+    }
+
+    return &prerequisite->result;
+}
+
+const struct LDPrerequisiteResult *
+LDi_evaluationContextAddPrerequisite(
+    struct LDEvaluationContext *const  context,
+    const char *const                  flagKey,
+    struct LDPrerequisiteResult *const result)
+{
+    struct LDPrerequisiteMemo *prerequisite;
+
+    LD_ASSERT(context);
+    LD_ASSERT(flagKey);
+    LD_ASSERT(result);
+
+    if (!(prerequisite = LDi_arenaAlloc(
+              &context->arena, sizeof(struct LDPrerequisiteMemo))) ||
+        !(prerequisite->key = LDi_arenaStrDup(&context->arena, flagKey)))
+    {
+        return NULL;
+    }
+
+    prerequisite->result = *result;
+
+    LDDetailsInit(&result->details);
+    result->flag   = NULL;
+    result->value  = NULL;
+    result->events = NULL;
+
+    HASH_ADD_KEYPTR(
+        hh,
+        context->prerequisites,
+        prerequisite->key,
+        strlen(prerequisite->key),
+        prerequisite);
+
+    return &prerequisite->result;
+}
+
+void *
+LDi_evaluationContextAlloc(
+    struct LDEvaluationContext *const context, const size_t bytes)
+{
+    LD_ASSERT(context);
+
+    return LDi_arenaAlloc(&context->arena, bytes);
+}
+
+char *
+LDi_evaluationContextStrDup(
+    struct LDEvaluationContext *const context, const char *const string)
+{
+    LD_ASSERT(context);
+
+    return LDi_arenaStrDup(&context->arena, string);
+}
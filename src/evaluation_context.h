@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <launchdarkly/json.h>
+#include <launchdarkly/variations.h>
+
+#include "evaluate.h"
+#include "store/ldjsonrc.h"
+
+/* Results memoized across the evaluations made for one user against one
+ * store, such as the flags of a single LDAllFlags call. A context must not be
+ * reused for a different user. Not thread safe.
+ *
+ * Memos are kept in an arena which is released in one step when the context
+ * is freed, along with the details strings of prerequisites and of scratch
+ * evaluations, see LDi_evaluateRCScratch. Values and events are built through
+ * the global allocation hooks, as they may be handed back to the caller.
+ *
+ * Prerequisite results are memoized with their events only if those were
+ * asked for, so every evaluation made with a context must agree on whether
+ * o_events is NULL. */
+struct LDEvaluationContext;
+
+/* The outcome of evaluating a prerequisite flag, everything needed to report
+ * it as a prerequisite event. */
+struct LDPrerequisiteResult
+{
+    EvalStatus       status;
+    struct LDJSONRC *flag;
+    struct LDDetails details;
+    struct LDJSON *  value;
+    /* Events of the prerequisite's own prerequisites, may be NULL */
+    struct LDJSON *events;
+};
+
+/* Does not clear the details, as their strings are either allocated from the
+ * context, or cleared by the evaluation which owns them. */
+void
+LDi_prerequisiteResultClear(struct LDPrerequisiteResult *const result);
+
+struct LDEvaluationContext *
+LDi_evaluationContextNew(void);
+
+void
+LDi_evaluationContextFree(struct LDEvaluationContext *const context);
+
+/* Returns true and sets status if the segment has been matched before. */
+LDBoolean
+LDi_evaluationContextFindSegment(
+    const struct LDEvaluationContext *const context,
+    const char *const                       segmentKey,
+    EvalStatus *const                       status);
+
+/* Failing to record a result only loses the memoization. */
+void
+LDi_evaluationContextAddSegment(
+    struct LDEvaluationContext *const context,
+    const char *const                 segmentKey,
+    const EvalStatus                  status);
+
+const struct LDPrerequisiteResult *
+LDi_evaluationContextFindPrerequisite(
+    const struct LDEvaluationContext *const context, const char *const flagKey);
+
+/* Takes ownership of the contents of result, clearing it, and returns the
+ * stored copy. On allocation failure returns NULL and leaves result as is. */
+const struct LDPrerequisiteResult *
+LDi_evaluationContextAddPrerequisite(
+    struct LDEvaluationContext *const  context,
+    const char *const                  flagKey,
+    struct LDPrerequisiteResult *const result);
+
+/* Returns scratch memory which lives until the context is freed, or NULL on
+ * allocation failure. */
+void *
+LDi_evaluationContextAlloc(
+    struct LDEvaluationContext *const context, const size_t bytes);
+
+char *
+LDi_evaluationContextStrDup(
+    struct LDEvaluationContext *const context, const char *const string);
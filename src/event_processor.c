@@ -5,50 +5,98 @@
 #include "event_processor.h"
 #include "event_processor_internal.h"
 #include "logging.h"
+#include "summary_counters.h"
 #include "utility.h"
 #include "time_utils.h"
 
+/* Evaluations append to one of several shards, chosen by thread, so that
+ * concurrent evaluations rarely contend on the same lock. Shards are merged
+ * into the processor when a payload is produced. */
+#define LD_EVENT_SHARDS 16
+
+struct LDEventShard
+{
+    ld_mutex_t                lock;
+    struct LDJSON *           events; /* Array of Objects */
+    struct LDSummaryCounters *summaryCounters;
+    double                    summaryStart;
+};
+
+/* The user keys used to deduplicate index events, sharded by key, so that a
+ * given key is always deduplicated in the same place. */
+struct LDUserKeyShard
+{
+    ld_mutex_t     lock;
+    struct LDLRU * userKeys;
+    struct LDTimer lastUserKeyFlush;
+};
+
 struct LDEventProcessor
 {
-    ld_mutex_t             lock;
-    struct LDJSON *        events;          /* Array of Objects */
-    struct LDJSON *        summaryCounters; /* Object */
-    double                 summaryStart;
-    struct LDLRU *         userKeys;
-    struct LDTimer         lastUserKeyFlush;
-    struct LDTimestamp     lastServerTime;
-    const struct LDConfig *config;
+    /* Guards the merged events and summary, and lastServerTime. May be taken
+     * before a shard lock, but never while holding one. */
+    ld_mutex_t                lock;
+    struct LDJSON *           events; /* Array of Objects */
+    struct LDSummaryCounters *summaryCounters;
+    double                    summaryStart;
+    struct LDTimestamp        lastServerTime;
+    /* Events queued in the processor and all shards, for eventsCapacity. */
+    ld_atomic_t               queuedEvents;
+    struct LDEventShard       shards[LD_EVENT_SHARDS];
+    struct LDUserKeyShard     userKeyShards[LD_EVENT_SHARDS];
+    const struct LDConfig *   config;
 };
 
 struct LDEventProcessor *
 LDEventProcessor_Create(const struct LDConfig *config)
 {
     struct LDEventProcessor *processor;
+    unsigned int             i, userKeysCapacity;
 
     if (!(processor =
               (struct LDEventProcessor *)LDAlloc(sizeof(struct LDEventProcessor))))
     {
-        goto error;
+        return NULL;
     }
 
+    memset(processor, 0, sizeof(struct LDEventProcessor));
+
     processor->summaryStart     = 0;
     processor->config           = config;
 
     LDTimestamp_InitZero(&processor->lastServerTime);
-    LDTimer_Reset(&processor->lastUserKeyFlush);
 
     LDi_mutex_init(&processor->lock);
 
+    for (i = 0; i < LD_EVENT_SHARDS; i++) {
+        LDi_mutex_init(&processor->shards[i].lock);
+        LDi_mutex_init(&processor->userKeyShards[i].lock);
+        LDTimer_Reset(&processor->userKeyShards[i].lastUserKeyFlush);
+    }
+
     if (!(processor->events = LDNewArray())) {
         goto error;
     }
 
-    if (!(processor->summaryCounters = LDNewObject())) {
+    if (!(processor->summaryCounters = LDi_summaryCountersNew())) {
         goto error;
     }
 
-    if (!(processor->userKeys = LDLRUInit(config->userKeysCapacity))) {
-        goto error;
+    /* Zero disables deduplication, so it must stay zero. */
+    userKeysCapacity = (config->userKeysCapacity + LD_EVENT_SHARDS - 1) / LD_EVENT_SHARDS;
+
+    for (i = 0; i < LD_EVENT_SHARDS; i++) {
+        if (!(processor->shards[i].events = LDNewArray())) {
+            goto error;
+        }
+
+        if (!(processor->shards[i].summaryCounters = LDi_summaryCountersNew())) {
+            goto error;
+        }
+
+        if (!(processor->userKeyShards[i].userKeys = LDLRUInit(userKeysCapacity))) {
+            goto error;
+        }
     }
 
     return processor;
@@ -63,367 +111,548 @@ void
 LDEventProcessor_Destroy(struct LDEventProcessor *processor)
 {
     if (processor) {
+        unsigned int i;
+
+        for (i = 0; i < LD_EVENT_SHARDS; i++) {
+            LDi_mutex_destroy(&processor->shards[i].lock);
+            LDJSONFree(processor->shards[i].events);
+            LDi_summaryCountersFree(processor->shards[i].summaryCounters);
+
+            LDi_mutex_destroy(&processor->userKeyShards[i].lock);
+            LDLRUFree(processor->userKeyShards[i].userKeys);
+        }
+
         LDi_mutex_destroy(&processor->lock);
         LDJSONFree(processor->events);
-        LDJSONFree(processor->summaryCounters);
-        LDLRUFree(processor->userKeys);
+        LDi_summaryCountersFree(processor->summaryCounters);
         LDFree(processor);
     }
 }
 
-LDBoolean
-LDEventProcessor_ProcessEvaluation(struct LDEventProcessor *processor, struct EvaluationResult *result)
+static struct LDEventShard *
+currentShard(struct LDEventProcessor *const processor)
 {
-    struct LDJSON *indexEvent, *featureEvent;
-    const struct LDJSON *evaluationValue;
-    const unsigned int *variationIndexRef;
-    struct LDTimestamp now;
+    unsigned long hash = LDi_thread_id();
 
-    indexEvent        = NULL;
-    featureEvent      = NULL;
-    evaluationValue   = NULL;
-    variationIndexRef = NULL;
+    /* Thread identifiers are often aligned addresses, so mix the high bits
+     * into the low ones before reducing. */
+    hash ^= (hash >> 16) >> 16;
+    hash ^= hash >> 16;
+    hash *= 0x45d9f3bUL;
+    hash ^= hash >> 16;
 
-    LD_ASSERT(processor);
-    LD_ASSERT(result->details);
+    return &processor->shards[hash % LD_EVENT_SHARDS];
+}
 
-    if (!LDTimestamp_InitNow(&now)) {
-        LD_LOG(LD_LOG_CRITICAL, "failed to obtain current time");
+static struct LDUserKeyShard *
+userKeyShard(struct LDEventProcessor *const processor, const char *key)
+{
+    unsigned long hash = 5381;
 
-        LDJSONFree(result->subEvents);
-        return LDBooleanFalse;
+    while (*key) {
+        hash = hash * 33 + (unsigned char)*key++;
     }
 
-    if (LDi_notNull(result->actualValue)) {
-        evaluationValue = result->actualValue;
-    } else {
-        evaluationValue = result->fallbackValue;
-    }
+    return &processor->userKeyShards[hash % LD_EVENT_SHARDS];
+}
 
-    if (result->details->hasVariation) {
-        variationIndexRef = &result->details->variationIndex;
-    }
+/* Moves the contents of every shard into the processor. The caller must hold
+ * processor->lock. */
+static void
+collectShards(struct LDEventProcessor *const processor)
+{
+    unsigned int i;
 
-    LDi_mutex_lock(&processor->lock);
+    for (i = 0; i < LD_EVENT_SHARDS; i++) {
+        struct LDEventShard *const shard = &processor->shards[i];
+        struct LDJSON *            iter;
 
-    featureEvent = LDi_newFeatureEvent(
-            result->flagKey,
-            result->user,
-            variationIndexRef,
-            evaluationValue,
-            result->fallbackValue,
-            NULL,
-            result->flag,
-            result->details,
-            now,
-            processor->config->inlineUsersInEvents,
-            processor->config->allAttributesPrivate,
-            processor->config->privateAttributeNames
-    );
+        LDi_mutex_lock(&shard->lock);
 
-    if (!featureEvent) {
-        LDi_mutex_unlock(&processor->lock);
+        for (iter = LDGetIter(shard->events); iter;) {
+            struct LDJSON *const next = LDIterNext(iter);
 
-        LDJSONFree(result->subEvents);
+            struct LDJSON *const event = LDCollectionDetachIter(shard->events, iter);
 
-        return LDBooleanFalse;
-    }
+            if (!LDArrayPush(processor->events, event)) {
+                LD_LOG(LD_LOG_ERROR, "alloc error");
 
-    if (!LDi_maybeMakeIndexEvent(processor, result->user, now, &indexEvent)) {
-        LDi_mutex_unlock(&processor->lock);
+                LDJSONFree(event);
+                LDi_atomic_decrement(&processor->queuedEvents);
+            }
 
-        LDJSONFree(featureEvent);
-        LDJSONFree(result->subEvents);
+            iter = next;
+        }
 
-        return LDBooleanFalse;
-    }
+        LDi_summaryCountersMerge(processor->summaryCounters, shard->summaryCounters);
 
-    if (!LDi_summarizeEvent(processor, featureEvent, (LDBoolean) (!result->flag))) {
-        LDi_mutex_unlock(&processor->lock);
+        if (shard->summaryStart != 0 &&
+            (processor->summaryStart == 0 || shard->summaryStart < processor->summaryStart))
+        {
+            processor->summaryStart = shard->summaryStart;
+        }
 
-        LDJSONFree(featureEvent);
-        LDJSONFree(result->subEvents);
+        shard->summaryStart = 0;
 
-        return LDBooleanFalse;
+        LDi_mutex_unlock(&shard->lock);
     }
+}
 
-    if (indexEvent) {
-        LDi_addEvent(processor, indexEvent);
+LDBoolean
+LDi_makeFeatureEventRecord(
+    const struct EvaluationResult *const result,
+    const struct LDTimestamp             now,
+    struct LDFeatureEventRecord *const   record)
+{
+    const struct LDDetails *details;
+    const struct LDJSON *   tmp;
 
-        indexEvent = NULL;
+    LD_ASSERT(result);
+    LD_ASSERT(result->details);
+    LD_ASSERT(record);
+
+    details = result->details;
+
+    memset(record, 0, sizeof(struct LDFeatureEventRecord));
+
+    record->flagKey      = result->flagKey;
+    record->creationDate = now;
+
+    if (details->hasVariation) {
+        record->hasVariation = LDBooleanTrue;
+        record->variation    = details->variationIndex;
     }
 
-    if (result->flag) {
-        LDi_possiblyQueueEvent(processor, featureEvent, now, result);
+    if (!result->flag) {
+        return LDBooleanTrue;
+    }
+
+    /* The same schema checks as LDi_newFeatureEvent */
+    if (LDi_notNull(tmp = LDObjectLookup(result->flag, "version"))) {
+        if (LDJSONGetType(tmp) != LDNumber) {
+            LD_LOG(LD_LOG_ERROR, "schema error");
+
+            return LDBooleanFalse;
+        }
 
-        featureEvent = NULL;
+        record->hasVersion = LDBooleanTrue;
+        record->version    = LDGetNumber(tmp);
     }
 
-    LDJSONFree(featureEvent);
+    if (LDi_notNull(tmp = LDObjectLookup(result->flag, "debugEventsUntilDate"))) {
+        if (LDJSONGetType(tmp) != LDNumber) {
+            LD_LOG(LD_LOG_ERROR, "schema error");
 
-    if (result->subEvents) {
-        struct LDJSON *iter;
-        /* local only sanity */
-        LD_ASSERT(LDJSONGetType(result->subEvents) == LDArray);
-        /* different loop to make cleanup easier */
-        for (iter = LDGetIter(result->subEvents); iter; iter = LDIterNext(iter)) {
-            /* should lock here */
-            if (!LDi_summarizeEvent(processor, iter, LDBooleanFalse)) {
-                LD_LOG(LD_LOG_ERROR, "summary failed");
+            return LDBooleanFalse;
+        }
 
-                LDJSONFree(result->subEvents);
+        record->hasDebugEventsUntilDate = LDBooleanTrue;
+        record->debugEventsUntilDate    = LDGetNumber(tmp);
+    }
 
-                LDi_mutex_unlock(&processor->lock);
+    if (LDi_notNull(tmp = LDObjectLookup(result->flag, "trackEvents"))) {
+        if (LDJSONGetType(tmp) != LDBool) {
+            LD_LOG(LD_LOG_ERROR, "schema error");
 
-                return LDBooleanFalse;
-            }
+            return LDBooleanFalse;
         }
 
-        for (iter = LDGetIter(result->subEvents); iter;) {
-            struct LDJSON *const next = LDIterNext(iter);
+        record->trackEvents = LDGetBool(tmp);
+    }
 
-            LDi_possiblyQueueEvent(
-                processor,
-                LDCollectionDetachIter(result->subEvents, iter),
-                now,
-                result);
+    if (LDi_notNull(tmp = LDObjectLookup(result->flag, "trackEventsFallthrough"))) {
+        if (LDJSONGetType(tmp) != LDBool) {
+            LD_LOG(LD_LOG_ERROR, "schema error");
 
-            iter = next;
+            return LDBooleanFalse;
         }
 
-        LDJSONFree(result->subEvents);
+        if (LDGetBool(tmp) && details->reason == LD_FALLTHROUGH) {
+            record->trackEvents = LDBooleanTrue;
+        }
     }
 
-    LDi_mutex_unlock(&processor->lock);
+    if (details->reason == LD_RULE_MATCH) {
+        tmp = LDArrayLookup(
+            LDObjectLookup(result->flag, "rules"), details->extra.rule.ruleIndex);
+
+        if (LDi_notNull(tmp = LDObjectLookup(tmp, "trackEvents")) &&
+            LDJSONGetType(tmp) == LDBool && LDGetBool(tmp) == LDBooleanTrue)
+        {
+            record->trackEvents = LDBooleanTrue;
+        }
+
+        if (details->extra.rule.inExperiment) {
+            record->trackEvents = LDBooleanTrue;
+        }
+    } else if (details->reason == LD_FALLTHROUGH) {
+        if (details->extra.fallthrough.inExperiment) {
+            record->trackEvents = LDBooleanTrue;
+        }
+    }
 
     return LDBooleanTrue;
 }
 
 LDBoolean
-LDi_summarizeEvent(
-    struct LDEventProcessor *const processor,
-    const struct LDJSON *const   event,
-    const LDBoolean              unknown)
+LDi_featureEventRecordIsQueued(
+    struct LDEventProcessor *const           processor,
+    const struct LDFeatureEventRecord *const record)
 {
-    char *         keytext;
-    const char *   flagKey;
-    struct LDJSON *tmp, *entry, *flagContext, *counters;
-    LDBoolean      success;
+    struct LDTimestamp debugUntil, lastServerTime;
 
     LD_ASSERT(processor);
-    LD_ASSERT(event);
+    LD_ASSERT(record);
 
-    keytext     = NULL;
-    flagKey     = NULL;
-    tmp         = NULL;
-    entry       = NULL;
-    flagContext = NULL;
-    counters    = NULL;
-    success     = LDBooleanFalse;
+    if (record->trackEvents) {
+        return LDBooleanTrue;
+    }
 
-    tmp = LDObjectLookup(event, "key");
-    LD_ASSERT(tmp);
-    LD_ASSERT(LDJSONGetType(tmp) == LDText);
-    flagKey = LDGetText(tmp);
-    LD_ASSERT(flagKey);
+    if (!record->hasDebugEventsUntilDate) {
+        return LDBooleanFalse;
+    }
 
-    if (!(keytext = LDi_makeSummaryKey(event))) {
-        LD_LOG(LD_LOG_ERROR, "alloc error");
+    LDTimestamp_InitUnixMillis(&debugUntil, record->debugEventsUntilDate);
 
+    if (!LDTimestamp_Before(&record->creationDate, &debugUntil)) {
         return LDBooleanFalse;
     }
 
-    if (processor->summaryStart == 0) {
+    LDi_mutex_lock(&processor->lock);
+    lastServerTime = processor->lastServerTime;
+    LDi_mutex_unlock(&processor->lock);
+
+    return LDTimestamp_Before(&lastServerTime, &debugUntil);
+}
+
+/* Counts one evaluation in the summary of shard. The caller must hold
+ * shard->lock. */
+static LDBoolean
+addSummary(
+    struct LDEventShard *const shard,
+    const char *const          flagKey,
+    const unsigned int *const  variation,
+    const double *const        version,
+    const struct LDJSON *const value,
+    const struct LDJSON *const defaultValue,
+    const LDBoolean            unknown)
+{
+    if (shard->summaryStart == 0) {
         double now;
 
         LDi_getUnixMilliseconds(&now);
 
-        processor->summaryStart = now;
+        shard->summaryStart = now;
     }
 
-    if (!(flagContext = LDObjectLookup(processor->summaryCounters, flagKey))) {
-        if (!(flagContext = LDNewObject())) {
-            LD_LOG(LD_LOG_ERROR, "alloc error");
+    return LDi_summaryCountersAdd(
+        shard->summaryCounters,
+        flagKey,
+        variation,
+        version,
+        value,
+        defaultValue,
+        unknown);
+}
 
-            goto cleanup;
-        }
+/* Counts a feature event in the summary of shard. The caller must hold
+ * shard->lock. */
+static LDBoolean
+addEventSummary(
+    struct LDEventShard *const shard,
+    const struct LDJSON *const event,
+    const LDBoolean            unknown)
+{
+    const char *         flagKey;
+    const struct LDJSON *tmp;
+    unsigned int         variation;
+    double               version;
+    const unsigned int * variationRef;
+    const double *       versionRef;
 
-        tmp = LDObjectLookup(event, "default");
+    LD_ASSERT(event);
 
-        if (LDi_notNull(tmp)) {
-            if (!(tmp = LDJSONDuplicate(tmp))) {
-                LD_LOG(LD_LOG_ERROR, "alloc error");
+    variationRef = NULL;
+    versionRef   = NULL;
 
-                LDJSONFree(flagContext);
+    tmp = LDObjectLookup(event, "key");
+    LD_ASSERT(tmp);
+    LD_ASSERT(LDJSONGetType(tmp) == LDText);
+    flagKey = LDGetText(tmp);
+    LD_ASSERT(flagKey);
 
-                goto cleanup;
-            }
+    if (LDi_notNull(tmp = LDObjectLookup(event, "variation"))) {
+        LD_ASSERT(LDJSONGetType(tmp) == LDNumber);
 
-            if (!LDObjectSetKey(flagContext, "default", tmp)) {
-                LD_LOG(LD_LOG_ERROR, "alloc error");
+        variation    = LDGetNumber(tmp);
+        variationRef = &variation;
+    }
 
-                LDJSONFree(tmp);
-                LDJSONFree(flagContext);
+    if (LDi_notNull(tmp = LDObjectLookup(event, "version"))) {
+        LD_ASSERT(LDJSONGetType(tmp) == LDNumber);
 
-                goto cleanup;
-            }
-        }
+        version    = LDGetNumber(tmp);
+        versionRef = &version;
+    }
 
-        if (!(tmp = LDNewObject())) {
-            LD_LOG(LD_LOG_ERROR, "alloc error");
+    return addSummary(
+        shard,
+        flagKey,
+        variationRef,
+        versionRef,
+        LDObjectLookup(event, "value"),
+        LDObjectLookup(event, "default"),
+        unknown);
+}
 
-            LDJSONFree(flagContext);
+/* Summarizes every evaluation in one pass over the shard lock. Sets success
+ * to false for the evaluations that could not be summarized. */
+static void
+summarizeEvaluations(
+    struct LDEventProcessor *const           processor,
+    const struct EvaluationResult *const     results,
+    const struct LDFeatureEventRecord *const records,
+    const unsigned int                       count,
+    LDBoolean *const                         success)
+{
+    struct LDEventShard *shard;
+    unsigned int         i;
 
-            goto cleanup;
-        }
+    shard = currentShard(processor);
 
-        if (!LDObjectSetKey(flagContext, "counters", tmp)) {
-            LD_LOG(LD_LOG_ERROR, "alloc error");
+    LDi_mutex_lock(&shard->lock);
 
-            LDJSONFree(tmp);
-            LDJSONFree(flagContext);
+    for (i = 0; i < count; i++) {
+        const struct EvaluationResult *const     result = &results[i];
+        const struct LDFeatureEventRecord *const record = &records[i];
+        const struct LDJSON *                    evaluationValue;
+        struct LDJSON *                          iter;
 
-            goto cleanup;
+        if (!success[i]) {
+            continue;
         }
 
-        if (!LDObjectSetKey(processor->summaryCounters, flagKey, flagContext)) {
-            LD_LOG(LD_LOG_ERROR, "alloc error");
+        if (LDi_notNull(result->actualValue)) {
+            evaluationValue = result->actualValue;
+        } else {
+            evaluationValue = result->fallbackValue;
+        }
 
-            LDJSONFree(flagContext);
+        if (!addSummary(
+                shard,
+                record->flagKey,
+                record->hasVariation ? &record->variation : NULL,
+                record->hasVersion ? &record->version : NULL,
+                evaluationValue,
+                result->fallbackValue,
+                (LDBoolean) (!result->flag)))
+        {
+            success[i] = LDBooleanFalse;
 
-            goto cleanup;
+            continue;
         }
-    }
 
-    counters = LDObjectLookup(flagContext, "counters");
-    LD_ASSERT(counters);
-    LD_ASSERT(LDJSONGetType(counters) == LDObject);
+        if (result->subEvents) {
+            /* local only sanity */
+            LD_ASSERT(LDJSONGetType(result->subEvents) == LDArray);
 
-    if (!(entry = LDObjectLookup(counters, keytext))) {
-        if (!(entry = LDNewObject())) {
-            LD_LOG(LD_LOG_ERROR, "alloc error");
+            for (iter = LDGetIter(result->subEvents); iter; iter = LDIterNext(iter)) {
+                if (!addEventSummary(shard, iter, LDBooleanFalse)) {
+                    LD_LOG(LD_LOG_ERROR, "summary failed");
+
+                    success[i] = LDBooleanFalse;
 
-            goto cleanup;
+                    break;
+                }
+            }
         }
+    }
 
-        if (!(tmp = LDNewNumber(1))) {
-            LD_LOG(LD_LOG_ERROR, "alloc error");
+    LDi_mutex_unlock(&shard->lock);
+}
+
+/* Queues the feature event of a summarized evaluation, when it is tracked or
+ * debugged, and its prerequisite events. */
+static LDBoolean
+queueEvaluation(
+    struct LDEventProcessor *const           processor,
+    struct EvaluationResult *const           result,
+    const struct LDFeatureEventRecord *const record,
+    const struct LDTimestamp                 now)
+{
+    struct LDJSON *      featureEvent, *iter;
+    const struct LDJSON *evaluationValue;
+
+    if (LDi_notNull(result->actualValue)) {
+        evaluationValue = result->actualValue;
+    } else {
+        evaluationValue = result->fallbackValue;
+    }
 
-            LDJSONFree(entry);
+    /* Most evaluations are only summarized, so the full event is built only
+     * when it is tracked or debugged. */
+    if (result->flag && LDi_featureEventRecordIsQueued(processor, record)) {
+        featureEvent = LDi_newFeatureEvent(
+                result->flagKey,
+                result->user,
+                record->hasVariation ? &record->variation : NULL,
+                evaluationValue,
+                result->fallbackValue,
+                NULL,
+                result->flag,
+                result->details,
+                now,
+                processor->config->inlineUsersInEvents,
+                processor->config->allAttributesPrivate,
+                processor->config->privateAttributeNames
+        );
 
-            goto cleanup;
+        if (!featureEvent) {
+            return LDBooleanFalse;
         }
 
-        if (!LDObjectSetKey(entry, "count", tmp)) {
-            LD_LOG(LD_LOG_ERROR, "alloc error");
+        LDi_possiblyQueueEvent(processor, featureEvent, now, result);
+    }
 
-            LDJSONFree(tmp);
-            LDJSONFree(entry);
+    if (result->subEvents) {
+        for (iter = LDGetIter(result->subEvents); iter;) {
+            struct LDJSON *const next = LDIterNext(iter);
+
+            LDi_possiblyQueueEvent(
+                processor,
+                LDCollectionDetachIter(result->subEvents, iter),
+                now,
+                result);
 
-            goto cleanup;
+            iter = next;
         }
+    }
+
+    return LDBooleanTrue;
+}
 
-        tmp = LDObjectLookup(event, "value");
+LDBoolean
+LDEventProcessor_ProcessEvaluation(struct LDEventProcessor *processor, struct EvaluationResult *result)
+{
+    LDBoolean success;
 
-        if (LDi_notNull(tmp)) {
-            if (!(tmp = LDJSONDuplicate(tmp))) {
-                LD_LOG(LD_LOG_ERROR, "alloc error");
+    return LDEventProcessor_ProcessEvaluations(processor, result, 1, &success);
+}
 
-                LDJSONFree(entry);
+LDBoolean
+LDEventProcessor_ProcessEvaluations(
+    struct LDEventProcessor *const processor,
+    struct EvaluationResult *const results,
+    const unsigned int             count,
+    LDBoolean *const               success)
+{
+    struct LDJSON *              indexEvent;
+    struct LDFeatureEventRecord *records;
+    struct LDTimestamp           now;
+    unsigned int                 i;
+    LDBoolean                    anySummarized, allProcessed;
 
-                goto cleanup;
-            }
+    LD_ASSERT(processor);
+    LD_ASSERT(results || count == 0);
+    LD_ASSERT(success || count == 0);
 
-            if (!LDObjectSetKey(entry, "value", tmp)) {
-                LD_LOG(LD_LOG_ERROR, "alloc error");
+    indexEvent    = NULL;
+    records       = NULL;
+    anySummarized = LDBooleanFalse;
+    allProcessed  = LDBooleanFalse;
 
-                LDJSONFree(tmp);
-                LDJSONFree(entry);
+    for (i = 0; i < count; i++) {
+        LD_ASSERT(results[i].details);
+        LD_ASSERT(results[i].user == results[0].user);
 
-                goto cleanup;
-            }
-        }
+        success[i] = LDBooleanFalse;
+    }
 
-        tmp = LDObjectLookup(event, "version");
+    if (count == 0) {
+        return LDBooleanTrue;
+    }
 
-        if (LDi_notNull(tmp)) {
-            if (!(tmp = LDJSONDuplicate(tmp))) {
-                LD_LOG(LD_LOG_ERROR, "alloc error");
+    if (!LDTimestamp_InitNow(&now)) {
+        LD_LOG(LD_LOG_CRITICAL, "failed to obtain current time");
 
-                LDJSONFree(entry);
+        goto cleanup;
+    }
 
-                goto cleanup;
-            }
+    if (!(records = LDAlloc(sizeof(struct LDFeatureEventRecord) * count))) {
+        LD_LOG(LD_LOG_ERROR, "alloc error");
 
-            if (!LDObjectSetKey(entry, "version", tmp)) {
-                LD_LOG(LD_LOG_ERROR, "alloc error");
+        goto cleanup;
+    }
 
-                LDJSONFree(tmp);
-                LDJSONFree(entry);
+    for (i = 0; i < count; i++) {
+        success[i] = LDi_makeFeatureEventRecord(&results[i], now, &records[i]);
+    }
 
-                goto cleanup;
-            }
+    if (!LDi_maybeMakeIndexEvent(processor, results[0].user, now, &indexEvent)) {
+        for (i = 0; i < count; i++) {
+            success[i] = LDBooleanFalse;
         }
 
-        tmp = LDObjectLookup(event, "variation");
+        goto cleanup;
+    }
 
-        if (LDi_notNull(tmp)) {
-            if (!(tmp = LDJSONDuplicate(tmp))) {
-                LD_LOG(LD_LOG_ERROR, "alloc error");
+    summarizeEvaluations(processor, results, records, count, success);
 
-                LDJSONFree(entry);
+    for (i = 0; i < count; i++) {
+        if (success[i]) {
+            anySummarized = LDBooleanTrue;
+        }
+    }
 
-                goto cleanup;
-            }
+    if (indexEvent && anySummarized) {
+        LDi_addEvent(processor, indexEvent);
 
-            if (!LDObjectSetKey(entry, "variation", tmp)) {
-                LD_LOG(LD_LOG_ERROR, "alloc error");
+        indexEvent = NULL;
+    }
 
-                LDJSONFree(tmp);
-                LDJSONFree(entry);
+    allProcessed = LDBooleanTrue;
 
-                goto cleanup;
-            }
+    for (i = 0; i < count; i++) {
+        if (success[i]) {
+            success[i] = queueEvaluation(processor, &results[i], &records[i], now);
         }
 
-        if (unknown) {
-            if (!(tmp = LDNewBool(LDBooleanTrue))) {
-                LD_LOG(LD_LOG_ERROR, "alloc error");
-
-                LDJSONFree(entry);
+        if (!success[i]) {
+            allProcessed = LDBooleanFalse;
+        }
+    }
 
-                goto cleanup;
-            }
+cleanup:
+    for (i = 0; i < count; i++) {
+        LDJSONFree(results[i].subEvents);
+        results[i].subEvents = NULL;
+    }
 
-            if (!LDObjectSetKey(entry, "unknown", tmp)) {
-                LD_LOG(LD_LOG_ERROR, "alloc error");
+    LDJSONFree(indexEvent);
+    LDFree(records);
 
-                LDJSONFree(tmp);
-                LDJSONFree(entry);
+    return allProcessed;
+}
 
-                goto cleanup;
-            }
-        }
+LDBoolean
+LDi_summarizeEvent(
+    struct LDEventProcessor *const processor,
+    const struct LDJSON *const   event,
+    const LDBoolean              unknown)
+{
+    struct LDEventShard *shard;
+    LDBoolean            success;
 
-        if (!LDObjectSetKey(counters, keytext, entry)) {
-            LD_LOG(LD_LOG_ERROR, "alloc error");
+    LD_ASSERT(processor);
+    LD_ASSERT(event);
 
-            LDJSONFree(entry);
+    shard = currentShard(processor);
 
-            goto cleanup;
-        }
-    } else {
-        LDBoolean status;
-        tmp = LDObjectLookup(entry, "count");
-        LD_ASSERT(tmp);
-        status = LDSetNumber(tmp, LDGetNumber(tmp) + 1);
-        LD_ASSERT(status);
-    }
+    LDi_mutex_lock(&shard->lock);
 
-    success = LDBooleanTrue;
+    success = addEventSummary(shard, event, unknown);
 
-cleanup:
-    LDFree(keytext);
+    LDi_mutex_unlock(&shard->lock);
 
     return success;
 }
@@ -507,7 +736,7 @@ LDi_possiblyQueueEvent(
         /* debugEventsUntilDate was validated as a Number by LDi_newFeatureRequestEvent.
          * Extract it as a timestamp. */
 
-        struct LDTimestamp debugUntil;
+        struct LDTimestamp debugUntil, lastServerTime;
         LDTimestamp_InitUnixMillis(&debugUntil, LDGetNumber(tmp));
 
         /* ensure we don't send debugEventsUntilDate to LD */
@@ -517,7 +746,11 @@ LDi_possiblyQueueEvent(
          * This is because the system time may be inaccurate. If there is no server time, the second conditional
          * will evaluate true because the server time is initialized to 0 when the EventProcessor is constructed. */
 
-        if (LDTimestamp_Before(&now, &debugUntil) && LDTimestamp_Before(&processor->lastServerTime, &debugUntil)) {
+        LDi_mutex_lock(&processor->lock);
+        lastServerTime = processor->lastServerTime;
+        LDi_mutex_unlock(&processor->lock);
+
+        if (LDTimestamp_Before(&now, &debugUntil) && LDTimestamp_Before(&lastServerTime, &debugUntil)) {
 
             struct LDJSON *debugEvent = NULL;
 
@@ -551,18 +784,46 @@ LDi_possiblyQueueEvent(
 void
 LDi_addEvent(struct LDEventProcessor *const processor, struct LDJSON *const event)
 {
+    struct LDEventShard *shard;
+
     LD_ASSERT(processor);
     LD_ASSERT(event);
 
-    /* sanity check */
-    LD_ASSERT(LDJSONGetType(processor->events) == LDArray);
-
-    if (LDCollectionGetSize(processor->events) >= processor->config->eventsCapacity)
+    /* The capacity is checked without a lock, so concurrent additions may
+     * exceed it by at most the number of adding threads. */
+    if (LDi_atomic_load(&processor->queuedEvents) >= processor->config->eventsCapacity)
     {
         LD_LOG(LD_LOG_WARNING, "event capacity exceeded, dropping event");
-    } else {
-        LDArrayPush(processor->events, event);
+
+        LDJSONFree(event);
+
+        return;
+    }
+
+    shard = currentShard(processor);
+
+    /* Counted before it can be collected, so that a flush never subtracts an
+     * event which has not been counted yet. */
+    LDi_atomic_increment(&processor->queuedEvents);
+
+    LDi_mutex_lock(&shard->lock);
+
+    /* sanity check */
+    LD_ASSERT(LDJSONGetType(shard->events) == LDArray);
+
+    if (!LDArrayPush(shard->events, event)) {
+        LDi_mutex_unlock(&shard->lock);
+
+        LDi_atomic_decrement(&processor->queuedEvents);
+
+        LD_LOG(LD_LOG_ERROR, "alloc error");
+
+        LDJSONFree(event);
+
+        return;
     }
+
+    LDi_mutex_unlock(&shard->lock);
 }
 
 LDBoolean
@@ -572,9 +833,10 @@ LDi_maybeMakeIndexEvent(
     const struct LDTimestamp     timestamp,
     struct LDJSON **const        result)
 {
-    struct LDJSON *  event, *tmp;
-    enum LDLRUStatus status;
-    double elapsedMs;
+    struct LDJSON *        event, *tmp;
+    enum LDLRUStatus       status;
+    double                 elapsedMs;
+    struct LDUserKeyShard *shard;
 
     LD_ASSERT(processor);
     LD_ASSERT(user);
@@ -586,19 +848,27 @@ LDi_maybeMakeIndexEvent(
         return LDBooleanTrue;
     }
 
-    if (!LDTimer_Elapsed(&processor->lastUserKeyFlush, &elapsedMs)) {
+    shard = userKeyShard(processor, user->key);
+
+    LDi_mutex_lock(&shard->lock);
+
+    if (!LDTimer_Elapsed(&shard->lastUserKeyFlush, &elapsedMs)) {
+        LDi_mutex_unlock(&shard->lock);
+
         LD_LOG(LD_LOG_ERROR, "couldn't measure elapsed time since last user key flush");
 
         return LDBooleanFalse;
     }
 
     if (elapsedMs > processor->config->userKeysFlushInterval) {
-        LDLRUClear(processor->userKeys);
+        LDLRUClear(shard->userKeys);
 
-        LDTimer_Reset(&processor->lastUserKeyFlush);
+        LDTimer_Reset(&shard->lastUserKeyFlush);
     }
 
-    status = LDLRUInsert(processor->userKeys, user->key);
+    status = LDLRUInsert(shard->userKeys, user->key);
+
+    LDi_mutex_unlock(&shard->lock);
 
     if (status == LDLRUSTATUS_ERROR) {
         return LDBooleanFalse;
@@ -1015,89 +1285,13 @@ LDi_addUserInfoToEvent(
     return LDBooleanTrue;
 }
 
-char *
-LDi_makeSummaryKey(const struct LDJSON *const event)
-{
-    char *         keytext;
-    struct LDJSON *key, *tmp;
-
-    LD_ASSERT(event);
-
-    tmp     = NULL;
-    keytext = NULL;
-    key     = NULL;
-
-    if (!(key = LDNewObject())) {
-        LD_LOG(LD_LOG_ERROR, "alloc error");
-
-        return NULL;
-    }
-
-    tmp = LDObjectLookup(event, "variation");
-
-    if (LDi_notNull(tmp)) {
-        LD_ASSERT(LDJSONGetType(tmp) == LDNumber);
-
-        if (!(tmp = LDJSONDuplicate(tmp))) {
-            LD_LOG(LD_LOG_ERROR, "alloc error");
-
-            LDJSONFree(key);
-
-            return NULL;
-        }
-
-        if (!LDObjectSetKey(key, "variation", tmp)) {
-            LD_LOG(LD_LOG_ERROR, "alloc error");
-
-            LDJSONFree(key);
-            LDJSONFree(tmp);
-
-            return NULL;
-        }
-    }
-
-    tmp = LDObjectLookup(event, "version");
-
-    if (LDi_notNull(tmp)) {
-        LD_ASSERT(LDJSONGetType(tmp) == LDNumber);
-
-        if (!(tmp = LDJSONDuplicate(tmp))) {
-            LD_LOG(LD_LOG_ERROR, "alloc error");
-
-            LDJSONFree(key);
-
-            return NULL;
-        }
-
-        if (!LDObjectSetKey(key, "version", tmp)) {
-            LD_LOG(LD_LOG_ERROR, "alloc error");
-
-            LDJSONFree(key);
-            LDJSONFree(tmp);
-
-            return NULL;
-        }
-    }
-
-    if (!(keytext = LDJSONSerialize(key))) {
-        LD_LOG(LD_LOG_ERROR, "alloc error");
-
-        LDJSONFree(key);
-
-        return NULL;
-    }
-
-    LDJSONFree(key);
-
-    return keytext;
-}
-
 LDBoolean
 LDEventProcessor_Identify(
         struct LDEventProcessor *processor, const struct LDUser *user)
 {
     struct LDJSON *event;
     struct LDTimestamp timestamp;
+    struct LDUserKeyShard *shard;
 
     LD_ASSERT(processor);
     LD_ASSERT(user);
@@ -1125,14 +1319,14 @@ LDEventProcessor_Identify(
         return LDBooleanFalse;
     }
 
-    LDi_mutex_lock(&processor->lock);
+    shard = userKeyShard(processor, user->key);
 
-    LDLRUInsert(processor->userKeys, user->key);
+    LDi_mutex_lock(&shard->lock);
+    LDLRUInsert(shard->userKeys, user->key);
+    LDi_mutex_unlock(&shard->lock);
 
     LDi_addEvent(processor, event);
 
-    LDi_mutex_unlock(&processor->lock);
-
     return LDBooleanTrue;
 }
 
@@ -1331,15 +1525,16 @@ LDi_objectToArray(const struct LDJSON *const object)
 struct LDJSON *
 LDi_prepareSummaryEvent(struct LDEventProcessor *const processor, const double now)
 {
-    struct LDJSON *tmp, *summary, *iter, *counters;
+    struct LDJSON *tmp, *summary, *counters;
 
     LD_ASSERT(processor);
 
     tmp      = NULL;
     summary  = NULL;
-    iter     = NULL;
     counters = NULL;
 
+    collectShards(processor);
+
     if (!(summary = LDNewObject())) {
         LD_LOG(LD_LOG_ERROR, "alloc error");
 
@@ -1388,37 +1583,12 @@ LDi_prepareSummaryEvent(struct LDEventProcessor *const processor, const double n
         goto error;
     }
 
-    if (!(counters = LDJSONDuplicate(processor->summaryCounters))) {
+    if (!(counters = LDi_summaryCountersToJSON(processor->summaryCounters))) {
         LD_LOG(LD_LOG_ERROR, "alloc error");
 
         goto error;
     }
 
-    for (iter = LDGetIter(counters); iter; iter = LDIterNext(iter)) {
-        struct LDJSON *countersObject, *countersArray;
-
-        countersObject = LDObjectDetachKey(iter, "counters");
-        LD_ASSERT(countersObject);
-
-        if (!(countersArray = LDi_objectToArray(countersObject))) {
-            LD_LOG(LD_LOG_ERROR, "alloc error");
-
-            LDJSONFree(countersObject);
-
-            goto error;
-        }
-
-        LDJSONFree(countersObject);
-
-        if (!LDObjectSetKey(iter, "counters", countersArray)) {
-            LD_LOG(LD_LOG_ERROR, "alloc error");
-
-            LDJSONFree(countersArray);
-
-            goto error;
-        }
-    }
-
     if (!LDObjectSetKey(summary, "features", counters)) {
         LD_LOG(LD_LOG_ERROR, "alloc error");
 
@@ -1456,13 +1626,9 @@ LDi_track(
         return LDBooleanFalse;
     }
 
-    LDi_mutex_lock(&processor->lock);
-
     if (!LDi_maybeMakeIndexEvent(processor, user, timestamp, &indexEvent)) {
         LD_LOG(LD_LOG_ERROR, "failed to construct index event");
 
-        LDi_mutex_unlock(&processor->lock);
-
         return LDBooleanFalse;
     }
 
@@ -1480,8 +1646,6 @@ LDi_track(
     {
         LD_LOG(LD_LOG_ERROR, "failed to construct custom event");
 
-        LDi_mutex_unlock(&processor->lock);
-
         LDJSONFree(indexEvent);
 
         return LDBooleanFalse;
@@ -1493,8 +1657,6 @@ LDi_track(
         LDi_addEvent(processor, indexEvent);
     }
 
-    LDi_mutex_unlock(&processor->lock);
-
     return LDBooleanTrue;
 }
 
@@ -1613,9 +1775,7 @@ LDEventProcessor_Alias(
         return LDBooleanFalse;
     }
 
-    LDi_mutex_lock(&processor->lock);
     LDi_addEvent(processor, event);
-    LDi_mutex_unlock(&processor->lock);
 
     return LDBooleanTrue;
 }
@@ -1624,8 +1784,10 @@ LDBoolean
 LDEventProcessor_CreateEventPayloadAndResetState(
         struct LDEventProcessor *processor, struct LDJSON **result)
 {
-    struct LDJSON *nextEvents, *nextSummaryCounters, *summaryEvent;
-    double         now;
+    struct LDJSON *           nextEvents, *summaryEvent;
+    struct LDSummaryCounters *nextSummaryCounters;
+    double                    now;
+    unsigned int              queued;
 
     LD_ASSERT(processor);
     LD_ASSERT(result);
@@ -1638,8 +1800,10 @@ LDEventProcessor_CreateEventPayloadAndResetState(
 
     LDi_mutex_lock(&processor->lock);
 
+    collectShards(processor);
+
     if (LDCollectionGetSize(processor->events) == 0 &&
-        LDCollectionGetSize(processor->summaryCounters) == 0)
+        LDi_summaryCountersIsEmpty(processor->summaryCounters))
     {
         LDi_mutex_unlock(&processor->lock);
 
@@ -1656,8 +1820,10 @@ LDEventProcessor_CreateEventPayloadAndResetState(
         return LDBooleanFalse;
     }
 
-    if (LDCollectionGetSize(processor->summaryCounters) != 0) {
-        if (!(nextSummaryCounters = LDNewObject())) {
+    summaryEvent = NULL;
+
+    if (!LDi_summaryCountersIsEmpty(processor->summaryCounters)) {
+        if (!(nextSummaryCounters = LDi_summaryCountersNew())) {
             LD_LOG(LD_LOG_ERROR, "alloc error");
 
             LDi_mutex_unlock(&processor->lock);
@@ -1673,22 +1839,33 @@ LDEventProcessor_CreateEventPayloadAndResetState(
             LDi_mutex_unlock(&processor->lock);
 
             LDJSONFree(nextEvents);
-            LDJSONFree(nextSummaryCounters);
+            LDi_summaryCountersFree(nextSummaryCounters);
 
             return LDBooleanFalse;
         }
 
-        LDArrayPush(processor->events, summaryEvent);
-
-        LDJSONFree(processor->summaryCounters);
+        LDi_summaryCountersFree(processor->summaryCounters);
 
         processor->summaryStart    = 0;
         processor->summaryCounters = nextSummaryCounters;
     }
 
+    /* The events stay queued, and counted, until they are handed over.
+     * Preparing the summary collects the shards again, so they are only
+     * counted once that is done. The summary itself is never counted. */
+    queued = LDCollectionGetSize(processor->events);
+
+    if (summaryEvent && !LDArrayPush(processor->events, summaryEvent)) {
+        LD_LOG(LD_LOG_ERROR, "alloc error");
+
+        LDJSONFree(summaryEvent);
+    }
+
     *result         = processor->events;
     processor->events = nextEvents;
 
+    LDi_atomic_sub(&processor->queuedEvents, queued);
+
     LDi_mutex_unlock(&processor->lock);
 
     return LDBooleanTrue;
@@ -1706,6 +1883,10 @@ LDEventProcessor_SetLastServerTime(struct LDEventProcessor *processor, time_t se
 
 struct LDJSON *
 LDEventProcessor_GetEvents(struct LDEventProcessor *processor) {
+    LDi_mutex_lock(&processor->lock);
+    collectShards(processor);
+    LDi_mutex_unlock(&processor->lock);
+
     return processor->events;
 }
 
@@ -1713,3 +1894,11 @@ double
 LDEventProcessor_GetLastServerTime(struct LDEventProcessor *processor) {
     return LDTimestamp_AsUnixMillis(&processor->lastServerTime);
 }
+
+unsigned int
+LDi_getQueuedEventCount(struct LDEventProcessor *const processor)
+{
+    LD_ASSERT(processor);
+
+    return LDi_atomic_load(&processor->queuedEvents);
+}
@@ -86,6 +86,18 @@ struct EvaluationResult {
 LDBoolean
 LDEventProcessor_ProcessEvaluation(struct LDEventProcessor *processor, struct EvaluationResult *result);
 
+/* Processes evaluations for a single user, summarizing all of them under one
+ * lock. The subEvents of every result are consumed. success receives the
+ * outcome of each evaluation, and the return value is true only if all of
+ * them succeeded. */
+LDBoolean
+LDEventProcessor_ProcessEvaluations(
+        struct LDEventProcessor *processor,
+        struct EvaluationResult *results,
+        unsigned int count,
+        LDBoolean *success
+);
+
 
 struct LDJSON *
 LDi_newFeatureEvent(
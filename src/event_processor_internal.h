@@ -7,6 +7,36 @@
 
 #include "event_processor.h"
 
+/* The fixed size parts of a feature event needed to summarize it, and to
+ * decide if it is tracked or debugged. Built without allocating, so that the
+ * JSON event is only constructed when it will be queued. flagKey is borrowed
+ * from the evaluation. */
+struct LDFeatureEventRecord
+{
+    const char *       flagKey;
+    struct LDTimestamp creationDate;
+    double             version;
+    double             debugEventsUntilDate;
+    unsigned int       variation;
+    LDBoolean          hasVersion;
+    LDBoolean          hasVariation;
+    LDBoolean          hasDebugEventsUntilDate;
+    LDBoolean          trackEvents;
+};
+
+LDBoolean
+LDi_makeFeatureEventRecord(
+    const struct EvaluationResult *result,
+    struct LDTimestamp now,
+    struct LDFeatureEventRecord *record
+);
+
+LDBoolean
+LDi_featureEventRecordIsQueued(
+    struct LDEventProcessor *context,
+    const struct LDFeatureEventRecord *record
+);
+
 LDBoolean
 LDi_summarizeEvent(
     struct LDEventProcessor *context,
@@ -29,9 +59,6 @@ LDi_addUserInfoToEvent(
     const struct LDJSON *privateAttributeNames
 );
 
-char *
-LDi_makeSummaryKey(const struct LDJSON *event);
-
 struct LDJSON *
 LDi_newIdentifyEvent(
     const struct LDUser *user,
@@ -81,3 +108,6 @@ LDi_objectToArray(const struct LDJSON *object);
 
 struct LDJSON *
 LDi_prepareSummaryEvent(struct LDEventProcessor *context, double now);
+
+unsigned int
+LDi_getQueuedEventCount(struct LDEventProcessor *context);
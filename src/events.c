@@ -3,6 +3,10 @@
 #include <string.h>
 #include <time.h>
 
+#ifdef LAUNCHDARKLY_EVENT_COMPRESSION
+#include <zlib.h>
+#endif
+
 #include <launchdarkly/api.h>
 
 #include "assertion.h"
@@ -32,6 +36,8 @@ struct AnalyticsContext
     struct curl_slist *headers;
     struct LDClient *  client;
     char *             buffer;
+    size_t             bufferSize;
+    LDBoolean          compressed;
     unsigned int       failureTime;
     char               payloadId[LD_UUID_SIZE + 1];
 };
@@ -45,7 +51,8 @@ resetMemory(struct AnalyticsContext *const context)
     context->headers = NULL;
 
     LDFree(context->buffer);
-    context->buffer = NULL;
+    context->buffer     = NULL;
+    context->bufferSize = 0;
 
     context->failureTime = 0;
 }
@@ -115,6 +122,150 @@ destroy(void *const rawcontext)
     LDFree(context);
 }
 
+#ifdef LAUNCHDARKLY_EVENT_COMPRESSION
+
+static voidpf
+zAlloc(voidpf opaque, uInt items, uInt size)
+{
+    (void)opaque;
+
+    return LDAlloc((size_t)items * size);
+}
+
+static void
+zFree(voidpf opaque, voidpf address)
+{
+    (void)opaque;
+
+    LDFree(address);
+}
+
+/* Passes data through the stream, growing the output geometrically as needed.
+ * With Z_FINISH the stream is also completed. */
+static LDBoolean
+deflateInto(
+    z_stream *const   stream,
+    char **const      output,
+    size_t *const     capacity,
+    const char *const data,
+    const size_t      dataSize,
+    const int         flush)
+{
+    int status;
+
+    stream->next_in  = (Bytef *)data;
+    stream->avail_in = (uInt)dataSize;
+
+    do {
+        if (stream->total_out == *capacity) {
+            const size_t capacityTmp = *capacity ? *capacity * 2 : 4096;
+            char *       outputTmp;
+
+            if (!(outputTmp = (char *)LDRealloc(*output, capacityTmp))) {
+                return LDBooleanFalse;
+            }
+
+            *output   = outputTmp;
+            *capacity = capacityTmp;
+        }
+
+        stream->next_out  = (Bytef *)*output + stream->total_out;
+        stream->avail_out = (uInt)(*capacity - stream->total_out);
+
+        if ((status = deflate(stream, flush)) == Z_STREAM_ERROR) {
+            return LDBooleanFalse;
+        }
+    } while (stream->avail_in ||
+             (flush == Z_FINISH && status != Z_STREAM_END));
+
+    return LDBooleanTrue;
+}
+
+LDBoolean
+LDi_compressEvents(
+    const struct LDJSON *const events,
+    char **const               result,
+    size_t *const              resultSize)
+{
+    z_stream             stream;
+    char *               output, *serialized;
+    size_t               capacity;
+    const struct LDJSON *iter;
+    LDBoolean            success;
+
+    LD_ASSERT(events);
+    LD_ASSERT(LDJSONGetType(events) == LDArray);
+    LD_ASSERT(result);
+    LD_ASSERT(resultSize);
+
+    output     = NULL;
+    serialized = NULL;
+    capacity   = 0;
+    success    = LDBooleanFalse;
+
+    memset(&stream, 0, sizeof(stream));
+    stream.zalloc = zAlloc;
+    stream.zfree  = zFree;
+
+    /* a window of 15 bits plus 16 selects the gzip format */
+    if (deflateInit2(
+            &stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+            Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        LD_LOG(LD_LOG_ERROR, "deflateInit2 failed");
+
+        return LDBooleanFalse;
+    }
+
+    if (!deflateInto(&stream, &output, &capacity, "[", 1, Z_NO_FLUSH)) {
+        goto cleanup;
+    }
+
+    for (iter = LDGetIter(events); iter; iter = LDIterNext(iter)) {
+        if (iter != LDGetIter(events) &&
+            !deflateInto(&stream, &output, &capacity, ",", 1, Z_NO_FLUSH))
+        {
+            goto cleanup;
+        }
+
+        if (!(serialized = LDJSONSerialize(iter))) {
+            goto cleanup;
+        }
+
+        if (!deflateInto(
+                &stream,
+                &output,
+                &capacity,
+                serialized,
+                strlen(serialized),
+                Z_NO_FLUSH))
+        {
+            goto cleanup;
+        }
+
+        LDFree(serialized);
+        serialized = NULL;
+    }
+
+    if (!deflateInto(&stream, &output, &capacity, "]", 1, Z_FINISH)) {
+        goto cleanup;
+    }
+
+    *result     = output;
+    *resultSize = stream.total_out;
+    output      = NULL;
+    success     = LDBooleanTrue;
+
+cleanup:
+    deflateEnd(&stream);
+    LDFree(serialized);
+    LDFree(output);
+
+    return success;
+}
+
+#endif
+
 static const char *
 strnchr(const char *str, const char c, size_t len)
 {
@@ -206,6 +357,40 @@ LDi_onHeader(
     return total;
 }
 
+static double
+deadline(struct LDClient *const client, void *const rawcontext)
+{
+    struct AnalyticsContext *context;
+    double                   now;
+    LDBoolean                shouldFlush;
+
+    LD_ASSERT(client);
+    LD_ASSERT(rawcontext);
+
+    context = (struct AnalyticsContext *)rawcontext;
+
+    if (context->active) {
+        return LD_NETWORK_MAX_WAIT;
+    }
+
+    LDi_getMonotonicMilliseconds(&now);
+
+    /* poll retries once a full second has passed */
+    if (context->failureTime) {
+        return context->failureTime + 1000 - now + 1;
+    }
+
+    LDi_rwlock_rdlock(&client->lock);
+    shouldFlush = client->shouldFlush;
+    LDi_rwlock_rdunlock(&client->lock);
+
+    if (shouldFlush) {
+        return 0;
+    }
+
+    return context->lastFlush + client->config->flushInterval - now;
+}
+
 static CURL *
 poll(struct LDClient *const client, void *const rawcontext)
 {
@@ -269,20 +454,44 @@ poll(struct LDClient *const client, void *const rawcontext)
         }
 
         if (!events) {
-            /* no events to send */
+            /* no events to send, so check again on the next interval */
             LDi_rwlock_wrlock(&client->lock);
-            shouldFlush = LDBooleanFalse;
+            client->shouldFlush = LDBooleanFalse;
             LDi_rwlock_wrunlock(&client->lock);
 
+            LDi_getMonotonicMilliseconds(&context->lastFlush);
+
             return NULL;
         }
 
-        if (!(context->buffer = LDJSONSerialize(events))) {
-            LD_LOG(LD_LOG_ERROR, "alloc error");
+        context->compressed = LDBooleanFalse;
 
-            LDJSONFree(events);
+#ifdef LAUNCHDARKLY_EVENT_COMPRESSION
+        if (client->config->compressEvents) {
+            if (!LDi_compressEvents(
+                    events, &context->buffer, &context->bufferSize))
+            {
+                LD_LOG(LD_LOG_ERROR, "failed compressing events");
 
-            return NULL;
+                LDJSONFree(events);
+
+                return NULL;
+            }
+
+            context->compressed = LDBooleanTrue;
+        }
+#endif
+
+        if (!context->compressed) {
+            if (!(context->buffer = LDJSONSerialize(events))) {
+                LD_LOG(LD_LOG_ERROR, "alloc error");
+
+                LDJSONFree(events);
+
+                return NULL;
+            }
+
+            context->bufferSize = strlen(context->buffer);
         }
 
         LDJSONFree(events);
@@ -320,6 +529,13 @@ poll(struct LDClient *const client, void *const rawcontext)
         goto error;
     }
 
+    if (context->compressed &&
+        !(context->headers = curl_slist_append(
+              context->headers, "Content-Encoding: gzip")))
+    {
+        goto error;
+    }
+
     {
         int status;
 /* This is done as a macro so that the string is a literal */
@@ -360,6 +576,12 @@ poll(struct LDClient *const client, void *const rawcontext)
 
     /* add outgoing buffer */
 
+    if (curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)context->bufferSize) !=
+        CURLE_OK)
+    {
+        goto error;
+    }
+
     if (curl_easy_setopt(curl, CURLOPT_POSTFIELDS, context->buffer) != CURLE_OK)
     {
         goto error;
@@ -404,15 +626,18 @@ LDi_constructAnalytics(struct LDClient *const client)
     context->headers     = NULL;
     context->client      = client;
     context->buffer      = NULL;
+    context->bufferSize  = 0;
+    context->compressed  = LDBooleanFalse;
     context->failureTime = 0;
 
     LDi_getMonotonicMilliseconds(&context->lastFlush);
 
-    netInterface->done    = done;
-    netInterface->poll    = poll;
-    netInterface->context = context;
-    netInterface->destroy = destroy;
-    netInterface->current = NULL;
+    netInterface->done     = done;
+    netInterface->poll     = poll;
+    netInterface->deadline = deadline;
+    netInterface->context  = context;
+    netInterface->destroy  = destroy;
+    netInterface->current  = NULL;
 
     return netInterface;
 
@@ -19,3 +19,13 @@ LDi_onHeader(
 
 LDBoolean
 LDi_parseRFC822(const char *const date, struct tm *tm);
+
+#ifdef LAUNCHDARKLY_EVENT_COMPRESSION
+/* Serializes an array of events as a gzip compressed JSON array, one event at
+ * a time. The result is not NUL terminated. */
+LDBoolean
+LDi_compressEvents(
+    const struct LDJSON *const events,
+    char **const               result,
+    size_t *const              resultSize);
+#endif
@@ -1,135 +1,251 @@
+#include <string.h>
+
 #include <launchdarkly/memory.h>
 
 #include "assertion.h"
 #include "lru.h"
 
-#include <uthash.h>
-#include <utlist.h>
-
-struct LDLRUNode
+/* The LRU is approximated with the CLOCK algorithm. Entries are kept in a
+ * fixed ring, each with a referenced bit that is set when the key is seen
+ * again. To make room, a hand sweeps the ring clearing referenced bits, and
+ * evicts the first entry whose bit was already clear.
+ *
+ * Keys are found through an open addressing table with linear probing, which
+ * is at most half full. Only a 64-bit hash of each key is kept, as two 32-bit
+ * halves, so inserting never copies the key. Two keys with the same hash are
+ * treated as the same key. */
+
+struct LDLRUSlot
 {
-    char *            key;
-    struct LDLRUNode *next, *prev;
-    UT_hash_handle    hh;
+    unsigned int hashHigh;
+    unsigned int hashLow;
+    /* One more than the index of the entry in the ring, or zero if empty. */
+    unsigned int entry;
 };
 
 struct LDLRU
 {
     unsigned int      elements;
     unsigned int      capacity;
-    struct LDLRUNode *list;
-    struct LDLRUNode *hash;
+    /* The number of slots, minus one. The number of slots is a power of two. */
+    unsigned int      mask;
+    unsigned int      hand;
+    struct LDLRUSlot *slots;
+    /* For each entry in the ring, the index of its slot. */
+    unsigned int *    entrySlots;
+    unsigned char *   referenced;
 };
 
+static unsigned int
+finalizeHash(unsigned int hash)
+{
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bU;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35U;
+    hash ^= hash >> 16;
+
+    return hash;
+}
+
+/* Combines FNV-1a and Jenkins' one-at-a-time hash, computed in one pass. */
+static void
+hashKey(
+    const char *key, unsigned int *const hashHigh, unsigned int *const hashLow)
+{
+    unsigned int fnv = 2166136261U, oneAtATime = 0;
+
+    for (; *key; key++) {
+        fnv = (fnv ^ (unsigned char)*key) * 16777619U;
+
+        oneAtATime += (unsigned char)*key;
+        oneAtATime += oneAtATime << 10;
+        oneAtATime ^= oneAtATime >> 6;
+    }
+
+    oneAtATime += oneAtATime << 3;
+    oneAtATime ^= oneAtATime >> 11;
+    oneAtATime += oneAtATime << 15;
+
+    *hashHigh = finalizeHash(oneAtATime);
+    *hashLow  = finalizeHash(fnv);
+}
+
 struct LDLRU *
 LDLRUInit(const unsigned int capacity)
 {
-    struct LDLRU *const lru = LDAlloc(sizeof(struct LDLRU));
+    struct LDLRU *lru;
+    unsigned int  slotCount;
+
+    /* Leaves room to double the capacity into a slot count. */
+    if (capacity > 0x40000000U) {
+        LD_LOG(LD_LOG_ERROR, "LDLRUInit capacity too large");
 
-    if (lru == NULL) {
         return NULL;
     }
 
-    lru->elements = 0;
+    if (!(lru = LDAlloc(sizeof(struct LDLRU)))) {
+        return NULL;
+    }
+
+    memset(lru, 0, sizeof(struct LDLRU));
+
     lru->capacity = capacity;
-    lru->list     = NULL;
-    lru->hash     = NULL;
+
+    if (capacity == 0) {
+        return lru;
+    }
+
+    for (slotCount = 1; slotCount < capacity * 2; slotCount *= 2) {}
+
+    lru->mask = slotCount - 1;
+
+    if (!(lru->slots = LDAlloc(sizeof(struct LDLRUSlot) * slotCount))) {
+        goto error;
+    }
+
+    if (!(lru->entrySlots = LDAlloc(sizeof(unsigned int) * capacity))) {
+        goto error;
+    }
+
+    if (!(lru->referenced = LDAlloc(capacity))) {
+        goto error;
+    }
+
+    LDLRUClear(lru);
 
     return lru;
+
+error:
+    LDLRUFree(lru);
+
+    return NULL;
 }
 
 void
 LDLRUFree(struct LDLRU *const lru)
 {
     if (lru) {
-        LDLRUClear(lru);
+        LDFree(lru->slots);
+        LDFree(lru->entrySlots);
+        LDFree(lru->referenced);
 
         LDFree(lru);
     }
 }
 
-enum LDLRUStatus
-LDLRUInsert(struct LDLRU *const lru, const char *const key)
+/* Empties a slot, moving back any later slots of its probe sequence that
+ * would otherwise no longer be reachable from their home slot. */
+static void
+removeSlot(struct LDLRU *const lru, unsigned int hole)
 {
-    struct LDLRUNode *existing = NULL;
-
-    LD_ASSERT(lru);
-    LD_ASSERT(key);
-
-    if (lru->capacity == 0) {
-        return LDLRUSTATUS_NEW;
-    }
+    unsigned int next = hole;
 
-    HASH_FIND_STR(lru->hash, key, existing);
+    for (;;) {
+        unsigned int home;
 
-    if (existing == NULL) {
-        struct LDLRUNode *node;
-        char *            keyDuplicate;
-
-        if (!(keyDuplicate = LDStrDup(key))) {
-            return LDLRUSTATUS_ERROR;
-        }
+        lru->slots[hole].entry = 0;
 
-        if (lru->elements == lru->capacity) {
-            node = lru->list->prev;
+        for (;;) {
+            next = (next + 1) & lru->mask;
 
-            HASH_DEL(lru->hash, node);
-            CDL_DELETE(lru->list, node);
+            if (lru->slots[next].entry == 0) {
+                return;
+            }
 
-            LDFree(node->key);
-        } else {
-            node = LDAlloc(sizeof(struct LDLRUNode));
+            home = lru->slots[next].hashLow & lru->mask;
 
-            if (node == NULL) {
-                return LDLRUSTATUS_ERROR;
+            /* The slot stays if its home lies cyclically in (hole, next]. */
+            if (hole <= next ? (hole >= home || home > next)
+                             : (hole >= home && home > next))
+            {
+                break;
             }
-
-            lru->elements++;
         }
 
-        memset(node, 0, sizeof(struct LDLRUNode));
-
-        node->key = keyDuplicate;
+        lru->slots[hole] = lru->slots[next];
+        lru->entrySlots[lru->slots[hole].entry - 1] = hole;
 
-        CDL_PREPEND(lru->list, node);
+        hole = next;
+    }
+}
 
-        HASH_ADD_KEYPTR(hh, lru->hash, node->key, strlen(node->key), node);
+/* Returns the index of the entry to reuse, after removing its key. */
+static unsigned int
+evictEntry(struct LDLRU *const lru)
+{
+    unsigned int entry;
 
-        return LDLRUSTATUS_NEW;
-    } else {
-        CDL_DELETE(lru->list, existing);
-        CDL_PREPEND(lru->list, existing);
+    while (lru->referenced[lru->hand]) {
+        lru->referenced[lru->hand] = 0;
 
-        return LDLRUSTATUS_EXISTED;
+        lru->hand = (lru->hand + 1) % lru->capacity;
     }
+
+    entry     = lru->hand;
+    lru->hand = (lru->hand + 1) % lru->capacity;
+
+    removeSlot(lru, lru->entrySlots[entry]);
+
+    return entry;
 }
 
-void
-LDLRUClear(struct LDLRU *const lru)
+enum LDLRUStatus
+LDLRUInsert(struct LDLRU *const lru, const char *const key)
 {
-    struct LDLRUNode *iter, *tmp1, *tmp2;
+    unsigned int hashHigh, hashLow, slot, entry;
 
     LD_ASSERT(lru);
+    LD_ASSERT(key);
+
+    if (lru->capacity == 0) {
+        return LDLRUSTATUS_NEW;
+    }
 
-    iter = NULL;
-    tmp1 = NULL;
-    tmp2 = NULL;
+    hashKey(key, &hashHigh, &hashLow);
 
-    HASH_ITER(hh, lru->hash, iter, tmp1)
+    for (slot = hashLow & lru->mask; lru->slots[slot].entry;
+         slot = (slot + 1) & lru->mask)
     {
-        HASH_DEL(lru->hash, iter);
+        if (lru->slots[slot].hashLow == hashLow &&
+            lru->slots[slot].hashHigh == hashHigh)
+        {
+            lru->referenced[lru->slots[slot].entry - 1] = 1;
 
-        LDFree(iter->key);
+            return LDLRUSTATUS_EXISTED;
+        }
     }
 
-    CDL_FOREACH_SAFE(lru->list, iter, tmp1, tmp2)
-    {
-        CDL_DELETE(lru->list, iter);
+    if (lru->elements == lru->capacity) {
+        entry = evictEntry(lru);
+
+        /* The eviction may have moved slots, including into this one. */
+        for (slot = hashLow & lru->mask; lru->slots[slot].entry;
+             slot = (slot + 1) & lru->mask)
+        {}
+    } else {
+        entry = lru->elements++;
+    }
+
+    lru->slots[slot].hashHigh = hashHigh;
+    lru->slots[slot].hashLow  = hashLow;
+    lru->slots[slot].entry    = entry + 1;
+
+    lru->entrySlots[entry] = slot;
+    lru->referenced[entry] = 0;
+
+    return LDLRUSTATUS_NEW;
+}
+
+void
+LDLRUClear(struct LDLRU *const lru)
+{
+    LD_ASSERT(lru);
 
-        LDFree(iter);
+    if (lru->capacity) {
+        memset(lru->slots, 0, sizeof(struct LDLRUSlot) * (lru->mask + 1));
     }
 
     lru->elements = 0;
-    lru->list     = NULL;
-    lru->hash     = NULL;
+    lru->hand     = 0;
 }
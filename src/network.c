@@ -176,6 +176,55 @@ LDi_removeAndFreeHandle(CURLM *const multi, CURL *const handle)
     return LDBooleanTrue;
 }
 
+/* Milliseconds until the earliest deadline of any interface. */
+static int
+nextTimeout(
+    struct LDClient *const                client,
+    struct NetworkInterface *const *const interfaces,
+    const size_t                          interfacecount,
+    const LDBoolean                       offline)
+{
+    double timeout;
+    size_t i;
+    int    rounded;
+
+    timeout = LD_NETWORK_MAX_WAIT;
+
+    if (!offline) {
+        for (i = 0; i < interfacecount; i++) {
+            const double remaining =
+                interfaces[i]->deadline(client, interfaces[i]->context);
+
+            if (remaining < timeout) {
+                timeout = remaining;
+            }
+        }
+    }
+
+    if (timeout <= 0) {
+        return 0;
+    }
+
+    /* round up, so that the thread never wakes just short of a deadline */
+    rounded = (int)timeout;
+
+    return rounded < timeout ? rounded + 1 : rounded;
+}
+
+void
+LDi_networkWakeup(struct LDClient *const client)
+{
+    LD_ASSERT(client);
+
+#if LIBCURL_VERSION_NUM >= 0x074400
+    LDi_rwlock_rdlock(&client->lock);
+    if (client->multi) {
+        curl_multi_wakeup(client->multi);
+    }
+    LDi_rwlock_rdunlock(&client->lock);
+#endif
+}
+
 THREAD_RETURN
 LDi_networkthread(void *const clientref)
 {
@@ -222,15 +271,18 @@ LDi_networkthread(void *const clientref)
         LD_LOG(LD_LOG_INFO, "analytic events are disabled");
     }
 
+    LDi_rwlock_wrlock(&client->lock);
+    client->multi = multihandle;
+    LDi_rwlock_wrunlock(&client->lock);
+
     while (LDBooleanTrue) {
         struct CURLMsg *info;
-        int             running_handles, active_events;
+        int             running_handles, timeout;
         unsigned int    i;
         LDBoolean       offline;
 
         info            = NULL;
         running_handles = 0;
-        active_events   = 0;
 
         LDi_rwlock_rdlock(&client->lock);
         if (client->shuttingdown) {
@@ -313,22 +365,43 @@ LDi_networkthread(void *const clientref)
             }
         } while (info);
 
-        if (curl_multi_wait(multihandle, NULL, 0, 5, &active_events) !=
-            CURLM_OK) {
-            LD_LOG(LD_LOG_ERROR, "failed to wait on handles");
+        timeout = nextTimeout(client, interfaces, interfacecount, offline);
+
+#if LIBCURL_VERSION_NUM >= 0x074400
+        /* sleep until a transfer needs attention, the next deadline, or a
+         * call to LDi_networkWakeup */
+        if (curl_multi_poll(multihandle, NULL, 0, timeout, NULL) != CURLM_OK) {
+            LD_LOG(LD_LOG_ERROR, "failed to poll on handles");
 
             goto cleanup;
         }
+#else
+        {
+            int active_events = 0;
 
-        if (!active_events) {
-            /* if curl is not doing anything, wait, so we don't burn CPU */
-            LDi_sleepMilliseconds(10);
+            if (curl_multi_wait(multihandle, NULL, 0, 5, &active_events) !=
+                CURLM_OK) {
+                LD_LOG(LD_LOG_ERROR, "failed to wait on handles");
+
+                goto cleanup;
+            }
+
+            /* curl_multi_wait returns at once without transfers, and there is
+             * no wakeup, so keep the wait short */
+            if (!active_events && timeout) {
+                LDi_sleepMilliseconds(timeout < 10 ? timeout : 10);
+            }
         }
+#endif
     }
 
 cleanup:
     LD_LOG(LD_LOG_INFO, "cleanup up networking thread");
 
+    LDi_rwlock_wrlock(&client->lock);
+    client->multi = NULL;
+    LDi_rwlock_wrunlock(&client->lock);
+
     {
         CURLMcode    status;
         unsigned int i;
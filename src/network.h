@@ -12,10 +12,17 @@
 #include "client.h"
 #include "concurrency.h"
 
+/* The longest the network thread sleeps for. Interfaces with nothing scheduled
+ * return it as their deadline. It only bounds the cost of a missed wakeup. */
+#define LD_NETWORK_MAX_WAIT (60.0 * 1000)
+
 struct NetworkInterface
 {
     /* get next handle */
     CURL *(*poll)(struct LDClient *const client, void *context);
+    /* milliseconds until poll next has work to do, zero or less if it has
+     * work now */
+    double (*deadline)(struct LDClient *const client, void *context);
     /* called when handle is ready */
     void (*done)(
         struct LDClient *const client, void *context, int responseCode);
@@ -46,6 +53,11 @@ LDi_constructAnalytics(struct LDClient *const client);
 THREAD_RETURN
 LDi_networkthread(void *const clientref);
 
+/* Wakes the network thread early, after changing state its interfaces poll,
+ * such as a flush or shutdown request. */
+void
+LDi_networkWakeup(struct LDClient *const client);
+
 LDBoolean
 validatePutBody(const struct LDJSON *const put);
 
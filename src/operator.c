@@ -64,47 +64,119 @@ operatorEndsWithFn(
     return strcmp(LDGetText(uvalue) + ulen - clen, LDGetText(cvalue)) == 0;
 }
 
-static LDBoolean
-operatorMatchesFn(
-    const struct LDJSON *const uvalue, const struct LDJSON *const cvalue)
+/* JIT compilation was added in PCRE 8.20, along with pcre_free_study. */
+#ifdef PCRE_STUDY_JIT_COMPILE
+#define LD_PCRE_STUDY_OPTIONS PCRE_STUDY_JIT_COMPILE
+#define LD_PCRE_FREE_STUDY(extra) pcre_free_study(extra)
+#else
+#define LD_PCRE_STUDY_OPTIONS 0
+#define LD_PCRE_FREE_STUDY(extra) pcre_free(extra)
+#endif
+
+struct LDRegex
 {
-    LDBoolean   matches;
-    pcre *      context;
-    const char *subject, *error, *regex;
-    int         errorOffset;
+    pcre *      code;
+    /* NULL when studying found nothing to optimize. */
+    pcre_extra *extra;
+};
 
-    CHECKSTRING(uvalue, cvalue);
+struct LDRegex *
+LDi_regexCompile(const char *const pattern)
+{
+    struct LDRegex *regex;
+    const char *    error;
+    int             errorOffset;
+
+    LD_ASSERT(pattern);
 
-    matches     = LDBooleanFalse;
-    context     = NULL;
-    subject     = NULL;
     error       = NULL;
-    regex       = NULL;
     errorOffset = 0;
 
-    subject = LDGetText(uvalue);
-    LD_ASSERT(subject);
-    regex = LDGetText(cvalue);
-    LD_ASSERT(regex);
+    if (!(regex = (struct LDRegex *)LDAlloc(sizeof(struct LDRegex)))) {
+        return NULL;
+    }
 
-    context =
-        pcre_compile(regex, PCRE_JAVASCRIPT_COMPAT, &error, &errorOffset, NULL);
+    regex->extra = NULL;
+    regex->code  = pcre_compile(
+        pattern, PCRE_JAVASCRIPT_COMPAT, &error, &errorOffset, NULL);
 
-    if (!context) {
+    if (!regex->code) {
         LD_LOG_3(
             LD_LOG_ERROR,
             "failed to compile regex '%s' got error '%s' with offset %d",
-            regex,
+            pattern,
             error,
             errorOffset);
 
+        LDFree(regex);
+
+        return NULL;
+    }
+
+    regex->extra = pcre_study(regex->code, LD_PCRE_STUDY_OPTIONS, &error);
+
+    if (error) {
+        /* The pattern is still usable without the study data. */
+        LD_LOG_2(
+            LD_LOG_WARNING,
+            "failed to study regex '%s' got error '%s'",
+            pattern,
+            error);
+    }
+
+    return regex;
+}
+
+LDBoolean
+LDi_regexMatches(
+    const struct LDRegex *const regex, const char *const subject)
+{
+    LD_ASSERT(regex);
+    LD_ASSERT(subject);
+
+    return pcre_exec(
+               regex->code,
+               regex->extra,
+               subject,
+               strlen(subject),
+               0,
+               0,
+               NULL,
+               0) >= 0;
+}
+
+void
+LDi_regexFree(struct LDRegex *const regex)
+{
+    if (regex) {
+        if (regex->extra) {
+            LD_PCRE_FREE_STUDY(regex->extra);
+        }
+
+        pcre_free(regex->code);
+        LDFree(regex);
+    }
+}
+
+static LDBoolean
+operatorMatchesFn(
+    const struct LDJSON *const uvalue, const struct LDJSON *const cvalue)
+{
+    LDBoolean       matches;
+    struct LDRegex *regex;
+
+    CHECKSTRING(uvalue, cvalue);
+
+    LD_ASSERT(LDGetText(uvalue));
+    LD_ASSERT(LDGetText(cvalue));
+
+    if (!(regex = LDi_regexCompile(LDGetText(cvalue)))) {
         return LDBooleanFalse;
     }
 
-    matches =
-        pcre_exec(context, NULL, subject, strlen(subject), 0, 0, NULL, 0) >= 0;
+    matches = LDi_regexMatches(regex, LDGetText(uvalue));
 
-    pcre_free(context);
+    LDi_regexFree(regex);
 
     return matches;
 }
@@ -294,40 +366,87 @@ operatorSemVerGreaterThan(
     return compareSemVer(uvalue, cvalue, semver_gt);
 }
 
-OpFn
-LDi_lookupOperation(const char *const operation)
+LDOperator
+LDi_parseOperator(const char *const operation)
 {
     LD_ASSERT(operation);
 
     if (strcmp(operation, "in") == 0) {
-        return operatorInFn;
+        return LD_OP_IN;
     } else if (strcmp(operation, "endsWith") == 0) {
-        return operatorEndsWithFn;
+        return LD_OP_ENDS_WITH;
     } else if (strcmp(operation, "startsWith") == 0) {
-        return operatorStartsWithFn;
+        return LD_OP_STARTS_WITH;
     } else if (strcmp(operation, "matches") == 0) {
-        return operatorMatchesFn;
+        return LD_OP_MATCHES;
     } else if (strcmp(operation, "contains") == 0) {
-        return operatorContainsFn;
+        return LD_OP_CONTAINS;
     } else if (strcmp(operation, "lessThan") == 0) {
-        return operatorLessThanFn;
+        return LD_OP_LESS_THAN;
     } else if (strcmp(operation, "lessThanOrEqual") == 0) {
-        return operatorLessThanOrEqualFn;
+        return LD_OP_LESS_THAN_OR_EQUAL;
     } else if (strcmp(operation, "greaterThan") == 0) {
-        return operatorGreaterThanFn;
+        return LD_OP_GREATER_THAN;
     } else if (strcmp(operation, "greaterThanOrEqual") == 0) {
-        return operatorGreaterThanOrEqualFn;
+        return LD_OP_GREATER_THAN_OR_EQUAL;
     } else if (strcmp(operation, "before") == 0) {
-        return operatorBefore;
+        return LD_OP_BEFORE;
     } else if (strcmp(operation, "after") == 0) {
-        return operatorAfter;
+        return LD_OP_AFTER;
     } else if (strcmp(operation, "semVerEqual") == 0) {
-        return operatorSemVerEqual;
+        return LD_OP_SEMVER_EQUAL;
     } else if (strcmp(operation, "semVerLessThan") == 0) {
-        return operatorSemVerLessThan;
+        return LD_OP_SEMVER_LESS_THAN;
     } else if (strcmp(operation, "semVerGreaterThan") == 0) {
-        return operatorSemVerGreaterThan;
+        return LD_OP_SEMVER_GREATER_THAN;
+    } else if (strcmp(operation, "segmentMatch") == 0) {
+        return LD_OP_SEGMENT_MATCH;
+    }
+
+    return LD_OP_UNKNOWN;
+}
+
+OpFn
+LDi_operatorFunction(const LDOperator operation)
+{
+    switch (operation) {
+        case LD_OP_IN:
+            return operatorInFn;
+        case LD_OP_ENDS_WITH:
+            return operatorEndsWithFn;
+        case LD_OP_STARTS_WITH:
+            return operatorStartsWithFn;
+        case LD_OP_MATCHES:
+            return operatorMatchesFn;
+        case LD_OP_CONTAINS:
+            return operatorContainsFn;
+        case LD_OP_LESS_THAN:
+            return operatorLessThanFn;
+        case LD_OP_LESS_THAN_OR_EQUAL:
+            return operatorLessThanOrEqualFn;
+        case LD_OP_GREATER_THAN:
+            return operatorGreaterThanFn;
+        case LD_OP_GREATER_THAN_OR_EQUAL:
+            return operatorGreaterThanOrEqualFn;
+        case LD_OP_BEFORE:
+            return operatorBefore;
+        case LD_OP_AFTER:
+            return operatorAfter;
+        case LD_OP_SEMVER_EQUAL:
+            return operatorSemVerEqual;
+        case LD_OP_SEMVER_LESS_THAN:
+            return operatorSemVerLessThan;
+        case LD_OP_SEMVER_GREATER_THAN:
+            return operatorSemVerGreaterThan;
+        default:
+            return NULL;
     }
+}
+
+OpFn
+LDi_lookupOperation(const char *const operation)
+{
+    LD_ASSERT(operation);
 
-    return NULL;
+    return LDi_operatorFunction(LDi_parseOperator(operation));
 }
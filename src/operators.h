@@ -14,8 +14,50 @@
 typedef LDBoolean (*OpFn)(
     const struct LDJSON *const uvalue, const struct LDJSON *const cvalue);
 
+typedef enum
+{
+    LD_OP_UNKNOWN,
+    LD_OP_IN,
+    LD_OP_ENDS_WITH,
+    LD_OP_STARTS_WITH,
+    LD_OP_MATCHES,
+    LD_OP_CONTAINS,
+    LD_OP_LESS_THAN,
+    LD_OP_LESS_THAN_OR_EQUAL,
+    LD_OP_GREATER_THAN,
+    LD_OP_GREATER_THAN_OR_EQUAL,
+    LD_OP_BEFORE,
+    LD_OP_AFTER,
+    LD_OP_SEMVER_EQUAL,
+    LD_OP_SEMVER_LESS_THAN,
+    LD_OP_SEMVER_GREATER_THAN,
+    LD_OP_SEGMENT_MATCH
+} LDOperator;
+
+/* Returns LD_OP_UNKNOWN for operators this SDK does not recognize. */
+LDOperator
+LDi_parseOperator(const char *const operation);
+
+/* Returns NULL for LD_OP_UNKNOWN and LD_OP_SEGMENT_MATCH, which do not compare
+ * a single user value against a single clause value. */
+OpFn
+LDi_operatorFunction(const LDOperator operation);
+
 OpFn
 LDi_lookupOperation(const char *const operation);
 
+/* A regular expression compiled for the "matches" operator. */
+struct LDRegex;
+
+/* Returns NULL if the pattern is invalid, or on allocation failure. */
+struct LDRegex *
+LDi_regexCompile(const char *const pattern);
+
+LDBoolean
+LDi_regexMatches(const struct LDRegex *const regex, const char *const subject);
+
+void
+LDi_regexFree(struct LDRegex *const regex);
+
 LDBoolean
 LDi_parseTime(const struct LDJSON *const json, timestamp_t *result);
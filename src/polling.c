@@ -7,6 +7,7 @@
 #include "client.h"
 #include "config.h"
 #include "network.h"
+#include "polling.h"
 #include "store.h"
 #include "user.h"
 #include "utility.h"
@@ -44,8 +45,8 @@ updateStore(struct LDStore *const store, const char *const rawupdate)
         goto error;
     }
 
-    LD_LOG(LD_LOG_INFO, "running store init");
-    return LDStoreInit(store, update);
+    LD_LOG(LD_LOG_INFO, "running store update");
+    return LDStoreUpdate(store, update);
 
 error:
     LDJSONFree(update);
@@ -53,14 +54,61 @@ error:
     return LDBooleanFalse;
 }
 
-struct PollContext
+/* curl spec says these may not be NULL terminated */
+size_t
+LDi_pollHeaderCallback(
+    const char * buffer,
+    const size_t size,
+    const size_t itemcount,
+    void *const  rawcontext)
 {
-    char *             memory;
-    size_t             size;
-    struct curl_slist *headers;
-    LDBoolean          active;
-    double             lastpoll;
-};
+    struct PollContext *context;
+    const size_t        total         = size * itemcount;
+    const char *const   etagheader    = "ETag:";
+    const size_t        etagheaderlen = strlen(etagheader);
+    const char *        end;
+    char *              etag;
+
+    LD_ASSERT(rawcontext);
+
+    context = (struct PollContext *)rawcontext;
+
+    if (total <= etagheaderlen ||
+        LDi_strncasecmp(buffer, etagheader, etagheaderlen) != 0)
+    {
+        return total;
+    }
+
+    end = buffer + total;
+    buffer += etagheaderlen;
+
+    /* trim spaces before, and spaces and line endings after, the value */
+    while (buffer < end && (*buffer == ' ' || *buffer == '\t')) {
+        buffer++;
+    }
+
+    while (end > buffer && (end[-1] == '\r' || end[-1] == '\n' ||
+                            end[-1] == ' ' || end[-1] == '\t'))
+    {
+        end--;
+    }
+
+    if (end == buffer) {
+        return total;
+    }
+
+    if (!(etag = (char *)LDAlloc(end - buffer + 1))) {
+        return total;
+    }
+
+    memcpy(etag, buffer, end - buffer);
+    etag[end - buffer] = '\0';
+
+    LDFree(context->responseEtag);
+    context->responseEtag = etag;
+
+    return total;
+}
 
 static size_t
 writeCallback(
@@ -100,6 +148,9 @@ resetMemory(struct PollContext *const context)
     curl_slist_free_all(context->headers);
     context->headers = NULL;
 
+    LDFree(context->responseEtag);
+    context->responseEtag = NULL;
+
     context->size = 0;
 }
 
@@ -110,7 +161,6 @@ done(
     const int              responseCode)
 {
     struct PollContext *context;
-    const LDBoolean     success = responseCode == 200;
 
     LD_ASSERT(client);
     LD_ASSERT(rawcontext);
@@ -118,12 +168,22 @@ done(
     context         = (struct PollContext *)rawcontext;
     context->active = LDBooleanFalse;
 
-    if (success) {
+    /* failures are retried on the next interval too */
+    LDi_getMonotonicMilliseconds(&context->lastpoll);
+
+    if (responseCode == 200) {
+        LDFree(context->etag);
+        context->etag = NULL;
+
         if (!updateStore(client->store, context->memory)) {
             LD_LOG(LD_LOG_ERROR, "polling failed to update store");
+        } else {
+            /* only trusted once the store holds the payload it names */
+            context->etag         = context->responseEtag;
+            context->responseEtag = NULL;
         }
-
-        LDi_getMonotonicMilliseconds(&context->lastpoll);
+    } else if (responseCode == 304) {
+        LD_LOG(LD_LOG_TRACE, "polling payload not modified");
     }
 
     resetMemory(context);
@@ -140,9 +200,30 @@ destroy(void *const rawcontext)
 
     resetMemory(context);
 
+    LDFree(context->etag);
     LDFree(context);
 }
 
+static double
+deadline(struct LDClient *const client, void *const rawcontext)
+{
+    struct PollContext *context;
+    double              now;
+
+    LD_ASSERT(client);
+    LD_ASSERT(rawcontext);
+
+    context = (struct PollContext *)rawcontext;
+
+    if (context->active || client->config->stream || client->config->dataSource) {
+        return LD_NETWORK_MAX_WAIT;
+    }
+
+    LDi_getMonotonicMilliseconds(&now);
+
+    return context->lastpoll + client->config->pollInterval - now;
+}
+
 static CURL *
 poll(struct LDClient *const client, void *const rawcontext)
 {
@@ -198,12 +279,62 @@ poll(struct LDClient *const client, void *const rawcontext)
         goto error;
     }
 
+    /* an empty string accepts every encoding curl was built to decode */
+    if (curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "") != CURLE_OK) {
+        LD_LOG(
+            LD_LOG_CRITICAL, "curl_easy_setopt CURLOPT_ACCEPT_ENCODING failed");
+
+        goto error;
+    }
+
+    if (curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, LDi_pollHeaderCallback) !=
+        CURLE_OK) {
+        LD_LOG(
+            LD_LOG_CRITICAL, "curl_easy_setopt CURLOPT_HEADERFUNCTION failed");
+
+        goto error;
+    }
+
+    if (curl_easy_setopt(curl, CURLOPT_HEADERDATA, context) != CURLE_OK) {
+        LD_LOG(LD_LOG_CRITICAL, "curl_easy_setopt CURLOPT_HEADERDATA failed");
+
+        goto error;
+    }
+
+    /* an unchanged payload is answered with 304 and no body */
+    if (context->etag) {
+        char header[512];
+
+        if (snprintf(header, sizeof(header), "If-None-Match: %s", context->etag)
+            >= (int)sizeof(header))
+        {
+            LD_LOG(LD_LOG_WARNING, "polling ETag too long to send");
+        } else {
+            if (!(context->headers =
+                      curl_slist_append(context->headers, header))) {
+                LD_LOG(LD_LOG_CRITICAL, "curl_slist_append failed for ETag");
+
+                goto error;
+            }
+
+            if (curl_easy_setopt(curl, CURLOPT_HTTPHEADER, context->headers) !=
+                CURLE_OK) {
+                LD_LOG(
+                    LD_LOG_CRITICAL,
+                    "curl_easy_setopt CURLOPT_HTTPHEADER failed");
+
+                goto error;
+            }
+        }
+    }
+
     context->active = LDBooleanTrue;
 
     return curl;
 
 error:
     curl_slist_free_all(context->headers);
+    context->headers = NULL;
 
     curl_easy_cleanup(curl);
 
@@ -232,18 +363,21 @@ LDi_constructPolling(struct LDClient *const client)
         goto error;
     }
 
-    context->memory   = NULL;
-    context->size     = 0;
-    context->headers  = NULL;
-    context->active   = LDBooleanFalse;
-    context->lastpoll = 0;
-
-    netInterface->done    = done;
-    netInterface->poll    = poll;
-    netInterface->context = context;
-    netInterface->destroy = destroy;
-    netInterface->context = context;
-    netInterface->current = NULL;
+    context->memory       = NULL;
+    context->size         = 0;
+    context->headers      = NULL;
+    context->active       = LDBooleanFalse;
+    context->lastpoll     = 0;
+    context->etag         = NULL;
+    context->responseEtag = NULL;
+
+    netInterface->done     = done;
+    netInterface->poll     = poll;
+    netInterface->deadline = deadline;
+    netInterface->context  = context;
+    netInterface->destroy  = destroy;
+    netInterface->context  = context;
+    netInterface->current  = NULL;
 
     return netInterface;
 
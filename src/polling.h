@@ -0,0 +1,34 @@
+/*!
+ * @file polling.h
+ * @brief Internal API Interface for Polling. Header primarily for testing.
+ */
+
+#pragma once
+
+#include <curl/curl.h>
+
+#include <launchdarkly/boolean.h>
+
+#include "network.h"
+
+struct PollContext
+{
+    char *             memory;
+    size_t             size;
+    struct curl_slist *headers;
+    LDBoolean          active;
+    double             lastpoll;
+    /* ETag of the payload the store was last updated from */
+    char *             etag;
+    /* ETag of the response in progress */
+    char *             responseEtag;
+};
+
+/* Records the value of an ETag header as the ETag of the response in
+ * progress. Other headers are ignored. */
+size_t
+LDi_pollHeaderCallback(
+    const char * buffer,
+    const size_t size,
+    const size_t itemcount,
+    void *const  rawcontext);
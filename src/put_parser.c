@@ -0,0 +1,518 @@
+#include <string.h>
+
+#include <launchdarkly/memory.h>
+
+#include "assertion.h"
+#include "logging.h"
+#include "put_parser.h"
+
+/* The number of objects descended into: the put, its data, and the flags or
+ * segments of the data. */
+#define LD_PUT_LEVEL_PUT 1
+#define LD_PUT_LEVEL_DATA 2
+#define LD_PUT_LEVEL_ITEMS 3
+
+enum LDPutState
+{
+    /* expecting a value */
+    LD_PUT_VALUE,
+    /* after the opening brace of an object */
+    LD_PUT_KEY_OR_END,
+    /* after a comma between members */
+    LD_PUT_KEY,
+    LD_PUT_IN_KEY,
+    LD_PUT_COLON,
+    /* expecting a comma or a closing brace */
+    LD_PUT_AFTER_VALUE,
+    /* buffering a value which is not descended into */
+    LD_PUT_CAPTURE,
+    LD_PUT_DONE,
+    LD_PUT_FAILED
+};
+
+struct LDPutBuffer
+{
+    char * data;
+    size_t size;
+    size_t capacity;
+};
+
+struct LDPutParser
+{
+    enum LDPutState state;
+    unsigned int    level;
+    /* the object at LD_PUT_LEVEL_ITEMS receiving items, one of the two below */
+    struct LDJSON *items;
+    struct LDJSON *features;
+    struct LDJSON *segments;
+    LDBoolean      hasData;
+    /* the key of the member whose value is being read */
+    char *             key;
+    struct LDPutBuffer keyBuffer;
+    struct LDPutBuffer capture;
+    /* nesting of the captured value, and whether it is a bare literal */
+    unsigned int captureDepth;
+    LDBoolean    captureLiteral;
+    LDBoolean    inString;
+    LDBoolean    escaped;
+};
+
+struct LDPutParser *
+LDi_putParserNew(void)
+{
+    struct LDPutParser *parser;
+
+    if (!(parser = LDAlloc(sizeof(struct LDPutParser)))) {
+        return NULL;
+    }
+
+    memset(parser, 0, sizeof(struct LDPutParser));
+
+    parser->state = LD_PUT_VALUE;
+
+    return parser;
+}
+
+void
+LDi_putParserFree(struct LDPutParser *const parser)
+{
+    if (parser) {
+        LDJSONFree(parser->features);
+        LDJSONFree(parser->segments);
+        LDFree(parser->key);
+        LDFree(parser->keyBuffer.data);
+        LDFree(parser->capture.data);
+        LDFree(parser);
+    }
+}
+
+static LDBoolean
+bufferAppend(
+    struct LDPutBuffer *const buffer,
+    const char *const         data,
+    const size_t              dataSize)
+{
+    /* room for a terminator */
+    if (buffer->size + dataSize + 1 > buffer->capacity) {
+        size_t capacity;
+        char * grown;
+
+        capacity = buffer->capacity ? buffer->capacity : 256;
+
+        while (capacity < buffer->size + dataSize + 1) {
+            capacity *= 2;
+        }
+
+        if (!(grown = (char *)LDRealloc(buffer->data, capacity))) {
+            LD_LOG(LD_LOG_ERROR, "alloc error");
+
+            return LDBooleanFalse;
+        }
+
+        buffer->data     = grown;
+        buffer->capacity = capacity;
+    }
+
+    memcpy(buffer->data + buffer->size, data, dataSize);
+    buffer->size += dataSize;
+    buffer->data[buffer->size] = '\0';
+
+    return LDBooleanTrue;
+}
+
+static LDBoolean
+isSpace(const char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static LDBoolean
+fail(struct LDPutParser *const parser, const char *const message)
+{
+    LD_LOG(LD_LOG_ERROR, message);
+
+    parser->state = LD_PUT_FAILED;
+
+    return LDBooleanFalse;
+}
+
+/* Decodes the buffered key, including its quotes, into parser->key. */
+static LDBoolean
+decodeKey(struct LDPutParser *const parser)
+{
+    LDFree(parser->key);
+    parser->key = NULL;
+
+    if (memchr(parser->keyBuffer.data, '\\', parser->keyBuffer.size)) {
+        struct LDJSON *decoded;
+
+        if (!(decoded = LDJSONDeserialize(parser->keyBuffer.data))) {
+            return fail(parser, "sse put failed to decode key");
+        }
+
+        parser->key = LDStrDup(LDGetText(decoded));
+
+        LDJSONFree(decoded);
+    } else {
+        parser->keyBuffer.data[parser->keyBuffer.size - 1] = '\0';
+
+        parser->key = LDStrDup(parser->keyBuffer.data + 1);
+    }
+
+    if (!parser->key) {
+        return fail(parser, "alloc error");
+    }
+
+    return LDBooleanTrue;
+}
+
+static LDBoolean
+isKey(const struct LDPutParser *const parser, const char *const key)
+{
+    return parser->key && strcmp(parser->key, key) == 0;
+}
+
+/* Called on the opening brace of a value. Returns true when the value is one
+ * of the objects that are descended into, rather than captured. */
+static LDBoolean
+descend(struct LDPutParser *const parser)
+{
+    if (parser->level == 0) {
+        return LDBooleanTrue;
+    }
+
+    if (parser->level == LD_PUT_LEVEL_PUT && isKey(parser, "data")) {
+        parser->hasData = LDBooleanTrue;
+
+        return LDBooleanTrue;
+    }
+
+    if (parser->level == LD_PUT_LEVEL_DATA) {
+        struct LDJSON **items = NULL;
+
+        if (isKey(parser, "flags")) {
+            items = &parser->features;
+        } else if (isKey(parser, "segments")) {
+            items = &parser->segments;
+        }
+
+        if (items) {
+            if (!*items && !(*items = LDNewObject())) {
+                return LDBooleanFalse;
+            }
+
+            parser->items = *items;
+
+            return LDBooleanTrue;
+        }
+    }
+
+    return LDBooleanFalse;
+}
+
+/* Returns an error message if the value must be an object but is not. */
+static const char *
+requiredObject(const struct LDPutParser *const parser)
+{
+    if (parser->level == 0) {
+        return "sse put body should be object, discarding";
+    } else if (parser->level == LD_PUT_LEVEL_PUT && isKey(parser, "data")) {
+        return "put.data is not an object";
+    } else if (parser->level == LD_PUT_LEVEL_DATA && isKey(parser, "flags")) {
+        return "put.flags is not an object";
+    } else if (parser->level == LD_PUT_LEVEL_DATA && isKey(parser, "segments")) {
+        return "put.segments is not an object";
+    }
+
+    return NULL;
+}
+
+/* Deserializes a completely captured value. Flags and segments are kept,
+ * anything else is only validated. */
+static LDBoolean
+completeCapture(struct LDPutParser *const parser)
+{
+    struct LDJSON *value;
+
+    if (!(value = LDJSONDeserialize(parser->capture.data))) {
+        return fail(parser, "sse put failed to decode event body");
+    }
+
+    parser->capture.size = 0;
+    parser->state        = LD_PUT_AFTER_VALUE;
+
+    if (parser->level == LD_PUT_LEVEL_ITEMS) {
+        LD_ASSERT(parser->items);
+        LD_ASSERT(parser->key);
+
+        if (!LDObjectSetKey(parser->items, parser->key, value)) {
+            LDJSONFree(value);
+
+            return fail(parser, "alloc error");
+        }
+    } else {
+        LDJSONFree(value);
+    }
+
+    return LDBooleanTrue;
+}
+
+/* Captures as much of the current value as dataSize allows, returning the
+ * number of bytes it spans. A literal ends on the byte after it, which is
+ * not consumed. */
+static size_t
+capture(
+    struct LDPutParser *const parser,
+    const char *const         data,
+    const size_t              dataSize,
+    LDBoolean *const          complete)
+{
+    size_t i;
+
+    *complete = LDBooleanFalse;
+
+    for (i = 0; i < dataSize && !*complete; i++) {
+        const char c = data[i];
+
+        if (parser->inString) {
+            if (parser->escaped) {
+                parser->escaped = LDBooleanFalse;
+            } else if (c == '\\') {
+                parser->escaped = LDBooleanTrue;
+            } else if (c == '"') {
+                parser->inString = LDBooleanFalse;
+                *complete        = parser->captureDepth == 0;
+            }
+        } else if (parser->captureLiteral) {
+            if (isSpace(c) || c == ',' || c == '}' || c == ']') {
+                *complete = LDBooleanTrue;
+
+                return i;
+            }
+        } else if (c == '"') {
+            parser->inString = LDBooleanTrue;
+        } else if (c == '{' || c == '[') {
+            parser->captureDepth++;
+        } else if (c == '}' || c == ']') {
+            /* mismatched brackets are left to LDJSONDeserialize */
+            *complete = --parser->captureDepth == 0;
+        }
+    }
+
+    return i;
+}
+
+static void
+startCapture(struct LDPutParser *const parser, const char c)
+{
+    parser->state          = LD_PUT_CAPTURE;
+    parser->capture.size   = 0;
+    parser->captureDepth   = 0;
+    parser->captureLiteral = c != '{' && c != '[' && c != '"';
+    parser->inString       = LDBooleanFalse;
+    parser->escaped        = LDBooleanFalse;
+}
+
+static LDBoolean
+closeObject(struct LDPutParser *const parser)
+{
+    LD_ASSERT(parser->level > 0);
+
+    if (parser->level == LD_PUT_LEVEL_ITEMS) {
+        parser->items = NULL;
+    }
+
+    parser->level--;
+    parser->state = parser->level == 0 ? LD_PUT_DONE : LD_PUT_AFTER_VALUE;
+
+    return LDBooleanTrue;
+}
+
+LDBoolean
+LDi_putParserProcess(
+    struct LDPutParser *const parser,
+    const char *const         data,
+    const size_t              dataSize)
+{
+    size_t i;
+
+    LD_ASSERT(parser);
+    LD_ASSERT(data || dataSize == 0);
+
+    for (i = 0; i < dataSize && parser->state != LD_PUT_FAILED;) {
+        const char c = data[i];
+
+        switch (parser->state) {
+        case LD_PUT_CAPTURE: {
+            LDBoolean    complete;
+            const size_t size = capture(parser, data + i, dataSize - i, &complete);
+
+            if (!bufferAppend(&parser->capture, data + i, size)) {
+                return fail(parser, "alloc error");
+            }
+
+            i += size;
+
+            if (complete && !completeCapture(parser)) {
+                return LDBooleanFalse;
+            }
+
+            continue;
+        }
+        case LD_PUT_IN_KEY: {
+            LDBoolean closed;
+            size_t    end;
+
+            closed = LDBooleanFalse;
+
+            for (end = i; end < dataSize && !closed; end++) {
+                if (parser->escaped) {
+                    parser->escaped = LDBooleanFalse;
+                } else if (data[end] == '\\') {
+                    parser->escaped = LDBooleanTrue;
+                } else if (data[end] == '"') {
+                    closed = LDBooleanTrue;
+                }
+            }
+
+            if (!bufferAppend(&parser->keyBuffer, data + i, end - i)) {
+                return fail(parser, "alloc error");
+            }
+
+            i = end;
+
+            if (closed) {
+                if (!decodeKey(parser)) {
+                    return LDBooleanFalse;
+                }
+
+                parser->state = LD_PUT_COLON;
+            }
+
+            continue;
+        }
+        default:
+            break;
+        }
+
+        i++;
+
+        if (isSpace(c)) {
+            continue;
+        }
+
+        switch (parser->state) {
+        case LD_PUT_VALUE:
+            if (c == '{' && descend(parser)) {
+                parser->level++;
+                parser->state = LD_PUT_KEY_OR_END;
+            } else if (requiredObject(parser)) {
+                return fail(parser, requiredObject(parser));
+            } else {
+                /* reprocess the first byte as part of the value */
+                startCapture(parser, c);
+                i--;
+            }
+            break;
+        case LD_PUT_KEY_OR_END:
+            if (c == '}') {
+                closeObject(parser);
+
+                break;
+            }
+            /* fallthrough */
+        case LD_PUT_KEY:
+            if (c != '"') {
+                return fail(parser, "sse put failed to decode event body");
+            }
+
+            parser->keyBuffer.size = 0;
+            parser->escaped        = LDBooleanFalse;
+            parser->state          = LD_PUT_IN_KEY;
+
+            if (!bufferAppend(&parser->keyBuffer, "\"", 1)) {
+                return fail(parser, "alloc error");
+            }
+            break;
+        case LD_PUT_COLON:
+            if (c != ':') {
+                return fail(parser, "sse put failed to decode event body");
+            }
+
+            parser->state = LD_PUT_VALUE;
+            break;
+        case LD_PUT_AFTER_VALUE:
+            if (c == ',') {
+                parser->state = LD_PUT_KEY;
+            } else if (c == '}') {
+                closeObject(parser);
+            } else {
+                return fail(parser, "sse put failed to decode event body");
+            }
+            break;
+        default:
+            return fail(parser, "sse put failed to decode event body");
+        }
+    }
+
+    return parser->state != LD_PUT_FAILED;
+}
+
+LDBoolean
+LDi_putParserFinish(
+    struct LDPutParser *const parser, struct LDJSON **const result)
+{
+    struct LDJSON *sets;
+
+    LD_ASSERT(parser);
+    LD_ASSERT(result);
+
+    *result = NULL;
+
+    /* a literal at the end of the body has no byte after it */
+    if (parser->state == LD_PUT_CAPTURE && parser->captureLiteral) {
+        if (!completeCapture(parser)) {
+            return LDBooleanFalse;
+        }
+    }
+
+    if (parser->state != LD_PUT_DONE) {
+        return fail(parser, "sse put failed to decode event body");
+    }
+
+    if (!parser->hasData) {
+        return fail(parser, "put.data does not exist");
+    }
+
+    if (!parser->features) {
+        return fail(parser, "put.flags does not exist");
+    }
+
+    if (!parser->segments) {
+        return fail(parser, "put.segments does not exist");
+    }
+
+    if (!(sets = LDNewObject())) {
+        return fail(parser, "alloc error");
+    }
+
+    if (!LDObjectSetKey(sets, "features", parser->features)) {
+        LDJSONFree(sets);
+
+        return fail(parser, "alloc error");
+    }
+
+    parser->features = NULL;
+
+    if (!LDObjectSetKey(sets, "segments", parser->segments)) {
+        LDJSONFree(sets);
+
+        return fail(parser, "alloc error");
+    }
+
+    parser->segments = NULL;
+
+    *result = sets;
+
+    return LDBooleanTrue;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <launchdarkly/boolean.h>
+#include <launchdarkly/json.h>
+
+/* Reads the body of a stream "put" event incrementally, as its data arrives.
+ *
+ * Only the outer levels of the put are walked byte by byte. Each flag and
+ * segment is buffered on its own and deserialized as soon as it is complete,
+ * so neither the raw body nor a second copy of the data is ever held whole.
+ * Any other values of the put are validated and discarded. Not thread safe. */
+struct LDPutParser;
+
+struct LDPutParser *
+LDi_putParserNew(void);
+
+void
+LDi_putParserFree(struct LDPutParser *const parser);
+
+/* Returns false if the data is not a valid put, after which the parser must
+ * not be used further. */
+LDBoolean
+LDi_putParserProcess(
+    struct LDPutParser *const parser,
+    const char *const         data,
+    const size_t              dataSize);
+
+/* Completes the put, producing the "features" and "segments" sets expected
+ * by LDStoreInit. Returns false if the put is incomplete or missing data. */
+LDBoolean
+LDi_putParserFinish(
+    struct LDPutParser *const parser, struct LDJSON **const result);
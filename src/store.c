@@ -38,7 +38,8 @@ LDStoreNew(const struct LDConfig *const config)
 
     if(config->storeBackend) {
         /* There is a configured back-end. We should wrap it in a caching wrapper. */
-        store->implementation = LDStoreCachingWrapperNew(config->storeBackend, config->storeCacheMilliseconds);
+        store->implementation = LDStoreCachingWrapperNew(
+                config->storeBackend, config->storeCacheMilliseconds, config->storeRefreshAhead);
     } else {
         /* There is no back-end, so we want a memory store. */
         store->implementation = LDStoreMemoryNew();
@@ -64,6 +65,118 @@ LDStoreInit(struct LDStore *const store, struct LDJSON *const sets)
     return store->implementation->init(store->implementation->context, sets);
 }
 
+/* Checks that upserting the newer items of set would leave the store holding
+ * exactly set. A NULL set is treated as empty. */
+static LDBoolean
+LDi_canUpdateSet(const struct LDJSON *const current, const struct LDJSON *const set)
+{
+    const struct LDJSON *iter, *existing;
+    unsigned int         matched;
+
+    matched = 0;
+
+    if (set && LDJSONGetType(set) != LDObject) {
+        return LDBooleanFalse;
+    }
+
+    for (iter = set ? LDGetIter(set) : NULL; iter; iter = LDIterNext(iter)) {
+        if ((existing = LDObjectLookup(current, LDIterKey(iter)))) {
+            if (LDi_getDataVersion(iter) < LDi_getDataVersion(existing)) {
+                return LDBooleanFalse;
+            }
+
+            matched++;
+        }
+    }
+
+    return matched == LDCollectionGetSize(current);
+}
+
+/* Upserts the items of set that are new or newer than the stored ones. */
+static LDBoolean
+LDi_updateSet(
+    struct LDStore *const      store,
+    const enum FeatureKind     kind,
+    const struct LDJSON *const current,
+    struct LDJSON *const       set)
+{
+    struct LDJSON *iter, *next, *existing;
+    LDBoolean      success;
+
+    success = LDBooleanTrue;
+
+    for (iter = set ? LDGetIter(set) : NULL; iter; iter = next) {
+        next = LDIterNext(iter);
+
+        existing = LDObjectLookup(current, LDIterKey(iter));
+
+        if (existing &&
+            LDi_getDataVersion(iter) == LDi_getDataVersion(existing))
+        {
+            continue;
+        }
+
+        if (!LDStoreUpsert(store, kind, LDCollectionDetachIter(set, iter))) {
+            success = LDBooleanFalse;
+        }
+    }
+
+    return success;
+}
+
+LDBoolean
+LDStoreUpdate(struct LDStore *const store, struct LDJSON *const sets)
+{
+    struct LDJSONRC *currentFeatures, *currentSegments;
+    struct LDJSON *  features, *segments;
+    LDBoolean        success;
+
+    LD_LOG(LD_LOG_TRACE, "LDStoreUpdate");
+
+    LD_ASSERT(store);
+    LD_ASSERT(sets);
+
+    currentFeatures = NULL;
+    currentSegments = NULL;
+
+    if (!LDStoreInitialized(store) ||
+        !LDStoreAll(store, LD_FLAG, &currentFeatures) || !currentFeatures ||
+        !LDStoreAll(store, LD_SEGMENT, &currentSegments) || !currentSegments)
+    {
+        goto init;
+    }
+
+    features = LDObjectLookup(sets, "features");
+    segments = LDObjectLookup(sets, "segments");
+
+    if (!LDi_canUpdateSet(LDJSONRCGet(currentFeatures), features) ||
+        !LDi_canUpdateSet(LDJSONRCGet(currentSegments), segments))
+    {
+        goto init;
+    }
+
+    /* segments first, so that no new flag refers to a missing segment */
+    success = LDi_updateSet(
+        store, LD_SEGMENT, LDJSONRCGet(currentSegments), segments);
+
+    if (!LDi_updateSet(store, LD_FLAG, LDJSONRCGet(currentFeatures), features))
+    {
+        success = LDBooleanFalse;
+    }
+
+    LDJSONRCRelease(currentFeatures);
+    LDJSONRCRelease(currentSegments);
+    LDJSONFree(sets);
+
+    return success;
+
+init:
+    LDJSONRCRelease(currentFeatures);
+    LDJSONRCRelease(currentSegments);
+
+    return LDStoreInit(store, sets);
+}
+
 LDBoolean
 LDStoreGet(
     struct LDStore *const   store,
@@ -81,6 +194,45 @@ LDStoreGet(
     return store->implementation->get(store->implementation->context, kind, key, result);
 }
 
+LDBoolean
+LDStoreGetMany(
+    struct LDStore *const    store,
+    const enum FeatureKind   kind,
+    const char *const *const keys,
+    const unsigned int       count,
+    struct LDJSONRC **const  results)
+{
+    unsigned int i;
+    LDBoolean    success;
+
+    LD_LOG(LD_LOG_TRACE, "LDStoreGetMany");
+
+    LD_ASSERT(store);
+    LD_ASSERT(store->implementation);
+    LD_ASSERT(store->implementation->get);
+    LD_ASSERT(store->implementation->context);
+    LD_ASSERT(keys);
+    LD_ASSERT(results);
+
+    if (store->implementation->getMany) {
+        return store->implementation->getMany(
+            store->implementation->context, kind, keys, count, results);
+    }
+
+    success = LDBooleanTrue;
+
+    for (i = 0; i < count; i++) {
+        if (!store->implementation->get(
+                store->implementation->context, kind, keys[i], &results[i]))
+        {
+            results[i] = NULL;
+            success    = LDBooleanFalse;
+        }
+    }
+
+    return success;
+}
+
 LDBoolean
 LDStoreAll(
     struct LDStore *const   store,
@@ -31,6 +31,18 @@ enum FeatureKind
 LDBoolean
 LDStoreInit(struct LDStore *const store, struct LDJSON *const sets);
 
+/** @brief Brings the store to the same state as `LDStoreInit` would, by
+ * upserting only the items whose version is newer than the stored one.
+ *
+ * Unchanged items are left in place, so their compiled forms and any
+ * references to them are kept. Falls back to `LDStoreInit` if the store is
+ * not initialized, or if an item would be removed or downgraded. Unlike
+ * `LDStoreInit` readers may observe the changes one item at a time.
+ * Input is consumed even on failure.
+ */
+LDBoolean
+LDStoreUpdate(struct LDStore *const store, struct LDJSON *const sets);
+
 /** @brief A convenience wrapper around `store->get`. */
 LDBoolean
 LDStoreGet(
@@ -39,6 +51,20 @@ LDStoreGet(
     const char *const       key,
     struct LDJSONRC **const result);
 
+/** @brief Gets `count` items of one kind, with a single call to
+ * `store->getMany` when the store provides it.
+ *
+ * Every entry of `results` is set, to `NULL` for missing items. On failure
+ * the successfully fetched items must still be released.
+ */
+LDBoolean
+LDStoreGetMany(
+    struct LDStore *const    store,
+    const enum FeatureKind   kind,
+    const char *const *const keys,
+    const unsigned int       count,
+    struct LDJSONRC **const  results);
+
 /** @brief A convenience wrapper around `store->all`. */
 LDBoolean
 LDStoreAll(
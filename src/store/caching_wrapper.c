@@ -6,12 +6,14 @@
 
 #include "assertion.h"
 #include "caching_wrapper.h"
+#include "compiled.h"
 #include "concurrency.h"
 #include "internal_store.h"
 #include "utility.h"
 #include "memory_cache.h"
 #include "store_utilities.h"
 #include "persistent_store_collection.h"
+#include "json_internal_helpers.h"
 
 #define PS_CONTEXT(ptr) (struct PersistentStoreContext *) ptr;
 
@@ -40,6 +42,15 @@ struct PersistentStoreContext {
     struct LDStoreInterface *persistentStore;
     struct LDMemoryContext *cache;
     unsigned int cacheMilliseconds;
+    /* Incremented by memoryInit, so that a refresh read from the backend before an init is discarded.
+     * Protected by the cache lock. */
+    unsigned int generation;
+    /* When true, expired items are served while the refresher thread updates them. */
+    LDBoolean refreshAhead;
+    LDBoolean refresherStop;
+    ld_thread_t refresher;
+    ld_mutex_t refresherLock;
+    ld_cond_t refresherAwake;
 };
 
 /* endregion */
@@ -58,6 +69,12 @@ upsertMemory(
 static ExpirationState
 getExpirationState(const struct PersistentStoreContext *const store, const struct LDCacheItem *const item);
 
+static LDBoolean
+claimRefresh(const struct PersistentStoreContext *const store, struct LDCacheItem *const item);
+
+static void
+releaseRefresh(struct PersistentStoreContext *const store, const char *const cacheKey);
+
 static LDBoolean
 getSingleItemFromBackend(
         struct PersistentStoreContext *const store,
@@ -83,50 +100,63 @@ queryAndUpdateInitialization(struct PersistentStoreContext *const store, LDBoole
 static void
 memoryDestructor(struct LDMemoryContext *const context);
 
+static THREAD_RETURN
+refresherThread(void *const contextRaw);
+
 /* endregion */
 
 /* region Cache Keys */
 
+/* Cache keys are composed on the stack, which is large enough for all but unusually long keys. Those are composed
+ * on the heap instead, so a key must always be released with freeCacheKey. */
+#define LD_CACHE_KEY_BUFFER_SIZE 256
+
 static char *
-featureStoreAllCacheKey(const char* kind)
+composeCacheKey(char *const buffer, const char *const prefix, const char *const key)
 {
-    char *result = NULL;
-    int bytes;
-    int status;
+    char * result;
+    size_t prefixLength;
+    size_t keyLength;
 
-    LD_ASSERT(kind);
+    LD_ASSERT(buffer);
+    LD_ASSERT(prefix);
+    LD_ASSERT(key);
 
-    bytes = 4 + strlen(kind) + 1;
+    prefixLength = strlen(prefix);
+    keyLength    = strlen(key);
 
-    if (!(result = LDAlloc(bytes))) {
-        return NULL;
+    if (prefixLength + 1 + keyLength + 1 <= LD_CACHE_KEY_BUFFER_SIZE) {
+        result = buffer;
+    } else {
+        result = LDAlloc(prefixLength + 1 + keyLength + 1);
+        LD_ASSERT(result);
     }
 
-    status = snprintf(result, bytes, "all:%s", kind);
-    LD_ASSERT(status == bytes - 1);
+    memcpy(result, prefix, prefixLength);
+    result[prefixLength] = ':';
+    memcpy(result + prefixLength + 1, key, keyLength + 1);
 
     return result;
 }
 
 static char *
-featureStoreCacheKey(const char* kind, const char *const key)
+featureStoreAllCacheKey(char *const buffer, const char* kind)
 {
-    char *result = NULL;
-    int   bytes;
-    int   status;
-
-    LD_ASSERT(kind);
-    LD_ASSERT(key);
-
-    bytes = strlen(kind) + 1 + strlen(key) + 1;
-
-    result = LDAlloc(bytes);
-    LD_ASSERT(result);
+    return composeCacheKey(buffer, "all", kind);
+}
 
-    status = snprintf(result, bytes, "%s:%s", kind, key);
-    LD_ASSERT(status == bytes - 1);
+static char *
+featureStoreCacheKey(char *const buffer, const char* kind, const char *const key)
+{
+    return composeCacheKey(buffer, kind, key);
+}
 
-    return result;
+static void
+freeCacheKey(char *const buffer, char *const cacheKey)
+{
+    if (cacheKey != buffer) {
+        LDFree(cacheKey);
+    }
 }
 
 /* endregion */
@@ -173,13 +203,16 @@ storeGet(
 {
     struct PersistentStoreContext *psCtx = NULL;
     struct LDCacheItem *item = NULL;
+    char cacheKeyBuffer[LD_CACHE_KEY_BUFFER_SIZE];
     char* cacheKey = NULL;
+    LDBoolean refreshing = LDBooleanFalse;
+    LDBoolean success;
 
     LD_ASSERT(key);
     LD_ASSERT(result);
     LD_ASSERT(contextRaw);
 
-    cacheKey = featureStoreCacheKey(featureKindToString(kind), key);
+    cacheKey = featureStoreCacheKey(cacheKeyBuffer, featureKindToString(kind), key);
 
     *result = NULL;
 
@@ -191,44 +224,50 @@ storeGet(
     LDi_memoryCacheGetCollectionItem(psCtx->cache,
                                      cacheKey,
                                      &item);
-    LDFree(cacheKey);
 
     if(item != NULL) {
         ExpirationState state = getExpirationState(psCtx, item);
 
-        switch(state) {
-            case LD_EXP_EXPIRED:
-                /* The item was expired, so we want to get it from the backend. */
-                break;
-            case LD_EXP_ERROR:
-                /* We encountered an error determining if the item is expired.
-                 * Report failure to access the store. */
-                LDi_rwlock_rdunlock(&psCtx->cache->lock);
-                return LDBooleanFalse;
-            case LD_EXP_CURRENT:
-                /* The item was current, so we can use it.
-                 * If it was deleted, then we just need to say that access was a success.
-                 * We don't need to return a result.
-                 * If it is current, and not deleted, then we can assign the result. */
-                if (LDi_isDataDeleted(LDJSONRCGet(item->feature))) {
-                    LDi_rwlock_rdunlock(&psCtx->cache->lock);
-                    /* It was deleted, so we don't assign a result. */
-                    return LDBooleanTrue;
-                } else {
-                    LDJSONRCRetain(item->feature);
-
-                    *result = item->feature;
-
-                    LDi_rwlock_rdunlock(&psCtx->cache->lock);
-
-                    return LDBooleanTrue;
-                }
+        if (state == LD_EXP_ERROR) {
+            /* We encountered an error determining if the item is expired.
+             * Report failure to access the store. */
+            LDi_rwlock_rdunlock(&psCtx->cache->lock);
+            freeCacheKey(cacheKeyBuffer, cacheKey);
+            return LDBooleanFalse;
+        }
+
+        /* If the item was expired, then we want to get it from the backend, unless another thread is already
+         * doing so. In that case the expired item is used until the refresh completes. */
+        if (state == LD_EXP_CURRENT || !claimRefresh(psCtx, item)) {
+            /* If it was deleted, then we just need to say that access was a success.
+             * We don't need to return a result. */
+            if (!LDi_isDataDeleted(LDJSONRCGet(item->feature))) {
+                LDJSONRCRetain(item->feature);
+
+                *result = item->feature;
+            }
+
+            LDi_rwlock_rdunlock(&psCtx->cache->lock);
+            freeCacheKey(cacheKeyBuffer, cacheKey);
+
+            return LDBooleanTrue;
         }
+
+        refreshing = LDBooleanTrue;
     }
     /* The item was not in the cache or it was expired. */
     LDi_rwlock_rdunlock(&psCtx->cache->lock);
 
-    return getSingleItemFromBackend(psCtx, kind, key, result);
+    success = getSingleItemFromBackend(psCtx, kind, key, result);
+
+    /* A successful refresh replaces the cached item, otherwise the next access tries again. */
+    if (refreshing && !success) {
+        releaseRefresh(psCtx, cacheKey);
+    }
+
+    freeCacheKey(cacheKeyBuffer, cacheKey);
+
+    return success;
 }
 
 static LDBoolean
@@ -239,12 +278,15 @@ storeAll(
 {
     struct PersistentStoreContext *psCtx = NULL;
     struct LDCacheItem *item = NULL;
+    char allCacheKeyBuffer[LD_CACHE_KEY_BUFFER_SIZE];
     char* allCacheKey = NULL;
+    LDBoolean refreshing = LDBooleanFalse;
+    LDBoolean success;
 
     LD_ASSERT(result);
     LD_ASSERT(contextRaw);
 
-    allCacheKey = featureStoreAllCacheKey(featureKindToString(kind));
+    allCacheKey = featureStoreAllCacheKey(allCacheKeyBuffer, featureKindToString(kind));
 
     psCtx = PS_CONTEXT(contextRaw);
     LD_ASSERT(psCtx->cache);
@@ -252,32 +294,42 @@ storeAll(
     LDi_rwlock_rdlock(&psCtx->cache->lock);
 
     LDi_memoryCacheGetCollectionItem(psCtx->cache, allCacheKey, &item);
-    LDFree(allCacheKey);
 
     if(item) {
         ExpirationState state = getExpirationState(psCtx, item);
 
-        switch(state) {
-            case LD_EXP_EXPIRED:
-                /* The item was expired, so we want to get it from the backend. */
-                break;
-            case LD_EXP_ERROR:
-                LDi_rwlock_rdunlock(&psCtx->cache->lock);
-                return LDBooleanFalse;
-            case LD_EXP_CURRENT:
-                LDJSONRCRetain(item->feature);
+        if (state == LD_EXP_ERROR) {
+            LDi_rwlock_rdunlock(&psCtx->cache->lock);
+            freeCacheKey(allCacheKeyBuffer, allCacheKey);
+            return LDBooleanFalse;
+        }
 
-                *result = item->feature;
+        /* As for a single item, only one thread gets an expired collection from the backend. */
+        if (state == LD_EXP_CURRENT || !claimRefresh(psCtx, item)) {
+            LDJSONRCRetain(item->feature);
 
-                LDi_rwlock_rdunlock(&psCtx->cache->lock);
+            *result = item->feature;
 
-                return LDBooleanTrue;
+            LDi_rwlock_rdunlock(&psCtx->cache->lock);
+            freeCacheKey(allCacheKeyBuffer, allCacheKey);
+
+            return LDBooleanTrue;
         }
+
+        refreshing = LDBooleanTrue;
     }
 
     LDi_rwlock_rdunlock(&psCtx->cache->lock);
 
-    return getAllItemsFromBackend(psCtx, kind, result);
+    success = getAllItemsFromBackend(psCtx, kind, result);
+
+    if (refreshing && !success) {
+        releaseRefresh(psCtx, allCacheKey);
+    }
+
+    freeCacheKey(allCacheKeyBuffer, allCacheKey);
+
+    return success;
 }
 
 static LDBoolean
@@ -325,9 +377,10 @@ storeUpsert(
 
     LDFree(serialized);
 
-    LDi_rwlock_wrlock(&psCtx->cache->lock);
-    rcItem = LDJSONRCNew(item);
+    rcItem = LDi_newCompiledRC(kind, item);
     LD_ASSERT(rcItem);
+
+    LDi_rwlock_wrlock(&psCtx->cache->lock);
     status = upsertMemory(psCtx, kind, rcItem);
     /* We made it, so we need to decrement our usage. */
     LDJSONRCRelease(rcItem);
@@ -369,6 +422,19 @@ storeDestructor(void *const contextRaw)
     struct PersistentStoreContext *psCtx = NULL;
     if(contextRaw) {
         psCtx = PS_CONTEXT(contextRaw);
+
+        if (psCtx->refreshAhead) {
+            LDi_mutex_lock(&psCtx->refresherLock);
+            psCtx->refresherStop = LDBooleanTrue;
+            LDi_cond_signal(&psCtx->refresherAwake);
+            LDi_mutex_unlock(&psCtx->refresherLock);
+
+            LDi_thread_join(&psCtx->refresher);
+
+            LDi_cond_destroy(&psCtx->refresherAwake);
+            LDi_mutex_destroy(&psCtx->refresherLock);
+        }
+
         memoryDestructor(psCtx->cache);
         if(psCtx->persistentStore) {
             if(psCtx->persistentStore->destructor) {
@@ -393,7 +459,8 @@ storeExpireAll(void *const contextRaw) {
 /* endregion */
 
 struct LDInternalStoreInterface *
-LDStoreCachingWrapperNew(struct LDStoreInterface *persistentStore, unsigned int cacheMilliseconds) {
+LDStoreCachingWrapperNew(
+        struct LDStoreInterface *persistentStore, unsigned int cacheMilliseconds, LDBoolean refreshAhead) {
     struct LDInternalStoreInterface *wrapper = NULL;
     struct PersistentStoreContext *context = NULL;
     struct LDMemoryContext *cache = NULL;
@@ -419,6 +486,23 @@ LDStoreCachingWrapperNew(struct LDStoreInterface *persistentStore, unsigned int
     context->cacheMilliseconds = cacheMilliseconds;
     context->persistentStore = persistentStore;
 
+    /* Without a cache there is nothing to refresh. */
+    if (refreshAhead && cacheMilliseconds) {
+        LDi_mutex_init(&context->refresherLock);
+        LDi_cond_init(&context->refresherAwake);
+
+        context->refreshAhead = LDBooleanTrue;
+
+        if (!LDi_thread_create(&context->refresher, refresherThread, context)) {
+            LD_LOG(LD_LOG_ERROR, "failed to start store refresher, items will be refreshed on access");
+
+            context->refreshAhead = LDBooleanFalse;
+
+            LDi_cond_destroy(&context->refresherAwake);
+            LDi_mutex_destroy(&context->refresherLock);
+        }
+    }
+
     wrapper->context = context;
     wrapper->init = storeInit;
     wrapper->get = storeGet;
@@ -431,6 +515,47 @@ LDStoreCachingWrapperNew(struct LDStoreInterface *persistentStore, unsigned int
     return wrapper;
 }
 
+/* Builds the "all" collection for a kind, as an object of references to the non-deleted items. Takes ownership
+ * of the array, and of one reference to each item in it. */
+static struct LDJSONRC *
+makeAllItemsRC(struct LDJSONRC **const items, const unsigned int itemCount)
+{
+    struct LDJSON *all;
+    struct LDJSONRC *allRC;
+    unsigned int i, associatedCount;
+
+    all = LDNewObject();
+    LD_ASSERT(all);
+
+    associatedCount = 0;
+
+    for (i = 0; i < itemCount; i++) {
+        struct LDJSON *value = LDJSONRCGet(items[i]);
+
+        if (LDi_isDataDeleted(value) || !LDObjectSetReference(all, LDi_getDataKey(value), value)) {
+            LDJSONRCRelease(items[i]);
+
+            continue;
+        }
+
+        items[associatedCount++] = items[i];
+    }
+
+    allRC = LDJSONRCNew(all);
+    LD_ASSERT(allRC);
+
+    /* The result has a set of associated items which are incremented/decremented with it. This allows for a
+     * reference counted shallow collection of flags/segments, which keeps their compiled representations. */
+    LDJSONRCAssociate(allRC, items, associatedCount);
+
+    /* The association holds its own references. */
+    for (i = 0; i < associatedCount; i++) {
+        LDJSONRCRelease(items[i]);
+    }
+
+    return allRC;
+}
+
 static LDBoolean
 memoryInit(struct PersistentStoreContext *const store, struct LDJSON *const sets)
 {
@@ -444,15 +569,21 @@ memoryInit(struct PersistentStoreContext *const store, struct LDJSON *const sets
     LDi_rwlock_wrlock(&store->cache->lock);
 
     LDi_memoryCacheFlush(store->cache);
+    store->generation++;
 
     /* For each data kind (Features/Segments/??). */
     for(dataKindsIter = LDGetIter(sets); dataKindsIter; dataKindsIter = dataKindsNext) {
         struct LDCacheItem *newAllCacheForKind;
         struct LDJSON *itemsIter, *itemsNext, *items;
+        struct LDJSONRC **itemRCs;
+        struct LDJSONRC *allRC;
+        unsigned int itemCount, i;
+        enum FeatureKind featureKind;
+        LDBoolean knownKind;
         const char* kind = LDIterKey(dataKindsIter);
 
-        /* The cache key is owned memory. */
-        char* allCacheKeyForKind = featureStoreAllCacheKey(kind);
+        char allCacheKeyBuffer[LD_CACHE_KEY_BUFFER_SIZE];
+        char* allCacheKeyForKind = featureStoreAllCacheKey(allCacheKeyBuffer, kind);
 
         /* Need to get the next iter before detaching. */
         dataKindsNext = LDIterNext(dataKindsIter);
@@ -460,27 +591,53 @@ memoryInit(struct PersistentStoreContext *const store, struct LDJSON *const sets
         /* Detaching means we now own it. */
         items = LDCollectionDetachIter(sets, dataKindsIter);
 
-        /* We need a duplicate of all the items, to go to the "all" cache for that kind. */
-        newAllCacheForKind = LDi_makeCacheItem(allCacheKeyForKind, LDJSONDuplicate(items));
-        LD_ASSERT(newAllCacheForKind);
-        LDi_addToCache(store->cache, newAllCacheForKind);
+        knownKind = stringToFeatureKind(kind, &featureKind);
+        itemCount = LDCollectionGetSize(items);
+        itemRCs = NULL;
+        i = 0;
+
+        if (itemCount) {
+            itemRCs = (struct LDJSONRC **) LDAlloc(sizeof(struct LDJSONRC *) * itemCount);
+            LD_ASSERT(itemRCs);
+        }
 
         /* For each item of the kind. */
         for (itemsIter = LDGetIter(items); itemsIter; itemsIter = itemsNext) {
             struct LDCacheItem *newItem;
-            char* cacheKey = featureStoreCacheKey(kind, LDi_getDataKey(itemsIter));
+            struct LDJSONRC *itemRC;
+            char cacheKeyBuffer[LD_CACHE_KEY_BUFFER_SIZE];
+            char* cacheKey = featureStoreCacheKey(cacheKeyBuffer, kind, LDi_getDataKey(itemsIter));
             /* Get the next item before detaching from the collection. */
             itemsNext = LDIterNext(itemsIter);
 
-            newItem = LDi_makeCacheItem(cacheKey, LDCollectionDetachIter(items, itemsIter));
+            if (knownKind) {
+                itemRC = LDi_newCompiledRC(featureKind, LDCollectionDetachIter(items, itemsIter));
+            } else {
+                itemRC = LDJSONRCNew(LDCollectionDetachIter(items, itemsIter));
+            }
+            LD_ASSERT(itemRC);
+
+            newItem = LDi_makeCacheItemFromRc(cacheKey, itemRC);
             LD_ASSERT(newItem);
 
             LDi_addToCache(store->cache, newItem);
 
-            LDFree(cacheKey);
+            /* The cache and the "all" collection hold their own references. */
+            itemRCs[i++] = itemRC;
+
+            freeCacheKey(cacheKeyBuffer, cacheKey);
         }
 
-        LDFree(allCacheKeyForKind);
+        /* The "all" cache for that kind shares the items placed in the cache above. */
+        allRC = makeAllItemsRC(itemRCs, i);
+        LD_ASSERT(allRC);
+
+        newAllCacheForKind = LDi_makeCacheItemFromRc(allCacheKeyForKind, allRC);
+        LD_ASSERT(newAllCacheForKind);
+        LDi_addToCache(store->cache, newAllCacheForKind);
+
+        LDJSONRCRelease(allRC);
+        freeCacheKey(allCacheKeyBuffer, allCacheKeyForKind);
         LDJSONFree(items);
     }
 
@@ -497,6 +654,8 @@ upsertMemory(
 {
     LDBoolean success;
     struct LDCacheItem *currentItem, *replacementItem, *allItems;
+    char cacheKeyBuffer[LD_CACHE_KEY_BUFFER_SIZE];
+    char allCacheKeyBuffer[LD_CACHE_KEY_BUFFER_SIZE];
     char * cacheKey;
     char * allCacheKey;
 
@@ -509,12 +668,10 @@ upsertMemory(
     replacementItem = NULL;
     cacheKey = NULL;
 
-    allCacheKey = featureStoreAllCacheKey(featureKindToString(kind));
-    LD_ASSERT(allCacheKey);
+    allCacheKey = featureStoreAllCacheKey(allCacheKeyBuffer, featureKindToString(kind));
 
-    cacheKey =
-            featureStoreCacheKey(featureKindToString(kind), LDi_getDataKey(LDJSONRCGet(replacement)));
-    LD_ASSERT(cacheKey);
+    cacheKey = featureStoreCacheKey(
+            cacheKeyBuffer, featureKindToString(kind), LDi_getDataKey(LDJSONRCGet(replacement)));
 
     LDi_memoryCacheGetCollectionItem(store->cache, cacheKey, &currentItem);
 
@@ -563,8 +720,8 @@ upsertMemory(
     success = LDBooleanTrue;
 
     cleanup:
-    LDFree(allCacheKey);
-    LDFree(cacheKey);
+    freeCacheKey(allCacheKeyBuffer, allCacheKey);
+    freeCacheKey(cacheKeyBuffer, cacheKey);
     LDi_deleteCacheItem(replacementItem);
 
     return success;
@@ -600,6 +757,53 @@ getExpirationState(const struct PersistentStoreContext *const store, const struc
     }
 }
 
+/**
+ * Claim the refresh of an expired item for the calling thread. Other threads that find the item expired while a
+ * refresh is in progress keep using it, rather than all querying the backend for it at once.
+ * When caching is disabled every access must query the backend, so the claim always succeeds. In refresh-ahead
+ * mode the refresher thread updates expired items, so the claim always fails.
+ * Expects a cache lock to be held.
+ * @param[in] store Store containing the timeout information.
+ * @param[in] item The expired item.
+ * @return True if the caller should refresh the item.
+ */
+static LDBoolean
+claimRefresh(const struct PersistentStoreContext *const store, struct LDCacheItem *const item)
+{
+    LD_ASSERT(store);
+    LD_ASSERT(item);
+
+    if (store->cacheMilliseconds == 0) {
+        return LDBooleanTrue;
+    }
+
+    if (store->refreshAhead) {
+        return LDBooleanFalse;
+    }
+
+    return LDi_atomic_increment(&item->refreshing) == 1;
+}
+
+/* Allows another refresh of an item after a failed one. A successful refresh replaces the item instead. */
+static void
+releaseRefresh(struct PersistentStoreContext *const store, const char *const cacheKey)
+{
+    struct LDCacheItem *item;
+
+    LD_ASSERT(store);
+    LD_ASSERT(cacheKey);
+
+    LDi_rwlock_wrlock(&store->cache->lock);
+
+    LDi_memoryCacheGetCollectionItem(store->cache, cacheKey, &item);
+
+    if (item) {
+        item->refreshing = 0;
+    }
+
+    LDi_rwlock_wrunlock(&store->cache->lock);
+}
+
 static LDBoolean
 getSingleItemFromBackend(
         struct PersistentStoreContext *const   store,
@@ -662,7 +866,7 @@ getSingleItemFromBackend(
         } else {
             /* Using an RC here, then adding that RC to the cache, prevents us from needing to duplicate
              * the cJSON value. */
-            deserializedRef = LDJSONRCNew(deserialized);
+            deserializedRef = LDi_newCompiledRC(kind, deserialized);
             LD_ASSERT(deserializedRef);
 
             *result = deserializedRef;
@@ -702,9 +906,10 @@ getAllItemsFromBackend(
 {
     LDBoolean                     success;
     struct LDStoreCollectionItem *collectionItemsFromStore;
-    unsigned int itemCount, i;
-    struct LDJSON *rawItems;
+    unsigned int itemCount, i, rcCount;
+    struct LDJSONRC **itemRCs;
     struct LDJSONRC *itemsRC;
+    char allCacheKeyBuffer[LD_CACHE_KEY_BUFFER_SIZE];
     char *allCacheKey;
     struct LDCacheItem *allCacheItem;
 
@@ -716,7 +921,8 @@ getAllItemsFromBackend(
     collectionItemsFromStore = NULL;
     itemCount = 0;
     i = 0;
-    rawItems = NULL;
+    rcCount = 0;
+    itemRCs = NULL;
     itemsRC = NULL;
     allCacheKey = NULL;
     allCacheItem = NULL;
@@ -729,12 +935,14 @@ getAllItemsFromBackend(
         goto cleanup;
     }
 
-    rawItems = LDNewObject();
-    LD_ASSERT(rawItems);
+    if (itemCount) {
+        itemRCs = (struct LDJSONRC **) LDAlloc(sizeof(struct LDJSONRC *) * itemCount);
+        LD_ASSERT(itemRCs);
+    }
 
     for (i = 0; i < itemCount; i++) {
-        const char *   key;
         struct LDJSON *deserialized;
+        struct LDJSONRC *itemRC;
 
         deserialized = NULL;
 
@@ -760,37 +968,45 @@ getAllItemsFromBackend(
             continue;
         }
 
-        key = LDGetText(LDObjectLookup(deserialized, "key"));
-        LD_ASSERT(key);
-
-        if (!LDObjectSetKey(rawItems, key, deserialized)) {
+        if (!(itemRC = LDi_newCompiledRC(kind, deserialized))) {
             goto cleanup;
         }
+
+        itemRCs[rcCount++] = itemRC;
     }
 
     LDi_rwlock_wrlock(&store->cache->lock);
 
-    allCacheKey = featureStoreAllCacheKey(featureKindToString(kind));
-    LD_ASSERT(allCacheKey);
+    allCacheKey = featureStoreAllCacheKey(allCacheKeyBuffer, featureKindToString(kind));
 
-    itemsRC = LDJSONRCNew(rawItems);
+    itemsRC = makeAllItemsRC(itemRCs, rcCount);
     LD_ASSERT(itemsRC);
 
     /* Insert the existing RC item into the cache. Allowing it to both be returned, and populate the cache. */
     allCacheItem = LDi_makeCacheItemFromRc(allCacheKey, itemsRC);
     LD_ASSERT(allCacheItem);
 
+    /* Replace the expired collection, if any. */
+    LDi_findAndRemoveCacheItem(store->cache, allCacheKey);
     LDi_addToCache(store->cache, allCacheItem);
 
     LDi_rwlock_wrunlock(&store->cache->lock);
 
-    rawItems = NULL;
+    itemRCs = NULL;
+    rcCount = 0;
     *result = itemsRC;
     success = LDBooleanTrue;
 
     cleanup:
-    LDFree(rawItems);
-    LDFree(allCacheKey);
+    for (i = 0; i < rcCount; i++) {
+        LDJSONRCRelease(itemRCs[i]);
+    }
+
+    LDFree(itemRCs);
+
+    if (allCacheKey) {
+        freeCacheKey(allCacheKeyBuffer, allCacheKey);
+    }
 
     for (i = 0; i < itemCount; i++) {
         LDFree(collectionItemsFromStore[i].buffer);
@@ -894,3 +1110,299 @@ memoryDestructor(struct LDMemoryContext *const context)
 
     LDFree(context);
 }
+
+/* region Refresh-ahead */
+
+/* Returns true if the cache key is for an item of the kind, rather than a collection. */
+static LDBoolean
+isItemCacheKey(const char *const cacheKey, const char *const kind)
+{
+    const size_t kindLength = strlen(kind);
+
+    return strncmp(cacheKey, kind, kindLength) == 0 && cacheKey[kindLength] == ':';
+}
+
+/* Returns true if any cached item or collection of the kind is at least halfway to expiry. Kinds that have
+ * nothing cached are left to be loaded on access. Expects a cache lock to be held. */
+static LDBoolean
+kindNeedsRefresh(const struct PersistentStoreContext *const store, const char *const kind, const double now)
+{
+    struct LDCacheItem *item, *itemTmp;
+    char allCacheKeyBuffer[LD_CACHE_KEY_BUFFER_SIZE];
+    char *allCacheKey;
+    LDBoolean needsRefresh;
+
+    needsRefresh = LDBooleanFalse;
+    allCacheKey = featureStoreAllCacheKey(allCacheKeyBuffer, kind);
+
+    HASH_ITER(hh, store->cache->items, item, itemTmp) {
+        if ((isItemCacheKey(item->key, kind) || strcmp(item->key, allCacheKey) == 0) &&
+            now - item->updatedOn >= store->cacheMilliseconds / 2.0)
+        {
+            needsRefresh = LDBooleanTrue;
+
+            break;
+        }
+    }
+
+    freeCacheKey(allCacheKeyBuffer, allCacheKey);
+
+    return needsRefresh;
+}
+
+/* Replaces the value of a cache item in place, taking ownership of one reference to the value. */
+static void
+refreshCacheItem(struct LDCacheItem *const item, struct LDJSONRC *const value, const double now)
+{
+    LDJSONRCRelease(item->feature);
+
+    item->feature    = value;
+    item->updatedOn  = now;
+    item->refreshing = 0;
+}
+
+/* Updates the cache from every item of a kind read from the backend, taking ownership of the array and of one
+ * reference to each item. Cached items that are newer than the backend's, because they were upserted after it was
+ * read, are kept. Cached items the backend no longer has, and that were cached before refreshStart, are replaced
+ * by deleted placeholders. Expects the cache write lock to be held. */
+static void
+applyRefresh(
+        struct PersistentStoreContext *const store,
+        const char *const kind,
+        struct LDJSONRC **const itemRCs,
+        const unsigned int itemCount,
+        const double refreshStart)
+{
+    struct LDCacheItem *item, *itemTmp;
+    struct LDJSONRC *allRC;
+    char allCacheKeyBuffer[LD_CACHE_KEY_BUFFER_SIZE];
+    char *allCacheKey;
+    unsigned int i;
+    double now;
+
+    LD_ASSERT(store);
+    LD_ASSERT(kind);
+    LD_ASSERT(itemRCs || itemCount == 0);
+
+    if (!LDi_getMonotonicMilliseconds(&now)) {
+        now = refreshStart;
+    }
+
+    for (i = 0; i < itemCount; i++) {
+        struct LDJSON *const refreshed = LDJSONRCGet(itemRCs[i]);
+        char cacheKeyBuffer[LD_CACHE_KEY_BUFFER_SIZE];
+        char *cacheKey;
+
+        cacheKey = featureStoreCacheKey(cacheKeyBuffer, kind, LDi_getDataKey(refreshed));
+
+        LDi_memoryCacheGetCollectionItem(store->cache, cacheKey, &item);
+
+        if (!item) {
+            item = LDi_makeCacheItemFromRc(cacheKey, itemRCs[i]);
+            LD_ASSERT(item);
+
+            LDi_addToCache(store->cache, item);
+        } else if (LDi_getDataVersion(LDJSONRCGet(item->feature)) >= LDi_getDataVersion(refreshed)) {
+            /* The "all" collection below should refer to the cached item. */
+            LDJSONRCRelease(itemRCs[i]);
+
+            itemRCs[i] = item->feature;
+            LDJSONRCRetain(itemRCs[i]);
+
+            item->updatedOn  = now;
+            item->refreshing = 0;
+        } else {
+            LDJSONRCRetain(itemRCs[i]);
+
+            refreshCacheItem(item, itemRCs[i], now);
+        }
+
+        freeCacheKey(cacheKeyBuffer, cacheKey);
+    }
+
+    HASH_ITER(hh, store->cache->items, item, itemTmp) {
+        struct LDJSON *current;
+
+        if (!isItemCacheKey(item->key, kind) || item->updatedOn >= refreshStart) {
+            continue;
+        }
+
+        current = LDJSONRCGet(item->feature);
+
+        if (LDi_isDataDeleted(current)) {
+            item->updatedOn  = now;
+            item->refreshing = 0;
+        } else {
+            struct LDJSONRC *placeholderRC;
+
+            placeholderRC = LDJSONRCNew(LDi_makeDeletedData(LDi_getDataKey(current), LDi_getDataVersion(current)));
+            LD_ASSERT(placeholderRC);
+
+            refreshCacheItem(item, placeholderRC, now);
+        }
+    }
+
+    allRC = makeAllItemsRC(itemRCs, itemCount);
+    LD_ASSERT(allRC);
+
+    allCacheKey = featureStoreAllCacheKey(allCacheKeyBuffer, kind);
+
+    LDi_memoryCacheGetCollectionItem(store->cache, allCacheKey, &item);
+
+    if (item) {
+        refreshCacheItem(item, allRC, now);
+    } else {
+        item = LDi_makeCacheItemFromRc(allCacheKey, allRC);
+        LD_ASSERT(item);
+
+        LDi_addToCache(store->cache, item);
+
+        LDJSONRCRelease(allRC);
+    }
+
+    freeCacheKey(allCacheKeyBuffer, allCacheKey);
+}
+
+/* Refreshes every cached item of a kind, and its "all" collection, with a single read of the backend. */
+static void
+refreshKind(struct PersistentStoreContext *const store, const enum FeatureKind kind)
+{
+    struct LDStoreCollectionItem *collectionItems;
+    struct LDJSONRC **itemRCs;
+    unsigned int itemCount, rcCount, generation, i;
+    const char *kindString;
+    double refreshStart;
+    LDBoolean needsRefresh;
+
+    LD_ASSERT(store);
+
+    collectionItems = NULL;
+    itemRCs = NULL;
+    itemCount = 0;
+    rcCount = 0;
+    kindString = featureKindToString(kind);
+
+    if (!LDi_getMonotonicMilliseconds(&refreshStart)) {
+        return;
+    }
+
+    LDi_rwlock_rdlock(&store->cache->lock);
+    needsRefresh = kindNeedsRefresh(store, kindString, refreshStart);
+    generation = store->generation;
+    LDi_rwlock_rdunlock(&store->cache->lock);
+
+    if (!needsRefresh) {
+        return;
+    }
+
+    if (!store->persistentStore->all(
+            store->persistentStore->context, kindString, &collectionItems, &itemCount))
+    {
+        LD_LOG(LD_LOG_WARNING, "refreshKind failed to read the backend, serving cached items");
+
+        return;
+    }
+
+    if (itemCount) {
+        itemRCs = (struct LDJSONRC **) LDAlloc(sizeof(struct LDJSONRC *) * itemCount);
+        LD_ASSERT(itemRCs);
+    }
+
+    for (i = 0; i < itemCount; i++) {
+        struct LDJSON *deserialized;
+
+        if (!collectionItems[i].buffer) {
+            continue;
+        }
+
+        /* A partial refresh would treat the remaining items as deleted. */
+        if (!(deserialized = LDJSONDeserialize(collectionItems[i].buffer))) {
+            LD_LOG(LD_LOG_ERROR, "refreshKind failed to deserialize JSON");
+
+            goto cleanup;
+        }
+
+        if (!LDi_validateData(deserialized)) {
+            LD_LOG(LD_LOG_ERROR, "refreshKind invalid feature from backend");
+
+            LDJSONFree(deserialized);
+
+            goto cleanup;
+        }
+
+        if (LDi_isDataDeleted(deserialized)) {
+            itemRCs[rcCount] = LDJSONRCNew(deserialized);
+        } else {
+            itemRCs[rcCount] = LDi_newCompiledRC(kind, deserialized);
+        }
+        LD_ASSERT(itemRCs[rcCount]);
+
+        rcCount++;
+    }
+
+    LDi_rwlock_wrlock(&store->cache->lock);
+
+    if (store->generation == generation) {
+        applyRefresh(store, kindString, itemRCs, rcCount, refreshStart);
+
+        itemRCs = NULL;
+        rcCount = 0;
+    }
+
+    LDi_rwlock_wrunlock(&store->cache->lock);
+
+    cleanup:
+    for (i = 0; i < rcCount; i++) {
+        LDJSONRCRelease(itemRCs[i]);
+    }
+
+    LDFree(itemRCs);
+
+    for (i = 0; i < itemCount; i++) {
+        LDFree(collectionItems[i].buffer);
+    }
+
+    LDFree(collectionItems);
+}
+
+/* Wakes four times per cache TTL, and refreshes each kind that has cached entries at least halfway to expiry.
+ * Steady state evaluations are then always served from the cache. */
+static THREAD_RETURN
+refresherThread(void *const contextRaw)
+{
+    struct PersistentStoreContext *store;
+    int interval;
+
+    LD_ASSERT(contextRaw);
+
+    store = PS_CONTEXT(contextRaw);
+
+    interval = store->cacheMilliseconds / 4;
+
+    if (interval == 0) {
+        interval = 1;
+    }
+
+    LDi_mutex_lock(&store->refresherLock);
+
+    while (!store->refresherStop) {
+        LDi_cond_wait(&store->refresherAwake, &store->refresherLock, interval);
+
+        if (store->refresherStop) {
+            break;
+        }
+
+        LDi_mutex_unlock(&store->refresherLock);
+
+        refreshKind(store, LD_SEGMENT);
+        refreshKind(store, LD_FLAG);
+
+        LDi_mutex_lock(&store->refresherLock);
+    }
+
+    LDi_mutex_unlock(&store->refresherLock);
+
+    return THREAD_RETURN_DEFAULT;
+}
+
+/* endregion */
@@ -6,7 +6,11 @@
  * The caching store wrapper provides an implementation of LDStoreInterface that provides caching.
  * It is constructed with a reference to a non-caching persistent store implementation such as the redis
  * store integration.
+ *
+ * In refresh-ahead mode a background thread refreshes cached items before they expire, and expired items continue
+ * to be served until they are refreshed.
  */
 
 struct LDInternalStoreInterface *
-LDStoreCachingWrapperNew(struct LDStoreInterface *persistentStore, unsigned int cacheMilliseconds);
+LDStoreCachingWrapperNew(
+        struct LDStoreInterface *persistentStore, unsigned int cacheMilliseconds, LDBoolean refreshAhead);
@@ -63,6 +63,24 @@ struct LDInternalStoreInterface {
             const char *const key,
             struct LDJSONRC **const result);
 
+    /**
+     * @brief Get several items of the same kind at once. Optional, when `NULL`
+     * the items are fetched with `get` one at a time.
+     * @param[in] context
+     * @param[in] kind The kind (features/segments) to get.
+     * @param[in] keys The keys to return values for.
+     * @param[in] count The number of keys.
+     * @param[out] results Returns an item, or NULL if it does not exist, for
+     * each key. Populated even on failure.
+     * @return LDBooleanTrue if the operation was a success.
+     */
+    LDBoolean (*getMany)(
+            void *const context,
+            enum FeatureKind kind,
+            const char *const *const keys,
+            const unsigned int count,
+            struct LDJSONRC **const results);
+
     /**
      * @brief Get all items of a specific kind.
      * @param[in] context
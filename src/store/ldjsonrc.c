@@ -6,16 +6,18 @@
 struct LDJSONRC
 {
     struct LDJSON *value;
-    ld_mutex_t lock;
-    unsigned int count;
+    ld_atomic_t count;
 
     /* An RC item may contain references to other  RC items.
      * When it does, then those are tracked as associated items. */
     struct LDJSONRC **associated;
     unsigned int associatedCount;
+
+    /* Optional value derived from the JSON, which borrows from it. */
+    void *compiled;
+    void (*compiledDestructor)(void *);
 };
 
-static void LDJSONRCRetainAssociated(struct LDJSONRC *const rc);
 static void LDJSONRCReleaseAssociated(struct LDJSONRC *const rc);
 
 struct LDJSONRC *
@@ -33,18 +35,18 @@ LDJSONRCNew(struct LDJSON *const json)
     result->value = json;
     result->associated = NULL;
     result->associatedCount = 0;
+    result->compiled = NULL;
+    result->compiledDestructor = NULL;
     result->count = 1;
 
-    LDi_mutex_init(&result->lock);
-
     return result;
 }
 
 void
 LDJSONRCAssociate(struct LDJSONRC *const rc, struct LDJSONRC **const associates, unsigned int associateCount) {
-    LD_ASSERT(rc);
+    unsigned int associatedIndex = 0;
 
-    LDi_mutex_lock(&rc->lock);
+    LD_ASSERT(rc);
 
     /* Remove any existing associations. Decrease reference counts to those associations. */
     if(rc->associated) {
@@ -58,10 +60,11 @@ LDJSONRCAssociate(struct LDJSONRC *const rc, struct LDJSONRC **const associates,
     rc->associated = associates;
     rc->associatedCount = associateCount;
 
-    /* For the duration of the association, all the items have an additional reference. */
-    LDJSONRCRetainAssociated(rc);
-
-    LDi_mutex_unlock(&rc->lock);
+    /* For the duration of the association, all the items have an additional reference. It is released when the
+     * parent is destroyed, so retaining and releasing the parent does not need to touch the associated items. */
+    for(associatedIndex = 0; associatedIndex < associateCount; ++associatedIndex) {
+        LDJSONRCRetain(associates[associatedIndex]);
+    }
 }
 
 void
@@ -69,21 +72,19 @@ LDJSONRCRetain(struct LDJSONRC *const rc)
 {
     LD_ASSERT(rc);
 
-    LDi_mutex_lock(&rc->lock);
-    rc->count++;
-
-    LDJSONRCRetainAssociated(rc);
-
-    LDi_mutex_unlock(&rc->lock);
+    LDi_atomic_increment(&rc->count);
 }
 
 static void
 destroyJSONRC(struct LDJSONRC *const rc)
 {
     if (rc) {
+        if (rc->compiled) {
+            rc->compiledDestructor(rc->compiled);
+        }
         LDJSONFree(rc->value);
-        LDi_mutex_destroy(&rc->lock);
         if(rc->associated) {
+            LDJSONRCReleaseAssociated(rc);
             LDFree(rc->associated);
         }
         LDFree(rc);
@@ -94,18 +95,10 @@ void
 LDJSONRCRelease(struct LDJSONRC *const rc)
 {
     if (rc) {
-        LDi_mutex_lock(&rc->lock);
-        LD_ASSERT(rc->count > 0);
-        rc->count--;
-
-        LDJSONRCReleaseAssociated(rc);
-
-        if (rc->count == 0) {
-            LDi_mutex_unlock(&rc->lock);
+        LD_ASSERT(LDi_atomic_load(&rc->count) > 0);
 
+        if (LDi_atomic_decrement(&rc->count) == 0) {
             destroyJSONRC(rc);
-        } else {
-            LDi_mutex_unlock(&rc->lock);
         }
     }
 }
@@ -118,27 +111,46 @@ LDJSONRCGet(struct LDJSONRC *const rc)
     return rc->value;
 }
 
-/**
- * Increment associated reference counters.
- * Parent RC should be locked when calling this method.
- * @param rc
- */
-static void
-LDJSONRCRetainAssociated(struct LDJSONRC *const rc) {
-    unsigned int associatedIndex = 0;
-    struct LDJSONRC *associatedItem = NULL;
+unsigned int
+LDJSONRCGetAssociatedCount(const struct LDJSONRC *const rc)
+{
+    LD_ASSERT(rc);
 
-    if(rc->associated) {
-        for(associatedIndex = 0; associatedIndex < rc->associatedCount; ++associatedIndex) {
-            associatedItem = rc->associated[associatedIndex];
-            LDJSONRCRetain(associatedItem);
-        }
-    }
+    return rc->associatedCount;
+}
+
+struct LDJSONRC *
+LDJSONRCGetAssociated(const struct LDJSONRC *const rc, const unsigned int index)
+{
+    LD_ASSERT(rc);
+    LD_ASSERT(index < rc->associatedCount);
+
+    return rc->associated[index];
+}
+
+void
+LDJSONRCSetCompiled(struct LDJSONRC *const rc, void *const compiled, void (*destructor)(void *))
+{
+    LD_ASSERT(rc);
+    LD_ASSERT(compiled);
+    LD_ASSERT(destructor);
+    LD_ASSERT(rc->compiled == NULL);
+
+    rc->compiled = compiled;
+    rc->compiledDestructor = destructor;
+}
+
+void *
+LDJSONRCGetCompiled(const struct LDJSONRC *const rc)
+{
+    LD_ASSERT(rc);
+
+    return rc->compiled;
 }
 
 /**
  * Decrement associated reference counters.
- * Parent RC should be locked when calling this method.
+ * Parent RC must not be shared with other threads when calling this method.
  * @param rc
  */
 static void
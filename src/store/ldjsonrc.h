@@ -6,6 +6,7 @@
  * Structure and associated methods for implementing a reference counting system.
  * When an RC item is created it has 1 reference. References are added by retaining
  * and removed by retaining. When the count hits 0 the items resources are released.
+ * Retaining and releasing are lock free, and safe to call from any thread.
  */
 struct LDJSONRC;
 
@@ -42,8 +43,9 @@ LDJSONRCGet(struct LDJSONRC *const rc);
 
 /**
  * Associate a series of LDJSONRC items with the given LDJSONRC item.
- * The LDJSONRC item will release/retain the associated items with the primary items.
- * The associated items may have additional references being retained.
+ * Each associated item is retained once, and released when the given LDJSONRC item is destroyed.
+ * This must be done before the LDJSONRC is shared with other threads.
+ * Takes ownership of the associates array.
  * @param rc The LDJSONRC to associate the items with.
  * @param associates The LDJSONRC items to associate.
  * @param associateCount The count of items.
@@ -51,3 +53,39 @@ LDJSONRCGet(struct LDJSONRC *const rc);
 void
 LDJSONRCAssociate(struct LDJSONRC *const rc, struct LDJSONRC **const associates, unsigned int associateCount);
 
+
+/**
+ * Get the number of items associated with the given LDJSONRC.
+ * @param rc
+ * @return The count of associated items.
+ */
+unsigned int
+LDJSONRCGetAssociatedCount(const struct LDJSONRC *const rc);
+
+/**
+ * Get an associated item. The returned item is only valid as long as a reference to the parent is held.
+ * @param rc The parent LDJSONRC.
+ * @param index An index less than the count returned by LDJSONRCGetAssociatedCount.
+ * @return The associated LDJSONRC.
+ */
+struct LDJSONRC *
+LDJSONRCGetAssociated(const struct LDJSONRC *const rc, const unsigned int index);
+
+/**
+ * Attach a derived representation of the JSON, such as a compiled flag. The derived value is destroyed,
+ * using the provided destructor, before the JSON it was derived from.
+ * This must be done before the LDJSONRC is shared with other threads, the derived value is immutable afterwards.
+ * @param rc The LDJSONRC to attach the value to.
+ * @param compiled The derived value to take ownership of.
+ * @param destructor Function used to free the derived value.
+ */
+void
+LDJSONRCSetCompiled(struct LDJSONRC *const rc, void *const compiled, void (*destructor)(void *));
+
+/**
+ * Get the derived representation attached with LDJSONRCSetCompiled.
+ * @param rc
+ * @return The derived value, or NULL if there is none.
+ */
+void *
+LDJSONRCGetCompiled(const struct LDJSONRC *const rc);
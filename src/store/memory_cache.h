@@ -13,6 +13,8 @@ struct LDCacheItem
     UT_hash_handle hh;
     /* monotonic milliseconds */
     double updatedOn;
+    /* non-zero once a thread has claimed the refresh of the expired item */
+    ld_atomic_t refreshing;
 };
 
 struct LDMemoryContext
@@ -7,10 +7,12 @@
 #include "launchdarkly/store.h"
 
 #include "assertion.h"
+#include "compiled.h"
 #include "concurrency.h"
 #include "internal_store.h"
 #include "memory_store.h"
 #include "store_utilities.h"
+#include "utility.h"
 #include "json_internal_helpers.h"
 
 #define MS_CONTEXT(ptr) (struct MemoryStoreContext *) ptr;
@@ -24,13 +26,25 @@ struct LDMemoryItem
     UT_hash_handle hh;
 };
 
-struct MemoryStoreContext {
+/* A version of the store. Once published it is never modified, so readers use it without a lock. A writer builds
+ * the next version off to the side, copying the table it changes and sharing the other. */
+struct LDMemorySnapshot {
     LDBoolean initialized;
     /* ut hash table */
     struct LDMemoryItem *features;
     /* ut hash table */
     struct LDMemoryItem *segments;
-    ld_rwlock_t lock;
+};
+
+struct MemoryStoreContext {
+    /* The published snapshot, replaced with an atomic exchange. */
+    struct LDMemorySnapshot *snapshot;
+    /* Readers register in the slot of the current epoch while they use the snapshot. A writer advances the epoch
+     * after publishing, then frees the previous snapshot once the slot of the previous epoch drains. */
+    ld_atomic_t epoch;
+    ld_atomic_t readers[2];
+    /* Serializes writers. Readers never take it. */
+    ld_mutex_t writeLock;
 };
 
 /* endregion */
@@ -50,49 +64,41 @@ static void clearItems(struct LDMemoryItem *items) {
     }
 }
 
+/* For an item which is not in a table. */
 static void
-removeAndDeleteItem(struct MemoryStoreContext* msCtx, enum FeatureKind kind, struct LDMemoryItem* item) {
-    LD_ASSERT(msCtx);
+freeMemoryItem(struct LDMemoryItem *const item) {
     LD_ASSERT(item);
 
-    switch(kind) {
-        case LD_FLAG:
-            if(msCtx->features) {
-                /* HASH_DEL Must be called with the direct pointer of the items.
-                 * It must be able to re-assign the pointer. */
-                HASH_DEL(msCtx->features, item);
-            }
-            break;
-        case LD_SEGMENT:
-            if(msCtx->segments) {
-                HASH_DEL(msCtx->segments, item);
-            }
-            break;
-        default:
-            break;
-    }
-
     LDFree(item->key);
     LDJSONRCRelease(item->value);
     LDFree(item);
 }
 
 static void
-clearStore(struct MemoryStoreContext *const context) {
-    LD_ASSERT(context);
+freeSnapshot(struct LDMemorySnapshot *const snapshot) {
+    LD_ASSERT(snapshot);
 
-    if(context->features != NULL) {
-        clearItems(context->features);
-    }
-    if(context->segments != NULL) {
-        clearItems(context->segments);
-    }
+    clearItems(snapshot->features);
+    clearItems(snapshot->segments);
 
-    context->features = NULL;
-    context->segments = NULL;
+    LDFree(snapshot);
 }
 
-static struct LDMemoryItem* makeMemoryItem(const char *const key, struct LDJSON *value) {
+static struct LDMemoryItem **
+tableForKind(struct LDMemorySnapshot *const snapshot, const enum FeatureKind kind) {
+    LD_ASSERT(snapshot);
+
+    switch(kind) {
+        case LD_FLAG:
+            return &snapshot->features;
+        case LD_SEGMENT:
+            return &snapshot->segments;
+        default:
+            return NULL;
+    }
+}
+
+static struct LDMemoryItem* makeMemoryItem(enum FeatureKind kind, const char *const key, struct LDJSON *value) {
     char *keyDupe;
     struct LDMemoryItem *item;
     struct LDJSONRC * valueRC;
@@ -107,7 +113,7 @@ static struct LDMemoryItem* makeMemoryItem(const char *const key, struct LDJSON
     LD_ASSERT(keyDupe);
 
     if (value) {
-        valueRC = LDJSONRCNew(value);
+        valueRC = LDi_newCompiledRC(kind, value);
         LD_ASSERT(valueRC);
     }
 
@@ -123,50 +129,126 @@ static struct LDMemoryItem* makeMemoryItem(const char *const key, struct LDJSON
 }
 
 static void
-addToStore(struct MemoryStoreContext* msCtx, enum FeatureKind kind, struct LDMemoryItem *item) {
-    LD_ASSERT(msCtx);
+addToTable(struct LDMemoryItem **const table, struct LDMemoryItem *item) {
+    LD_ASSERT(table);
     LD_ASSERT(item);
 
-    switch(kind) {
-        case LD_FLAG:
-            HASH_ADD_KEYPTR(
-                hh,
-                msCtx->features,
-                item->key,
-                strlen(item->key),
-                item);
-            break;
-        case LD_SEGMENT:
-            HASH_ADD_KEYPTR(
-                hh,
-                msCtx->segments,
-                item->key,
-                strlen(item->key),
-                item);
-            break;
-        default:
+    HASH_ADD_KEYPTR(
+        hh,
+        *table,
+        item->key,
+        strlen(item->key),
+        item);
+}
+
+/* Copies every item of a table except the one named by skipKey. The copies retain the values they share with the
+ * original. On failure nothing is left allocated. */
+static LDBoolean
+copyTable(struct LDMemoryItem *const source, const char *const skipKey, struct LDMemoryItem **const result) {
+    struct LDMemoryItem *item, *itemTmp, *copy;
+
+    LD_ASSERT(skipKey);
+    LD_ASSERT(result);
+
+    *result = NULL;
+
+    HASH_ITER(hh, source, item, itemTmp)
+    {
+        if (strcmp(item->key, skipKey) == 0) {
+            continue;
+        }
+
+        if (!(copy = (struct LDMemoryItem *)LDAlloc(sizeof(struct LDMemoryItem)))) {
+            goto error;
+        }
+
+        memset(copy, 0, sizeof *copy);
+
+        if (!(copy->key = LDStrDup(item->key))) {
+            LDFree(copy);
+
+            goto error;
+        }
+
+        if (item->value) {
+            LDJSONRCRetain(item->value);
+            copy->value = item->value;
+        }
+
+        addToTable(result, copy);
+    }
+
+    return LDBooleanTrue;
+
+error:
+    LD_LOG(LD_LOG_ERROR, "alloc error");
+
+    clearItems(*result);
+    *result = NULL;
+
+    return LDBooleanFalse;
+}
+
+/* Registers the caller as a reader, and returns the published snapshot. It stays valid until readEnd is called with
+ * the same slot. Takes no lock, and never waits for a writer. */
+static struct LDMemorySnapshot *
+readBegin(struct MemoryStoreContext *const msCtx, unsigned int *const slot) {
+    unsigned int epoch;
+
+    LD_ASSERT(msCtx);
+    LD_ASSERT(slot);
+
+    for (;;) {
+        epoch = (unsigned int)LDi_atomic_load(&msCtx->epoch);
+        *slot = epoch & 1;
+
+        LDi_atomic_increment(&msCtx->readers[*slot]);
+
+        /* Pairs with the fence in publish. Either the writer sees this registration, or this sees its epoch. */
+        LDi_atomic_fence();
+
+        if ((unsigned int)LDi_atomic_load(&msCtx->epoch) == epoch) {
             break;
+        }
+
+        /* A writer advanced the epoch, and may already have stopped waiting for this slot. */
+        LDi_atomic_decrement(&msCtx->readers[*slot]);
     }
+
+    return (struct LDMemorySnapshot *)LDi_atomic_load_pointer(&msCtx->snapshot);
 }
 
 static void
-getFromStore(struct MemoryStoreContext* msCtx, enum FeatureKind kind, const char* key, struct LDMemoryItem **result) {
+readEnd(struct MemoryStoreContext *const msCtx, const unsigned int slot) {
     LD_ASSERT(msCtx);
-    LD_ASSERT(result);
-    LD_ASSERT(key);
 
-    *result  = NULL;
+    LDi_atomic_decrement(&msCtx->readers[slot]);
+}
 
-    switch(kind) {
-        case LD_FLAG:
-            HASH_FIND_STR(msCtx->features, key, *result);
-            break;
-        case LD_SEGMENT:
-            HASH_FIND_STR(msCtx->segments, key, *result);
-            break;
-        default:
-            break;
+/* Publishes next, and returns the previous snapshot once no reader can still be using it. The caller must hold
+ * msCtx->writeLock. */
+static struct LDMemorySnapshot *
+publish(struct MemoryStoreContext *const msCtx, struct LDMemorySnapshot *const next) {
+    struct LDMemorySnapshot *previous;
+    unsigned int slot;
+
+    LD_ASSERT(msCtx);
+    LD_ASSERT(next);
+
+    previous = (struct LDMemorySnapshot *)LDi_atomic_exchange_pointer(&msCtx->snapshot, next);
+
+    /* Readers that register in the new epoch load the new snapshot. Only those in the previous epoch's slot can
+     * still hold the previous one. */
+    slot = ((unsigned int)LDi_atomic_add(&msCtx->epoch, 1) - 1) & 1;
+
+    LDi_atomic_fence();
+
+    /* Readers only hold a slot for a lookup, so this is short. */
+    while (LDi_atomic_load(&msCtx->readers[slot]) != 0) {
+        LDi_sleepMilliseconds(0);
     }
+
+    return previous;
 }
 
 /* region LDInternalStoreInterface Implementation */
@@ -177,13 +259,17 @@ storeInit(
         struct LDJSON *const newData) {
     struct LDJSON *dataKindsIter = NULL;
     struct LDJSON *dataKindsNext = NULL;
+    struct LDMemorySnapshot *staging, *previous;
     struct MemoryStoreContext* msCtx = MS_CONTEXT(contextRaw);
     LD_ASSERT(msCtx);
 
-    /* An init can happen on any put, so we need to clear the store if we have one. */
-    LDi_rwlock_wrlock(&msCtx->lock);
+    /* The new snapshot is built without holding any lock, and readers keep using the published one until it is
+     * swapped in. */
+    staging = (struct LDMemorySnapshot *)LDAlloc(sizeof(struct LDMemorySnapshot));
+    LD_ASSERT(staging);
+    memset(staging, 0, sizeof(struct LDMemorySnapshot));
 
-    clearStore(msCtx);
+    staging->initialized = LDBooleanTrue;
 
     /* For each data kind (Features/Segments/??). */
     for(dataKindsIter = LDGetIter(newData); dataKindsIter; dataKindsIter = dataKindsNext) {
@@ -207,23 +293,53 @@ storeInit(
                 itemsNext = LDIterNext(itemsIter);
 
                 newItem = makeMemoryItem(
+                        featureKind,
                         LDi_getDataKey(itemsIter),
                         LDCollectionDetachIter(items,
                                                itemsIter));
 
-                addToStore(msCtx, featureKind, newItem);
+                addToTable(tableForKind(staging, featureKind), newItem);
             }
             LDJSONFree(items);
         }
     }
 
-    msCtx->initialized = LDBooleanTrue;
+    LDi_mutex_lock(&msCtx->writeLock);
+    previous = publish(msCtx, staging);
+    LDi_mutex_unlock(&msCtx->writeLock);
 
-    LDi_rwlock_wrunlock(&msCtx->lock);
+    /* Readers retain any item they return, so those items outlive the previous snapshot. */
+    freeSnapshot(previous);
     LDJSONFree(newData);
     return LDBooleanTrue;
 }
 
+/* The caller must be registered as a reader of the snapshot. */
+static void
+getRetained(
+        struct LDMemorySnapshot *const snapshot,
+        enum FeatureKind kind,
+        const char *const key,
+        struct LDJSONRC **const result)
+{
+    struct LDMemoryItem **table, *item;
+
+    *result  = NULL;
+    item     = NULL;
+
+    if ((table = tableForKind(snapshot, kind))) {
+        HASH_FIND_STR(*table, key, item);
+    }
+
+    if(item) {
+        /* If the item has a value, and it isn't deleted, then provide a result. */
+        if(item->value != NULL && !LDi_isDataDeleted(LDJSONRCGet(item->value))) {
+            LDJSONRCRetain(item->value);
+                *result = item->value;
+        }
+    }
+}
+
 static LDBoolean
 storeGet(
         void *const contextRaw,
@@ -231,27 +347,49 @@ storeGet(
         const char *const key,
         struct LDJSONRC **const result)
 {
-    struct LDMemoryItem *item;
+    struct LDMemorySnapshot *snapshot;
+    unsigned int slot;
     struct MemoryStoreContext* msCtx = MS_CONTEXT(contextRaw);
     LD_ASSERT(msCtx);
     LD_ASSERT(key);
     LD_ASSERT(result);
 
-    *result  = NULL;
+    snapshot = readBegin(msCtx, &slot);
 
-    LDi_rwlock_rdlock(&msCtx->lock);
+    getRetained(snapshot, kind, key, result);
 
-    getFromStore(msCtx, kind, key, &item);
+    readEnd(msCtx, slot);
 
-    if(item) {
-        /* If the item has a value, and it isn't deleted, then provide a result. */
-        if(item->value != NULL && !LDi_isDataDeleted(LDJSONRCGet(item->value))) {
-            LDJSONRCRetain(item->value);
-                *result = item->value;
-        }
+    /* Failure would be that the store was not working, not that we couldn't find the item. The memory store
+     * is always functional, so always return true. */
+    return LDBooleanTrue;
+}
+
+static LDBoolean
+storeGetMany(
+        void *const contextRaw,
+        enum FeatureKind kind,
+        const char *const *const keys,
+        const unsigned int count,
+        struct LDJSONRC **const results)
+{
+    unsigned int i, slot;
+    struct LDMemorySnapshot *snapshot;
+    struct MemoryStoreContext* msCtx = MS_CONTEXT(contextRaw);
+    LD_ASSERT(msCtx);
+    LD_ASSERT(keys);
+    LD_ASSERT(results);
+
+    /* One snapshot for every key, so the items come from a single version of the store. */
+    snapshot = readBegin(msCtx, &slot);
+
+    for (i = 0; i < count; i++) {
+        LD_ASSERT(keys[i]);
+
+        getRetained(snapshot, kind, keys[i], &results[i]);
     }
 
-    LDi_rwlock_rdunlock(&msCtx->lock);
+    readEnd(msCtx, slot);
 
     /* Failure would be that the store was not working, not that we couldn't find the item. The memory store
      * is always functional, so always return true. */
@@ -269,53 +407,38 @@ storeAll(
     * a little extra space is better than having to implement vector behavior. */
     struct LDJSONRC** associatedRcItems = NULL;
     unsigned int associatedCount = 0;
-    struct LDMemoryItem *item, *itemTmp;
+    unsigned int slot;
+    struct LDMemoryItem **table, *item, *itemTmp;
+    struct LDMemorySnapshot *snapshot;
     struct LDJSON* all = LDNewObject();
     struct MemoryStoreContext* msCtx = MS_CONTEXT(contextRaw);
 
     *result = NULL;
 
-    LDi_rwlock_rdlock(&msCtx->lock);
+    snapshot = readBegin(msCtx, &slot);
 
-    switch(kind) {
-        case LD_FLAG: {
-            unsigned int itemCount = HASH_COUNT(msCtx->features);
-            associatedRcItems = (struct LDJSONRC **) LDAlloc(sizeof(struct LDJSONRC *) * itemCount);
-
-            HASH_ITER(hh, msCtx->features, item, itemTmp) {
-                struct LDJSON *value = LDJSONRCGet(item->value);
-                if (!LDi_isDataDeleted(value)) {
-                    LDObjectSetReference(all, item->key, value);
-                    *(associatedRcItems + associatedCount) = item->value;
-                    associatedCount++;
-                }
-            }
-        }
-            break;
-        case LD_SEGMENT: {
-            unsigned int itemCount = HASH_COUNT(msCtx->segments);
-            associatedRcItems = (struct LDJSONRC **) LDAlloc(sizeof(struct LDJSONRC *) * itemCount);
-
-            HASH_ITER(hh, msCtx->segments, item, itemTmp) {
-                struct LDJSON *value = LDJSONRCGet(item->value);
-                if (!LDi_isDataDeleted(value)) {
-                    LDObjectSetReference(all, item->key, value);
-                    *(associatedRcItems + associatedCount) = item->value;
-                    associatedCount++;
-                }
+    if ((table = tableForKind(snapshot, kind))) {
+        unsigned int itemCount = HASH_COUNT(*table);
+        associatedRcItems = (struct LDJSONRC **) LDAlloc(sizeof(struct LDJSONRC *) * itemCount);
+
+        HASH_ITER(hh, *table, item, itemTmp) {
+            struct LDJSON *value = LDJSONRCGet(item->value);
+            if (!LDi_isDataDeleted(value)) {
+                LDObjectSetReference(all, item->key, value);
+                *(associatedRcItems + associatedCount) = item->value;
+                associatedCount++;
             }
         }
-            break;
-        default:
-            break;
     }
 
-    LDi_rwlock_rdunlock(&msCtx->lock);
     *result = LDJSONRCNew(all);
     /* The result from this method will have a set of associated items which are incremented/decremented with the
-     * parent item. This allows for a reference counted shallow collection of flags/segments. */
+     * parent item. This allows for a reference counted shallow collection of flags/segments. They are retained
+     * before the snapshot is released, as a writer may free it straight after. */
     LDJSONRCAssociate(*result, associatedRcItems, associatedCount);
 
+    readEnd(msCtx, slot);
+
     /* Failure would be that the store was not working, not that we couldn't find the item. The memory store
      * is always functional, so always return true. */
     return LDBooleanTrue;
@@ -328,7 +451,9 @@ storeUpsert(
         const char *const key,
         struct LDJSON *const item)
 {
-    struct LDMemoryItem *existing;
+    struct LDMemoryItem *existing, *newItem, *replaced, **currentTable;
+    struct LDMemorySnapshot *current, *next, *previous;
+    unsigned int itemVersion;
     struct MemoryStoreContext* msCtx = MS_CONTEXT(contextRaw);
 
     LD_ASSERT(msCtx);
@@ -343,40 +468,82 @@ storeUpsert(
         return LDBooleanFalse;
     }
 
-    LDi_rwlock_wrlock(&msCtx->lock);
+    itemVersion = LDi_getDataVersion(item);
+    existing    = NULL;
+    next        = NULL;
 
-    getFromStore(msCtx, kind, key, &existing);
+    /* Compiling can be slow, for regexes or large segments, so it happens before any lock is taken, as in
+     * storeInit. */
+    newItem = makeMemoryItem(kind, LDi_getDataKey(item), item);
 
-    if(existing) {
-        if(existing->value) {
-            unsigned int itemVersion = LDi_getDataVersion(item);
-            unsigned int existingVersion = LDi_getDataVersion(LDJSONRCGet(existing->value));
-            if (existingVersion >= itemVersion) {
-                /* The store contains the same or newer version, so no work needs to be done. */
-                LDJSONFree(item);
+    /* Only writers take the lock, so the published snapshot is current for as long as it is held. */
+    LDi_mutex_lock(&msCtx->writeLock);
 
-                LDi_rwlock_wrunlock(&msCtx->lock);
-                return LDBooleanTrue;
-            }
+    current      = msCtx->snapshot;
+    currentTable = tableForKind(current, kind);
+    LD_ASSERT(currentTable);
+
+    HASH_FIND_STR(*currentTable, key, existing);
+
+    if(existing && existing->value) {
+        unsigned int existingVersion = LDi_getDataVersion(LDJSONRCGet(existing->value));
+        if (existingVersion >= itemVersion) {
+            /* The store contains the same or newer version, so no work needs to be done. */
+            LDi_mutex_unlock(&msCtx->writeLock);
+
+            freeMemoryItem(newItem);
+
+            return LDBooleanTrue;
         }
-        removeAndDeleteItem(msCtx, kind, existing);
     }
-    addToStore(msCtx, kind, makeMemoryItem(LDi_getDataKey(item), item));
-    LDi_rwlock_wrunlock(&msCtx->lock);
+
+    /* Copy on write. The table of the other kind is shared with the next snapshot. */
+    if (!(next = (struct LDMemorySnapshot *)LDAlloc(sizeof(struct LDMemorySnapshot)))) {
+        LD_LOG(LD_LOG_ERROR, "alloc error");
+
+        goto error;
+    }
+
+    *next = *current;
+
+    if (!copyTable(*currentTable, key, tableForKind(next, kind))) {
+        goto error;
+    }
+
+    addToTable(tableForKind(next, kind), newItem);
+
+    previous = publish(msCtx, next);
+
+    LDi_mutex_unlock(&msCtx->writeLock);
+
+    /* Only the copied table belongs to the previous snapshot alone. Readers retain any item they return, so it
+     * can be released outside the lock. */
+    replaced = *tableForKind(previous, kind);
+    LDFree(previous);
+    clearItems(replaced);
+
     return LDBooleanTrue;
+
+error:
+    LDi_mutex_unlock(&msCtx->writeLock);
+
+    LDFree(next);
+    freeMemoryItem(newItem);
+
+    return LDBooleanFalse;
 }
 
 static LDBoolean
 storeInitialized(void *const contextRaw)
 {
     LDBoolean initialized;
+    unsigned int slot;
 
     struct MemoryStoreContext* msCtx = MS_CONTEXT(contextRaw);
     LD_ASSERT(msCtx);
 
-    LDi_rwlock_wrlock(&msCtx->lock);
-    initialized = msCtx->initialized;
-    LDi_rwlock_wrunlock(&msCtx->lock);
+    initialized = readBegin(msCtx, &slot)->initialized;
+    readEnd(msCtx, slot);
     return initialized;
 }
 
@@ -387,9 +554,9 @@ storeDestructor(void *const contextRaw)
     if(contextRaw) {
         msCtx = MS_CONTEXT(contextRaw);
 
-        clearStore(msCtx);
+        freeSnapshot(msCtx->snapshot);
 
-        LDi_rwlock_destroy(&msCtx->lock);
+        LDi_mutex_destroy(&msCtx->writeLock);
 
         LDFree(contextRaw);
     }
@@ -409,14 +576,19 @@ LDStoreMemoryNew(void) {
     LD_ASSERT(context);
     memset(context, 0, sizeof(struct MemoryStoreContext));
 
-    context->initialized = LDBooleanFalse;
-    context->features = NULL;
-    context->segments = NULL;
-    LDi_rwlock_init(&context->lock);
+    context->snapshot = LDAlloc(sizeof(struct LDMemorySnapshot));
+    LD_ASSERT(context->snapshot);
+    memset(context->snapshot, 0, sizeof(struct LDMemorySnapshot));
+
+    context->epoch = 0;
+    context->readers[0] = 0;
+    context->readers[1] = 0;
+    LDi_mutex_init(&context->writeLock);
 
     memoryStore->context = context;
     memoryStore->init = storeInit;
     memoryStore->get = storeGet;
+    memoryStore->getMany = storeGetMany;
     memoryStore->all = storeAll;
     memoryStore->upsert = storeUpsert;
     memoryStore->initialized = storeInitialized;
@@ -1,4 +1,5 @@
 
+#include <stdlib.h>
 #include <string.h>
 #include "launchdarkly/api.h"
 
@@ -73,6 +74,113 @@ LDi_getDataVersion(const struct LDJSON *const feature)
     return LDGetNumber(tmp);
 }
 
+static const char *
+skipWhitespace(const char *text)
+{
+    while (*text == ' ' || *text == '\t' || *text == '\n' || *text == '\r') {
+        text++;
+    }
+
+    return text;
+}
+
+/* Finds a plain numeric "version" among the top level fields of an object,
+ * stepping over every other value without parsing it. */
+static LDBoolean
+scanDataVersion(const char *cursor, unsigned int *const version)
+{
+    unsigned int depth;
+    LDBoolean    expectKey;
+
+    cursor = skipWhitespace(cursor);
+
+    if (*cursor != '{') {
+        return LDBooleanFalse;
+    }
+
+    cursor++;
+    depth     = 1;
+    expectKey = LDBooleanTrue;
+
+    while (*cursor) {
+        if (*cursor == '"') {
+            const char *const start = ++cursor;
+
+            for (; *cursor != '"'; cursor++) {
+                if (*cursor == '\0' || (*cursor == '\\' && !*++cursor)) {
+                    return LDBooleanFalse;
+                }
+            }
+
+            cursor++;
+
+            if (depth == 1 && expectKey) {
+                const LDBoolean isVersion = cursor - start - 1 == 7 &&
+                    memcmp(start, "version", 7) == 0;
+
+                cursor = skipWhitespace(cursor);
+
+                if (*cursor != ':') {
+                    return LDBooleanFalse;
+                }
+
+                cursor    = skipWhitespace(cursor + 1);
+                expectKey = LDBooleanFalse;
+
+                if (isVersion) {
+                    /* strtod alone would also accept hex, inf, and nan */
+                    if (*cursor < '0' || *cursor > '9') {
+                        return LDBooleanFalse;
+                    }
+
+                    *version = (unsigned int)strtod(cursor, NULL);
+
+                    return LDBooleanTrue;
+                }
+            }
+        } else {
+            if (*cursor == '{' || *cursor == '[') {
+                depth++;
+            } else if (*cursor == '}' || *cursor == ']') {
+                if (--depth == 0) {
+                    return LDBooleanFalse;
+                }
+            } else if (*cursor == ',' && depth == 1) {
+                expectKey = LDBooleanTrue;
+            }
+
+            cursor++;
+        }
+    }
+
+    return LDBooleanFalse;
+}
+
+LDBoolean
+LDi_getSerializedDataVersion(
+    const char *const serialized, unsigned int *const version)
+{
+    struct LDJSON *feature;
+
+    LD_ASSERT(serialized);
+    LD_ASSERT(version);
+
+    if (scanDataVersion(serialized, version)) {
+        return LDBooleanTrue;
+    }
+
+    /* escaped keys, a missing or non numeric version, or invalid JSON */
+    if (!(feature = LDJSONDeserialize(serialized))) {
+        return LDBooleanFalse;
+    }
+
+    *version = LDi_getDataVersion(feature);
+
+    LDJSONFree(feature);
+
+    return LDBooleanTrue;
+}
+
 LDBoolean
 LDi_validateData(const struct LDJSON *const feature)
 {
@@ -17,6 +17,14 @@ LDi_getDataKey(const struct LDJSON *const feature);
 unsigned int
 LDi_getDataVersion(const struct LDJSON *const feature);
 
+/* Reads the "version" field of a serialized flag or segment as
+ * LDi_getDataVersion would. The top level of the object is scanned in place,
+ * and it is only deserialized if that finds no plain numeric version. Returns
+ * false if the text is not valid JSON. */
+LDBoolean
+LDi_getSerializedDataVersion(
+    const char *const serialized, unsigned int *const version);
+
 /* Verify that the LDJSON object is a valid flag or segment. */
 LDBoolean
 LDi_validateData(const struct LDJSON *const feature);
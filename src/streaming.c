@@ -111,70 +111,53 @@ validatePutBody(const struct LDJSON *const put)
     return LDBooleanTrue;
 }
 
-/* consumes input even on failure */
+/* Receives the data of a put as it arrives, and initializes the store once
+ * it is complete. The partial put is discarded on failure. */
 static LDBoolean
-onPut(struct LDClient *const client, const char *const eventBuffer)
+onPutData(
+    const char *const eventName,
+    const char *const data,
+    const size_t      dataSize,
+    void *const       rawContext)
 {
-    struct LDJSON *data, *features, *put;
-    LDBoolean      success;
-
-    LD_ASSERT(client);
-    LD_ASSERT(eventBuffer);
-
-    data     = NULL;
-    features = NULL;
-    success  = LDBooleanFalse;
-    put      = NULL;
-
-    if (!(put = LDJSONDeserialize(eventBuffer))) {
-        LD_LOG(LD_LOG_ERROR, "sse delete failed to decode event body");
+    struct StreamContext *context;
+    struct LDJSON *       sets;
+    LDBoolean             success;
 
-        goto cleanup;
-    }
+    LD_ASSERT(eventName);
+    LD_ASSERT(rawContext);
 
-    if (LDJSONGetType(put) != LDObject) {
-        LD_LOG(LD_LOG_ERROR, "sse delete body should be object, discarding");
+    context = (struct StreamContext *)rawContext;
+    sets    = NULL;
 
-        goto cleanup;
-    }
+    (void)eventName;
 
-    if (!(data = LDObjectDetachKey(put, "data"))) {
-        LD_LOG(LD_LOG_ERROR, "put.data does not exist");
+    if (!context->putParser && !(context->putParser = LDi_putParserNew())) {
+        LD_LOG(LD_LOG_ERROR, "alloc error");
 
-        goto cleanup;
+        return LDBooleanFalse;
     }
 
-    if (!validatePutBody(data)) {
-        LD_LOG(LD_LOG_ERROR, "put.data failed validation");
+    if (data) {
+        if (!(success = LDi_putParserProcess(context->putParser, data, dataSize))) {
+            goto cleanup;
+        }
 
-        goto cleanup;
+        return LDBooleanTrue;
     }
 
-    features = LDObjectDetachKey(data, "flags");
-    LD_ASSERT(features);
-
-    if (!LDObjectSetKey(data, "features", features)) {
-        LD_LOG(LD_LOG_ERROR, "alloc error");
-
+    if (!(success = LDi_putParserFinish(context->putParser, &sets))) {
         goto cleanup;
     }
-    features = NULL;
 
-    if (!(success = LDStoreInit(client->store, data))) {
+    /* sets consumed even on failure */
+    if (!(success = LDStoreInit(context->client->store, sets))) {
         LD_LOG(LD_LOG_ERROR, "LDStoreInit error");
-
-        data = NULL;
-
-        goto cleanup;
     }
-    data = NULL;
-
-    success = LDBooleanTrue;
 
 cleanup:
-    LDJSONFree(put);
-    LDJSONFree(data);
-    LDJSONFree(features);
+    LDi_putParserFree(context->putParser);
+    context->putParser = NULL;
 
     return success;
 }
@@ -336,9 +319,8 @@ LDi_onEvent(
     status  = LDBooleanTrue;
     context = (struct StreamContext *)rawContext;
 
-    if (strcmp(eventName, "put") == 0) {
-        status = onPut(context->client, eventBuffer);
-    } else if (strcmp(eventName, "patch") == 0) {
+    /* put events are streamed to onPutData instead */
+    if (strcmp(eventName, "patch") == 0) {
         status = onPatch(context->client, eventBuffer);
     } else if (strcmp(eventName, "delete") == 0) {
         status = onDelete(context->client, eventBuffer);
@@ -380,6 +362,9 @@ resetMemory(struct StreamContext *const context)
 
     LDSSEParserDestroy(&context->parser);
 
+    LDi_putParserFree(context->putParser);
+    context->putParser = NULL;
+
     curl_slist_free_all(context->headers);
     context->headers = NULL;
 }
@@ -447,6 +432,38 @@ destroy(void *const rawcontext)
     LDFree(context);
 }
 
+static double
+deadline(struct LDClient *const client, void *const rawcontext)
+{
+    struct StreamContext *context;
+    double                now;
+
+    LD_ASSERT(client);
+    LD_ASSERT(rawcontext);
+
+    context = (struct StreamContext *)rawcontext;
+
+    if (client->config->dataSource || !client->config->stream ||
+        context->permanentFailure)
+    {
+        return LD_NETWORK_MAX_WAIT;
+    }
+
+    LDi_getMonotonicMilliseconds(&now);
+
+    /* the read timeout */
+    if (context->active) {
+        return context->lastReadTimeMilliseconds + (300 * 1000) - now;
+    }
+
+    /* a backoff that poll has already scheduled */
+    if (context->attempts && context->waitUntil) {
+        return context->waitUntil - now;
+    }
+
+    return 0;
+}
+
 static CURL *
 poll(struct LDClient *const client, void *const rawcontext)
 {
@@ -585,6 +602,14 @@ poll(struct LDClient *const client, void *const rawcontext)
         goto error;
     }
 
+    /* an empty string accepts every encoding curl was built to decode */
+    if (curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "") != CURLE_OK) {
+        LD_LOG(
+            LD_LOG_CRITICAL, "curl_easy_setopt CURLOPT_ACCEPT_ENCODING failed");
+
+        goto error;
+    }
+
     context->active = LDBooleanTrue;
     LDi_getMonotonicMilliseconds(&context->lastReadTimeMilliseconds);
 
@@ -612,6 +637,7 @@ LDi_constructStreamContext(
     }
 
     LDSSEParserInitialize(&context->parser, LDi_onEvent, context);
+    LDSSEParserStreamEvent(&context->parser, "put", onPutData);
 
     context->active                   = LDBooleanFalse;
     context->headers                  = NULL;
@@ -623,6 +649,7 @@ LDi_constructStreamContext(
     context->multi                    = multi;
     context->networkInterface         = networkInterface;
     context->lastReadTimeMilliseconds = 0;
+    context->putParser                = NULL;
 
     return context;
 }
@@ -648,11 +675,12 @@ LDi_constructStreaming(struct LDClient *const client, CURLM *const multi)
         goto error;
     }
 
-    netInterface->done    = done;
-    netInterface->poll    = poll;
-    netInterface->context = context;
-    netInterface->destroy = destroy;
-    netInterface->current = NULL;
+    netInterface->done     = done;
+    netInterface->poll     = poll;
+    netInterface->deadline = deadline;
+    netInterface->context  = context;
+    netInterface->destroy  = destroy;
+    netInterface->current  = NULL;
 
     return netInterface;
 
@@ -9,6 +9,7 @@
 #include <curl/curl.h>
 
 #include "network.h"
+#include "put_parser.h"
 #include "sse.h"
 #include "store.h"
 
@@ -30,6 +31,8 @@ struct StreamContext
     LDBoolean permanentFailure;
     /* used to track stream read timeouts */
     double lastReadTimeMilliseconds;
+    /* the put event being received, if any */
+    struct LDPutParser *putParser;
 };
 
 /* Used as a return value for LDi_parsePath.  */
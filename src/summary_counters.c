@@ -0,0 +1,386 @@
+#include <launchdarkly/memory.h>
+#include <string.h>
+
+#include <uthash.h>
+
+#include "assertion.h"
+#include "logging.h"
+#include "summary_counters.h"
+#include "utility.h"
+
+struct LDSummaryCounterKey
+{
+    double       version;
+    unsigned int variation;
+    LDBoolean    hasVersion;
+    LDBoolean    hasVariation;
+};
+
+struct LDSummaryCounter
+{
+    /* zeroed before use, so padding does not affect hashing */
+    struct LDSummaryCounterKey key;
+    unsigned int               count;
+    struct LDJSON *            value;
+    LDBoolean                  unknown;
+    UT_hash_handle             hh;
+};
+
+struct LDSummaryFlag
+{
+    char *                   key;
+    struct LDJSON *          defaultValue;
+    struct LDSummaryCounter *counters;
+    UT_hash_handle           hh;
+};
+
+struct LDSummaryCounters
+{
+    struct LDSummaryFlag *flags;
+};
+
+struct LDSummaryCounters *
+LDi_summaryCountersNew(void)
+{
+    struct LDSummaryCounters *counters;
+
+    if (!(counters = LDAlloc(sizeof(struct LDSummaryCounters)))) {
+        return NULL;
+    }
+
+    counters->flags = NULL;
+
+    return counters;
+}
+
+static void
+flagFree(struct LDSummaryFlag *const flag)
+{
+    struct LDSummaryCounter *counter, *tmp;
+
+    HASH_ITER(hh, flag->counters, counter, tmp)
+    {
+        HASH_DEL(flag->counters, counter);
+
+        LDJSONFree(counter->value);
+        LDFree(counter);
+    }
+
+    LDJSONFree(flag->defaultValue);
+    LDFree(flag->key);
+    LDFree(flag);
+}
+
+void
+LDi_summaryCountersFree(struct LDSummaryCounters *const counters)
+{
+    if (counters) {
+        struct LDSummaryFlag *flag, *tmp;
+
+        HASH_ITER(hh, counters->flags, flag, tmp)
+        {
+            HASH_DEL(counters->flags, flag);
+
+            flagFree(flag);
+        }
+
+        LDFree(counters);
+    }
+}
+
+static struct LDSummaryFlag *
+newFlag(const char *const flagKey, const struct LDJSON *const defaultValue)
+{
+    struct LDSummaryFlag *flag;
+
+    if (!(flag = LDAlloc(sizeof(struct LDSummaryFlag)))) {
+        return NULL;
+    }
+
+    memset(flag, 0, sizeof(struct LDSummaryFlag));
+
+    if (!(flag->key = LDStrDup(flagKey))) {
+        LDFree(flag);
+
+        return NULL;
+    }
+
+    if (LDi_notNull(defaultValue) &&
+        !(flag->defaultValue = LDJSONDuplicate(defaultValue)))
+    {
+        LDFree(flag->key);
+        LDFree(flag);
+
+        return NULL;
+    }
+
+    return flag;
+}
+
+LDBoolean
+LDi_summaryCountersAdd(
+    struct LDSummaryCounters *const counters,
+    const char *const               flagKey,
+    const unsigned int *const       variation,
+    const double *const             version,
+    const struct LDJSON *const      value,
+    const struct LDJSON *const      defaultValue,
+    const LDBoolean                 unknown)
+{
+    struct LDSummaryFlag *     flag;
+    struct LDSummaryCounter *  counter;
+    struct LDSummaryCounterKey key;
+
+    LD_ASSERT(counters);
+    LD_ASSERT(flagKey);
+
+    HASH_FIND_STR(counters->flags, flagKey, flag);
+
+    if (!flag) {
+        if (!(flag = newFlag(flagKey, defaultValue))) {
+            LD_LOG(LD_LOG_ERROR, "alloc error");
+
+            return LDBooleanFalse;
+        }
+
+        HASH_ADD_KEYPTR(hh, counters->flags, flag->key, strlen(flag->key), flag);
+    }
+
+    memset(&key, 0, sizeof(key));
+
+    if (variation) {
+        key.hasVariation = LDBooleanTrue;
+        key.variation    = *variation;
+    }
+
+    if (version) {
+        key.hasVersion = LDBooleanTrue;
+        key.version    = *version;
+    }
+
+    HASH_FIND(hh, flag->counters, &key, sizeof(key), counter);
+
+    if (counter) {
+        counter->count++;
+
+        return LDBooleanTrue;
+    }
+
+    if (!(counter = LDAlloc(sizeof(struct LDSummaryCounter)))) {
+        LD_LOG(LD_LOG_ERROR, "alloc error");
+
+        return LDBooleanFalse;
+    }
+
+    memset(counter, 0, sizeof(struct LDSummaryCounter));
+
+    if (LDi_notNull(value) && !(counter->value = LDJSONDuplicate(value))) {
+        LD_LOG(LD_LOG_ERROR, "alloc error");
+
+        LDFree(counter);
+
+        return LDBooleanFalse;
+    }
+
+    counter->key     = key;
+    counter->count   = 1;
+    counter->unknown = unknown;
+
+    HASH_ADD(hh, flag->counters, key, sizeof(struct LDSummaryCounterKey), counter);
+
+    return LDBooleanTrue;
+}
+
+void
+LDi_summaryCountersMerge(
+    struct LDSummaryCounters *const destination,
+    struct LDSummaryCounters *const source)
+{
+    struct LDSummaryFlag *flag, *flagTmp, *existingFlag;
+
+    LD_ASSERT(destination);
+    LD_ASSERT(source);
+
+    HASH_ITER(hh, source->flags, flag, flagTmp)
+    {
+        HASH_DEL(source->flags, flag);
+
+        HASH_FIND_STR(destination->flags, flag->key, existingFlag);
+
+        if (!existingFlag) {
+            HASH_ADD_KEYPTR(
+                hh, destination->flags, flag->key, strlen(flag->key), flag);
+        } else {
+            struct LDSummaryCounter *counter, *counterTmp, *existing;
+
+            HASH_ITER(hh, flag->counters, counter, counterTmp)
+            {
+                HASH_FIND(
+                    hh,
+                    existingFlag->counters,
+                    &counter->key,
+                    sizeof(struct LDSummaryCounterKey),
+                    existing);
+
+                if (existing) {
+                    existing->count += counter->count;
+                } else {
+                    HASH_DEL(flag->counters, counter);
+
+                    HASH_ADD(
+                        hh,
+                        existingFlag->counters,
+                        key,
+                        sizeof(struct LDSummaryCounterKey),
+                        counter);
+                }
+            }
+
+            flagFree(flag);
+        }
+    }
+}
+
+LDBoolean
+LDi_summaryCountersIsEmpty(const struct LDSummaryCounters *const counters)
+{
+    LD_ASSERT(counters);
+
+    return counters->flags == NULL;
+}
+
+static LDBoolean
+setKeyOrFree(struct LDJSON *const object, const char *const key, struct LDJSON *const value)
+{
+    if (!value) {
+        return LDBooleanFalse;
+    }
+
+    if (!LDObjectSetKey(object, key, value)) {
+        LDJSONFree(value);
+
+        return LDBooleanFalse;
+    }
+
+    return LDBooleanTrue;
+}
+
+static struct LDJSON *
+counterToJSON(const struct LDSummaryCounter *const counter)
+{
+    struct LDJSON *entry;
+
+    if (!(entry = LDNewObject())) {
+        return NULL;
+    }
+
+    if (!setKeyOrFree(entry, "count", LDNewNumber(counter->count))) {
+        goto error;
+    }
+
+    if (counter->value &&
+        !setKeyOrFree(entry, "value", LDJSONDuplicate(counter->value)))
+    {
+        goto error;
+    }
+
+    if (counter->key.hasVersion &&
+        !setKeyOrFree(entry, "version", LDNewNumber(counter->key.version)))
+    {
+        goto error;
+    }
+
+    if (counter->key.hasVariation &&
+        !setKeyOrFree(entry, "variation", LDNewNumber(counter->key.variation)))
+    {
+        goto error;
+    }
+
+    if (counter->unknown &&
+        !setKeyOrFree(entry, "unknown", LDNewBool(LDBooleanTrue)))
+    {
+        goto error;
+    }
+
+    return entry;
+
+error:
+    LDJSONFree(entry);
+
+    return NULL;
+}
+
+static struct LDJSON *
+flagToJSON(const struct LDSummaryFlag *const flag)
+{
+    struct LDJSON *          context, *array;
+    struct LDSummaryCounter *counter, *tmp;
+
+    if (!(context = LDNewObject())) {
+        return NULL;
+    }
+
+    if (flag->defaultValue &&
+        !setKeyOrFree(context, "default", LDJSONDuplicate(flag->defaultValue)))
+    {
+        goto error;
+    }
+
+    if (!(array = LDNewArray())) {
+        goto error;
+    }
+
+    if (!setKeyOrFree(context, "counters", array)) {
+        goto error;
+    }
+
+    HASH_ITER(hh, flag->counters, counter, tmp)
+    {
+        struct LDJSON *entry;
+
+        if (!(entry = counterToJSON(counter))) {
+            goto error;
+        }
+
+        if (!LDArrayPush(array, entry)) {
+            LDJSONFree(entry);
+
+            goto error;
+        }
+    }
+
+    return context;
+
+error:
+    LDJSONFree(context);
+
+    return NULL;
+}
+
+struct LDJSON *
+LDi_summaryCountersToJSON(const struct LDSummaryCounters *const counters)
+{
+    struct LDJSON *       features;
+    struct LDSummaryFlag *flag, *tmp;
+
+    LD_ASSERT(counters);
+
+    if (!(features = LDNewObject())) {
+        LD_LOG(LD_LOG_ERROR, "alloc error");
+
+        return NULL;
+    }
+
+    HASH_ITER(hh, counters->flags, flag, tmp)
+    {
+        if (!setKeyOrFree(features, flag->key, flagToJSON(flag))) {
+            LD_LOG(LD_LOG_ERROR, "alloc error");
+
+            LDJSONFree(features);
+
+            return NULL;
+        }
+    }
+
+    return features;
+}
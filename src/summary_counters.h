@@ -0,0 +1,42 @@
+#pragma once
+
+#include <launchdarkly/boolean.h>
+#include <launchdarkly/json.h>
+
+/* Evaluation counts for summary events, keyed by flag key, and then by
+ * variation and flag version. Counts are kept as integers, and converted to
+ * JSON only when the summary event is produced. Not thread safe. */
+struct LDSummaryCounters;
+
+struct LDSummaryCounters *
+LDi_summaryCountersNew(void);
+
+void
+LDi_summaryCountersFree(struct LDSummaryCounters *const counters);
+
+/* variation and version are NULL when absent. value and defaultValue are
+ * duplicated the first time they are seen for a counter or flag, and are
+ * omitted from the summary when NULL or JSON null. */
+LDBoolean
+LDi_summaryCountersAdd(
+    struct LDSummaryCounters *const counters,
+    const char *const               flagKey,
+    const unsigned int *const       variation,
+    const double *const             version,
+    const struct LDJSON *const      value,
+    const struct LDJSON *const      defaultValue,
+    const LDBoolean                 unknown);
+
+/* Moves every count from source into destination, leaving source empty. */
+void
+LDi_summaryCountersMerge(
+    struct LDSummaryCounters *const destination,
+    struct LDSummaryCounters *const source);
+
+LDBoolean
+LDi_summaryCountersIsEmpty(const struct LDSummaryCounters *const counters);
+
+/* Returns the "features" object of a summary event, or NULL on allocation
+ * failure. Flags and counters appear in the order they were first counted. */
+struct LDJSON *
+LDi_summaryCountersToJSON(const struct LDSummaryCounters *const counters);
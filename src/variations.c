@@ -1,9 +1,13 @@
+#include <string.h>
+
 #include <launchdarkly/api.h>
 
 #include "assertion.h"
 #include "client.h"
+#include "concurrency.h"
 #include "config.h"
 #include "evaluate.h"
+#include "evaluation_context.h"
 #include "store.h"
 #include "user.h"
 #include "utility.h"
@@ -307,13 +311,19 @@ variation(
         detailsRef->reason          = LD_ERROR;
         detailsRef->extra.errorKind = LD_USER_NOT_SPECIFIED;
     } else {
-        const EvalStatus status = LDi_evaluate(
+        /* A single flag is evaluated without a context, so neither memos nor
+         * an arena are set up for it. Its temporaries, the fallback and value
+         * copies, details strings and events, are all allocated through the
+         * global hooks. The events of prerequisites are only built to be
+         * sent. */
+        const EvalStatus status = LDi_evaluateRC(
             client,
-            flag,
+            flagrc,
             user,
             store,
+            NULL,
             detailsRef,
-            &subEvents,
+            client->config->sendEvents ? &subEvents : NULL,
             &value,
             o_details != NULL);
 
@@ -594,19 +604,566 @@ LDJSONVariation(
     return result;
 }
 
+/* Per key state of LDVariationBatch. */
+struct LDBatchEntry
+{
+    struct LDJSONRC *flag;
+    struct LDJSON *  value;
+    /* used when the caller does not ask for details */
+    struct LDDetails details;
+    LDBoolean        failed;
+};
+
+static struct LDJSON *
+batchFallback(
+    const struct LDJSON *const *const fallbacks,
+    const unsigned int                index,
+    struct LDDetails *const           details)
+{
+    struct LDJSON *result;
+
+    if (!fallbacks || !fallbacks[index]) {
+        return NULL;
+    }
+
+    if (!(result = LDJSONDuplicate(fallbacks[index]))) {
+        setDetailsOOM(details);
+    }
+
+    return result;
+}
+
+static void
+batchFail(
+    const struct LDJSON *const *const fallbacks,
+    const unsigned int                count,
+    struct LDJSON **const             results,
+    struct LDDetails *const           details,
+    const enum LDEvalErrorKind        errorKind)
+{
+    unsigned int i;
+
+    for (i = 0; i < count; i++) {
+        if (details) {
+            LDDetailsInit(&details[i]);
+
+            details[i].reason          = LD_ERROR;
+            details[i].extra.errorKind = errorKind;
+        }
+
+        results[i] = batchFallback(fallbacks, i, details ? &details[i] : NULL);
+    }
+}
+
+LDBoolean
+LDVariationBatch(
+    struct LDClient *const            client,
+    const struct LDUser *const        user,
+    const char *const *const          keys,
+    const struct LDJSON *const *const fallbacks,
+    const unsigned int                count,
+    struct LDJSON **const             results,
+    struct LDDetails *const           details)
+{
+    struct LDBatchEntry *       entries;
+    struct EvaluationResult *   evaluations;
+    LDBoolean *                 processed;
+    struct LDEvaluationContext *context;
+    unsigned int                i;
+    LDBoolean                   storeSuccess;
+
+    LD_ASSERT_API(client);
+    LD_ASSERT_API(user);
+    LD_ASSERT_API(keys);
+    LD_ASSERT_API(results || count == 0);
+
+    entries     = NULL;
+    evaluations = NULL;
+    processed   = NULL;
+    context     = NULL;
+
+#ifdef LAUNCHDARKLY_DEFENSIVE
+    if (results == NULL && count != 0) {
+        LD_LOG(LD_LOG_WARNING, "LDVariationBatch NULL results");
+
+        return LDBooleanFalse;
+    } else if (client == NULL) {
+        LD_LOG(LD_LOG_WARNING, "LDVariationBatch NULL client");
+
+        batchFail(fallbacks, count, results, details, LD_CLIENT_NOT_SPECIFIED);
+
+        return LDBooleanFalse;
+    } else if (user == NULL) {
+        LD_LOG(LD_LOG_WARNING, "LDVariationBatch NULL user");
+
+        batchFail(fallbacks, count, results, details, LD_USER_NOT_SPECIFIED);
+
+        return LDBooleanFalse;
+    } else if (keys == NULL) {
+        LD_LOG(LD_LOG_WARNING, "LDVariationBatch NULL keys");
+
+        batchFail(fallbacks, count, results, details, LD_NULL_KEY);
+
+        return LDBooleanFalse;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (keys[i] == NULL) {
+            LD_LOG(LD_LOG_WARNING, "LDVariationBatch NULL key");
+
+            batchFail(fallbacks, count, results, details, LD_NULL_KEY);
+
+            return LDBooleanFalse;
+        }
+    }
+#endif
+
+    if (count == 0) {
+        return LDBooleanTrue;
+    }
+
+    if (!LDClientIsInitialized(client)) {
+        batchFail(fallbacks, count, results, details, LD_CLIENT_NOT_READY);
+
+        return LDBooleanTrue;
+    }
+
+    /* Segment matches and prerequisites are shared between the flags, as they
+     * are all evaluated for the same user. The scratch arrays of the batch are
+     * allocated from the context too, and released with it. */
+    if (!(context = LDi_evaluationContextNew()) ||
+        !(entries = LDi_evaluationContextAlloc(
+              context, sizeof(struct LDBatchEntry) * count)) ||
+        !(evaluations = LDi_evaluationContextAlloc(
+              context, sizeof(struct EvaluationResult) * count)) ||
+        !(processed = LDi_evaluationContextAlloc(
+              context, sizeof(LDBoolean) * count)))
+    {
+        LD_LOG(LD_LOG_ERROR, "alloc error");
+
+        LDi_evaluationContextFree(context);
+
+        batchFail(fallbacks, count, results, details, LD_OOM);
+
+        return LDBooleanFalse;
+    }
+
+    memset(entries, 0, sizeof(struct LDBatchEntry) * count);
+    memset(evaluations, 0, sizeof(struct EvaluationResult) * count);
+
+    /* The flags are read in one call, so that the memory store serves them
+     * under a single lock, from one version of the data. */
+    {
+        struct LDJSONRC **flags;
+
+        if ((flags = LDi_evaluationContextAlloc(
+                 context, sizeof(struct LDJSONRC *) * count)))
+        {
+            storeSuccess = LDStoreGetMany(client->store, LD_FLAG, keys, count, flags);
+
+            for (i = 0; i < count; i++) {
+                entries[i].flag = flags[i];
+            }
+        } else {
+            storeSuccess = LDBooleanFalse;
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        struct LDBatchEntry *const entry = &entries[i];
+        struct LDDetails *const    detailsRef =
+            details ? &details[i] : &entry->details;
+        struct LDJSON *subEvents;
+
+        subEvents = NULL;
+
+        LDDetailsInit(detailsRef);
+
+        if (!entry->flag || !LDJSONRCGet(entry->flag)) {
+            detailsRef->reason          = LD_ERROR;
+            detailsRef->extra.errorKind =
+                storeSuccess ? LD_FLAG_NOT_FOUND : LD_STORE_ERROR;
+        } else {
+            /* Details the caller does not see are scratch, and those of
+             * prerequisites are only built to be sent. */
+            struct LDJSON **const o_events =
+                client->config->sendEvents ? &subEvents : NULL;
+            const EvalStatus status = details
+                ? LDi_evaluateRC(
+                      client,
+                      entry->flag,
+                      user,
+                      client->store,
+                      context,
+                      detailsRef,
+                      o_events,
+                      &entry->value,
+                      LDBooleanTrue)
+                : LDi_evaluateRCScratch(
+                      client,
+                      entry->flag,
+                      user,
+                      client->store,
+                      context,
+                      detailsRef,
+                      o_events,
+                      &entry->value,
+                      LDBooleanFalse);
+
+            if (status == EVAL_MEM) {
+                detailsRef->reason          = LD_ERROR;
+                detailsRef->extra.errorKind = LD_OOM;
+
+                LDJSONFree(subEvents);
+                subEvents = NULL;
+
+                entry->failed = LDBooleanTrue;
+            } else if (status == EVAL_SCHEMA) {
+                detailsRef->reason          = LD_ERROR;
+                detailsRef->extra.errorKind = LD_MALFORMED_FLAG;
+
+                LDJSONFree(subEvents);
+                subEvents = NULL;
+            }
+        }
+
+        evaluations[i].user               = user;
+        evaluations[i].subEvents          = subEvents;
+        evaluations[i].flagKey            = keys[i];
+        evaluations[i].actualValue        = entry->value;
+        evaluations[i].fallbackValue      = fallbacks ? fallbacks[i] : NULL;
+        evaluations[i].flag               = NULL;
+        evaluations[i].details            = detailsRef;
+        evaluations[i].detailedEvaluation = (LDBoolean)(details != NULL);
+
+        if (entry->flag) {
+            evaluations[i].flag = LDJSONRCGet(entry->flag);
+        }
+    }
+
+    if (client->config->sendEvents) {
+        /* Evaluations which ran out of memory are not reported, as with the
+         * single flag variations. */
+        unsigned int reported;
+
+        for (i = 0, reported = 0; i < count; i++) {
+            if (!entries[i].failed) {
+                evaluations[reported++] = evaluations[i];
+            }
+        }
+
+        LDEventProcessor_ProcessEvaluations(
+            client->eventProcessor, evaluations, reported, processed);
+
+        for (i = 0, reported = 0; i < count; i++) {
+            if (!entries[i].failed && !processed[reported++]) {
+                entries[i].failed = LDBooleanTrue;
+            }
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        struct LDBatchEntry *const entry = &entries[i];
+
+        if (!entry->failed && LDi_notNull(entry->value)) {
+            results[i]   = entry->value;
+            entry->value = NULL;
+        } else {
+            results[i] = batchFallback(
+                fallbacks, i, details ? &details[i] : NULL);
+        }
+
+        /* entry->details is scratch, released with the context */
+        LDJSONFree(entry->value);
+        LDJSONRCRelease(entry->flag);
+    }
+
+    LDi_evaluationContextFree(context);
+
+    return LDBooleanTrue;
+}
+
+/* The stores provide the collection of all flags as references to the individually stored flags, associated in
+ * the same order, so that evaluation can use their compiled representation. Returns NULL when the collection
+ * does not carry them. */
+static struct LDJSONRC *
+associatedFlag(struct LDJSONRC *const rawFlagsRC, const unsigned int index)
+{
+    if (LDJSONRCGetAssociatedCount(rawFlagsRC) != LDCollectionGetSize(LDJSONRCGet(rawFlagsRC))) {
+        return NULL;
+    }
+
+    return LDJSONRCGetAssociated(rawFlagsRC, index);
+}
+
+static EvalStatus
+evaluateStored(
+    struct LDClient *const            client,
+    struct LDJSONRC *const            rawFlagsRC,
+    const unsigned int                index,
+    const struct LDJSON *const        flag,
+    const struct LDUser *const        user,
+    struct LDEvaluationContext *const context,
+    struct LDDetails *const           details,
+    struct LDJSON **const             o_events,
+    struct LDJSON **const             o_value)
+{
+    struct LDJSONRC *flagrc;
+
+    if ((flagrc = associatedFlag(rawFlagsRC, index))) {
+        return LDi_evaluateRC(
+            client,
+            flagrc,
+            user,
+            client->store,
+            context,
+            details,
+            o_events,
+            o_value,
+            LDBooleanFalse);
+    }
+
+    return LDi_evaluate(
+        client,
+        flag,
+        user,
+        client->store,
+        context,
+        details,
+        o_events,
+        o_value,
+        LDBooleanFalse);
+}
+
+/* Flags are only split across threads when each thread gets at least this
+ * many, below which starting a thread costs more than it saves. */
+#define LD_ALL_FLAGS_MIN_PER_THREAD 256
+
+/* A contiguous range of the flags in a store collection, evaluated on one
+ * thread. */
+struct LDFlagRange
+{
+    struct LDClient *    client;
+    struct LDJSONRC *    rawFlagsRC;
+    const struct LDUser *user;
+    unsigned int         options;
+    /* the flag at index begin */
+    const struct LDJSON *first;
+    unsigned int         begin;
+    unsigned int         end;
+    /* shared by every range, each writing only its own indices */
+    struct LDFlagState **results;
+    ld_thread_t          thread;
+    LDBoolean            threaded;
+    LDBoolean            success;
+};
+
+static void
+evaluateFlagRange(struct LDFlagRange *const range)
+{
+    /* Not thread safe, so each range has its own. Evaluation proceeds without
+     * memoization if this fails. */
+    struct LDEvaluationContext *const context = LDi_evaluationContextNew();
+    const struct LDJSON *             rawFlagsIter;
+    unsigned int                      index;
+
+    range->success = LDBooleanFalse;
+
+    for (rawFlagsIter = range->first, index = range->begin; index < range->end;
+         rawFlagsIter = LDIterNext(rawFlagsIter), index++)
+    {
+        /* JSON returned by the iterator is transformed into an explicit flag model.
+         * This transformation could be refactored to happen at a lower layer of abstraction, such as
+         * LDStoreAll.
+         * The alternative would be directly querying the JSON for each piece of data needed to implement AllFlagsState.
+         * */
+        struct LDFlagModel model;
+
+        /* LDFlagState is the 'value' part of the key-value hashtable embedded in struct LDAllFlagsState, which
+         * is ultimately returned to the caller.
+         * Its members are comprised of the LDi_evaluate results (LDJSON value, and LDDetails) as well
+         * as the data contained in LDFlagModel.
+         * */
+        struct LDFlagState* flag = NULL;
+
+        LD_ASSERT(rawFlagsIter);
+
+        LDi_initFlagModel(&model, rawFlagsIter); /* does not allocate */
+
+        if ((range->options & LD_CLIENT_SIDE_ONLY) && !model.clientSideAvailability.usingEnvironmentID) {
+
+            continue;
+        }
+
+        if (!(flag = LDi_newFlagState(model.key))) {
+            LD_LOG(LD_LOG_ERROR, "LDAllFlagsState flag alloc failed");
+
+            LDi_evaluationContextFree(context);
+
+            return;
+        }
+
+        evaluateStored(
+                range->client,
+                range->rawFlagsRC,
+                index,
+                rawFlagsIter,
+                range->user,
+                context,
+                &flag->details,
+                NULL, /* the events of prerequisites are not sent */
+                &flag->value);
+
+        LDi_flagModelPopulate(&model, flag);
+
+        range->results[index] = flag;
+    }
+
+    LDi_evaluationContextFree(context);
+
+    range->success = LDBooleanTrue;
+}
+
+static THREAD_RETURN
+evaluateFlagRangeThread(void *const rangeRef)
+{
+    evaluateFlagRange((struct LDFlagRange *)rangeRef);
+
+    return THREAD_RETURN_DEFAULT;
+}
+
+static void
+freeFlagResults(struct LDFlagState **const results, const unsigned int count)
+{
+    if (results) {
+        unsigned int index;
+
+        for (index = 0; index < count; index++) {
+            LDi_freeFlagState(results[index]);
+        }
+
+        LDFree(results);
+    }
+}
+
+/* Evaluates every flag in the collection, splitting them across up to
+ * config->allFlagsThreads threads. Returns an array with an entry for each
+ * flag in collection order, which is NULL for skipped flags, or NULL on
+ * failure. */
+static struct LDFlagState **
+evaluateAllFlags(
+    struct LDClient *const     client,
+    struct LDJSONRC *const     rawFlagsRC,
+    const struct LDUser *const user,
+    const unsigned int         options,
+    unsigned int *const        o_count)
+{
+    struct LDFlagState **results;
+    struct LDFlagRange * ranges;
+    const struct LDJSON *rawFlagsIter;
+    unsigned int         count, rangeCount, i, index;
+    LDBoolean            success;
+
+    count      = LDCollectionGetSize(LDJSONRCGet(rawFlagsRC));
+    rangeCount = client->config->allFlagsThreads;
+    success    = LDBooleanTrue;
+    *o_count   = count;
+
+    if (rangeCount > count / LD_ALL_FLAGS_MIN_PER_THREAD) {
+        rangeCount = count / LD_ALL_FLAGS_MIN_PER_THREAD;
+    }
+
+    if (rangeCount == 0) {
+        rangeCount = 1;
+    }
+
+    if (!(results = LDAlloc(sizeof(struct LDFlagState *) * (count + 1)))) {
+        LD_LOG(LD_LOG_ERROR, "alloc error");
+
+        return NULL;
+    }
+
+    memset(results, 0, sizeof(struct LDFlagState *) * (count + 1));
+
+    if (!(ranges = LDAlloc(sizeof(struct LDFlagRange) * rangeCount))) {
+        LD_LOG(LD_LOG_ERROR, "alloc error");
+
+        LDFree(results);
+
+        return NULL;
+    }
+
+    rawFlagsIter = LDGetIter(LDJSONRCGet(rawFlagsRC));
+    index        = 0;
+
+    for (i = 0; i < rangeCount; i++) {
+        struct LDFlagRange *const range = &ranges[i];
+
+        range->client     = client;
+        range->rawFlagsRC = rawFlagsRC;
+        range->user       = user;
+        range->options    = options;
+        range->first      = rawFlagsIter;
+        range->begin      = index;
+        range->end        = (unsigned int)((count * (i + 1.0)) / rangeCount);
+        range->results    = results;
+        range->threaded   = LDBooleanFalse;
+        range->success    = LDBooleanFalse;
+
+        for (; index < range->end; index++) {
+            rawFlagsIter = LDIterNext(rawFlagsIter);
+        }
+    }
+
+    /* The calling thread takes the first range. A range that cannot be given
+     * a thread is evaluated by the caller afterwards. */
+    for (i = 1; i < rangeCount; i++) {
+        ranges[i].threaded = LDi_thread_create(
+            &ranges[i].thread, evaluateFlagRangeThread, &ranges[i]);
+    }
+
+    evaluateFlagRange(&ranges[0]);
+
+    for (i = 1; i < rangeCount; i++) {
+        if (ranges[i].threaded) {
+            LDi_thread_join(&ranges[i].thread);
+        } else {
+            evaluateFlagRange(&ranges[i]);
+        }
+    }
+
+    for (i = 0; i < rangeCount; i++) {
+        if (!ranges[i].success) {
+            success = LDBooleanFalse;
+        }
+    }
+
+    LDFree(ranges);
+
+    if (!success) {
+        freeFlagResults(results, count);
+
+        return NULL;
+    }
+
+    return results;
+}
+
 struct LDJSON *
 LDAllFlags(struct LDClient *const client, const struct LDUser *const user)
 {
-    struct LDJSON *  evaluatedFlags, *rawFlags, *rawFlagsIter;
-    struct LDJSONRC *rawFlagsRC;
+    struct LDJSON *      evaluatedFlags;
+    struct LDJSONRC *    rawFlagsRC;
+    struct LDFlagState **results;
+    unsigned int         count, index;
 
     LD_ASSERT_API(client);
     LD_ASSERT_API(user);
 
-    rawFlags       = NULL;
-    rawFlagsIter   = NULL;
     rawFlagsRC     = NULL;
     evaluatedFlags = NULL;
+    results        = NULL;
+    count          = 0;
 
 #ifdef LAUNCHDARKLY_DEFENSIVE
     if (client == NULL) {
@@ -653,57 +1210,29 @@ LDAllFlags(struct LDClient *const client, const struct LDUser *const user)
         return evaluatedFlags;
     }
 
-    rawFlags = LDJSONRCGet(rawFlagsRC);
-    LD_ASSERT(rawFlags);
-
-    for (rawFlagsIter = LDGetIter(rawFlags); rawFlagsIter;
-         rawFlagsIter = LDIterNext(rawFlagsIter))
-    {
-        struct LDJSON *  value, *events;
-        struct LDDetails details;
-        struct LDJSON *  flag;
-        const char *     key;
-
-        value  = NULL;
-        events = NULL;
-        key    = NULL;
-
-        flag = rawFlagsIter;
-        LD_ASSERT(flag);
-
-        LDDetailsInit(&details);
-
-        LDi_evaluate(
-            client,
-            flag,
-            user,
-            client->store,
-            &details,
-            &events,
-            &value,
-            LDBooleanFalse);
+    if (!(results = evaluateAllFlags(client, rawFlagsRC, user, 0, &count))) {
+        goto error;
+    }
 
-        if (value) {
-            key = LDGetText(LDObjectLookup(flag, "key"));
-            LD_ASSERT(key);
-            if (!LDObjectSetKey(evaluatedFlags, key, value)) {
-                LDJSONFree(events);
-                LDJSONFree(value);
-                LDDetailsClear(&details);
+    for (index = 0; index < count; index++) {
+        struct LDFlagState *const flag = results[index];
 
+        if (flag && flag->value) {
+            if (!LDObjectSetKey(evaluatedFlags, flag->key, flag->value)) {
                 goto error;
             }
-        }
 
-        LDJSONFree(events);
-        LDDetailsClear(&details);
+            flag->value = NULL;
+        }
     }
 
+    freeFlagResults(results, count);
     LDJSONRCRelease(rawFlagsRC);
 
     return evaluatedFlags;
 
 error:
+    freeFlagResults(results, count);
     LDJSONRCRelease(rawFlagsRC);
     LDJSONFree(evaluatedFlags);
 
@@ -714,20 +1243,21 @@ error:
 struct LDAllFlagsState*
 LDAllFlagsState(struct LDClient *const client, const struct LDUser *const user, unsigned int options)
 {
-    struct LDJSON               *rawFlags, *rawFlagsIter;
     struct LDJSONRC             *rawFlagsRC;
     struct LDAllFlagsState      *state;
     struct LDAllFlagsBuilder    *builder;
+    struct LDFlagState          **results;
     LDBoolean                   success;
+    unsigned int                count, index;
 
     LD_ASSERT_API(client);
     LD_ASSERT_API(user);
 
-    rawFlags       = NULL;
-    rawFlagsIter   = NULL;
     rawFlagsRC     = NULL;
     state          = NULL;
     builder        = NULL;
+    results        = NULL;
+    count          = 0;
     success        = LDBooleanFalse;
 
 
@@ -778,78 +1308,37 @@ LDAllFlagsState(struct LDClient *const client, const struct LDUser *const user,
         goto cleanup;
     }
 
-    rawFlags = LDJSONRCGet(rawFlagsRC);
-    LD_ASSERT(rawFlags);
-
-    for (rawFlagsIter = LDGetIter(rawFlags); rawFlagsIter;
-         rawFlagsIter = LDIterNext(rawFlagsIter))
-    {
-        /* LDi_evaluate generates an events object which is not used in this function. */
-        struct LDJSON *eventsUnused = NULL;
-
-        /* JSON returned by the iterator is transformed into an explicit flag model.
-         * This transformation could be refactored to happen at a lower layer of abstraction, such as
-         * LDStoreAll.
-         * The alternative would be directly querying the JSON for each piece of data needed to implement AllFlagsState.
-         * */
-        struct LDFlagModel model;
-
-        /* LDFlagState is the 'value' part of the key-value hashtable embedded in struct LDAllFlagsState, which
-         * is ultimately returned to the caller.
-         * Its members are comprised of the LDi_evaluate results (LDJSON value, and LDDetails) as well
-         * as the data contained in LDFlagModel.
-         * */
-        struct LDFlagState* flag = NULL;
-
-        LD_ASSERT(rawFlagsIter);
-
-        LDi_initFlagModel(&model, rawFlagsIter); /* does not allocate */
-
-        if ((options & LD_CLIENT_SIDE_ONLY) && !model.clientSideAvailability.usingEnvironmentID) {
-
-            continue;
-        }
-
-        if (!(flag = LDi_newFlagState(model.key))) {
-            LD_LOG(LD_LOG_ERROR, "LDAllFlagsState flag alloc failed");
-
-            goto cleanup;
-        }
-
-        LDi_evaluate(
-                client,
-                rawFlagsIter,
-                user,
-                client->store,
-                &flag->details,
-                &eventsUnused,
-                &flag->value,
-                LDBooleanFalse);
-
-        LDJSONFree(eventsUnused);
-
-        LDi_flagModelPopulate(&model, flag);
+    if (!(results = evaluateAllFlags(client, rawFlagsRC, user, options, &count))) {
+        goto cleanup;
+    }
 
-        if (!LDi_allFlagsBuilderAdd(builder, flag)) {
-            LDi_freeFlagState(flag);
+    /* Flags are added in collection order however they were evaluated, so the
+     * result is the same as a sequential evaluation. */
+    for (index = 0; index < count; index++) {
+        if (results[index]) {
+            if (!LDi_allFlagsBuilderAdd(builder, results[index])) {
+                goto cleanup;
+            }
 
-            goto cleanup;
+            results[index] = NULL;
         }
-
     }
 
     success = LDBooleanTrue;
 
     cleanup:
 
+    freeFlagResults(results, count);
     LDJSONRCRelease(rawFlagsRC);
 
     if (success) {
-        LD_ASSERT(state = LDi_allFlagsBuilderBuild(builder));
+        state = LDi_allFlagsBuilderBuild(builder);
     } else {
-        LD_ASSERT(state = LDi_newAllFlagsState(LDBooleanFalse));
+        state = LDi_newAllFlagsState(LDBooleanFalse);
     }
 
+    LD_ASSERT(state);
+
     LDi_freeAllFlagsBuilder(builder);
 
     return state;
@@ -1,3 +1,4 @@
+#include <stdio.h>
 #include <string.h>
 
 #include <launchdarkly/store/redis.h>
@@ -302,6 +303,10 @@ resetReply(redisReply **const reply)
     *reply = NULL;
 }
 
+/* Items written by one HMSET, bounding the size of a single command. HMSET
+ * is used rather than a multi-field HSET, which needs Redis 4.0. */
+#define LD_REDIS_HMSET_BATCH 1000
+
 static LDBoolean
 storeInit(
     void *const                          contextRaw,
@@ -312,7 +317,12 @@ storeInit(
     redisReply *       reply;
     struct Connection *connection;
     LDBoolean          success;
-    unsigned int       x;
+    unsigned int       x, pending;
+    const char **      argv;
+    size_t *           argvlen;
+    char *             key;
+    size_t             keySize;
+    const char *       prefix;
 
     LD_LOG(LD_LOG_TRACE, "redis storeInit");
 
@@ -323,18 +333,51 @@ storeInit(
     context    = (struct Context *)contextRaw;
     reply      = NULL;
     success    = LDBooleanFalse;
+    pending    = 0;
+    argv       = NULL;
+    argvlen    = NULL;
+    key        = NULL;
+    prefix     = LDRedisConfigGetPrefix(context->config);
 
-    if (!(connection = borrowConnection(context))) {
+    /* Everything is allocated up front, as a failure after the first command
+     * is appended would leave the connection out of step. */
+    keySize = 0;
+
+    for (x = 0; x < collectionCount; x++) {
+        const size_t size = strlen(prefix) + strlen(collections[x].kind) + 2;
+
+        if (size > keySize) {
+            keySize = size;
+        }
+    }
+
+    if (keySize && !(key = (char *)LDAlloc(keySize))) {
         goto cleanup;
     }
 
-    reply = redisCommand(connection->connection, "MULTI");
+    if (!(argv = (const char **)LDAlloc(
+              sizeof(const char *) * (2 + 2 * LD_REDIS_HMSET_BATCH))))
+    {
+        goto cleanup;
+    }
 
-    if (!redisCheckStatus(reply, "OK")) {
+    if (!(argvlen =
+              (size_t *)LDAlloc(sizeof(size_t) * (2 + 2 * LD_REDIS_HMSET_BATCH))))
+    {
         goto cleanup;
     }
 
-    resetReply(&reply);
+    if (!(connection = borrowConnection(context))) {
+        goto cleanup;
+    }
+
+    /* Every command is appended before any reply is read, so the whole init
+     * costs a single round trip. */
+    if (redisAppendCommand(connection->connection, "MULTI") != REDIS_OK) {
+        goto cleanup;
+    }
+
+    pending++;
 
     for (x = 0; x < collectionCount; x++) {
         const struct LDStoreCollectionState *collection;
@@ -342,65 +385,106 @@ storeInit(
 
         collection = &(collections[x]);
 
-        reply = redisCommand(
-            connection->connection,
-            "DEL %s:%s",
-            LDRedisConfigGetPrefix(context->config),
-            collection->kind);
-
-        if (!redisCheckStatus(reply, "QUEUED")) {
+        if (redisAppendCommand(
+                connection->connection,
+                "DEL %s:%s",
+                prefix,
+                collection->kind) != REDIS_OK)
+        {
             goto cleanup;
         }
 
-        resetReply(&reply);
+        pending++;
 
-        for (y = 0; y < collection->itemCount; y++) {
-            struct LDStoreCollectionStateItem *item;
+        snprintf(key, keySize, "%s:%s", prefix, collection->kind);
 
-            item = &(collection->items[y]);
+        for (y = 0; y < collection->itemCount; y += LD_REDIS_HMSET_BATCH) {
+            unsigned int z, count;
+            int          argc;
 
-            reply = redisCommand(
-                connection->connection,
-                "HSET %s:%s %s %s",
-                LDRedisConfigGetPrefix(context->config),
-                collection->kind,
-                item->key,
-                item->item.buffer);
+            count = collection->itemCount - y;
+
+            if (count > LD_REDIS_HMSET_BATCH) {
+                count = LD_REDIS_HMSET_BATCH;
+            }
+
+            argv[0]    = "HMSET";
+            argvlen[0] = 5;
+            argv[1]    = key;
+            argvlen[1] = strlen(key);
+            argc       = 2;
+
+            for (z = 0; z < count; z++) {
+                const struct LDStoreCollectionStateItem *const item =
+                    &(collection->items[y + z]);
 
-            if (!redisCheckStatus(reply, "QUEUED")) {
+                argv[argc]      = item->key;
+                argvlen[argc++] = strlen(item->key);
+                argv[argc]      = (const char *)item->item.buffer;
+                argvlen[argc++] = item->item.bufferSize;
+            }
+
+            if (redisAppendCommandArgv(
+                    connection->connection, argc, argv, argvlen) != REDIS_OK)
+            {
                 goto cleanup;
             }
 
-            resetReply(&reply);
+            pending++;
         }
     }
 
-    reply = redisCommand(
-        connection->connection,
-        "SET %s:%s %s",
-        LDRedisConfigGetPrefix(context->config),
-        initedKey,
-        "");
-
-    if (!redisCheckStatus(reply, "QUEUED")) {
+    if (redisAppendCommand(
+            connection->connection, "SET %s:%s %s", prefix, initedKey, "") !=
+        REDIS_OK)
+    {
         goto cleanup;
     }
 
-    resetReply(&reply);
-
-    reply = redisCommand(connection->connection, "EXEC");
+    pending++;
 
-    if (!redisCheckReply(reply, REDIS_REPLY_ARRAY)) {
+    if (redisAppendCommand(connection->connection, "EXEC") != REDIS_OK) {
         goto cleanup;
     }
 
+    pending++;
+
+    /* MULTI replies OK, each queued command QUEUED, and EXEC an array. Every
+     * reply is read, even after a failure, to keep the connection usable. */
     success = LDBooleanTrue;
 
+    for (x = pending; x > 0; x--) {
+        if (redisGetReply(connection->connection, (void **)&reply) !=
+            REDIS_OK) {
+            success = LDBooleanFalse;
+
+            break;
+        }
+
+        if (x == pending) {
+            if (!redisCheckStatus(reply, "OK")) {
+                success = LDBooleanFalse;
+            }
+        } else if (x == 1) {
+            if (!redisCheckReply(reply, REDIS_REPLY_ARRAY)) {
+                success = LDBooleanFalse;
+            }
+        } else if (!redisCheckStatus(reply, "QUEUED")) {
+            success = LDBooleanFalse;
+        }
+
+        resetReply(&reply);
+    }
+
 cleanup:
     resetReply(&reply);
 
     returnConnection(context, connection);
 
+    LDFree(key);
+    LDFree(argv);
+    LDFree(argvlen);
+
     return success;
 }
 
@@ -413,7 +497,6 @@ storeGet(
 {
     struct Context *   context;
     struct Connection *connection;
-    struct LDJSON *    feature;
     redisReply *       reply;
     LDBoolean          success;
 
@@ -426,7 +509,6 @@ storeGet(
 
     context    = (struct Context *)contextRaw;
     connection = NULL;
-    feature    = NULL;
     reply      = NULL;
     success    = LDBooleanFalse;
 
@@ -451,25 +533,17 @@ storeGet(
         goto cleanup;
     } else if (!redisCheckReply(reply, REDIS_REPLY_STRING)) {
         goto cleanup;
-    } else if (!(feature = LDJSONDeserialize(reply->str))) {
+    } else if (!LDi_getSerializedDataVersion(reply->str, &result->version)) {
         goto cleanup;
     } else if (!(result->buffer = LDStrDup(reply->str))) {
         goto cleanup;
     }
 
-    if (result->buffer) {
-        result->bufferSize = strlen(reply->str);
-        result->version    = LDi_getDataVersion(feature);
-    } else {
-        result->bufferSize = 0;
-        result->version    = 0;
-    }
+    result->bufferSize = reply->len;
 
     success = LDBooleanTrue;
 
 cleanup:
-    LDJSONFree(feature);
-
     resetReply(&reply);
 
     returnConnection(context, connection);
@@ -491,7 +565,6 @@ storeAll(
     unsigned int                  i;
     struct LDStoreCollectionItem *collection, *collectionIter;
     size_t                        resultBytes;
-    struct LDJSON *               feature;
 
     LD_LOG(LD_LOG_TRACE, "redis storeAll");
 
@@ -506,7 +579,6 @@ storeAll(
     *resultCount = 0;
     collection   = NULL;
     resultBytes  = 0;
-    feature      = NULL;
 
     if (!(connection = borrowConnection(context))) {
         goto cleanup;
@@ -518,7 +590,9 @@ storeAll(
         LDRedisConfigGetPrefix(context->config),
         kind);
 
-    if (reply->type == REDIS_REPLY_NIL) {
+    if (!reply) {
+        goto cleanup;
+    } else if (reply->type == REDIS_REPLY_NIL) {
         success = LDBooleanTrue;
 
         goto cleanup;
@@ -555,7 +629,8 @@ storeAll(
         raw = reply->element[i]->str;
         LD_ASSERT(raw);
 
-        if (!(feature = LDJSONDeserialize(raw))) {
+        /* only the version is needed, so the item is not parsed whole */
+        if (!LDi_getSerializedDataVersion(raw, &collectionIter->version)) {
             goto cleanup;
         }
 
@@ -563,11 +638,7 @@ storeAll(
             goto cleanup;
         }
 
-        collectionIter->bufferSize = strlen(raw);
-        collectionIter->version    = LDi_getDataVersion(feature);
-
-        LDJSONFree(feature);
-        feature = NULL;
+        collectionIter->bufferSize = reply->element[i]->len;
 
         collectionIter++;
     }
@@ -576,8 +647,6 @@ storeAll(
     success = LDBooleanTrue;
 
 cleanup:
-    LDJSONFree(feature);
-
     resetReply(&reply);
     returnConnection(context, connection);
 
@@ -2,6 +2,9 @@
 #include "commonfixture.h"
 
 extern "C" {
+#include <stdlib.h>
+#include <string.h>
+
 #include "logging.h"
 #include "launchdarkly/memory.h"
 }
@@ -15,3 +18,46 @@ void CommonFixture::SetUp() {
 void CommonFixture::TearDown() {
     LDBasicLoggerThreadSafeShutdown();
 }
+
+static int allocationsLeft;
+
+static void *
+failingAlloc(const size_t bytes)
+{
+    if (allocationsLeft == 0) {
+        return NULL;
+    }
+
+    allocationsLeft--;
+
+    return malloc(bytes);
+}
+
+static char *
+defaultStrNDup(const char *const string, const size_t n)
+{
+    return strndup(string, n);
+}
+
+int CommonFixture::failAllocationsUntilSuccess(
+    const std::function<bool()> &attempt)
+{
+    int failAfter;
+
+    for (failAfter = 0;; failAfter++) {
+        bool succeeded;
+
+        allocationsLeft = failAfter;
+        LDSetMemoryRoutines(
+            failingAlloc, free, realloc, strdup, calloc, defaultStrNDup);
+
+        succeeded = attempt();
+
+        LDSetMemoryRoutines(
+            malloc, free, realloc, strdup, calloc, defaultStrNDup);
+
+        if (succeeded) {
+            return failAfter;
+        }
+    }
+}
@@ -1,11 +1,18 @@
 #ifndef LDSERVERAPI_COMMONFIXTURE_H
 #define LDSERVERAPI_COMMONFIXTURE_H
 
+#include <functional>
+
 class CommonFixture : public ::testing::Test {
 protected:
     void SetUp() override;
 
     void TearDown() override;
+
+    // Runs attempt with every allocation failing after the first 0, 1, 2, ...
+    // until attempt returns true. Returns how many allocations were allowed
+    // on the successful run.
+    static int failAllocationsUntilSuccess(const std::function<bool()> &attempt);
 };
 
 #endif //LDSERVERAPI_COMMONFIXTURE_H
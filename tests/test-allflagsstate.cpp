@@ -1,6 +1,8 @@
 #include "gtest/gtest.h"
 #include "commonfixture.h"
 
+#include <string>
+
 extern "C" {
 #include <launchdarkly/api.h>
 #include "client.h"
@@ -533,3 +535,50 @@ TEST_F(AllFlagsStateFixture, AllFlagsState_GivesSameResultAsAllFlags) {
     LDUserFree(user);
     LDAllFlagsStateFree(allFlagsState);
 }
+
+// Splitting the flags across threads must not change the serialized state, including its order.
+TEST_F(AllFlagsStateFixture, ThreadedEvaluationMatchesSequential) {
+    struct LDAllFlagsState *sequentialState, *threadedState;
+    struct LDJSON *sequentialFlags, *threadedFlags;
+    struct LDUser *user;
+    char *sequentialStr, *threadedStr;
+    unsigned int i;
+
+    ASSERT_TRUE(LDStoreInitEmpty(client->store));
+
+    for (i = 0; i < 1000; i++) {
+        struct LDJSON *flag;
+        const std::string key = "flag" + std::to_string(i);
+
+        ASSERT_TRUE(flag = makeMinimalFlag(key.c_str(), i, LDBooleanTrue, i % 2 == 0));
+        addVariation(flag, LDNewNumber(i));
+        setFallthrough(flag, 0);
+
+        ASSERT_TRUE(LDStoreUpsert(client->store, LD_FLAG, flag));
+    }
+
+    ASSERT_TRUE(user = LDUserNew("user1"));
+
+    ASSERT_TRUE(sequentialState = LDAllFlagsState(client, user, LD_ALLFLAGS_DEFAULT));
+    ASSERT_TRUE(sequentialStr = LDAllFlagsStateSerializeJSON(sequentialState));
+    ASSERT_TRUE(sequentialFlags = LDAllFlags(client, user));
+
+    LDConfigSetAllFlagsThreads(client->config, 4);
+
+    ASSERT_TRUE(threadedState = LDAllFlagsState(client, user, LD_ALLFLAGS_DEFAULT));
+    ASSERT_TRUE(LDAllFlagsStateValid(threadedState));
+    ASSERT_TRUE(threadedStr = LDAllFlagsStateSerializeJSON(threadedState));
+    ASSERT_TRUE(threadedFlags = LDAllFlags(client, user));
+
+    ASSERT_STREQ(sequentialStr, threadedStr);
+    ASSERT_EQ(1000, LDCollectionGetSize(threadedFlags));
+    ASSERT_TRUE(LDJSONCompare(sequentialFlags, threadedFlags));
+
+    LDFree(sequentialStr);
+    LDFree(threadedStr);
+    LDJSONFree(sequentialFlags);
+    LDJSONFree(threadedFlags);
+    LDAllFlagsStateFree(sequentialState);
+    LDAllFlagsStateFree(threadedState);
+    LDUserFree(user);
+}
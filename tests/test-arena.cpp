@@ -0,0 +1,72 @@
+#include "gtest/gtest.h"
+#include "commonfixture.h"
+
+#include <string>
+
+extern "C" {
+#include <launchdarkly/api.h>
+
+#include "arena.h"
+}
+
+// Inherit from the CommonFixture to give a reasonable name for the test output.
+// Any custom setup and teardown would happen in this derived class.
+class ArenaFixture : public CommonFixture {
+};
+
+TEST_F(ArenaFixture, AllocationsAreDistinctAndAligned) {
+    struct LDArena arena;
+    char *         previous = NULL;
+    int            i;
+
+    LDi_arenaInit(&arena, NULL, 0);
+
+    for (i = 0; i < 1000; i++) {
+        char *const allocation = (char *)LDi_arenaAlloc(&arena, (i % 37) + 1);
+
+        ASSERT_TRUE(allocation);
+        ASSERT_EQ(0, (size_t)allocation % sizeof(union LDArenaAlign));
+
+        memset(allocation, 'x', (i % 37) + 1);
+
+        if (previous) {
+            ASSERT_NE(previous, allocation);
+        }
+
+        previous = allocation;
+    }
+
+    LDi_arenaDestroy(&arena);
+}
+
+TEST_F(ArenaFixture, UsesBufferBeforeHeap) {
+    struct LDArena     arena;
+    union LDArenaAlign buffer[16];
+    char *             allocation;
+
+    LDi_arenaInit(&arena, buffer, sizeof(buffer));
+
+    ASSERT_TRUE(allocation = (char *)LDi_arenaAlloc(&arena, sizeof(buffer)));
+    ASSERT_EQ((char *)buffer, allocation);
+    ASSERT_EQ(NULL, arena.blocks);
+
+    ASSERT_TRUE(allocation = (char *)LDi_arenaAlloc(&arena, 1));
+    ASSERT_TRUE(arena.blocks);
+
+    LDi_arenaDestroy(&arena);
+}
+
+TEST_F(ArenaFixture, LargeAllocation) {
+    struct LDArena    arena;
+    const std::string large(64 * 1024, 'a');
+    char *            copy;
+
+    LDi_arenaInit(&arena, NULL, 0);
+
+    ASSERT_TRUE(LDi_arenaStrDup(&arena, "small"));
+    ASSERT_TRUE(copy = LDi_arenaStrDup(&arena, large.c_str()));
+    ASSERT_EQ(large, copy);
+    ASSERT_STREQ("next", LDi_arenaStrDup(&arena, "next"));
+
+    LDi_arenaDestroy(&arena);
+}
@@ -5,6 +5,8 @@ extern "C" {
 
 #include <launchdarkly/api.h>
 #include "client.h"
+#include "event_processor.h"
+#include "utility.h"
 
 #include "test-utils/client.h"
 }
@@ -25,3 +27,71 @@ TEST_F(ConcurrencyFixture, TestClientFlush) {
         LDClientFlush(client);
     });
 }
+
+// Events tracked from many threads land in per-thread buffers, and must all be
+// present, with one index event for the shared user, once the payload is built.
+TEST_F(ConcurrencyFixture, TestConcurrentTrackIsCollected) {
+    struct LDClient *client;
+    struct LDUser *user;
+    struct LDJSON *payload, *iter;
+    unsigned int indexEvents, customEvents;
+
+    ASSERT_TRUE(client = makeOfflineClient());
+    ASSERT_TRUE(user = LDUserNew("shared"));
+
+    Defer([client, user](){
+        LDUserFree(user);
+        LDClientClose(client);
+    });
+
+    const std::size_t THREAD_CONCURRENCY = 16;
+    const std::size_t EVENTS_PER_THREAD = 50;
+
+    RunMany(THREAD_CONCURRENCY, [=]() {
+        for (std::size_t i = 0; i < EVENTS_PER_THREAD; i++) {
+            LDClientTrack(client, "metric", user, NULL);
+        }
+    });
+
+    for (std::thread& t : pool) {
+        t.join();
+    }
+
+    ASSERT_TRUE(LDEventProcessor_CreateEventPayloadAndResetState(client->eventProcessor, &payload));
+
+    indexEvents = 0;
+    customEvents = 0;
+
+    for (iter = LDGetIter(payload); iter; iter = LDIterNext(iter)) {
+        const char *const kind = LDGetText(LDObjectLookup(iter, "kind"));
+
+        if (strcmp(kind, "index") == 0) {
+            indexEvents++;
+        } else if (strcmp(kind, "custom") == 0) {
+            customEvents++;
+        }
+    }
+
+    ASSERT_EQ(1, indexEvents);
+    ASSERT_EQ(THREAD_CONCURRENCY * EVENTS_PER_THREAD, customEvents);
+
+    LDJSONFree(payload);
+}
+
+// The network thread sleeps until its next deadline, which for an idle offline
+// client is far away, so closing must wake it rather than wait.
+TEST_F(ConcurrencyFixture, TestCloseWakesNetworkThread) {
+    struct LDClient *client;
+    double start, end;
+
+    ASSERT_TRUE(client = makeOfflineClient());
+
+    /* let the network thread go to sleep */
+    LDi_sleepMilliseconds(50);
+
+    LDi_getMonotonicMilliseconds(&start);
+    LDClientClose(client);
+    LDi_getMonotonicMilliseconds(&end);
+
+    ASSERT_LT(end - start, 1000);
+}
@@ -103,6 +103,20 @@ TEST_F(ConfigFixture, DefaultAndReplace) {
     LDConfigSetFeatureStoreBackendCacheTTL(config, 100);
     ASSERT_EQ(config->storeCacheMilliseconds, 100);
 
+    ASSERT_EQ(config->storeRefreshAhead, LDBooleanFalse);
+    LDConfigSetFeatureStoreBackendRefreshAhead(config, LDBooleanTrue);
+    ASSERT_EQ(config->storeRefreshAhead, LDBooleanTrue);
+
+    ASSERT_EQ(config->allFlagsThreads, 1);
+    LDConfigSetAllFlagsThreads(config, 4);
+    ASSERT_EQ(config->allFlagsThreads, 4);
+    LDConfigSetAllFlagsThreads(config, 0);
+    ASSERT_EQ(config->allFlagsThreads, 1);
+
+    ASSERT_EQ(config->compressEvents, LDBooleanFalse);
+    LDConfigSetCompressEvents(config, LDBooleanTrue);
+    ASSERT_EQ(config->compressEvents, LDBooleanTrue);
+
     ASSERT_EQ(config->wrapperName, nullptr);
     ASSERT_EQ(config->wrapperVersion, nullptr);
     ASSERT_TRUE(LDConfigSetWrapperInfo(config, "a", "b"));
@@ -1,17 +1,20 @@
 #include "gtest/gtest.h"
 #include "commonfixture.h"
+#include <string>
 #include <vector>
 #include <mutex>
 
 extern "C" {
 #include <float.h>
 #include <math.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <launchdarkly/api.h>
 
 #include "assertion.h"
 #include "evaluate.h"
+#include "evaluation_context.h"
 #include "store.h"
 #include "test-utils/flags.h"
 #include "utility.h"
@@ -132,6 +135,7 @@ TEST_F(EvalFixture, ReturnsOffVariationIfFlagIsOff) {
                     flag,
                     user,
                     (struct LDStore *) 1,
+                    NULL,
                     &details,
                     &events,
                     &result,
@@ -178,6 +182,7 @@ TEST_F(EvalFixture, ReturnsCorrectReasonWhenOffAndOffVariationNull) {
                     flag,
                     user,
                     (struct LDStore *) 1,
+                    NULL,
                     &details,
                     &events,
                     &result,
@@ -221,6 +226,7 @@ TEST_F(EvalFixture, FlagReturnsNilIfFlagIsOffAndOffVariantIsUnspecified) {
                     flag,
                     user,
                     (struct LDStore *) 1,
+                    NULL,
                     &details,
                     &events,
                     &result,
@@ -270,6 +276,7 @@ TEST_F(EvalFixture, FlagReturnsFallthroughIfFlagIsOnAndThereAreNoRules) {
                     flag,
                     user,
                     (struct LDStore *) 1,
+                    NULL,
                     &details,
                     &events,
                     &result,
@@ -324,6 +331,7 @@ TEST_F(EvalFixture, FlagReturnsErrorForFallthroughWithNoVariationAndNoRollout) {
                     flag,
                     user,
                     (struct LDStore *) 1,
+                    NULL,
                     &details,
                     &events,
                     &result,
@@ -385,6 +393,7 @@ TEST_F(EvalFixture, FlagReturnsOffVariationIfPrerequisiteIsOff) {
             flag1,
             user,
             store,
+            NULL,
             &details,
             &events,
             &result,
@@ -461,6 +470,7 @@ TEST_F(EvalFixture, FlagReturnsOffVariationIfPrerequisiteIsNotMet) {
             flag1,
             user,
             store,
+            NULL,
             &details,
             &events,
             &result,
@@ -538,6 +548,7 @@ TEST_F(EvalFixture, FlagReturnsFallthroughVariationIfPrerequisiteIsMetAndThereAr
             flag1,
             user,
             store,
+            NULL,
             &details,
             &events,
             &result,
@@ -625,6 +636,7 @@ TEST_F(EvalFixture, MultipleLevelsOfPrerequisiteProduceMultipleEvents) {
             flag1,
             user,
             store,
+            NULL,
             &details,
             &events,
             &result,
@@ -706,6 +718,7 @@ TEST_F(EvalFixture, FlagMatchesUserFromTarget) {
             flag,
             user,
             (struct LDStore *) 1,
+            NULL,
             &details,
             &events,
             &result,
@@ -747,6 +760,7 @@ TEST_F(EvalFixture, FlagMatchesUserFromRules) {
             flag,
             user,
             (struct LDStore *) 1,
+            NULL,
             &details,
             &events,
             &result,
@@ -798,6 +812,7 @@ TEST_F(EvalFixture, ClauseCanMatchBuiltInAttribute) {
             flag,
             user,
             (struct LDStore *) 1,
+            NULL,
             &details,
             &events,
             &result,
@@ -845,6 +860,7 @@ TEST_F(EvalFixture, ClauseCanMatchCustomAttribute) {
             flag,
             user,
             (struct LDStore *) 1,
+            NULL,
             &details,
             &events,
             &result,
@@ -860,6 +876,42 @@ TEST_F(EvalFixture, ClauseCanMatchCustomAttribute) {
     LDDetailsClear(&details);
 }
 
+TEST_F(EvalFixture, AttributeViewBorrowsFromUser) {
+    struct LDUser *user;
+    struct LDJSON *custom;
+    struct LDUserAttributeView view;
+    const struct LDJSON *value;
+
+    ASSERT_TRUE(user = LDUserNew("key"));
+    ASSERT_TRUE(LDUserSetName(user, "Bob"));
+    LDUserSetAnonymous(user, LDBooleanTrue);
+
+    ASSERT_TRUE(custom = LDNewObject());
+    ASSERT_TRUE(LDObjectSetKey(custom, "groups", LDNewText("admins")));
+    LDUserSetCustom(user, custom);
+
+    ASSERT_TRUE(value = LDi_viewAttributeByID(
+            user, LD_USER_ATTRIBUTE_NAME, "name", &view));
+    ASSERT_EQ(LDJSONGetType(value), LDText);
+    ASSERT_EQ(LDGetText(value), user->name);
+
+    ASSERT_TRUE(value = LDi_viewAttributeByID(
+            user, LD_USER_ATTRIBUTE_ANONYMOUS, "anonymous", &view));
+    ASSERT_EQ(LDJSONGetType(value), LDBool);
+    ASSERT_TRUE(LDGetBool(value));
+
+    ASSERT_TRUE(value = LDi_viewAttributeByID(
+            user, LD_USER_ATTRIBUTE_CUSTOM, "groups", &view));
+    ASSERT_EQ(value, LDObjectLookup(user->custom, "groups"));
+
+    ASSERT_FALSE(LDi_viewAttributeByID(
+            user, LD_USER_ATTRIBUTE_EMAIL, "email", &view));
+    ASSERT_FALSE(LDi_viewAttributeByID(
+            user, LD_USER_ATTRIBUTE_CUSTOM, "missing", &view));
+
+    LDUserFree(user);
+}
+
 TEST_F(EvalFixture, ClauseReturnsFalseForMissingAttribute) {
     struct LDUser *user;
     struct LDJSON *flag, *result, *clause, *values, *events;
@@ -890,6 +942,7 @@ TEST_F(EvalFixture, ClauseReturnsFalseForMissingAttribute) {
             flag,
             user,
             (struct LDStore *) 1,
+            NULL,
             &details,
             &events,
             &result,
@@ -936,6 +989,7 @@ TEST_F(EvalFixture, ClauseCanBeNegated) {
             flag,
             user,
             (struct LDStore *) 1,
+            NULL,
             &details,
             &events,
             &result,
@@ -982,6 +1036,7 @@ TEST_F(EvalFixture, ClauseForMissingAttributeIsFalseEvenIfNegate) {
             flag,
             user,
             (struct LDStore *) 1,
+            NULL,
             &details,
             &events,
             &result,
@@ -1028,6 +1083,7 @@ TEST_F(EvalFixture, ClauseWithUnknownOperatorDoesNotMatch) {
                     flag,
                     user,
                     (struct LDStore *) 1,
+                    NULL,
                     &details,
                     &events,
                     &result,
@@ -1043,6 +1099,105 @@ TEST_F(EvalFixture, ClauseWithUnknownOperatorDoesNotMatch) {
     LDDetailsClear(&details);
 }
 
+TEST_F(EvalFixture, CompiledClausePrecompilesRegexes) {
+    struct LDUser *user;
+    struct LDJSON *flag, *result, *clause, *values, *events;
+    struct LDCompiledFlag *compiled;
+    struct LDDetails details;
+
+    result = NULL;
+    events = NULL;
+    LDDetailsInit(&details);
+
+    /* user */
+    ASSERT_TRUE(user = LDUserNew("key"));
+    ASSERT_TRUE(LDUserSetEmail(user, "bob@example.com"));
+
+    /* flag */
+    ASSERT_TRUE(values = LDNewArray());
+    ASSERT_TRUE(LDArrayPush(values, LDNewNumber(3)));
+    ASSERT_TRUE(LDArrayPush(values, LDNewText("[")));
+    ASSERT_TRUE(LDArrayPush(values, LDNewText("@example\\.com$")));
+
+    ASSERT_TRUE(clause = LDNewObject());
+    ASSERT_TRUE(LDObjectSetKey(clause, "op", LDNewText("matches")));
+    ASSERT_TRUE(LDObjectSetKey(clause, "values", values));
+    ASSERT_TRUE(LDObjectSetKey(clause, "attribute", LDNewText("email")));
+
+    ASSERT_TRUE(flag = booleanFlagWithClause(clause));
+
+    ASSERT_TRUE(compiled = LDi_compileFlag(flag));
+    ASSERT_EQ(compiled->ruleCount, 1);
+    ASSERT_EQ(compiled->rules[0].clauseCount, 1);
+    ASSERT_TRUE(compiled->rules[0].clauses[0].regexes);
+    ASSERT_FALSE(compiled->rules[0].clauses[0].regexes[0]);
+    ASSERT_FALSE(compiled->rules[0].clauses[0].regexes[1]);
+    ASSERT_TRUE(compiled->rules[0].clauses[0].regexes[2]);
+
+    /* run */
+    ASSERT_EQ(
+            LDi_evaluateCompiled(
+                    NULL,
+                    compiled,
+                    user,
+                    (struct LDStore *) 1,
+                    NULL,
+                    &details,
+                    &events,
+                    &result,
+                    LDBooleanFalse), EVAL_MATCH);
+
+    /* validate */
+    ASSERT_TRUE(LDGetBool(result));
+    ASSERT_FALSE(events);
+
+    LDi_compiledFlagFree(compiled);
+    LDJSONFree(flag);
+    LDJSONFree(result);
+    LDUserFree(user);
+    LDDetailsClear(&details);
+}
+
+TEST_F(EvalFixture, CompileFailsCleanlyWhenOutOfMemory) {
+    struct LDJSON *flag, *segment, *rules, *values, *clause;
+    struct LDCompiledFlag *compiledFlag;
+    struct LDCompiledSegment *compiledSegment;
+
+    ASSERT_TRUE(values = LDNewArray());
+    ASSERT_TRUE(LDArrayPush(values, LDNewText("@example\\.com$")));
+
+    ASSERT_TRUE(clause = LDNewObject());
+    ASSERT_TRUE(LDObjectSetKey(clause, "op", LDNewText("matches")));
+    ASSERT_TRUE(LDObjectSetKey(clause, "values", values));
+    ASSERT_TRUE(LDObjectSetKey(clause, "attribute", LDNewText("email")));
+
+    ASSERT_TRUE(flag = booleanFlagWithClause(clause));
+
+    /* a second rule, so that failures can occur between rules */
+    rules = LDObjectLookup(flag, "rules");
+    ASSERT_TRUE(LDArrayPush(rules, LDJSONDuplicate(LDArrayLookup(rules, 0))));
+
+    ASSERT_TRUE(segment = LDNewObject());
+    ASSERT_TRUE(LDObjectSetKey(segment, "key", LDNewText("segment")));
+    ASSERT_TRUE(LDObjectSetKey(segment, "rules", LDJSONDuplicate(rules)));
+
+    /* Every allocation is failed in turn, until compiling succeeds. */
+    ASSERT_GT(failAllocationsUntilSuccess([&]() {
+        return (compiledFlag = LDi_compileFlag(flag)) != NULL;
+    }), 2);
+    ASSERT_EQ(compiledFlag->ruleCount, 2);
+    LDi_compiledFlagFree(compiledFlag);
+
+    ASSERT_GT(failAllocationsUntilSuccess([&]() {
+        return (compiledSegment = LDi_compileSegment(segment)) != NULL;
+    }), 2);
+    ASSERT_EQ(compiledSegment->ruleCount, 2);
+    LDi_compiledSegmentFree(compiledSegment);
+
+    LDJSONFree(flag);
+    LDJSONFree(segment);
+}
+
 TEST_F(EvalFixture, SegmentMatchClauseRetrievesSegmentFromStore) {
     struct LDUser *user;
     struct LDStore *store;
@@ -1087,6 +1242,7 @@ TEST_F(EvalFixture, SegmentMatchClauseRetrievesSegmentFromStore) {
                     flag,
                     user,
                     store,
+                    NULL,
                     &details,
                     &events,
                     &result,
@@ -1103,6 +1259,188 @@ TEST_F(EvalFixture, SegmentMatchClauseRetrievesSegmentFromStore) {
     LDDetailsClear(&details);
 }
 
+TEST_F(EvalFixture, SegmentMatchIsMemoizedByContext) {
+    struct LDUser *user;
+    struct LDStore *store;
+    struct LDJSON *segment, *flag, *result, *included, *values, *clause,
+            *events;
+    struct LDDetails details;
+    struct LDEvaluationContext *context;
+
+    result = NULL;
+    events = NULL;
+    LDDetailsInit(&details);
+
+    ASSERT_TRUE(user = LDUserNew("foo"));
+    ASSERT_TRUE(context = LDi_evaluationContextNew());
+
+    ASSERT_TRUE(included = LDNewArray());
+    ASSERT_TRUE(LDArrayPush(included, LDNewText("foo")));
+
+    ASSERT_TRUE(segment = LDNewObject());
+    ASSERT_TRUE(LDObjectSetKey(segment, "key", LDNewText("segkey")));
+    ASSERT_TRUE(LDObjectSetKey(segment, "included", included));
+    ASSERT_TRUE(LDObjectSetKey(segment, "version", LDNewNumber(3)));
+
+    ASSERT_TRUE(values = LDNewArray());
+    ASSERT_TRUE(LDArrayPush(values, LDNewText("segkey")));
+
+    ASSERT_TRUE(clause = LDNewObject());
+    ASSERT_TRUE(LDObjectSetKey(clause, "attribute", LDNewText("")));
+    ASSERT_TRUE(LDObjectSetKey(clause, "op", LDNewText("segmentMatch")));
+    ASSERT_TRUE(LDObjectSetKey(clause, "values", values));
+
+    ASSERT_TRUE(flag = booleanFlagWithClause(clause));
+
+    ASSERT_TRUE(store = prepareEmptyStore());
+    ASSERT_TRUE(LDStoreUpsert(store, LD_SEGMENT, segment));
+
+    ASSERT_EQ(EVAL_MATCH, LDi_evaluate(
+            NULL, flag, user, store, context, &details, &events, &result,
+            LDBooleanFalse));
+    ASSERT_TRUE(LDGetBool(result));
+    LDJSONFree(result);
+    result = NULL;
+    LDDetailsClear(&details);
+
+    /* the context remembers the match after the segment is gone */
+    ASSERT_TRUE(LDStoreRemove(store, LD_SEGMENT, "segkey", 4));
+
+    ASSERT_EQ(EVAL_MATCH, LDi_evaluate(
+            NULL, flag, user, store, context, &details, &events, &result,
+            LDBooleanFalse));
+    ASSERT_TRUE(LDGetBool(result));
+    LDJSONFree(result);
+    result = NULL;
+    LDDetailsClear(&details);
+
+    ASSERT_EQ(EVAL_MATCH, LDi_evaluate(
+            NULL, flag, user, store, NULL, &details, &events, &result,
+            LDBooleanFalse));
+    ASSERT_FALSE(LDGetBool(result));
+    ASSERT_FALSE(events);
+
+    LDi_evaluationContextFree(context);
+    LDJSONFree(flag);
+    LDJSONFree(result);
+    LDStoreDestroy(store);
+    LDUserFree(user);
+    LDDetailsClear(&details);
+}
+
+TEST_F(EvalFixture, ContextKeepsManyMemos) {
+    struct LDEvaluationContext *context;
+    EvalStatus status;
+    int i;
+
+    ASSERT_TRUE(context = LDi_evaluationContextNew());
+
+    /* enough to outgrow the first block of the context several times */
+    for (i = 0; i < 1000; i++) {
+        const std::string key = "segment-" + std::to_string(i);
+
+        LDi_evaluationContextAddSegment(
+            context, key.c_str(), i % 2 ? EVAL_MATCH : EVAL_MISS);
+    }
+
+    for (i = 0; i < 1000; i++) {
+        const std::string key = "segment-" + std::to_string(i);
+
+        ASSERT_TRUE(LDi_evaluationContextFindSegment(
+            context, key.c_str(), &status));
+        ASSERT_EQ(i % 2 ? EVAL_MATCH : EVAL_MISS, status);
+    }
+
+    ASSERT_FALSE(LDi_evaluationContextFindSegment(context, "other", &status));
+    ASSERT_TRUE(LDi_evaluationContextAlloc(context, 100000));
+
+    LDi_evaluationContextFree(context);
+}
+
+static struct LDJSON *
+flagMatchingUserKey(const char *const flagKey, const char *const userKey) {
+    struct LDJSON *flag, *values, *clause;
+
+    LD_ASSERT(values = LDNewArray());
+    LD_ASSERT(LDArrayPush(values, LDNewText(userKey)));
+
+    LD_ASSERT(clause = LDNewObject());
+    LD_ASSERT(LDObjectSetKey(clause, "attribute", LDNewText("key")));
+    LD_ASSERT(LDObjectSetKey(clause, "op", LDNewText("in")));
+    LD_ASSERT(LDObjectSetKey(clause, "values", values));
+
+    LD_ASSERT(flag = booleanFlagWithClause(clause));
+    LD_ASSERT(LDObjectSetKey(flag, "key", LDNewText(flagKey)));
+    LD_ASSERT(LDObjectSetKey(flag, "version", LDNewNumber(1)));
+
+    return flag;
+}
+
+TEST_F(EvalFixture, ScratchDetailsAndPrerequisitesLiveInContext) {
+    struct LDUser *user;
+    struct LDStore *store;
+    struct LDJSON *flag, *result, *events;
+    struct LDJSONRC *flagRC;
+    struct LDDetails details;
+    struct LDEvaluationContext *context;
+    struct LDClient *client;
+    struct LDConfig *config;
+    const struct LDPrerequisiteResult *prerequisite;
+
+    result = NULL;
+    events = NULL;
+    LDDetailsInit(&details);
+
+    ASSERT_TRUE(config = LDConfigNew("abc"));
+    ASSERT_TRUE(client = LDClientInit(config, 0));
+    ASSERT_TRUE(user = LDUserNew("userKeyA"));
+    ASSERT_TRUE(context = LDi_evaluationContextNew());
+
+    ASSERT_TRUE(store = prepareEmptyStore());
+    ASSERT_TRUE(LDStoreUpsert(
+        store, LD_FLAG, flagMatchingUserKey("prereq", "userKeyA")));
+
+    ASSERT_TRUE(flag = flagMatchingUserKey("feature", "userKeyA"));
+    addPrerequisite(flag, "prereq", 1);
+    ASSERT_TRUE(flagRC = LDJSONRCNew(flag));
+
+    /* The rule ids of the flag and its prerequisite are copied into the
+     * context, and the prerequisite event is not built. */
+    ASSERT_EQ(EVAL_MATCH, LDi_evaluateRCScratch(
+            client, flagRC, user, store, context, &details, NULL, &result,
+            LDBooleanTrue));
+    ASSERT_TRUE(LDGetBool(result));
+    ASSERT_EQ(LD_RULE_MATCH, details.reason);
+    ASSERT_STREQ("rule-id", details.extra.rule.id);
+
+    ASSERT_TRUE(prerequisite =
+        LDi_evaluationContextFindPrerequisite(context, "prereq"));
+    ASSERT_EQ(LD_RULE_MATCH, prerequisite->details.reason);
+    ASSERT_STREQ("rule-id", prerequisite->details.extra.rule.id);
+    ASSERT_FALSE(prerequisite->events);
+
+    LDJSONFree(result);
+    result = NULL;
+    LDDetailsInit(&details);
+
+    /* Without a context, the details are the caller's to clear. */
+    ASSERT_EQ(EVAL_MATCH, LDi_evaluateRC(
+            client, flagRC, user, store, NULL, &details, &events, &result,
+            LDBooleanTrue));
+    ASSERT_STREQ("rule-id", details.extra.rule.id);
+    ASSERT_TRUE(events);
+    ASSERT_EQ(1, LDCollectionGetSize(events));
+
+    LDi_evaluationContextFree(context);
+    LDJSONRCRelease(flagRC);
+    LDJSONFree(result);
+    LDJSONFree(events);
+    LDStoreDestroy(store);
+    LDUserFree(user);
+    LDDetailsClear(&details);
+    LDClientClose(client);
+}
+
 TEST_F(EvalFixture, SegmentMatchClauseFallsThroughIfSegmentNotFound) {
     struct LDUser *user;
     struct LDStore *store;
@@ -1136,6 +1474,7 @@ TEST_F(EvalFixture, SegmentMatchClauseFallsThroughIfSegmentNotFound) {
                     flag,
                     user,
                     store,
+                    NULL,
                     &details,
                     &events,
                     &result,
@@ -1197,6 +1536,7 @@ TEST_F(EvalFixture, CanMatchJustOneSegmentFromList) {
                     flag,
                     user,
                     store,
+                    NULL,
                     &details,
                     &events,
                     &result,
@@ -1279,6 +1619,25 @@ TEST_F(EvalFixture, BucketUserWithSeed) {
     LDUserFree(user);
 }
 
+TEST_F(EvalFixture, BucketUserNegativeSeedAndLongKey) {
+    float bucket;
+    struct LDUser *user;
+    int seed;
+
+    seed = -61;
+
+    ASSERT_TRUE(user = LDUserNew("userKeyA"));
+    ASSERT_TRUE(LDi_bucketUser(user, "hashKey", "key", "saltyA", &seed, &bucket));
+    ASSERT_TRUE(floateq(0.817202032, bucket));
+    LDUserFree(user);
+
+    /* the hashed input is longer than any fixed buffer */
+    ASSERT_TRUE(user = LDUserNew(std::string(300, 'k').c_str()));
+    ASSERT_TRUE(LDi_bucketUser(user, "hashKey", "key", "saltyA", NULL, &bucket));
+    ASSERT_TRUE(floateq(0.671786308, bucket));
+    LDUserFree(user);
+}
+
 TEST_F(EvalFixture, InExperimentExplanation) {
     struct LDUser *user;
     struct LDJSON *flag, *result, *events, *fallthrough, *rollout, *variations,
@@ -1318,6 +1677,7 @@ TEST_F(EvalFixture, InExperimentExplanation) {
                     flag,
                     user,
                     (struct LDStore *) 1,
+                    NULL,
                     &details,
                     &events,
                     &result,
@@ -1377,6 +1737,7 @@ TEST_F(EvalFixture, NotInExperimentExplanation) {
                     flag,
                     user,
                     (struct LDStore *) 1,
+                    NULL,
                     &details,
                     &events,
                     &result,
@@ -1437,6 +1798,7 @@ TEST_F(EvalFixture, RolloutCustomSeed) {
                     flag,
                     user,
                     (struct LDStore *) 1,
+                    NULL,
                     &details,
                     &events,
                     &result,
@@ -1480,6 +1842,7 @@ TEST_F(EvalFixture, MalformedOffVariationIndexReturnsError) {
                     flag,
                     user,
                     (struct LDStore *) 1,
+                    NULL,
                     &details,
                     &events,
                     &result,
@@ -1525,6 +1888,7 @@ TEST_F(EvalFixture, MalformedOnVariationIndexReturnsError) {
                     flag,
                     user,
                     (struct LDStore *) 1,
+                    NULL,
                     &details,
                     &events,
                     &result,
@@ -1,13 +1,20 @@
 #include "gtest/gtest.h"
 #include "commonfixture.h"
 
+#include <atomic>
+#include <thread>
+
 extern "C" {
+#include <stdlib.h>
+#include <string.h>
+
 #include <launchdarkly/api.h>
 
 #include "client.h"
 #include "event_processor.h"
 #include "event_processor_internal.h"
 #include "store.h"
+#include "summary_counters.h"
 
 #include "test-utils/client.h"
 #include "test-utils/flags.h"
@@ -308,6 +315,176 @@ TEST_F(EventProcessorFixture, CounterForNilVariationIsDistinctFromOthers) {
     LDEventProcessor_Destroy(processor);
 }
 
+TEST_F(EventProcessorFixture, SummaryCountersAreKeyedByVersion) {
+    struct LDSummaryCounters *counters;
+    struct LDJSON *value, *features, *counterEntry;
+    const unsigned int variation = 1;
+    const double version1 = 11, version2 = 12;
+    int i;
+
+    ASSERT_TRUE(counters = LDi_summaryCountersNew());
+    ASSERT_TRUE(LDi_summaryCountersIsEmpty(counters));
+    ASSERT_TRUE(value = LDNewText("value"));
+
+    for (i = 0; i < 1000; i++) {
+        ASSERT_TRUE(LDi_summaryCountersAdd(
+                counters, "key1", &variation, &version1, value, NULL, LDBooleanFalse));
+    }
+    ASSERT_TRUE(LDi_summaryCountersAdd(
+            counters, "key1", &variation, &version2, value, NULL, LDBooleanFalse));
+    ASSERT_FALSE(LDi_summaryCountersIsEmpty(counters));
+
+    ASSERT_TRUE(features = LDi_summaryCountersToJSON(counters));
+    ASSERT_EQ(1, LDCollectionGetSize(features));
+    ASSERT_FALSE(LDObjectLookup(LDObjectLookup(features, "key1"), "default"));
+    ASSERT_TRUE(counterEntry = LDObjectLookup(LDObjectLookup(features, "key1"), "counters"));
+    ASSERT_EQ(2, LDCollectionGetSize(counterEntry));
+
+    ASSERT_TRUE(counterEntry = LDGetIter(counterEntry));
+    ASSERT_EQ(1000, LDGetNumber(LDObjectLookup(counterEntry, "count")));
+    ASSERT_EQ(11, LDGetNumber(LDObjectLookup(counterEntry, "version")));
+    ASSERT_TRUE(LDJSONCompare(value, LDObjectLookup(counterEntry, "value")));
+
+    ASSERT_TRUE(counterEntry = LDIterNext(counterEntry));
+    ASSERT_EQ(1, LDGetNumber(LDObjectLookup(counterEntry, "count")));
+    ASSERT_EQ(12, LDGetNumber(LDObjectLookup(counterEntry, "version")));
+
+    LDJSONFree(value);
+    LDJSONFree(features);
+    LDi_summaryCountersFree(counters);
+}
+
+TEST_F(EventProcessorFixture, FailedFlushKeepsCapacity) {
+    struct LDUser *user;
+    struct LDConfig *config;
+    struct LDEventProcessor *processor;
+    struct LDJSON *flag, *value, *event, *payload;
+    const unsigned int variation = 1;
+
+    ASSERT_TRUE(user = LDUserNew("abc"));
+    ASSERT_TRUE(config = LDConfigNew("key"));
+    LDConfigSetEventsCapacity(config, 2);
+    ASSERT_TRUE(processor = LDEventProcessor_Create(config));
+
+    ASSERT_TRUE(
+            flag = makeMinimalFlag("key1", 11, LDBooleanTrue, LDBooleanFalse));
+    ASSERT_TRUE(value = LDNewText("value"));
+    ASSERT_TRUE(
+            event = LDi_newFeatureEvent(
+                    "key1",
+                    user,
+                    &variation,
+                    value,
+                    value,
+                    NULL,
+                    flag,
+                    NULL,
+                    timestampZero(),
+                    config->inlineUsersInEvents,
+                    config->allAttributesPrivate,
+                    config->privateAttributeNames
+            ));
+    ASSERT_TRUE(LDi_summarizeEvent(processor, event, LDBooleanFalse));
+    LDJSONFree(event);
+
+    LDi_addEvent(processor, LDi_newBaseEvent("custom", timestampZero()));
+    LDi_addEvent(processor, LDi_newBaseEvent("custom", timestampZero()));
+
+    /* Every allocation of the flush fails in turn. A failed flush keeps its
+     * events queued, and counted once. */
+    ASSERT_GT(failAllocationsUntilSuccess([&]() {
+        return LDEventProcessor_CreateEventPayloadAndResetState(
+            processor, &payload) == LDBooleanTrue;
+    }), 1);
+    /* two events and the summary */
+    ASSERT_EQ(LDCollectionGetSize(payload), 3);
+    LDJSONFree(payload);
+
+    /* the capacity is available again, and still enforced */
+    LDi_addEvent(processor, LDi_newBaseEvent("custom", timestampZero()));
+    LDi_addEvent(processor, LDi_newBaseEvent("custom", timestampZero()));
+    LDi_addEvent(processor, LDi_newBaseEvent("custom", timestampZero()));
+
+    ASSERT_TRUE(LDEventProcessor_CreateEventPayloadAndResetState(
+        processor, &payload));
+    ASSERT_EQ(LDCollectionGetSize(payload), 2);
+    LDJSONFree(payload);
+
+    LDJSONFree(flag);
+    LDJSONFree(value);
+    LDUserFree(user);
+    LDConfigFree(config);
+    LDEventProcessor_Destroy(processor);
+}
+
+// Events added while a payload is built, including during the summary, are
+// counted exactly once, so the count returns to zero once they are all sent.
+TEST_F(EventProcessorFixture, ConcurrentFlushCountsEventsOnce) {
+    struct LDUser *user;
+    struct LDConfig *config;
+    struct LDEventProcessor *processor;
+    struct LDJSON *flag, *value, *event, *payload;
+    const unsigned int variation = 1;
+    std::atomic<bool> adding(true);
+
+    ASSERT_TRUE(user = LDUserNew("abc"));
+    ASSERT_TRUE(config = LDConfigNew("key"));
+    LDConfigSetEventsCapacity(config, 1000000);
+    ASSERT_TRUE(processor = LDEventProcessor_Create(config));
+
+    ASSERT_TRUE(
+            flag = makeMinimalFlag("key1", 11, LDBooleanTrue, LDBooleanFalse));
+    ASSERT_TRUE(value = LDNewText("value"));
+    ASSERT_TRUE(
+            event = LDi_newFeatureEvent(
+                    "key1",
+                    user,
+                    &variation,
+                    value,
+                    value,
+                    NULL,
+                    flag,
+                    NULL,
+                    timestampZero(),
+                    config->inlineUsersInEvents,
+                    config->allAttributesPrivate,
+                    config->privateAttributeNames
+            ));
+
+    std::thread adder([&]() {
+        int i;
+
+        for (i = 0; i < 20000; i++) {
+            LDi_summarizeEvent(processor, event, LDBooleanFalse);
+            LDi_addEvent(
+                processor, LDi_newBaseEvent("custom", timestampZero()));
+        }
+
+        adding = false;
+    });
+
+    while (adding) {
+        EXPECT_TRUE(LDEventProcessor_CreateEventPayloadAndResetState(
+            processor, &payload));
+        LDJSONFree(payload);
+    }
+
+    adder.join();
+
+    ASSERT_TRUE(LDEventProcessor_CreateEventPayloadAndResetState(
+        processor, &payload));
+    LDJSONFree(payload);
+
+    ASSERT_EQ(0, LDi_getQueuedEventCount(processor));
+
+    LDJSONFree(event);
+    LDJSONFree(flag);
+    LDJSONFree(value);
+    LDUserFree(user);
+    LDConfigFree(config);
+    LDEventProcessor_Destroy(processor);
+}
+
 TEST_F(EventProcessorFixture, TrackQueued) {
     const char *key;
     struct LDClient *client;
@@ -601,6 +778,60 @@ TEST_F(EventProcessorFixture, ExperimentationFallthroughNonDetailed) {
     LDClientClose(client);
 }
 
+TEST_F(EventProcessorFixture, FeatureEventRecordDecidesTracking) {
+    struct LDConfig *config;
+    struct LDClient *client;
+    struct LDJSON *flag, *value;
+    struct LDUser *user;
+    struct LDDetails details;
+    struct EvaluationResult result;
+    struct LDFeatureEventRecord record;
+    struct LDTimestamp now;
+
+    ASSERT_TRUE(config = LDConfigNew("api_key"));
+    ASSERT_TRUE(client = LDClientInit(config, 0));
+    ASSERT_TRUE(user = LDUserNew("user"));
+    ASSERT_TRUE(value = LDNewNumber(51));
+    ASSERT_TRUE(LDTimestamp_InitNow(&now));
+
+    ASSERT_TRUE(flag = makeMinimalFlag("flag", 11, LDBooleanTrue, LDBooleanFalse));
+
+    memset(&details, 0, sizeof(details));
+    LDDetailsInit(&details);
+    details.reason         = LD_FALLTHROUGH;
+    details.hasVariation   = LDBooleanTrue;
+    details.variationIndex = 2;
+
+    memset(&result, 0, sizeof(result));
+    result.user          = user;
+    result.flagKey       = "flag";
+    result.actualValue   = value;
+    result.fallbackValue = value;
+    result.flag          = flag;
+    result.details       = &details;
+
+    ASSERT_TRUE(LDi_makeFeatureEventRecord(&result, now, &record));
+    ASSERT_STREQ("flag", record.flagKey);
+    ASSERT_TRUE(record.hasVersion);
+    ASSERT_EQ(11, record.version);
+    ASSERT_TRUE(record.hasVariation);
+    ASSERT_EQ(2, record.variation);
+    ASSERT_FALSE(record.trackEvents);
+    ASSERT_FALSE(LDi_featureEventRecordIsQueued(client->eventProcessor, &record));
+
+    details.extra.fallthrough.inExperiment = LDBooleanTrue;
+
+    ASSERT_TRUE(LDi_makeFeatureEventRecord(&result, now, &record));
+    ASSERT_TRUE(record.trackEvents);
+    ASSERT_TRUE(LDi_featureEventRecordIsQueued(client->eventProcessor, &record));
+
+    LDDetailsClear(&details);
+    LDJSONFree(flag);
+    LDJSONFree(value);
+    LDUserFree(user);
+    LDClientClose(client);
+}
+
 TEST_F(EventProcessorFixture, ExperimentationRuleNonDetailed) {
     struct LDConfig *config;
     struct LDClient *client;
@@ -1,10 +1,16 @@
 #include "gtest/gtest.h"
 #include "commonfixture.h"
 
+#include <string>
+
 extern "C" {
 #include <string.h>
 #include <time.h>
 
+#ifdef LAUNCHDARKLY_EVENT_COMPRESSION
+#include <zlib.h>
+#endif
+
 #include <launchdarkly/api.h>
 
 #include "client.h"
@@ -75,3 +81,72 @@ TEST_F(EventsFixture, ParseServerTimeHeaderBad) {
 
     LDClientClose(client);
 }
+
+#ifdef LAUNCHDARKLY_EVENT_COMPRESSION
+TEST_F(EventsFixture, CompressEvents) {
+    struct LDJSON *events, *event, *decompressed;
+    char *compressed, *expected;
+    size_t compressedSize;
+    unsigned int i;
+    z_stream stream;
+    std::string text(1 << 20, '\0');
+
+    ASSERT_TRUE(events = LDNewArray());
+
+    for (i = 0; i < 1000; i++) {
+        ASSERT_TRUE(event = LDNewObject());
+        ASSERT_TRUE(LDObjectSetKey(event, "kind", LDNewText("custom")));
+        ASSERT_TRUE(LDObjectSetKey(event, "index", LDNewNumber(i)));
+        ASSERT_TRUE(LDArrayPush(events, event));
+    }
+
+    ASSERT_TRUE(LDi_compressEvents(events, &compressed, &compressedSize));
+    ASSERT_TRUE(expected = LDJSONSerialize(events));
+    ASSERT_LT(compressedSize, strlen(expected));
+
+    memset(&stream, 0, sizeof(stream));
+    ASSERT_EQ(inflateInit2(&stream, 15 + 16), Z_OK);
+    stream.next_in = (Bytef *)compressed;
+    stream.avail_in = (uInt)compressedSize;
+    stream.next_out = (Bytef *)&text[0];
+    stream.avail_out = (uInt)text.size();
+    ASSERT_EQ(inflate(&stream, Z_FINISH), Z_STREAM_END);
+    text.resize(stream.total_out);
+    inflateEnd(&stream);
+
+    ASSERT_EQ(text, expected);
+    ASSERT_TRUE(decompressed = LDJSONDeserialize(text.c_str()));
+    ASSERT_TRUE(LDJSONCompare(decompressed, events));
+
+    LDFree(compressed);
+    LDFree(expected);
+    LDJSONFree(decompressed);
+    LDJSONFree(events);
+}
+
+TEST_F(EventsFixture, CompressNoEvents) {
+    struct LDJSON *events;
+    char *compressed;
+    size_t compressedSize;
+    char text[16];
+    z_stream stream;
+
+    ASSERT_TRUE(events = LDNewArray());
+    ASSERT_TRUE(LDi_compressEvents(events, &compressed, &compressedSize));
+
+    memset(&stream, 0, sizeof(stream));
+    ASSERT_EQ(inflateInit2(&stream, 15 + 16), Z_OK);
+    stream.next_in = (Bytef *)compressed;
+    stream.avail_in = (uInt)compressedSize;
+    stream.next_out = (Bytef *)text;
+    stream.avail_out = sizeof(text);
+    ASSERT_EQ(inflate(&stream, Z_FINISH), Z_STREAM_END);
+    inflateEnd(&stream);
+
+    ASSERT_EQ(stream.total_out, 2);
+    ASSERT_EQ(0, memcmp(text, "[]", 2));
+
+    LDFree(compressed);
+    LDJSONFree(events);
+}
+#endif
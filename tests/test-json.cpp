@@ -1,6 +1,8 @@
 #include "gtest/gtest.h"
 #include "commonfixture.h"
 
+#include <string>
+
 extern "C" {
 #include <string.h>
 
@@ -269,3 +271,83 @@ TEST_F(JSONFixture, ObjectSetDefensiveChecks) {
     LDJSONFree(object);
     LDJSONFree(notObject);
 }
+
+// Objects past a size threshold are indexed, which must not change what
+// lookups find as keys are set, deleted and detached.
+TEST_F(JSONFixture, LargeObjectLookups) {
+    struct LDJSON *object, *copy, *item;
+    unsigned int   i;
+
+    ASSERT_TRUE(object = LDNewObject());
+
+    for (i = 0; i < 1000; i++) {
+        ASSERT_TRUE(LDObjectSetKey(
+            object, ("key-" + std::to_string(i)).c_str(), LDNewNumber(i)));
+    }
+
+    ASSERT_TRUE(LDObjectSetKey(object, "key-10", LDNewNumber(-10)));
+    LDObjectDeleteKey(object, "key-20");
+    ASSERT_TRUE(item = LDObjectDetachKey(object, "key-30"));
+    ASSERT_EQ(LDGetNumber(item), 30);
+    LDJSONFree(item);
+
+    ASSERT_EQ(LDCollectionGetSize(object), 998);
+
+    for (i = 0; i < 1000; i++) {
+        item = LDObjectLookup(object, ("key-" + std::to_string(i)).c_str());
+
+        if (i == 20 || i == 30) {
+            ASSERT_FALSE(item);
+        } else {
+            ASSERT_TRUE(item);
+            ASSERT_EQ(LDGetNumber(item), i == 10 ? -10.0 : (double)i);
+        }
+    }
+
+    ASSERT_FALSE(LDObjectLookup(object, "key-1000"));
+
+    ASSERT_TRUE(copy = LDJSONDuplicate(object));
+    ASSERT_TRUE(LDJSONCompare(object, copy));
+    ASSERT_EQ(LDGetNumber(LDObjectLookup(copy, "key-999")), 999);
+
+    // Detaching every item empties the index as well.
+    while ((item = LDGetIter(copy))) {
+        LDJSONFree(LDCollectionDetachIter(copy, item));
+    }
+
+    ASSERT_FALSE(LDObjectLookup(copy, "key-999"));
+    ASSERT_TRUE(LDObjectSetKey(copy, "key-999", LDNewNumber(1)));
+    ASSERT_EQ(LDGetNumber(LDObjectLookup(copy, "key-999")), 1);
+
+    LDJSONFree(copy);
+    LDJSONFree(object);
+}
+
+TEST_F(JSONFixture, LargeObjectDuplicateKeys) {
+    struct LDJSON *object;
+    std::string    text;
+    unsigned int   i;
+
+    text = "{\"a\":1";
+
+    for (i = 0; i < 100; i++) {
+        text += ",\"key-" + std::to_string(i) + "\":" + std::to_string(i);
+    }
+
+    text += ",\"a\":2,\"a\":3}";
+
+    ASSERT_TRUE(object = LDJSONDeserialize(text.c_str()));
+
+    // As with a walk of the object, the first item with a key is found.
+    ASSERT_EQ(LDGetNumber(LDObjectLookup(object, "a")), 1);
+    LDJSONFree(LDObjectDetachKey(object, "a"));
+    ASSERT_EQ(LDGetNumber(LDObjectLookup(object, "a")), 2);
+    LDObjectDeleteKey(object, "a");
+    ASSERT_EQ(LDGetNumber(LDObjectLookup(object, "a")), 3);
+    LDObjectDeleteKey(object, "a");
+    ASSERT_FALSE(LDObjectLookup(object, "a"));
+
+    ASSERT_EQ(LDGetNumber(LDObjectLookup(object, "key-50")), 50);
+
+    LDJSONFree(object);
+}
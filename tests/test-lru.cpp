@@ -1,6 +1,8 @@
 #include "gtest/gtest.h"
 #include "commonfixture.h"
 
+#include <string>
+
 extern "C" {
 #include <launchdarkly/api.h>
 
@@ -64,3 +66,39 @@ TEST_F(LRUFixture, ZeroCapacityAlwaysNew) {
 
     LDLRUFree(lru);
 }
+
+TEST_F(LRUFixture, EvictsOldestUnreferenced) {
+    struct LDLRU *lru;
+    unsigned int  i;
+
+    ASSERT_TRUE(lru = LDLRUInit(100));
+
+    // Without repeated keys, eviction is first in first out, which moves
+    // entries around the table many times over.
+    for (i = 0; i < 10000; i++) {
+        ASSERT_EQ(LDLRUSTATUS_NEW,
+            LDLRUInsert(lru, ("user-" + std::to_string(i)).c_str()));
+    }
+
+    for (i = 9900; i < 10000; i++) {
+        ASSERT_EQ(LDLRUSTATUS_EXISTED,
+            LDLRUInsert(lru, ("user-" + std::to_string(i)).c_str()));
+    }
+
+    ASSERT_EQ(LDLRUSTATUS_NEW, LDLRUInsert(lru, "user-9899"));
+
+    LDLRUFree(lru);
+}
+
+TEST_F(LRUFixture, ClearForgetsKeys) {
+    struct LDLRU *lru;
+
+    ASSERT_TRUE(lru = LDLRUInit(10));
+
+    ASSERT_EQ(LDLRUSTATUS_NEW, LDLRUInsert(lru, "123"));
+    LDLRUClear(lru);
+    ASSERT_EQ(LDLRUSTATUS_NEW, LDLRUInsert(lru, "123"));
+    ASSERT_EQ(LDLRUSTATUS_EXISTED, LDLRUInsert(lru, "123"));
+
+    LDLRUFree(lru);
+}
@@ -0,0 +1,142 @@
+#include "gtest/gtest.h"
+#include "commonfixture.h"
+
+extern "C" {
+#include <string.h>
+
+#include <launchdarkly/api.h>
+
+#include "assertion.h"
+#include "client.h"
+#include "network.h"
+#include "polling.h"
+#include "store.h"
+#include "utility.h"
+}
+
+class PollingFixture : public CommonFixture {
+    struct LDConfig *config;
+
+protected:
+    struct LDClient *client;
+    struct NetworkInterface *networkInterface;
+    struct PollContext *context;
+
+    void SetUp() override {
+        CommonFixture::SetUp();
+        LD_ASSERT(config = LDConfigNew("key"));
+        LDConfigSetUseLDD(config, LDBooleanTrue);
+        LDConfigSetSendEvents(config, LDBooleanFalse);
+        LD_ASSERT(client = LDClientInit(config, 0));
+        LD_ASSERT(networkInterface = LDi_constructPolling(client));
+        context = (struct PollContext *) networkInterface->context;
+    }
+
+    void TearDown() override {
+        networkInterface->destroy(networkInterface->context);
+        LDFree(networkInterface);
+        LDClientClose(client);
+        CommonFixture::TearDown();
+    }
+
+    void header(const char *const line) {
+        ASSERT_EQ(strlen(line),
+            LDi_pollHeaderCallback(line, 1, strlen(line), context));
+    }
+
+    void body(const char *const payload) {
+        LDFree(context->memory);
+        ASSERT_TRUE(context->memory = LDStrDup(payload));
+        context->size = strlen(payload);
+    }
+
+    double flagVersion(const char *const key) {
+        struct LDJSONRC *flag;
+        double version;
+
+        if (!LDStoreGet(client->store, LD_FLAG, key, &flag) || !flag) {
+            return 0;
+        }
+
+        version = LDGetNumber(LDObjectLookup(LDJSONRCGet(flag), "version"));
+
+        LDJSONRCRelease(flag);
+
+        return version;
+    }
+};
+
+static const char *const payloadVersion2 =
+    "{\"flags\": {\"my-flag\": {\"key\": \"my-flag\", \"version\": 2}},"
+    "\"segments\": {}}";
+
+TEST_F(PollingFixture, HeaderNameIsCaseInsensitive) {
+    header("etag: \"abc\"\r\n");
+
+    ASSERT_STREQ("\"abc\"", context->responseEtag);
+}
+
+TEST_F(PollingFixture, HeaderValueIsTrimmed) {
+    header("ETag: \t W/\"abc\" \t\r\n");
+
+    ASSERT_STREQ("W/\"abc\"", context->responseEtag);
+}
+
+TEST_F(PollingFixture, HeaderWithoutValueIsIgnored) {
+    header("ETag:\r\n");
+    ASSERT_FALSE(context->responseEtag);
+
+    header("ETag:  \r\n");
+    ASSERT_FALSE(context->responseEtag);
+}
+
+TEST_F(PollingFixture, OtherHeadersAreIgnored) {
+    header("Content-Type: application/json\r\n");
+    header("ETags: \"abc\"\r\n");
+    header("HTTP/1.1 200 OK\r\n");
+
+    ASSERT_FALSE(context->responseEtag);
+}
+
+TEST_F(PollingFixture, EtagAdoptedAfterStoreUpdate) {
+    header("ETag: \"v2\"\r\n");
+    body(payloadVersion2);
+
+    networkInterface->done(client, context, 200);
+
+    ASSERT_STREQ("\"v2\"", context->etag);
+    ASSERT_FALSE(context->responseEtag);
+    ASSERT_EQ(2, flagVersion("my-flag"));
+}
+
+TEST_F(PollingFixture, EtagClearedWhenStoreUpdateFails) {
+    header("ETag: \"v2\"\r\n");
+    body(payloadVersion2);
+    networkInterface->done(client, context, 200);
+    ASSERT_STREQ("\"v2\"", context->etag);
+
+    header("ETag: \"v3\"\r\n");
+    body("{\"flags\": ");
+    networkInterface->done(client, context, 200);
+
+    ASSERT_FALSE(context->etag);
+    ASSERT_FALSE(context->responseEtag);
+    ASSERT_EQ(2, flagVersion("my-flag"));
+}
+
+TEST_F(PollingFixture, NotModifiedLeavesStoreUntouched) {
+    header("ETag: \"v2\"\r\n");
+    body(payloadVersion2);
+    networkInterface->done(client, context, 200);
+
+    /* anything received with a 304 is discarded */
+    header("ETag: \"v3\"\r\n");
+    body(
+        "{\"flags\": {\"my-flag\": {\"key\": \"my-flag\", \"version\": 3}},"
+        "\"segments\": {}}");
+    networkInterface->done(client, context, 304);
+
+    ASSERT_STREQ("\"v2\"", context->etag);
+    ASSERT_FALSE(context->responseEtag);
+    ASSERT_EQ(2, flagVersion("my-flag"));
+}
@@ -2,6 +2,8 @@
 #include "commonfixture.h"
 
 extern "C" {
+#include <stdio.h>
+
 #include <launchdarkly/api.h>
 
 #include "assertion.h"
@@ -79,6 +81,46 @@ TEST_F(SegmentsFixture, ExplicitExcludeUser) {
     LDUserFree(user);
 }
 
+TEST_F(SegmentsFixture, ExplicitIncludeAmongManyKeys) {
+    struct LDUser *included, *other;
+    struct LDJSON *segment, *tmp;
+    struct LDCompiledSegment *compiled;
+    char key[32];
+    int i;
+
+    /* users */
+    ASSERT_TRUE(included = LDUserNew("user-999"));
+    ASSERT_TRUE(other = LDUserNew("user-1000"));
+
+    /* segment */
+    ASSERT_TRUE(segment = LDNewObject());
+    ASSERT_TRUE(LDObjectSetKey(segment, "key", LDNewText("test")));
+    ASSERT_TRUE(LDObjectSetKey(segment, "salt", LDNewText("abcdef")));
+    ASSERT_TRUE(LDObjectSetKey(segment, "version", LDNewNumber(1)));
+    ASSERT_TRUE(LDObjectSetKey(segment, "deleted", LDNewBool(LDBooleanFalse)));
+
+    ASSERT_TRUE(tmp = LDNewArray());
+    /* Elements which are not text never match. */
+    ASSERT_TRUE(LDArrayPush(tmp, LDNewNumber(5)));
+    for (i = 0; i < 1000; i++) {
+        snprintf(key, sizeof(key), "user-%d", i);
+        ASSERT_TRUE(LDArrayPush(tmp, LDNewText(key)));
+    }
+    /* Duplicates are tolerated. */
+    ASSERT_TRUE(LDArrayPush(tmp, LDNewText("user-999")));
+    ASSERT_TRUE(LDObjectSetKey(segment, "included", tmp));
+
+    /* run */
+    ASSERT_TRUE(compiled = LDi_compileSegment(segment));
+    ASSERT_EQ(LDi_segmentMatchesUserCompiled(compiled, included), EVAL_MATCH);
+    ASSERT_EQ(LDi_segmentMatchesUserCompiled(compiled, other), EVAL_MISS);
+
+    LDi_compiledSegmentFree(compiled);
+    LDJSONFree(segment);
+    LDUserFree(included);
+    LDUserFree(other);
+}
+
 TEST_F(SegmentsFixture, ExplicitIncludeHasPrecedence) {
     struct LDUser *user;
     struct LDJSON *segment, *tmp;
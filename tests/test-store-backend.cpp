@@ -2,6 +2,9 @@
 #include "commonfixture.h"
 #include "concurrencyfixture.h"
 
+#include <atomic>
+#include <string>
+
 extern "C" {
 #include <string.h>
 
@@ -9,6 +12,7 @@ extern "C" {
 
 #include "assertion.h"
 #include "store.h"
+#include "store/store_utilities.h"
 #include "utility.h"
 
 #include "test-utils/flags.h"
@@ -105,12 +109,16 @@ makeMockFailInterface() {
 }
 
 static struct LDStore *
-prepareStore(struct LDStoreInterface *const handle, unsigned int storeCacheMilliseconds = 30000) {
+prepareStore(
+        struct LDStoreInterface *const handle,
+        unsigned int storeCacheMilliseconds = 30000,
+        LDBoolean refreshAhead = LDBooleanFalse) {
     struct LDStore *store;
     struct LDConfig *config;
 
     LD_ASSERT(config = LDConfigNew(""));
     config->storeCacheMilliseconds = storeCacheMilliseconds;
+    config->storeRefreshAhead = refreshAhead;
 
     if (handle) {
         LDConfigSetFeatureStoreBackend(config, handle);
@@ -622,6 +630,72 @@ TEST_F(StoreBackendFixture, AllCache) {
     LDStoreDestroy(store);
 }
 
+TEST_F(StoreBackendFixture, RefreshAhead) {
+    struct LDStore *store;
+    struct LDStoreInterface *handle;
+    struct LDJSON *full;
+    struct LDJSONRC *item, *values;
+    unsigned int i;
+
+    ASSERT_TRUE(full = LDNewObject());
+    ASSERT_TRUE(LDObjectSetKey(
+            full, "abc", makeMinimalFlag("abc", 13, LDBooleanTrue, LDBooleanTrue)));
+
+    staticGetKey = "abc";
+    staticGetCount = 0;
+    ASSERT_TRUE(
+            staticGetValue =
+                    makeMinimalFlag("abc", 12, LDBooleanTrue, LDBooleanTrue));
+    staticAllValue = full;
+    staticAllCount = 0;
+
+    ASSERT_TRUE(handle = makeMockFailInterface());
+    handle->get = mockStaticGet;
+    handle->all = mockStaticAll;
+    ASSERT_TRUE(store = prepareStore(handle, 100, LDBooleanTrue));
+
+    ASSERT_TRUE(LDStoreGet(store, LD_FLAG, "abc", &item));
+    ASSERT_TRUE(item);
+    ASSERT_EQ(LDi_getDataVersion(LDJSONRCGet(item)), 12);
+    LDJSONRCRelease(item);
+
+    // The refresher replaces the item with the version it reads from the backend.
+    for (i = 0; i < 100; i++) {
+        ASSERT_TRUE(LDStoreGet(store, LD_FLAG, "abc", &item));
+        ASSERT_TRUE(item);
+
+        if (LDi_getDataVersion(LDJSONRCGet(item)) == 13) {
+            LDJSONRCRelease(item);
+            break;
+        }
+
+        LDJSONRCRelease(item);
+        LDi_sleepMilliseconds(20);
+    }
+    ASSERT_LT(i, 100);
+
+    // Expired items are still served from the cache.
+    LDi_expireAll(store);
+    ASSERT_TRUE(LDStoreGet(store, LD_FLAG, "abc", &item));
+    ASSERT_TRUE(item);
+    LDJSONRCRelease(item);
+
+    ASSERT_TRUE(LDStoreAll(store, LD_FLAG, &values));
+    ASSERT_TRUE(LDJSONCompare(LDJSONRCGet(values), full));
+    LDJSONRCRelease(values);
+
+    ASSERT_EQ(staticGetCount, 1);
+
+    LDStoreDestroy(store);
+
+    ASSERT_GE(staticAllCount, 1);
+
+    LDJSONFree(staticGetValue);
+    staticGetValue = NULL;
+    LDJSONFree(full);
+    staticAllValue = NULL;
+}
+
 // It was previously possible to encounter a double-free when calling LDStoreInitialized,
 // triggered by LDi_deleteAndRemoveCacheItem.
 // LDStoreInitialized did not hold a write-lock while removing the INIT_CHECKED_KEY item, which could end up
@@ -650,3 +724,120 @@ TEST_F(ConcurrencyFixture, TestStoreInitializedDoubleFree) {
         }
     });
 }
+
+static std::atomic<unsigned int> slowGetCount;
+
+static LDBoolean
+mockSlowGet(
+        void *const context,
+        const char *const kind,
+        const char *const featureKey,
+        struct LDStoreCollectionItem *const result) {
+    slowGetCount++;
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    return mockStaticGet(context, kind, featureKey, result);
+}
+
+// When a cached item expires, only one of the threads evaluating it should query the backend. The others are
+// served the expired item until the refresh completes.
+TEST_F(ConcurrencyFixture, TestStoreGetRefreshesExpiredItemOnce) {
+    struct LDStore *store;
+    struct LDStoreInterface *handle;
+    struct LDJSONRC *item;
+
+    ASSERT_TRUE(handle = makeMockFailInterface());
+    handle->get = mockSlowGet;
+    ASSERT_TRUE(store = prepareStore(handle));
+
+    ASSERT_TRUE(
+            staticGetValue =
+                    makeMinimalFlag("abc", 12, LDBooleanTrue, LDBooleanTrue));
+    staticGetKey = "abc";
+    slowGetCount = 0;
+
+    ASSERT_TRUE(LDStoreGet(store, LD_FLAG, "abc", &item));
+    ASSERT_TRUE(item);
+    LDJSONRCRelease(item);
+    ASSERT_EQ(slowGetCount, 1);
+
+    LDi_expireAll(store);
+
+    RunMany(20, [=]() {
+        struct LDJSONRC *result = NULL;
+
+        EXPECT_TRUE(LDStoreGet(store, LD_FLAG, "abc", &result));
+        EXPECT_TRUE(result);
+        LDJSONRCRelease(result);
+    });
+
+    for (std::thread& t : pool) {
+        t.join();
+    }
+
+    ASSERT_EQ(slowGetCount, 2);
+
+    LDJSONFree(staticGetValue);
+    staticGetValue = NULL;
+    LDStoreDestroy(store);
+}
+
+// Readers of the memory store take no lock, and use whichever snapshot is published. Each reader must only ever
+// see versions move forward, while the items it read before a write stay valid after it.
+TEST_F(ConcurrencyFixture, TestMemoryStoreReadersDuringWrites) {
+    struct LDStore *store;
+    struct LDConfig *config;
+    std::atomic<bool> writing(true);
+
+    ASSERT_TRUE(config = LDConfigNew(""));
+    ASSERT_TRUE(store = LDStoreNew(config));
+    LDConfigFree(config);
+
+    ASSERT_TRUE(LDStoreInitEmpty(store));
+
+    RunMany(4, [&]() {
+        double lastFlag = 0, lastSegment = 0;
+
+        while (writing) {
+            struct LDJSONRC *flag, *segment, *all;
+            double version;
+
+            EXPECT_TRUE(LDStoreGet(store, LD_FLAG, "a", &flag));
+            if (flag) {
+                version = LDGetNumber(LDObjectLookup(LDJSONRCGet(flag), "version"));
+                EXPECT_LE(lastFlag, version);
+                lastFlag = version;
+            }
+
+            EXPECT_TRUE(LDStoreGet(store, LD_SEGMENT, "s", &segment));
+            if (segment) {
+                version = LDGetNumber(LDObjectLookup(LDJSONRCGet(segment), "version"));
+                EXPECT_LE(lastSegment, version);
+                lastSegment = version;
+            }
+
+            EXPECT_TRUE(LDStoreAll(store, LD_FLAG, &all));
+            EXPECT_TRUE(all);
+
+            LDJSONRCRelease(flag);
+            LDJSONRCRelease(segment);
+            LDJSONRCRelease(all);
+        }
+    });
+
+    for (unsigned int version = 1; version <= 200; version++) {
+        EXPECT_TRUE(LDStoreUpsert(store, LD_FLAG, makeMinimalFlag("a", version, LDBooleanTrue, LDBooleanFalse)));
+        EXPECT_TRUE(LDStoreUpsert(store, LD_SEGMENT, makeMinimalFlag("s", version, LDBooleanTrue, LDBooleanFalse)));
+        EXPECT_TRUE(LDStoreUpsert(store, LD_FLAG, makeMinimalFlag(
+                std::to_string(version).c_str(), 1, LDBooleanTrue, LDBooleanFalse)));
+    }
+
+    writing = false;
+
+    for (std::thread& t : pool) {
+        t.join();
+    }
+
+    LDStoreDestroy(store);
+}
@@ -0,0 +1,52 @@
+#include "gtest/gtest.h"
+#include "commonfixture.h"
+
+extern "C" {
+#include <launchdarkly/api.h>
+
+#include "store/store_utilities.h"
+}
+
+// Inherit from the CommonFixture to give a reasonable name for the test output.
+// Any custom setup and teardown would happen in this derived class.
+class StoreUtilitiesFixture : public CommonFixture {
+};
+
+TEST_F(StoreUtilitiesFixture, SerializedVersionScanned) {
+    unsigned int version = 0;
+
+    ASSERT_TRUE(LDi_getSerializedDataVersion(
+        "{\"key\":\"a\",\"version\":12,\"deleted\":false}", &version));
+    ASSERT_EQ(version, 12);
+
+    ASSERT_TRUE(LDi_getSerializedDataVersion(
+        " { \"version\" : 3 } ", &version));
+    ASSERT_EQ(version, 3);
+}
+
+TEST_F(StoreUtilitiesFixture, SerializedVersionSkipsNestedFields) {
+    unsigned int version = 0;
+
+    ASSERT_TRUE(LDi_getSerializedDataVersion(
+        "{\"rules\":[{\"version\":1,\"x\":\"}\\\"{\"}],"
+        "\"name\":\"version\",\"o\":{\"version\":2},\"version\":7}",
+        &version));
+    ASSERT_EQ(version, 7);
+}
+
+TEST_F(StoreUtilitiesFixture, SerializedVersionFallsBackToParsing) {
+    unsigned int version = 99;
+
+    ASSERT_TRUE(LDi_getSerializedDataVersion(
+        "{\"vers\\u0069on\":4}", &version));
+    ASSERT_EQ(version, 4);
+
+    ASSERT_TRUE(LDi_getSerializedDataVersion("{\"key\":\"a\"}", &version));
+    ASSERT_EQ(version, 0);
+
+    ASSERT_TRUE(LDi_getSerializedDataVersion(
+        "{\"version\":\"5\"}", &version));
+    ASSERT_EQ(version, 0);
+
+    ASSERT_FALSE(LDi_getSerializedDataVersion("{\"key\":", &version));
+}
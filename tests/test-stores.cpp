@@ -188,6 +188,36 @@ TEST_P(CommonStoreFixture, UpsertUpdatesAll) {
     LDJSONFree(all);
 }
 
+TEST_P(CommonStoreFixture, StoredItemsAreCompiled) {
+    struct LDJSONRC *result;
+    struct LDJSON *all, *category;
+
+    ASSERT_TRUE(all = LDNewObject());
+    ASSERT_TRUE(category = LDNewObject());
+    ASSERT_TRUE(LDObjectSetKey(all, "features", category));
+    ASSERT_TRUE(LDObjectSetKey(category, "a", makeVersioned("a", 32)));
+    ASSERT_TRUE(LDObjectSetKey(category, "b", makeVersioned("b", 51)));
+
+    ASSERT_TRUE(LDStoreInit(store, all));
+    ASSERT_TRUE(LDStoreUpsert(store, LD_FLAG, makeVersioned("c", 1)));
+
+    ASSERT_TRUE(LDStoreGet(store, LD_FLAG, "a", &result));
+    ASSERT_TRUE(result);
+    ASSERT_TRUE(LDJSONRCGetCompiled(result));
+    LDJSONRCRelease(result);
+
+    ASSERT_TRUE(LDStoreGet(store, LD_FLAG, "c", &result));
+    ASSERT_TRUE(result);
+    ASSERT_TRUE(LDJSONRCGetCompiled(result));
+    LDJSONRCRelease(result);
+
+    ASSERT_TRUE(LDStoreAll(store, LD_FLAG, &result));
+    ASSERT_TRUE(result);
+    ASSERT_EQ(3, LDJSONRCGetAssociatedCount(result));
+    ASSERT_TRUE(LDJSONRCGetCompiled(LDJSONRCGetAssociated(result, 0)));
+    LDJSONRCRelease(result);
+}
+
 TEST_P(CommonStoreFixture, DeletedOnly) {
     struct LDJSONRC *lookup;
 
@@ -228,6 +258,101 @@ TEST_P(CommonStoreFixture, BasicDoesNotExist) {
     ASSERT_FALSE(lookup);
 }
 
+TEST_P(CommonStoreFixture, ReinitKeepsRetainedItems) {
+    struct LDJSON *all, *category, *feature1Copy, *feature2Copy;
+    struct LDJSONRC *lookup1, *lookup2;
+
+    ASSERT_TRUE(all = LDNewObject());
+    ASSERT_TRUE(category = LDNewObject());
+    ASSERT_TRUE(LDObjectSetKey(all, "features", category));
+    ASSERT_TRUE(feature1Copy = makeVersioned("a", 1));
+    ASSERT_TRUE(LDObjectSetKey(category, "a", LDJSONDuplicate(feature1Copy)));
+    ASSERT_TRUE(LDStoreInit(store, all));
+
+    ASSERT_TRUE(LDStoreGet(store, LD_FLAG, "a", &lookup1));
+    ASSERT_TRUE(lookup1);
+
+    ASSERT_TRUE(all = LDNewObject());
+    ASSERT_TRUE(category = LDNewObject());
+    ASSERT_TRUE(LDObjectSetKey(all, "features", category));
+    ASSERT_TRUE(feature2Copy = makeVersioned("a", 2));
+    ASSERT_TRUE(LDObjectSetKey(category, "a", LDJSONDuplicate(feature2Copy)));
+    ASSERT_TRUE(LDStoreInit(store, all));
+
+    /* The item retained before the re-init is unaffected by it. */
+    ASSERT_TRUE(LDJSONCompare(LDJSONRCGet(lookup1), feature1Copy));
+
+    ASSERT_TRUE(LDStoreGet(store, LD_FLAG, "a", &lookup2));
+    ASSERT_TRUE(lookup2);
+    ASSERT_TRUE(LDJSONCompare(LDJSONRCGet(lookup2), feature2Copy));
+
+    LDJSONFree(feature1Copy);
+    LDJSONFree(feature2Copy);
+    LDJSONRCRelease(lookup1);
+    LDJSONRCRelease(lookup2);
+}
+
+static struct LDJSON *
+makeSets(const unsigned int aVersion, const unsigned int bVersion) {
+    struct LDJSON *all, *category;
+
+    LD_ASSERT(all = LDNewObject());
+    LD_ASSERT(category = LDNewObject());
+    LD_ASSERT(LDObjectSetKey(all, "features", category));
+    LD_ASSERT(LDObjectSetKey(category, "a", makeVersioned("a", aVersion)));
+
+    if (bVersion) {
+        LD_ASSERT(LDObjectSetKey(category, "b", makeVersioned("b", bVersion)));
+    }
+
+    LD_ASSERT(LDObjectSetKey(all, "segments", LDNewObject()));
+
+    return all;
+}
+
+TEST_P(CommonStoreFixture, UpdateUpsertsOnlyNewer) {
+    struct LDJSONRC *before, *after;
+
+    ASSERT_TRUE(LDStoreUpdate(store, makeSets(1, 1)));
+    ASSERT_TRUE(LDStoreInitialized(store));
+
+    ASSERT_TRUE(LDStoreGet(store, LD_FLAG, "a", &before));
+    ASSERT_TRUE(before);
+
+    ASSERT_TRUE(LDStoreUpdate(store, makeSets(1, 2)));
+
+    ASSERT_TRUE(LDStoreGet(store, LD_FLAG, "b", &after));
+    ASSERT_TRUE(after);
+    ASSERT_EQ(2, LDGetNumber(LDObjectLookup(LDJSONRCGet(after), "version")));
+    LDJSONRCRelease(after);
+
+    /* the unchanged flag was not replaced */
+    ASSERT_TRUE(LDStoreGet(store, LD_FLAG, "a", &after));
+    ASSERT_TRUE(after);
+    ASSERT_TRUE(LDJSONCompare(LDJSONRCGet(before), LDJSONRCGet(after)));
+    if (GetParam().first == "MemoryStore") {
+        ASSERT_EQ(before, after);
+    }
+
+    LDJSONRCRelease(before);
+    LDJSONRCRelease(after);
+}
+
+TEST_P(CommonStoreFixture, UpdateWithRemovedItem) {
+    struct LDJSONRC *lookup;
+
+    ASSERT_TRUE(LDStoreUpdate(store, makeSets(1, 1)));
+    ASSERT_TRUE(LDStoreUpdate(store, makeSets(2, 0)));
+
+    ASSERT_TRUE(LDStoreGet(store, LD_FLAG, "b", &lookup));
+    ASSERT_FALSE(lookup);
+
+    ASSERT_TRUE(LDStoreGet(store, LD_FLAG, "a", &lookup));
+    ASSERT_TRUE(lookup);
+    ASSERT_EQ(2, LDGetNumber(LDObjectLookup(LDJSONRCGet(lookup), "version")));
+    LDJSONRCRelease(lookup);
+}
+
 TEST_P(CommonStoreFixture, UpsertNewer) {
     struct LDJSON *feature, *featureCopy;
     struct LDJSONRC *lookup;
@@ -98,6 +98,46 @@ TEST_F(StreamingFixtureWithContext, InitialPut) {
     LDJSONRCRelease(segment);
 }
 
+TEST_F(StreamingFixtureWithContext, PutInSmallChunks) {
+    struct LDJSONRC *flag, *segment;
+    size_t i;
+
+    const char *const event =
+            "event: put\n"
+            "data: {\"path\": \"/\", \"data\": {\"flags\": {\"my-\\\"flag\":"
+            "{\"key\": \"my-\\\"flag\", \"version\": 2, \"variations\": "
+            "[\"a}\", {\"b\": [1]}]}}, \"extra\": [{\"c\": null}], "
+            "\"segments\": {\"my-segment\": {\"key\": \"my-segment\", "
+            "\"version\": 5}}}}\n\n";
+
+    for (i = 0; i < strlen(event); i += 7) {
+        const size_t size = strlen(event) - i < 7 ? strlen(event) - i : 7;
+
+        ASSERT_EQ(LDi_streamWriteCallback(event + i, size, 1, context), size);
+    }
+
+    ASSERT_TRUE(LDStoreGet(context->client->store, LD_FLAG, "my-\"flag", &flag));
+    ASSERT_TRUE(flag);
+    ASSERT_EQ(LDGetNumber(LDObjectLookup(LDJSONRCGet(flag), "version")), 2);
+    ASSERT_EQ(LDCollectionGetSize(LDObjectLookup(LDJSONRCGet(flag), "variations")), 2);
+
+    ASSERT_TRUE(
+            LDStoreGet(context->client->store, LD_SEGMENT, "my-segment", &segment));
+    ASSERT_TRUE(segment);
+
+    LDJSONRCRelease(flag);
+    LDJSONRCRelease(segment);
+}
+
+TEST_F(StreamingFixtureWithContext, PutWithInvalidItem) {
+    const char *const event =
+            "event: put\n"
+            "data: {\"path\": \"/\", \"data\": {\"flags\": {\"my-flag\":"
+            "{\"key\": \"my-flag\", \"version\": }},\"segments\": {}}}\n\n";
+
+    ASSERT_FALSE(LDi_streamWriteCallback(event, strlen(event), 1, context));
+}
+
 TEST_F(StreamingFixtureWithContext, PatchFlag) {
     struct LDJSONRC *flag;
 
@@ -470,3 +470,63 @@ TEST_F(VariationsFixture, TestNullOffVariationInPrerequisiteDoesNotCauseUseAfter
     LDClientClose(client);
 
 }
+
+TEST_F(VariationsFixture, VariationBatch) {
+    struct LDClient *client;
+    struct LDUser *user;
+    struct LDJSON *flag, *def, *payload, *summary, *features;
+    struct LDJSON *fallbacks[3], *results[3];
+    struct LDDetails details[3];
+    const char *keys[3] = {"flag1", "flag2", "missing"};
+    unsigned int i;
+    /* setup */
+    ASSERT_TRUE(client = makeTestClient());
+    ASSERT_TRUE(user = LDUserNew("userkey"));
+    ASSERT_TRUE(LDStoreInitEmpty(client->store));
+    /* flags */
+    ASSERT_TRUE(flag = makeMinimalFlag("flag1", 1, LDBooleanTrue, LDBooleanFalse));
+    addVariation(flag, LDNewBool(LDBooleanFalse));
+    addVariation(flag, LDNewBool(LDBooleanTrue));
+    setFallthrough(flag, 1);
+    LDStoreUpsert(client->store, LD_FLAG, flag);
+    ASSERT_TRUE(flag = makeMinimalFlag("flag2", 1, LDBooleanTrue, LDBooleanFalse));
+    addVariation(flag, LDNewText("a"));
+    addVariation(flag, LDNewText("b"));
+    setFallthrough(flag, 0);
+    LDStoreUpsert(client->store, LD_FLAG, flag);
+    /* fallbacks */
+    ASSERT_TRUE(fallbacks[0] = LDNewBool(LDBooleanFalse));
+    ASSERT_TRUE(fallbacks[1] = LDNewText("fallback"));
+    ASSERT_TRUE(def = LDNewText("default"));
+    fallbacks[2] = def;
+    /* run */
+    ASSERT_TRUE(LDVariationBatch(
+        client, user, keys, fallbacks, 3, results, details));
+    /* validate */
+    ASSERT_EQ(LDGetBool(results[0]), LDBooleanTrue);
+    ASSERT_EQ(details[0].reason, LD_FALLTHROUGH);
+    ASSERT_STREQ(LDGetText(results[1]), "a");
+    ASSERT_EQ(details[1].reason, LD_FALLTHROUGH);
+    ASSERT_TRUE(LDJSONCompare(results[2], def));
+    ASSERT_NE(results[2], def);
+    ASSERT_EQ(details[2].reason, LD_ERROR);
+    ASSERT_EQ(details[2].extra.errorKind, LD_FLAG_NOT_FOUND);
+    /* every evaluation is summarized, with a single index event */
+    ASSERT_TRUE(LDEventProcessor_CreateEventPayloadAndResetState(
+        client->eventProcessor, &payload));
+    ASSERT_EQ(LDCollectionGetSize(payload), 2);
+    ASSERT_STREQ(LDGetText(LDObjectLookup(LDArrayLookup(payload, 0), "kind")), "index");
+    ASSERT_TRUE(summary = LDArrayLookup(payload, 1));
+    ASSERT_TRUE(features = LDObjectLookup(summary, "features"));
+    ASSERT_EQ(LDCollectionGetSize(features), 3);
+    ASSERT_TRUE(LDObjectLookup(features, "missing"));
+    /* cleanup */
+    for (i = 0; i < 3; i++) {
+        LDJSONFree(fallbacks[i]);
+        LDJSONFree(results[i]);
+        LDDetailsClear(&details[i]);
+    }
+    LDJSONFree(payload);
+    LDUserFree(user);
+    LDClientClose(client);
+}